@@ -0,0 +1,43 @@
+// alloc_counter.h
+// Replaces the global operator new/delete with malloc-backed versions that count every
+// allocation (frame_arena.h: heapAllocations). Include it from exactly one translation
+// unit of a program; the game does in debug builds, tools/alloc_check always.
+
+#pragma once
+
+#include "frame_arena.h"
+
+#include <cstdlib>
+#include <new>
+
+inline const bool heapAllocationsInstalled = (heapAllocationsCounted = true);
+
+void* operator new(std::size_t n) {
+    ++heapAllocationsThread;
+    heapAllocationsTotal.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, std::align_val_t a) {
+    ++heapAllocationsThread;
+    heapAllocationsTotal.fetch_add(1, std::memory_order_relaxed);
+    size_t align = std::max(sizeof(void*), (size_t)a);
+    void* p = nullptr;
+    if (posix_memalign(&p, align, n ? n : 1) == 0) return p;
+    throw std::bad_alloc();
+}
+
+// GCC pairs the malloc above with these frees after inlining and warns, wrongly:
+// this operator new and this delete are the matching pair.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
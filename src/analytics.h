@@ -0,0 +1,183 @@
+// analytics.h
+// Metrics computed while re-simulating replays (tools/replay_stats) and the
+// compact result files they produce. Each worker thread owns a clone() of every
+// metric; the clones are merged once at the end, so nothing is shared while
+// replays run.
+//
+// Adding a metric: derive from ReplayMetric, implement the hooks plus
+// clone/merge/report, and registerMetric() it before the run.
+
+#pragma once
+
+#include "replay.h"
+#include "finesse.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// --------------------------- METRIC INTERFACE ----------------------------
+class ReplayMetric : public ReplayObserver {
+public:
+    virtual const char* name() const = 0;
+    virtual std::unique_ptr<ReplayMetric> clone() const = 0;   // empty instance of the same metric
+    virtual void merge(const ReplayMetric& other) = 0;         // other is always the same type
+    virtual void report(std::ostream& os) const = 0;
+    virtual bool save(const std::string& /*dir*/) const { return true; }
+};
+
+inline std::vector<std::unique_ptr<ReplayMetric>>& metricRegistry() {
+    static std::vector<std::unique_ptr<ReplayMetric>> registry;
+    return registry;
+}
+
+inline void registerMetric(std::unique_ptr<ReplayMetric> m) { metricRegistry().push_back(std::move(m)); }
+
+inline const ReplayMetric* findMetric(const std::string& name) {
+    for (const auto& m : metricRegistry()) if (name == m->name()) return m.get();
+    return nullptr;
+}
+
+// Forwards the re-simulation hooks to a thread's metric clones.
+struct MetricSet : ReplayObserver {
+    std::vector<std::unique_ptr<ReplayMetric>> metrics;
+    void onStart(const GameState& g) override { for (auto& m : metrics) m->onStart(g); }
+    void onInput(const GameState& g, GameAction a) override { for (auto& m : metrics) m->onInput(g, a); }
+    void onPlace(const GameState& g, GameAction a) override { for (auto& m : metrics) m->onPlace(g, a); }
+    void onLock(const GameState& g, int piece, int lines) override { for (auto& m : metrics) m->onLock(g, piece, lines); }
+    void onEnd(const GameState& g, GameAction last) override { for (auto& m : metrics) m->onEnd(g, last); }
+};
+
+// --------------------------- HEATMAP FILE ----------------------------
+// "THMP" | u16 version | u16 width | u16 height | u16 reserved | u64 samples | u64 counts[height][width]
+struct Heatmap {
+    uint64_t samples = 0;
+    uint64_t cells[BOARD_H][BOARD_W] = {};
+};
+
+inline bool saveHeatmap(const std::string& path, const Heatmap& h) {
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'T','H','M','P'});
+    putU16(out, 1); putU16(out, BOARD_W); putU16(out, BOARD_H); putU16(out, 0);
+    auto putU64 = [&](uint64_t v) { for (int i = 0; i < 8; ++i) out.push_back((uint8_t)(v >> (8 * i))); };
+    putU64(h.samples);
+    for (int y = 0; y < BOARD_H; ++y) for (int x = 0; x < BOARD_W; ++x) putU64(h.cells[y][x]);
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+inline bool loadHeatmap(const std::string& path, Heatmap& h) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t hdr[20];
+    bool ok = std::fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) && std::memcmp(hdr, "THMP", 4) == 0 &&
+              getU16(hdr + 4) == 1 && getU16(hdr + 6) == BOARD_W && getU16(hdr + 8) == BOARD_H;
+    std::vector<uint8_t> body((size_t)BOARD_W * BOARD_H * 8);
+    ok = ok && std::fread(body.data(), 1, body.size(), f) == body.size();
+    std::fclose(f);
+    if (!ok) return false;
+    auto getU64 = [](const uint8_t* p) { return (uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32); };
+    h.samples = getU64(hdr + 12);
+    for (int y = 0; y < BOARD_H; ++y) for (int x = 0; x < BOARD_W; ++x) h.cells[y][x] = getU64(body.data() + (y * BOARD_W + x) * 8);
+    return true;
+}
+
+// --------------------------- BUILT-IN METRICS ----------------------------
+// Occupancy of every cell, sampled after each lock.
+class HeatmapMetric : public ReplayMetric {
+public:
+    Heatmap map;
+    const char* name() const override { return "heatmap"; }
+    std::unique_ptr<ReplayMetric> clone() const override { return std::unique_ptr<ReplayMetric>(new HeatmapMetric()); }
+    void onLock(const GameState& g, int, int) override {
+        ++map.samples;
+        for (int y = 0; y < BOARD_H; ++y) for (int x = 0; x < BOARD_W; ++x) map.cells[y][x] += g.board[y][x] != 0;
+    }
+    void merge(const ReplayMetric& other) override {
+        const Heatmap& o = static_cast<const HeatmapMetric&>(other).map;
+        map.samples += o.samples;
+        for (int y = 0; y < BOARD_H; ++y) for (int x = 0; x < BOARD_W; ++x) map.cells[y][x] += o.cells[y][x];
+    }
+    void report(std::ostream& os) const override {
+        os << "heatmap: " << map.samples << " samples (occupancy %, top row first)\n";
+        for (int y = 0; y < BOARD_H; ++y) {
+            os << "  ";
+            for (int x = 0; x < BOARD_W; ++x) {
+                int pct = map.samples ? (int)(100 * map.cells[y][x] / map.samples) : 0;
+                os << (pct < 10 ? "  " : (pct < 100 ? " " : "")) << pct << ' ';
+            }
+            os << '\n';
+        }
+    }
+    bool save(const std::string& dir) const override { return saveHeatmap(dir + "/heatmap.thmp", map); }
+};
+
+// How many locks cleared 0, 1, 2, 3 or 4 lines.
+class ClearTypeMetric : public ReplayMetric {
+public:
+    uint64_t counts[5] = {};
+    const char* name() const override { return "clears"; }
+    std::unique_ptr<ReplayMetric> clone() const override { return std::unique_ptr<ReplayMetric>(new ClearTypeMetric()); }
+    void onLock(const GameState&, int, int lines) override { ++counts[lines < 4 ? lines : 4]; }
+    void merge(const ReplayMetric& other) override {
+        for (int i = 0; i < 5; ++i) counts[i] += static_cast<const ClearTypeMetric&>(other).counts[i];
+    }
+    void report(std::ostream& os) const override {
+        static const char* names[5] = {"none", "single", "double", "triple", "tetris"};
+        os << "clears:";
+        for (int i = 0; i < 5; ++i) os << ' ' << names[i] << '=' << counts[i];
+        os << '\n';
+    }
+};
+
+// Why games ended: garbage pushed the stack out, a piece spawned into the stack
+// (split by piece), or the replay stopped before a top-out.
+class TopoutMetric : public ReplayMetric {
+public:
+    uint64_t spawnBlocked[PIECE_COUNT] = {};
+    uint64_t garbage = 0, unfinished = 0;
+    const char* name() const override { return "topout"; }
+    std::unique_ptr<ReplayMetric> clone() const override { return std::unique_ptr<ReplayMetric>(new TopoutMetric()); }
+    void onEnd(const GameState& g, GameAction last) override {
+        if (!g.gameOver) ++unfinished;
+        else if (last == ACT_GARBAGE) ++garbage;
+        else ++spawnBlocked[g.currentPieceIndex];
+    }
+    void merge(const ReplayMetric& other) override {
+        const TopoutMetric& o = static_cast<const TopoutMetric&>(other);
+        for (int i = 0; i < PIECE_COUNT; ++i) spawnBlocked[i] += o.spawnBlocked[i];
+        garbage += o.garbage;
+        unfinished += o.unfinished;
+    }
+    void report(std::ostream& os) const override {
+        static const char names[PIECE_COUNT] = {'I','O','T','S','Z','J','L'};
+        os << "topout: garbage=" << garbage << " unfinished=" << unfinished << " spawn-blocked:";
+        for (int i = 0; i < PIECE_COUNT; ++i) os << ' ' << names[i] << '=' << spawnBlocked[i];
+        os << '\n';
+    }
+};
+
+// Pieces typed with more shifts and turns than the placement needs (finesse.h).
+class FinesseMetric : public ReplayMetric {
+public:
+    FinesseCounter counter;
+    const char* name() const override { return "finesse"; }
+    std::unique_ptr<ReplayMetric> clone() const override { return std::unique_ptr<ReplayMetric>(new FinesseMetric()); }
+    void onStart(const GameState&) override { counter.keys = 0; counter.softDropped = counter.tucked = false; }
+    void onInput(const GameState& g, GameAction a) override { counter.onInput(g, a); }
+    void merge(const ReplayMetric& other) override { counter.merge(static_cast<const FinesseMetric&>(other).counter); }
+    void report(std::ostream& os) const override {
+        os << "finesse: " << counter.faults << " of " << counter.pieces << " pieces over par ("
+           << (counter.pieces ? 100.0 * counter.faults / counter.pieces : 0.0) << "%), " << counter.extraKeys << " extra keys\n";
+    }
+};
+
+inline void registerBuiltinMetrics() {
+    registerMetric(std::unique_ptr<ReplayMetric>(new HeatmapMetric()));
+    registerMetric(std::unique_ptr<ReplayMetric>(new ClearTypeMetric()));
+    registerMetric(std::unique_ptr<ReplayMetric>(new TopoutMetric()));
+    registerMetric(std::unique_ptr<ReplayMetric>(new FinesseMetric()));
+}
@@ -0,0 +1,265 @@
+// bitboard.h
+// Bit-packed board for bots: one uint16 mask per row (bit x = column x).
+// Placement rules mirror tetris_core.h exactly, and the heuristic features come
+// from popcount / count-zeros over column masks obtained with a movemask transpose
+// (SSE2 or NEON, scalar fallback). extractFeatures/evaluateBoards take whole
+// arrays of candidate boards so the search scores a move list in one call.
+
+#pragma once
+
+#include "tetris_core.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BITBOARD_SSE2 1
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define BITBOARD_SSSE3 1
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BITBOARD_NEON 1
+#endif
+
+static_assert(BOARD_W <= 16, "BitBoard rows are 16 bits wide");
+static_assert(BOARD_H <= 24, "BitBoard holds at most 24 rows");
+
+const int BITBOARD_ROWS = 24;                      // padded to whole SIMD registers, rows >= BOARD_H stay 0
+const uint16_t FULL_ROW = (uint16_t)((1u << BOARD_W) - 1);
+const uint32_t FULL_COL = (1u << BOARD_H) - 1;
+
+struct alignas(16) BitBoard {
+    uint16_t rows[BITBOARD_ROWS];
+};
+
+// Without POPCNT the builtin becomes a libgcc call; the SWAR version stays inline.
+#if defined(__POPCNT__) || defined(__aarch64__)
+inline int popcount32(uint32_t v) { return __builtin_popcount(v); }
+#else
+inline int popcount32(uint32_t v) {
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    return (int)((((v + (v >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24);
+}
+#endif
+inline int ctz32(uint32_t v) { return __builtin_ctz(v); }  // v != 0
+inline int clz32(uint32_t v) { return __builtin_clz(v); }  // v != 0
+
+// --------------------------- CONVERSION ----------------------------
+inline void toBitBoard(const Board& board, BitBoard& out) {
+    std::memset(&out, 0, sizeof(out));
+    for (int y = 0; y < BOARD_H; ++y) {
+        uint16_t r = 0;
+        for (int x = 0; x < BOARD_W; ++x) r |= (uint16_t)((board[y][x] != 0) << x);
+        out.rows[y] = r;
+    }
+}
+
+inline void fromBitBoard(const BitBoard& bb, Board& out) {
+    for (int y = 0; y < BOARD_H; ++y)
+        for (int x = 0; x < BOARD_W; ++x) out[y][x] = (bb.rows[y] >> x) & 1;
+}
+
+// --------------------------- RULES ----------------------------
+// Same semantics as isValidMove/tryRotate/mergePiece/clearLines in tetris_core.h.
+struct PieceBlocks {
+    glm::ivec2 b[4];
+    int n = 0;
+};
+
+inline PieceBlocks pieceBlocks(const std::vector<glm::ivec2>& blocks) {
+    PieceBlocks p;
+    for (const auto& b : blocks) p.b[p.n++] = b;
+    return p;
+}
+
+inline bool isValidMove(const BitBoard& bb, const glm::ivec2& pos, const PieceBlocks& p) {
+    for (int i = 0; i < p.n; ++i) {
+        int x = pos.x + p.b[i].x;
+        int y = pos.y + p.b[i].y;
+        if (x < 0 || x >= BOARD_W || y >= BOARD_H) return false;
+        if (y >= 0 && ((bb.rows[y] >> x) & 1)) return false;
+    }
+    return true;
+}
+
+inline bool isOPiece(const PieceBlocks& p) {
+    for (int i = 0; i < p.n; ++i)
+        if (!(p.b[i].x >= 0 && p.b[i].x <= 1 && p.b[i].y >= 0 && p.b[i].y <= 1)) return false;
+    return true;
+}
+
+inline bool tryRotate(const BitBoard& bb, PieceBlocks& p, glm::ivec2& pos) {
+    if (isOPiece(p)) return true;
+    PieceBlocks rotated = p;
+    for (int i = 0; i < rotated.n; ++i) { int nx = rotated.b[i].y; int ny = -rotated.b[i].x; rotated.b[i].x = nx; rotated.b[i].y = ny; }
+    static const glm::ivec2 kicks[] = {{0,0},{1,0},{-1,0},{0,1},{0,-1},{1,1},{-1,1},{1,-1},{-1,-1}};
+    for (auto &k : kicks) { glm::ivec2 q = pos + k; if (isValidMove(bb, q, rotated)) { p = rotated; pos = q; return true; } }
+    return false;
+}
+
+// Blocks of piece after rotation clockwise turns from its spawn orientation.
+inline PieceBlocks rotatedBlocks(int piece, int rotation) {
+    PieceBlocks p = pieceBlocks(PIECES[piece].blocks);
+    if (isOPiece(p)) return p;
+    for (int r = 0; r < (rotation & 3); ++r)
+        for (int i = 0; i < p.n; ++i) { int nx = p.b[i].y; int ny = -p.b[i].x; p.b[i].x = nx; p.b[i].y = ny; }
+    return p;
+}
+
+// Number of clockwise rotations from the spawn orientation that give blocks.
+inline int pieceRotation(int piece, const std::vector<glm::ivec2>& blocks) {
+    for (int r = 0; r < 4; ++r) {
+        PieceBlocks p = rotatedBlocks(piece, r);
+        bool same = p.n == (int)blocks.size();
+        for (int i = 0; i < p.n && same; ++i) same = p.b[i] == blocks[i];
+        if (same) return r;
+    }
+    return 0;
+}
+
+inline void mergePiece(BitBoard& bb, const glm::ivec2& pos, const PieceBlocks& p) {
+    for (int i = 0; i < p.n; ++i) {
+        int y = pos.y + p.b[i].y;
+        if (y >= 0) bb.rows[y] |= (uint16_t)(1u << (pos.x + p.b[i].x));
+    }
+}
+
+inline int clearLines(BitBoard& bb) {
+    int write = BOARD_H - 1;
+    for (int y = BOARD_H - 1; y >= 0; --y)
+        if (bb.rows[y] != FULL_ROW) bb.rows[write--] = bb.rows[y];
+    int cleared = write + 1;
+    for (int y = 0; y <= write; ++y) bb.rows[y] = 0;
+    return cleared;
+}
+
+// Cascade gravity on the bitboard (tetris_core.h CASCADE); same result as cascadeClear.
+inline int cascadeClearLines(BitBoard& bb, int* chains = nullptr) { return cascadeRows<uint16_t>(bb.rows, BOARD_H, FULL_ROW, chains); }
+
+// --------------------------- TRANSPOSE ----------------------------
+// cols[x] bit y == cell (x, y). Row 0 (top) is bit 0, so the highest block is ctz.
+inline void columnMasks(const BitBoard& bb, uint32_t cols[BOARD_W]) {
+#if defined(BITBOARD_SSE2)
+    const __m128i lowMask = _mm_set1_epi16(0xff);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i r0 = _mm_load_si128((const __m128i*)(bb.rows + 0));
+    __m128i r1 = _mm_load_si128((const __m128i*)(bb.rows + 8));
+    __m128i r2 = _mm_load_si128((const __m128i*)(bb.rows + 16));
+    // bytes = one row each; movemask picks bit 7 of every byte, add(v,v) walks the next column into bit 7
+    __m128i loA = _mm_packus_epi16(_mm_and_si128(r0, lowMask), _mm_and_si128(r1, lowMask));
+    __m128i loB = _mm_packus_epi16(_mm_and_si128(r2, lowMask), zero);
+    __m128i hiA = _mm_packus_epi16(_mm_srli_epi16(r0, 8), _mm_srli_epi16(r1, 8));
+    __m128i hiB = _mm_packus_epi16(_mm_srli_epi16(r2, 8), zero);
+    for (int x = 7; x >= 0; --x) {
+        if (x < BOARD_W) cols[x] = (uint32_t)_mm_movemask_epi8(loA) | ((uint32_t)_mm_movemask_epi8(loB) << 16);
+        if (x + 8 < BOARD_W) cols[x + 8] = (uint32_t)_mm_movemask_epi8(hiA) | ((uint32_t)_mm_movemask_epi8(hiB) << 16);
+        loA = _mm_add_epi8(loA, loA); loB = _mm_add_epi8(loB, loB);
+        hiA = _mm_add_epi8(hiA, hiA); hiB = _mm_add_epi8(hiB, hiB);
+    }
+#elif defined(BITBOARD_NEON)
+    static const int8_t laneShift[16] = {0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7};
+    const int8x16_t shifts = vld1q_s8(laneShift);
+    auto movemask = [&](uint8x16_t v) -> uint32_t {
+        uint8x16_t bits = vshlq_u8(vshrq_n_u8(v, 7), shifts);
+        return (uint32_t)vaddv_u8(vget_low_u8(bits)) | ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+    };
+    uint16x8_t r0 = vld1q_u16(bb.rows + 0), r1 = vld1q_u16(bb.rows + 8), r2 = vld1q_u16(bb.rows + 16);
+    uint8x16_t loA = vcombine_u8(vmovn_u16(r0), vmovn_u16(r1));
+    uint8x16_t loB = vcombine_u8(vmovn_u16(r2), vdup_n_u8(0));
+    uint8x16_t hiA = vcombine_u8(vshrn_n_u16(r0, 8), vshrn_n_u16(r1, 8));
+    uint8x16_t hiB = vcombine_u8(vshrn_n_u16(r2, 8), vdup_n_u8(0));
+    for (int x = 7; x >= 0; --x) {
+        if (x < BOARD_W) cols[x] = movemask(loA) | (movemask(loB) << 16);
+        if (x + 8 < BOARD_W) cols[x + 8] = movemask(hiA) | (movemask(hiB) << 16);
+        loA = vaddq_u8(loA, loA); loB = vaddq_u8(loB, loB);
+        hiA = vaddq_u8(hiA, hiA); hiB = vaddq_u8(hiB, hiB);
+    }
+#else
+    for (int x = 0; x < BOARD_W; ++x) cols[x] = 0;
+    for (int y = 0; y < BOARD_H; ++y)
+        for (uint32_t r = bb.rows[y]; r; r &= r - 1) cols[ctz32(r)] |= 1u << y;
+#endif
+}
+
+// Sum over all rows of horizontal filled/empty changes, walls count as filled.
+inline int rowTransitions(const BitBoard& bb) {
+    const uint32_t span = (1u << (BOARD_W + 1)) - 1;
+#if defined(BITBOARD_SSSE3)
+    // 8 rows per register, popcount via the 4-bit shuffle table
+    const __m128i nibbleCount = _mm_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m128i nib = _mm_set1_epi8(0x0f);
+    const __m128i walls = _mm_set1_epi16((short)(1 | (1u << (BOARD_W + 1))));
+    const __m128i spanV = _mm_set1_epi16((short)span);
+    __m128i acc = _mm_setzero_si128();
+    for (int y = 0; y < BITBOARD_ROWS; y += 8) {
+        __m128i p = _mm_or_si128(_mm_slli_epi16(_mm_load_si128((const __m128i*)(bb.rows + y)), 1), walls);
+        __m128i t = _mm_and_si128(_mm_xor_si128(p, _mm_srli_epi16(p, 1)), spanV);
+        __m128i c = _mm_add_epi8(_mm_shuffle_epi8(nibbleCount, _mm_and_si128(t, nib)),
+                                 _mm_shuffle_epi8(nibbleCount, _mm_and_si128(_mm_srli_epi16(t, 4), nib)));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(c, _mm_setzero_si128()));
+    }
+    // padded rows (y >= BOARD_H) are empty and contribute exactly 2 each
+    int total = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    return total - 2 * (BITBOARD_ROWS - BOARD_H);
+#else
+    int total = 0;
+    for (int y = 0; y < BOARD_H; ++y) {
+        uint32_t p = ((uint32_t)bb.rows[y] << 1) | 1u | (1u << (BOARD_W + 1));
+        total += popcount32((p ^ (p >> 1)) & span);
+    }
+    return total;
+#endif
+}
+
+// --------------------------- FEATURES ----------------------------
+struct BoardFeatures {
+    int heights[BOARD_W];
+    int aggregateHeight;
+    int maxHeight;
+    int holes;            // empty cells below the top of their column
+    int coveredCells;     // filled cells above the deepest hole of their column
+    int bumpiness;
+    int rowTransitions;
+    int colTransitions;   // floor counts as filled, the space above the well as empty
+    int wellSums;         // sum of 1+2+..+d over every vertical run of d well cells
+};
+
+inline void extractFeatures(const BitBoard& bb, BoardFeatures& f) {
+    uint32_t cols[BOARD_W];
+    columnMasks(bb, cols);
+    f.aggregateHeight = f.maxHeight = f.holes = f.coveredCells = f.bumpiness = f.colTransitions = f.wellSums = 0;
+    for (int x = 0; x < BOARD_W; ++x) {
+        uint32_t c = cols[x];
+        int top = c ? ctz32(c) : BOARD_H;
+        int h = BOARD_H - top;
+        f.heights[x] = h;
+        f.aggregateHeight += h;
+        if (h > f.maxHeight) f.maxHeight = h;
+        f.holes += h - popcount32(c);
+        uint32_t holeMask = ~c & FULL_COL & (~0u << top);
+        if (holeMask) {
+            int deepest = 31 - clz32(holeMask);
+            f.coveredCells += popcount32(c & ((1u << deepest) - 1));
+        }
+        uint32_t p = c | (1u << BOARD_H);
+        f.colTransitions += popcount32((p ^ (p << 1)) & ((2u << BOARD_H) - 1));
+        uint32_t left = x > 0 ? cols[x - 1] : FULL_COL;
+        uint32_t right = x + 1 < BOARD_W ? cols[x + 1] : FULL_COL;
+        for (uint32_t w = ~c & left & right & FULL_COL; w; w &= w >> 1) f.wellSums += popcount32(w);
+        if (x > 0) f.bumpiness += std::abs(h - f.heights[x - 1]);
+    }
+    f.rowTransitions = rowTransitions(bb);
+}
+
+// Batched form: one call per move list, prefetching the next board while scoring this one.
+inline void extractFeatures(const BitBoard* boards, int count, BoardFeatures* out) {
+    for (int i = 0; i < count; ++i) {
+        if (i + 1 < count) __builtin_prefetch(&boards[i + 1]);
+        extractFeatures(boards[i], out[i]);
+    }
+}
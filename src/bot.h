@@ -0,0 +1,359 @@
+// bot.h
+// CPU opponent: an anytime search over placements (bot_eval.h) that runs as background
+// jobs on the shared job system (jobs.h). The render loop only posts the search and
+// polls the published best move, it never waits on the workers.
+
+#pragma once
+
+#include "bot_eval.h"
+#include "jobs.h"
+#include "montecarlo.h"
+#include "perf_counters.h"
+#include "placement_cache.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <array>
+
+// --------------------------- ANYTIME SEARCH ----------------------------
+// Depth levels, each one a full pass over the candidate list ordered by the previous level:
+//   1: current piece only
+//   2: current + known next piece
+//   3: level 2 plus the average over the 7 possible pieces after that
+// Every finished candidate publishes into a lock-free per-level best, and the
+// caller takes the deepest level that has a result when the budget runs out.
+//
+// In MonteCarlo mode level 1 only orders the candidates; the rest of the budget
+// goes to rollouts (montecarlo.h) over the top MC_CANDIDATES, round-robin so
+// every candidate has about the same sample count whenever the budget expires.
+//
+// Network mode is the heuristic search with boards scored by a learned evaluator
+// (nn_eval.h, set with setNetwork) instead of the hand-tuned features.
+//
+// With a PlacementCache attached, heuristic searches are remembered per position: a
+// position some process already searched through every level is answered without
+// starting the workers, and a shallower search defers to a deeper cached entry.
+//
+// Searches live in a small ring allocated with the BotSearch, Monte Carlo sums
+// included, so starting one does not allocate. A ring entry is reused once every job
+// of its old search has returned; if none has, start() leaves the bot idle and the
+// caller tries again later.
+const int BOT_LEVELS = 3;
+const int BOT_TASK_RING = 4;
+const int MC_CANDIDATES = 8;
+const int MC_BATCH = 4;
+
+enum class BotEval { Heuristic, MonteCarlo, Network };
+
+struct BotStats {
+    int level = 0;          // deepest heuristic level used (MonteCarlo: 1, or 2 once rollouts decided)
+    long long rollouts = 0;
+    double seconds = 0.0;   // wall time from start() to poll()
+    bool cached = false;    // answered from the placement cache without searching
+    double rolloutsPerSecond() const { return seconds > 0.0 ? rollouts / seconds : 0.0; }
+};
+
+class BotSearch {
+public:
+    // threads: search jobs per piece, by default one per job system worker.
+    explicit BotSearch(int threads = 0) : searchers(threads > 0 ? threads : jobSystem().workerCount()), tasks(new SearchTask[BOT_TASK_RING]) {
+        for (int t = 0; t < BOT_TASK_RING; ++t) tasks[t].mc.reset(new McSlot[(size_t)searchers * MAX_PLACEMENTS]());
+    }
+    ~BotSearch() {
+        generation.fetch_add(1);   // every search still running or queued sees itself expired
+        while (active.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+    BotSearch(const BotSearch&) = delete;
+    BotSearch& operator=(const BotSearch&) = delete;
+
+    // Applies from the next start() on.
+    void setEval(BotEval e, const RolloutConfig& cfg = RolloutConfig()) { eval = e; rolloutConfig = cfg; }
+    BotEval evalMode() const { return eval; }
+    // Not owned; used by BotEval::Network (which falls back to the heuristic without one).
+    void setNetwork(const NnEval* n) { net = n; }
+    // Not owned; nullptr detaches. Applies from the next start() on.
+    void setCache(PlacementCache* c) { cache = c; }
+
+    // Enumerates candidates for the current piece and queues one background search job
+    // per searcher. Cheap (tens of microseconds); a newer start() expires the old jobs.
+    // Does nothing (busy() stays false) while every ring entry still has jobs running.
+    void start(const GameState& g, double budgetSeconds) {
+        generation.fetch_add(1);   // expire the previous search before looking for a free entry
+        SearchTask* job = nullptr;
+        for (int t = 0; t < BOT_TASK_RING && !job; ++t) {
+            SearchTask& cand = tasks[(nextTask + t) % BOT_TASK_RING];
+            if (cand.active.load(std::memory_order_acquire) == 0) { job = &cand; nextTask = (nextTask + t + 1) % BOT_TASK_RING; }
+        }
+        current = nullptr;
+        if (!job) return;
+        job->reset((size_t)searchers * MAX_PLACEMENTS);
+        job->nextPiece = g.nextPieceIndex;
+        job->cascade = g.cascade;
+        job->eval = eval;
+        job->net = eval == BotEval::Network ? net : nullptr;
+        job->rollout = rolloutConfig;
+        job->seed = g.pieceSerial * 0x9e3779b9u + (unsigned)g.currentPieceIndex;
+        job->started = Clock::now();
+        job->deadline = job->started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budgetSeconds));
+        BitBoard root;
+        toBitBoard(g.board, root);
+        forEachPlacement(root, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int lines) {
+            if (job->count >= MAX_PLACEMENTS) return;
+            Candidate& c = job->candidates[job->count++];
+            c.placement = p;
+            c.lines = lines;
+            c.board = after;
+        }, g.cascade);
+        for (auto& b : job->best) b.store(EMPTY, std::memory_order_relaxed);
+        current = job;
+        if (cache && eval == BotEval::Heuristic && !g.cascade) {  // cached entries assume plain clears
+            job->cache = cache;
+            job->key = placementKey(root, g.currentPieceIndex, g.nextPieceIndex);
+            CachedPlacement hit;
+            int idx;
+            if (cache->lookup(job->key, hit) && hit.levels >= BOT_LEVELS && (idx = job->find(hit.placement)) >= 0) {
+                publish(job->best[BOT_LEVELS - 1], hit.score, idx);
+                job->cached = true;
+                job->levelsDone.store(BOT_LEVELS, std::memory_order_release);
+                return;
+            }
+        }
+        unsigned myGen = generation.load(std::memory_order_relaxed);
+        JobSystem& js = jobSystem();
+        for (int i = 0; i < searchers; ++i) {
+            active.fetch_add(1, std::memory_order_relaxed);
+            job->active.fetch_add(1, std::memory_order_relaxed);
+            js.runBackground(js.create([this, job, myGen, i] {
+                search(*job, myGen, i);
+                job->active.fetch_sub(1, std::memory_order_release);
+                active.fetch_sub(1, std::memory_order_release);
+            }));
+        }
+    }
+
+    // Non-blocking. Returns true once the budget has expired (or every level finished),
+    // with the best placement found so far. Falls back to the first candidate if no
+    // worker got scheduled in time, so a move is always produced.
+    bool poll(Placement& out, BotStats* stats = nullptr) {
+        if (!current) return false;
+        const SearchTask& job = *current;
+        bool finished = job.levelsDone.load(std::memory_order_acquire) >= BOT_LEVELS;
+        Clock::time_point now = Clock::now();
+        if (!finished && now < job.deadline) return false;
+        out = job.count ? job.candidates[0].placement : Placement{0, spawnPosition().x};
+        BotStats st;
+        for (int l = BOT_LEVELS - 1; l >= 0; --l) {
+            uint64_t packed = job.best[l].load(std::memory_order_acquire);
+            if (packed != EMPTY) { out = job.candidates[packed & 0xffff].placement; st.level = l + 1; break; }
+        }
+        if (job.cache && !job.cached) remember(job, out, st);
+        st.cached = job.cached;
+        if (job.eval == BotEval::MonteCarlo) {
+            // best mean over every worker's private sums; candidates without samples are skipped
+            double bestMean = 0.0;
+            bool any = false;
+            for (int c = 0; c < job.count; ++c) {
+                long long sum = 0, n = 0;
+                for (size_t w = 0; w < (size_t)searchers; ++w) {
+                    const McSlot& slot = job.mc[w * MAX_PLACEMENTS + c];
+                    n += slot.count.load(std::memory_order_acquire);
+                    sum += slot.sum.load(std::memory_order_relaxed);
+                }
+                st.rollouts += n;
+                if (n == 0) continue;
+                double mean = (double)sum / (double)n;
+                if (!any || mean > bestMean) { bestMean = mean; out = job.candidates[c].placement; any = true; }
+            }
+            if (any) st.level = 2;
+        }
+        st.seconds = std::chrono::duration<double>(now - job.started).count();
+        if (stats) *stats = st;
+        current = nullptr;
+        return true;
+    }
+
+    bool busy() const { return current != nullptr; }
+    int threadCount() const { return searchers; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    static const uint64_t EMPTY = 0;
+
+    struct McSlot {
+        std::atomic<long long> sum{0};
+        std::atomic<int> count{0};
+    };
+    struct Candidate {
+        Placement placement;
+        int lines = 0;
+        BitBoard board;
+    };
+    struct SearchTask {
+        std::array<Candidate, MAX_PLACEMENTS> candidates;
+        int count = 0;
+        int nextPiece = 0;
+        bool cascade = false;
+        Clock::time_point deadline;
+        std::array<int, MAX_PLACEMENTS> scores[BOT_LEVELS];
+        std::atomic<int> nextIndex[BOT_LEVELS] = {};
+        std::atomic<int> doneCount[BOT_LEVELS] = {};
+        std::atomic<uint64_t> best[BOT_LEVELS];
+        std::atomic<int> levelsDone{0};
+        // MonteCarlo
+        BotEval eval = BotEval::Heuristic;
+        const NnEval* net = nullptr;  // Network mode
+        RolloutConfig rollout;
+        unsigned seed = 0;
+        Clock::time_point started;
+        std::atomic<int> mcNext{0};
+        std::unique_ptr<McSlot[]> mc; // [worker][candidate], each row written by one worker only
+        std::atomic<int> active{0};   // this search's jobs still queued or running
+        // placement cache (heuristic only)
+        PlacementCache* cache = nullptr;
+        uint64_t key = 0;
+        bool cached = false;
+
+        // Back to an empty search for reuse; mcSlots is the size of mc.
+        void reset(size_t mcSlots) {
+            count = 0;
+            for (int l = 0; l < BOT_LEVELS; ++l) {
+                nextIndex[l].store(0, std::memory_order_relaxed);
+                doneCount[l].store(0, std::memory_order_relaxed);
+            }
+            levelsDone.store(0, std::memory_order_relaxed);
+            mcNext.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < mcSlots; ++i) { mc[i].sum.store(0, std::memory_order_relaxed); mc[i].count.store(0, std::memory_order_relaxed); }
+            cache = nullptr;
+            key = 0;
+            cached = false;
+        }
+
+        int find(const Placement& p) const {
+            for (int i = 0; i < count; ++i) if (candidates[i].placement.rotation == p.rotation && candidates[i].placement.x == p.x) return i;
+            return -1;
+        }
+    };
+
+    // Stores the best move of the deepest complete level if it is deeper than what the
+    // cache has, or takes the cached move if that one was searched deeper than this result.
+    static void remember(const SearchTask& job, Placement& out, BotStats& st) {
+        int done = std::min(job.levelsDone.load(std::memory_order_acquire), BOT_LEVELS);
+        CachedPlacement hit;
+        bool have = job.cache->lookup(job.key, hit) && job.find(hit.placement) >= 0;
+        if (have && hit.levels > done && hit.levels >= st.level) { out = hit.placement; st.level = hit.levels; return; }
+        if (done == 0 || (have && hit.levels >= done)) return;
+        uint64_t packed = job.best[done - 1].load(std::memory_order_acquire);
+        if (packed == EMPTY) return;
+        CachedPlacement e;
+        e.placement = job.candidates[packed & 0xffff].placement;
+        e.score = (int)((uint32_t)(packed >> 32) ^ 0x80000000u);
+        e.levels = done;
+        job.cache->store(job.key, e);
+    }
+
+    // Packed as [score (order-preserving) : 32][valid : 16][candidate : 16], so a CAS max
+    // keeps the best score and 0 means "nothing published yet".
+    static void publish(std::atomic<uint64_t>& slot, int score, int idx) {
+        uint64_t v = ((uint64_t)((uint32_t)score ^ 0x80000000u) << 32) | (1u << 16) | (uint64_t)idx;
+        uint64_t cur = slot.load(std::memory_order_relaxed);
+        while (v > cur && !slot.compare_exchange_weak(cur, v, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    int evaluate(const SearchTask& job, int level, int idx, const std::atomic<unsigned>& gen, unsigned myGen) const {
+        const Candidate& c = job.candidates[idx];
+        int base = 76 * c.lines;
+        if (level == 0) { int s; scoreBoards(job.net, &c.board, &c.lines, 1, &s); return s; }
+        int best = INT_MIN;
+        if (level == 1) {
+            int lines[MAX_PLACEMENTS], scores[MAX_PLACEMENTS];
+            BitBoard after[MAX_PLACEMENTS];
+            int n = 0;
+            forEachPlacement(c.board, job.nextPiece, [&](const Placement&, const BitBoard& b, int l) {
+                if (n < MAX_PLACEMENTS) { after[n] = b; lines[n] = l; ++n; }
+            }, job.cascade);
+            scoreBoards(job.net, after, lines, n, scores);
+            for (int i = 0; i < n; ++i) best = std::max(best, base + scores[i]);
+            return best == INT_MIN ? -100000 + base : best;
+        }
+        forEachPlacement(c.board, job.nextPiece, [&](const Placement&, const BitBoard& after, int lines) {
+            if (expired(job, gen, myGen)) return;
+            long sum = 0;
+            for (int p = 0; p < PIECE_COUNT; ++p) {
+                int s = bestPlacementScore(after, p, job.cascade, job.net);
+                sum += (s == INT_MIN) ? -100000 : s;
+            }
+            best = std::max(best, base + HEURISTIC_WEIGHTS[1] * lines + (int)(sum / PIECE_COUNT));
+        }, job.cascade);
+        return best == INT_MIN ? -100000 + base : best;
+    }
+
+    static bool expired(const SearchTask& job, const std::atomic<unsigned>& gen, unsigned myGen) {
+        return gen.load(std::memory_order_relaxed) != myGen || Clock::now() >= job.deadline;
+    }
+
+    // One searcher's share of a job; index picks its row of Monte Carlo sums.
+    void search(SearchTask& job, unsigned myGen, int index) {
+        if (expired(job, generation, myGen)) return;   // superseded while queued
+        GameState sim; // rollout scratch state, private to this search
+        PerfScope perf(PERF_AI_SEARCH, true);
+        runJob(job, myGen, index, sim);
+    }
+
+    void runRollouts(SearchTask& job, const int* order, unsigned myGen, int index, GameState& sim) {
+        int k = std::min(job.count, MC_CANDIDATES);
+        if (k == 0) return;
+        seedRolloutStream(sim, job.seed, (unsigned)index);
+        sim.cascade = job.cascade;
+        McSlot* row = &job.mc[(size_t)index * MAX_PLACEMENTS];
+        while (!expired(job, generation, myGen)) {
+            int unit = job.mcNext.fetch_add(1, std::memory_order_relaxed);
+            int idx = order[unit % k];
+            const Candidate& c = job.candidates[idx];
+            long long sum = 0;
+            for (int i = 0; i < MC_BATCH; ++i) sum += 76 * c.lines + rollout(sim, c.board, job.nextPiece, job.rollout);
+            row[idx].sum.store(row[idx].sum.load(std::memory_order_relaxed) + sum, std::memory_order_relaxed);
+            row[idx].count.store(row[idx].count.load(std::memory_order_relaxed) + MC_BATCH, std::memory_order_release);
+        }
+    }
+
+    void runJob(SearchTask& job, unsigned myGen, int index, GameState& sim) {
+        int order[MAX_PLACEMENTS], rank[MAX_PLACEMENTS];
+        for (int i = 0; i < job.count; ++i) order[i] = i;
+        for (int level = 0; level < BOT_LEVELS; ++level) {
+            for (;;) {
+                int i = job.nextIndex[level].fetch_add(1, std::memory_order_relaxed);
+                if (i >= job.count || expired(job, generation, myGen)) break;
+                int idx = order[i];
+                int s = evaluate(job, level, idx, generation, myGen);
+                if (expired(job, generation, myGen)) break; // level 3 may have been cut short
+                job.scores[level][idx] = s;
+                publish(job.best[level], s, idx);
+                job.doneCount[level].fetch_add(1, std::memory_order_release);
+            }
+            // wait for the other workers to finish this level, then derive the next ordering locally
+            while (job.doneCount[level].load(std::memory_order_acquire) < job.count) {
+                if (expired(job, generation, myGen)) return;
+                std::this_thread::yield();
+            }
+            if (level == BOT_LEVELS - 1 || job.count == 0) { job.levelsDone.store(BOT_LEVELS, std::memory_order_release); return; }
+            job.levelsDone.store(level + 1, std::memory_order_release);
+            const auto& sc = job.scores[level];
+            // ties keep their previous order; std::stable_sort would take a heap buffer
+            for (int i = 0; i < job.count; ++i) rank[order[i]] = i;
+            std::sort(order, order + job.count, [&](int a, int b){ return sc[a] != sc[b] ? sc[a] > sc[b] : rank[a] < rank[b]; });
+            if (job.eval == BotEval::MonteCarlo) { runRollouts(job, order, myGen, index, sim); return; }
+        }
+    }
+
+    int searchers = 1;
+    std::atomic<int> active{0};          // queued or running search jobs
+    std::atomic<unsigned> generation{0};
+    BotEval eval = BotEval::Heuristic;
+    RolloutConfig rolloutConfig;
+    const NnEval* net = nullptr;
+    PlacementCache* cache = nullptr;
+    std::unique_ptr<SearchTask[]> tasks; // BOT_TASK_RING searches, reused in turn
+    int nextTask = 0;
+    SearchTask* current = nullptr;       // the caller's thread's search, until poll() returns it
+};
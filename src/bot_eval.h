@@ -0,0 +1,103 @@
+// bot_eval.h
+// Placement enumeration and board evaluation shared by the CPU search, the
+// Monte Carlo rollouts and the tools.
+
+#pragma once
+
+#include "tetris_core.h"
+#include "bitboard.h"
+#include "finesse.h"
+#include "nn_eval.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+// --------------------------- PLACEMENTS ----------------------------
+// A placement is "rotate N times at spawn, shift to column x, hard drop". The CPU
+// types it with the fewest keys (finesse.h), which lands the same cells.
+struct Placement {
+    int rotation = 0;
+    int x = 0;
+};
+
+const int MAX_PLACEMENTS = 4 * BOARD_W;
+
+// Calls f(placement, boardAfter, linesCleared) for every reachable placement of pieceIdx.
+// Placements that leave cells above the top are skipped (they would lose the game).
+// With cascade the boards after are settled by cascade gravity (GameState::cascade).
+template<class F>
+void forEachPlacement(const BitBoard& board, int pieceIdx, F&& f, bool cascade = false) {
+    PieceBlocks blocks = pieceBlocks(PIECES[pieceIdx].blocks);
+    glm::ivec2 pos = spawnPosition();
+    if (!isValidMove(board, pos, blocks)) return;
+    int rotations = isOPiece(blocks) ? 1 : 4;
+    for (int r = 0; r < rotations; ++r) {
+        if (r > 0 && !tryRotate(board, blocks, pos)) break;
+        int minX = pos.x, maxX = pos.x;
+        while (isValidMove(board, glm::ivec2(minX - 1, pos.y), blocks)) --minX;
+        while (isValidMove(board, glm::ivec2(maxX + 1, pos.y), blocks)) ++maxX;
+        for (int x = minX; x <= maxX; ++x) {
+            glm::ivec2 p(x, pos.y);
+            while (isValidMove(board, glm::ivec2(p.x, p.y + 1), blocks)) p.y += 1;
+            bool above = false;
+            for (int i = 0; i < blocks.n; ++i) if (p.y + blocks.b[i].y < 0) above = true;
+            if (above) continue;
+            BitBoard after = board;
+            mergePiece(after, p, blocks);
+            int lines = cascade ? cascadeClearLines(after) : clearLines(after);
+            f(Placement{r, x}, after, lines);
+        }
+    }
+}
+
+// --------------------------- EVALUATION ----------------------------
+// Classic four-feature heuristic (aggregate height, lines, holes, bumpiness), weights x100.
+// tools/sim_farm tunes other weights through the same function.
+const int32_t HEURISTIC_WEIGHTS[4] = {-51, 76, -36, -18};
+
+inline int scoreFeatures(const BoardFeatures& f, int lines, const int32_t* w = HEURISTIC_WEIGHTS) {
+    return w[0] * f.aggregateHeight + w[1] * lines + w[2] * f.holes + w[3] * f.bumpiness;
+}
+
+inline int evaluateBoard(const BitBoard& board, int lines) {
+    BoardFeatures f;
+    extractFeatures(board, f);
+    return scoreFeatures(f, lines);
+}
+
+// Scores a whole move list in one call.
+inline void evaluateBoards(const BitBoard* boards, const int* lines, int count, int* scores) {
+    BoardFeatures f[MAX_PLACEMENTS];
+    for (int i = 0; i < count; i += MAX_PLACEMENTS) {
+        int n = std::min(MAX_PLACEMENTS, count - i);
+        extractFeatures(boards + i, n, f);
+        for (int j = 0; j < n; ++j) scores[i + j] = scoreFeatures(f[j], lines[i + j]);
+    }
+}
+
+// The learned evaluator if one is given (nn_eval.h), else the heuristic.
+inline void scoreBoards(const NnEval* net, const BitBoard* boards, const int* lines, int count, int* scores) {
+    if (net) nnEvaluateBoards(*net, boards, lines, count, scores);
+    else evaluateBoards(boards, lines, count, scores);
+}
+
+// Best single placement of pieceIdx on board; INT_MIN if the piece cannot be placed.
+inline int bestPlacementScore(const BitBoard& board, int pieceIdx, bool cascade = false, const NnEval* net = nullptr) {
+    BitBoard after[MAX_PLACEMENTS];
+    int lines[MAX_PLACEMENTS], scores[MAX_PLACEMENTS];
+    int n = 0;
+    forEachPlacement(board, pieceIdx, [&](const Placement&, const BitBoard& b, int l) {
+        if (n < MAX_PLACEMENTS) { after[n] = b; lines[n] = l; ++n; }
+    }, cascade);
+    scoreBoards(net, after, lines, n, scores);
+    int best = INT_MIN;
+    for (int i = 0; i < n; ++i) best = std::max(best, scores[i]);
+    return best;
+}
+
+// Plays a placement on a live game (steerPiece, then hard drop). Returns lines cleared.
+inline int applyPlacement(GameState& g, const Placement& p) {
+    steerPiece(g, p.rotation, p.x);
+    return hardDrop(g);
+}
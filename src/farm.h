@@ -0,0 +1,342 @@
+// farm.h
+// Simulation farm: one coordinator process hands out work to worker processes over
+// stream sockets and sums what comes back, so a batch can use more cores than one
+// process scales to, or be split per NUMA node. Workers hold no state between tasks;
+// a task whose worker dies before answering, or takes longer than the task deadline,
+// goes back on the queue. A task that cannot be done (say, the archive will not open)
+// comes back as an ERROR instead of a result.
+//
+// Messages are framed and little-endian with no pointers or host-specific sizes, so
+// the same protocol works over a TCP connection between hosts; locally it runs over a
+// Unix socket.
+//   frame   u32 length | u8 type | payload (length counts type + payload)
+//   HELLO   worker -> coordinator   u32 worker | u32 pid
+//   TASK    coordinator -> worker   u32 id | u8 kind | u64 begin | u64 end | u32 maxPieces
+//                                   | i32 weights[4] | u64 offset | u16 pathBytes | path
+//   RESULT  worker -> coordinator   u32 id | u16 count | u64 values[count]
+//   STOP    coordinator -> worker   (empty)
+//   ERROR   worker -> coordinator   u32 id | u16 bytes | message
+// A task covers the seeds (or, for replays, the submission indices) [begin, end); for
+// replays, offset is where submission begin starts in the file.
+
+#pragma once
+
+#include "replay.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum FarmMessage : uint8_t { FARM_HELLO = 1, FARM_TASK, FARM_RESULT, FARM_STOP, FARM_ERROR };
+
+enum FarmKind : uint8_t {
+    FARM_GAMES = 1,     // bot games with the given heuristic weights: games, pieces, lines, topouts
+    FARM_VERIFY = 2,    // submissions in the archive at path: one count per Verdict
+};
+
+const uint32_t FARM_MAX_FRAME = 1 << 20;
+
+struct FarmTask {
+    uint32_t id = 0;
+    uint8_t kind = FARM_GAMES;
+    uint64_t begin = 0, end = 0;
+    uint32_t maxPieces = 0;
+    int32_t weights[4] = {};          // aggregate height, lines, holes, bumpiness (x100)
+    uint64_t offset = 0;              // byte offset of submission begin in path
+    std::string path;
+};
+
+struct FarmResult {
+    uint32_t id = 0;
+    std::vector<uint64_t> values;
+    std::string error;                // set if the task failed; values are then empty
+};
+
+inline void putU64(std::vector<uint8_t>& out, uint64_t v) { putU32(out, (uint32_t)v); putU32(out, (uint32_t)(v >> 32)); }
+inline uint64_t getU64(const uint8_t* p) { return getU32(p) | (uint64_t)getU32(p + 4) << 32; }
+
+// --------------------------- FRAMES ----------------------------
+inline bool farmSend(int fd, uint8_t type, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> f;
+    putU32(f, (uint32_t)payload.size() + 1);
+    f.push_back(type);
+    f.insert(f.end(), payload.begin(), payload.end());
+    for (size_t off = 0; off < f.size();) {
+        ssize_t n = send(fd, f.data() + off, f.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        off += (size_t)n;
+    }
+    return true;
+}
+
+// Accumulates bytes from a stream and cuts them into frames.
+struct FarmReader {
+    std::vector<uint8_t> buf;
+
+    // Reads what the socket has; false on EOF, an error or a frame over the limit.
+    bool fill(int fd) {
+        uint8_t chunk[16384];
+        ssize_t n;
+        do n = recv(fd, chunk, sizeof(chunk), 0); while (n < 0 && errno == EINTR);
+        if (n <= 0) return false;
+        buf.insert(buf.end(), chunk, chunk + n);
+        return buf.size() < 4 || getU32(buf.data()) <= FARM_MAX_FRAME;
+    }
+
+    // Takes the next whole frame if one is buffered.
+    bool next(uint8_t& type, std::vector<uint8_t>& payload) {
+        if (buf.size() < 4) return false;
+        uint32_t len = getU32(buf.data());
+        if (len == 0 || buf.size() < 4 + (size_t)len) return false;
+        type = buf[4];
+        payload.assign(buf.begin() + 5, buf.begin() + 4 + len);
+        buf.erase(buf.begin(), buf.begin() + 4 + len);
+        return true;
+    }
+};
+
+// --------------------------- MESSAGES ----------------------------
+inline std::vector<uint8_t> encodeTask(const FarmTask& t) {
+    std::vector<uint8_t> p;
+    putU32(p, t.id);
+    p.push_back(t.kind);
+    putU64(p, t.begin);
+    putU64(p, t.end);
+    putU32(p, t.maxPieces);
+    for (int32_t w : t.weights) putU32(p, (uint32_t)w);
+    putU64(p, t.offset);
+    putU16(p, (uint16_t)t.path.size());
+    p.insert(p.end(), t.path.begin(), t.path.end());
+    return p;
+}
+
+inline bool decodeTask(const std::vector<uint8_t>& p, FarmTask& t) {
+    const size_t fixed = 4 + 1 + 8 + 8 + 4 + 16 + 8 + 2;
+    if (p.size() < fixed) return false;
+    const uint8_t* q = p.data();
+    t.id = getU32(q);
+    t.kind = q[4];
+    t.begin = getU64(q + 5);
+    t.end = getU64(q + 13);
+    t.maxPieces = getU32(q + 21);
+    for (int i = 0; i < 4; ++i) t.weights[i] = (int32_t)getU32(q + 25 + 4 * i);
+    t.offset = getU64(q + 41);
+    size_t pathBytes = getU16(q + 49);
+    if (p.size() != fixed + pathBytes) return false;
+    t.path.assign((const char*)q + fixed, pathBytes);
+    return true;
+}
+
+inline std::vector<uint8_t> encodeResult(const FarmResult& r) {
+    std::vector<uint8_t> p;
+    putU32(p, r.id);
+    putU16(p, (uint16_t)r.values.size());
+    for (uint64_t v : r.values) putU64(p, v);
+    return p;
+}
+
+inline std::vector<uint8_t> encodeError(const FarmResult& r) {
+    std::vector<uint8_t> p;
+    size_t n = std::min<size_t>(r.error.size(), 0xffff);
+    putU32(p, r.id);
+    putU16(p, (uint16_t)n);
+    p.insert(p.end(), r.error.begin(), r.error.begin() + (long)n);
+    return p;
+}
+
+inline bool decodeError(const std::vector<uint8_t>& p, FarmResult& r) {
+    if (p.size() < 6 || p.size() != 6 + (size_t)getU16(p.data() + 4)) return false;
+    r.id = getU32(p.data());
+    r.values.clear();
+    r.error.assign((const char*)p.data() + 6, p.size() - 6);
+    if (r.error.empty()) r.error = "failed";
+    return true;
+}
+
+inline bool decodeResult(const std::vector<uint8_t>& p, FarmResult& r) {
+    if (p.size() < 6) return false;
+    r.id = getU32(p.data());
+    size_t n = getU16(p.data() + 4);
+    if (p.size() != 6 + 8 * n) return false;
+    r.values.resize(n);
+    for (size_t i = 0; i < n; ++i) r.values[i] = getU64(p.data() + 6 + 8 * i);
+    return true;
+}
+
+// --------------------------- WORKER ----------------------------
+// Connects to the coordinator, says HELLO and runs tasks until STOP or the connection
+// drops; a result with an error set goes back as ERROR. Returns 0 on STOP.
+inline int farmWorker(const std::string& socketPath, uint32_t index, const std::function<FarmResult(const FarmTask&)>& run) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (fd < 0 || socketPath.size() >= sizeof(addr.sun_path)) return 1;
+    std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) { close(fd); return 1; }
+    std::vector<uint8_t> hello;
+    putU32(hello, index);
+    putU32(hello, (uint32_t)getpid());
+    FarmReader rd;
+    uint8_t type;
+    std::vector<uint8_t> payload;
+    bool ok = farmSend(fd, FARM_HELLO, hello);
+    while (ok) {
+        while (ok && !rd.next(type, payload)) ok = rd.fill(fd);
+        if (!ok || type == FARM_STOP) break;
+        FarmTask t;
+        if (type != FARM_TASK || !decodeTask(payload, t)) { ok = false; break; }
+        FarmResult r = run(t);
+        r.id = t.id;
+        ok = r.error.empty() ? farmSend(fd, FARM_RESULT, encodeResult(r)) : farmSend(fd, FARM_ERROR, encodeError(r));
+    }
+    close(fd);
+    return ok ? 0 : 1;
+}
+
+// --------------------------- COORDINATOR ----------------------------
+// Starts the worker processes through spawn (which returns the child's pid), feeds
+// them tasks one at a time each and collects the results. Dead workers are reaped
+// and started again; their task goes back to the front of the queue. A worker still
+// on a task after taskSeconds is killed and handled the same way.
+class FarmCoordinator {
+public:
+    using Spawn = std::function<pid_t(int index)>;
+    using Done = std::function<void(const FarmTask&, const FarmResult&)>;
+
+    ~FarmCoordinator() { stop(); }
+
+    bool listen(const std::string& path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) return false;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        unlink(path.c_str());
+        ls = socket(AF_UNIX, SOCK_STREAM, 0);
+        socketPath = path;
+        return ls >= 0 && bind(ls, (sockaddr*)&addr, sizeof(addr)) == 0 && ::listen(ls, 256) == 0;
+    }
+
+    void start(int workers, Spawn s) {
+        spawn = std::move(s);
+        pids.assign((size_t)workers, -1);
+        for (int i = 0; i < workers; ++i) pids[(size_t)i] = spawn(i);
+        restartBudget = 4 * workers + 4;
+    }
+
+    // Runs every task once; false if the workers kept dying and the restarts ran out.
+    // Failed tasks reach done with the error set and are not run again.
+    bool run(const std::vector<FarmTask>& tasks, const Done& done) {
+        std::deque<FarmTask> queue(tasks.begin(), tasks.end());
+        size_t remaining = tasks.size();
+        std::vector<pollfd> pfds;
+        uint8_t type;
+        std::vector<uint8_t> payload;
+        while (remaining > 0) {
+            for (Conn& c : conns) {
+                if (c.fd < 0 || c.busy || c.index < 0 || queue.empty()) continue;
+                c.task = queue.front();
+                queue.pop_front();
+                c.busy = true;
+                c.deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(taskSeconds));
+                if (!farmSend(c.fd, FARM_TASK, encodeTask(c.task))) drop(c, queue);
+            }
+            pfds.assign(1, pollfd{ls, POLLIN, 0});
+            for (const Conn& c : conns) pfds.push_back(pollfd{c.fd, POLLIN, 0});
+            int n = poll(pfds.data(), pfds.size(), 100);
+            if (n > 0 && (pfds[0].revents & POLLIN)) {
+                int fd = accept(ls, nullptr, nullptr);
+                if (fd >= 0) { conns.emplace_back(); conns.back().fd = fd; }
+            }
+            for (size_t i = 1; n > 0 && i < pfds.size(); ++i) {
+                Conn& c = conns[i - 1];
+                if (!pfds[i].revents || c.fd < 0) continue;
+                if (!c.rd.fill(c.fd)) { drop(c, queue); continue; }
+                while (c.fd >= 0 && c.rd.next(type, payload)) {
+                    FarmResult r;
+                    if (type == FARM_HELLO && payload.size() == 8) { c.index = (int)getU32(payload.data()); c.pid = (pid_t)getU32(payload.data() + 4); }
+                    else if ((type == FARM_RESULT || type == FARM_ERROR) && c.busy &&
+                             (type == FARM_RESULT ? decodeResult(payload, r) : decodeError(payload, r)) && r.id == c.task.id) {
+                        c.busy = false;
+                        --remaining;
+                        failed += !r.error.empty();
+                        done(c.task, r);
+                    } else drop(c, queue);
+                }
+            }
+            for (Conn& c : conns) {
+                if (c.fd < 0 || !c.busy || Clock::now() < c.deadline) continue;
+                ++timeouts;
+                if (c.pid > 0) kill(c.pid, SIGKILL);   // reap() starts it again
+                drop(c, queue);
+            }
+            conns.erase(std::remove_if(conns.begin(), conns.end(), [](const Conn& c) { return c.fd < 0; }), conns.end());
+            if (!reap()) return false;
+        }
+        return true;
+    }
+
+    // STOP to every worker, then waits for them to exit.
+    void stop() {
+        for (Conn& c : conns) if (c.fd >= 0) { farmSend(c.fd, FARM_STOP, {}); close(c.fd); }
+        conns.clear();
+        for (pid_t& p : pids) if (p > 0) { waitpid(p, nullptr, 0); p = -1; }
+        if (ls >= 0) { close(ls); unlink(socketPath.c_str()); ls = -1; }
+    }
+
+    double taskSeconds = 300.0; // deadline for one task
+    int crashes = 0;           // workers that died while the farm was running
+    int timeouts = 0;          // tasks whose worker was killed for going over the deadline
+    int failed = 0;            // tasks that came back as ERROR
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Conn {
+        int fd = -1;
+        int index = -1;        // from HELLO
+        pid_t pid = -1;        // from HELLO
+        bool busy = false;
+        FarmTask task;
+        Clock::time_point deadline;
+        FarmReader rd;
+    };
+
+    void drop(Conn& c, std::deque<FarmTask>& queue) {
+        if (c.busy) queue.push_front(c.task);
+        c.busy = false;
+        close(c.fd);
+        c.fd = -1;
+    }
+
+    // Restarts dead workers; false once the restart budget is spent and none are left.
+    bool reap() {
+        int alive = 0;
+        for (size_t i = 0; i < pids.size(); ++i) {
+            if (pids[i] > 0 && waitpid(pids[i], nullptr, WNOHANG) == pids[i]) {
+                ++crashes;
+                pids[i] = restartBudget-- > 0 ? spawn((int)i) : -1;
+            }
+            alive += pids[i] > 0;
+        }
+        return alive > 0;
+    }
+
+    int ls = -1;
+    std::string socketPath;
+    Spawn spawn;
+    std::vector<pid_t> pids;
+    std::vector<Conn> conns;
+    int restartBudget = 0;
+};
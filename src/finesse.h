@@ -0,0 +1,186 @@
+// finesse.h
+// Fewest inputs for every placement ("finesse"). For each piece, every orientation and
+// column the piece can stand in at the spawn row is searched breadth-first on an open
+// board, and the first key of a shortest path to every placement is stored. Placements
+// that cover the same cells (S/Z/I turned twice, shifted) share one target, so the
+// cheaper of the two wins. Typing a placement is then one lookup per key, from wherever
+// the piece is now, and a player's inputs can be scored against the same table.
+//
+// The game only turns clockwise, so shapes are reached by 0-3 turns; the table also
+// finds shorter orders of turns and shifts at the walls, where kicks move the piece.
+// Built on first use, so initPieces() must have run.
+
+#pragma once
+
+#include "bitboard.h"
+
+#include <vector>
+
+const int FINESSE_X0 = 4;                        // origin x + FINESSE_X0 indexes the table
+const int FINESSE_COLS = BOARD_W + 2 * FINESSE_X0;
+const int FINESSE_UNREACHABLE = 255;
+const int PLACEMENT_MAX_INPUTS = 4 + BOARD_W + 1; // worst case of the rotate-then-shift fallback, plus the drop
+
+struct FinesseStep {
+    uint8_t keys = FINESSE_UNREACHABLE;          // shifts and turns still needed (the drop not counted)
+    uint8_t next = ACT_HARD_DROP;                // first of them, ACT_HARD_DROP once there
+};
+
+// table[((from rotation * COLS + from x) * 4 + rotation) * COLS + x] for one piece
+struct FinessePiece {
+    std::vector<FinesseStep> table;
+    int rotations = 1;
+};
+
+inline const FinessePiece* finesseTables() {
+    static const std::vector<FinessePiece> tables = []{
+        std::vector<FinessePiece> t(PIECE_COUNT);
+        BitBoard empty{};
+        const int states = 4 * FINESSE_COLS;
+        for (int piece = 0; piece < PIECE_COUNT; ++piece) {
+            FinessePiece& fp = t[(size_t)piece];
+            fp.rotations = isOPiece(pieceBlocks(PIECES[piece].blocks)) ? 1 : 4;
+            fp.table.assign((size_t)states * states, FinesseStep{});
+            // cells a state covers once dropped: shape in a 4x4 box plus its leftmost column
+            std::vector<int> footprint((size_t)states, -1);
+            for (int r = 0; r < fp.rotations; ++r) {
+                PieceBlocks p = rotatedBlocks(piece, r);
+                int minX = 100, minY = 100;
+                for (int i = 0; i < p.n; ++i) { minX = std::min(minX, p.b[i].x); minY = std::min(minY, p.b[i].y); }
+                int shape = 0;
+                for (int i = 0; i < p.n; ++i) shape |= 1 << ((p.b[i].y - minY) * 4 + p.b[i].x - minX);
+                for (int xi = 0; xi < FINESSE_COLS; ++xi)
+                    if (isValidMove(empty, glm::ivec2(xi - FINESSE_X0, spawnPosition().y), p))
+                        footprint[(size_t)(r * FINESSE_COLS + xi)] = shape | ((xi - FINESSE_X0 + minX) << 16);
+            }
+            std::vector<int> dist((size_t)states), first((size_t)states), queue;
+            for (int start = 0; start < states; ++start) {
+                if (footprint[(size_t)start] < 0) continue;
+                std::fill(dist.begin(), dist.end(), -1);
+                dist[(size_t)start] = 0;
+                first[(size_t)start] = ACT_HARD_DROP;
+                queue.assign(1, start);
+                for (size_t qi = 0; qi < queue.size(); ++qi) {
+                    int s = queue[qi], r = s / FINESSE_COLS;
+                    glm::ivec2 pos(s % FINESSE_COLS - FINESSE_X0, spawnPosition().y);
+                    static const GameAction moves[] = {ACT_ROTATE, ACT_LEFT, ACT_RIGHT};
+                    for (GameAction a : moves) {
+                        PieceBlocks p = rotatedBlocks(piece, r);
+                        glm::ivec2 q = pos;
+                        int nr = r;
+                        if (a == ACT_ROTATE) {
+                            if (fp.rotations == 1 || !tryRotate(empty, p, q)) continue;
+                            nr = (r + 1) & 3;
+                        } else {
+                            q.x += a == ACT_LEFT ? -1 : 1;
+                            if (!isValidMove(empty, q, p)) continue;
+                        }
+                        int xi = q.x + FINESSE_X0;
+                        if (xi < 0 || xi >= FINESSE_COLS) continue;
+                        int n = nr * FINESSE_COLS + xi;
+                        if (dist[(size_t)n] >= 0) continue;
+                        dist[(size_t)n] = dist[(size_t)s] + 1;
+                        first[(size_t)n] = s == start ? a : first[(size_t)s];
+                        queue.push_back(n);
+                    }
+                }
+                // each target takes the nearest state covering the same cells
+                for (int target = 0; target < states; ++target) {
+                    if (footprint[(size_t)target] < 0) continue;
+                    FinesseStep& e = fp.table[(size_t)start * states + target];
+                    for (int s : queue)   // in BFS order, so the first match is the nearest
+                        if (footprint[(size_t)s] == footprint[(size_t)target]) { e.keys = (uint8_t)dist[(size_t)s]; e.next = (uint8_t)first[(size_t)s]; break; }
+                }
+            }
+        }
+        return t;
+    }();
+    return tables.data();
+}
+
+inline const FinesseStep& finesseStep(int piece, int fromRotation, int fromX, int rotation, int x) {
+    static const FinesseStep none;
+    const FinessePiece& fp = finesseTables()[piece];
+    int fx = fromX + FINESSE_X0, tx = x + FINESSE_X0;
+    if (fx < 0 || fx >= FINESSE_COLS || tx < 0 || tx >= FINESSE_COLS) return none;
+    if (fp.rotations == 1) fromRotation = rotation = 0;
+    return fp.table[(size_t)((fromRotation & 3) * FINESSE_COLS + fx) * 4 * FINESSE_COLS + (rotation & 3) * FINESSE_COLS + tx];
+}
+
+// Shifts and turns a placement (rotation, origin x) needs from spawn; FINESSE_UNREACHABLE if none.
+inline int finesseKeys(int piece, int rotation, int x) {
+    return finesseStep(piece, 0, spawnPosition().x, rotation, x).keys;
+}
+
+// Moves g's current piece toward the placement (rotation, x) without dropping it: the
+// table's keys while the stack lets them through, then (if one is blocked or a kick
+// lands elsewhere) turns and shifts from there, the path forEachPlacement assumes.
+// Writes the keys to out if given; returns how many were pressed.
+inline int steerPiece(GameState& g, int rotation, int x, GameAction* out = nullptr) {
+    const int limit = PLACEMENT_MAX_INPUTS - 1;
+    int piece = g.currentPieceIndex, n = 0;
+    int r = pieceRotation(piece, g.currentPiece.blocks);
+    for (; n < limit; ++n) {
+        const FinesseStep& s = finesseStep(piece, r, g.currentPos.x, rotation, x);
+        if (s.keys == 0) return n;
+        if (s.keys == FINESSE_UNREACHABLE) break;
+        if (s.next == ACT_ROTATE ? !tryRotate(g.board, g.currentPiece.blocks, g.currentPos) : !movePiece(g, s.next == ACT_LEFT ? -1 : 1, 0)) break;
+        if (s.next == ACT_ROTATE) r = (r + 1) & 3;
+        if (out) out[n] = (GameAction)s.next;
+    }
+    bool turns = finesseTables()[piece].rotations > 1;
+    for (; turns && r != (rotation & 3) && n < limit && tryRotate(g.board, g.currentPiece.blocks, g.currentPos); ++n) {
+        r = (r + 1) & 3;
+        if (out) out[n] = ACT_ROTATE;
+    }
+    for (int dx; g.currentPos.x != x && n < limit && movePiece(g, dx = x > g.currentPos.x ? 1 : -1, 0); ++n)
+        if (out) out[n] = dx > 0 ? ACT_RIGHT : ACT_LEFT;
+    return n;
+}
+
+// The inputs that type the placement for g's current piece, ending with the hard drop.
+// Returns the count, at most PLACEMENT_MAX_INPUTS. Steers a per-thread copy, assigned
+// rather than constructed so the piece's block vector is reused instead of allocated.
+inline int placementInputs(const GameState& g, int rotation, int x, GameAction* out) {
+    static thread_local GameState s;
+    s = g;
+    int n = steerPiece(s, rotation, x, out);
+    out[n++] = ACT_HARD_DROP;
+    return n;
+}
+
+// The next key toward the placement (rotation, x) from where g's piece is now, planned
+// against the live board every time, so a shift the stack blocks or a row gravity takes
+// away does not throw off the keys after it. ACT_HARD_DROP once nothing is left to press.
+inline GameAction nextPlacementInput(const GameState& g, int rotation, int x) {
+    GameAction keys[PLACEMENT_MAX_INPUTS];
+    placementInputs(g, rotation, x, keys);
+    return keys[0];
+}
+
+// --------------------------- FINESSE FAULTS ----------------------------
+// Counts a player's shifts and turns per piece against the table. A piece is a fault
+// when it took more keys than its placement needs from spawn; soft drops and gravity
+// are free, and pieces moved after a soft drop (tucks, spins) are not scored.
+struct FinesseCounter {
+    int keys = 0;
+    bool softDropped = false, tucked = false;
+    long long pieces = 0, faults = 0, extraKeys = 0;
+
+    // Call with the state before a is applied.
+    void onInput(const GameState& before, GameAction a) {
+        if (before.gameOver) return;
+        if (a == ACT_LEFT || a == ACT_RIGHT || a == ACT_ROTATE) { ++keys; tucked = tucked || softDropped; }
+        if (a == ACT_SOFT_DROP) softDropped = true;
+        if (!actionLocksPiece(before, a)) return;
+        int piece = before.currentPieceIndex;
+        int par = finesseKeys(piece, pieceRotation(piece, before.currentPiece.blocks), before.currentPos.x);
+        if (!tucked && par != FINESSE_UNREACHABLE) {
+            ++pieces;
+            if (keys > par) { ++faults; extraKeys += keys - par; }
+        }
+        keys = 0;
+        softDropped = tucked = false;
+    }
+    void merge(const FinesseCounter& o) { pieces += o.pieces; faults += o.faults; extraKeys += o.extraKeys; }
+};
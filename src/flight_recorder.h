@@ -0,0 +1,303 @@
+// flight_recorder.h
+// Always-on flight recorder: a fixed ring of small records covering roughly the last
+// 30 seconds (inputs, sim ticks, frame times, GPU pass times, notable events), written
+// to disk on a crash signal, on request or after a hitch, so a report of a stutter
+// comes with the seconds before it. tools/flight_dump prints the files.
+//
+// The ring is a static array: recording never allocates and costs a clock read plus a
+// few relaxed stores. Each slot is a little seqlock (like live_state.h), so writers on
+// any thread never wait and a dump taken from a signal handler, while the game keeps
+// writing, can tell whole records from torn ones. Dumping uses only open/write/close
+// and stack buffers, which keeps it async-signal-safe.
+//
+// Only crashes dump on the thread they happen on. Requested and hitch dumps go to a
+// writer thread, so the frame that hitched does not also write the megabyte ring. The
+// crash handlers run on an alternate signal stack, installed per thread: every thread
+// the game starts calls flightThreadStart so a stack overflow anywhere still dumps.
+//
+// File, little-endian:
+//   "TFLT" | u16 version | u16 slotBytes | u32 capacity | u32 reason | u32 detail
+//   | u32 pid | u64 head | u64 start (unix ns) | capacity x slot
+//   slot: u64 seq | u64 time (ns since start) | u16 kind | u16 a | u32 frame | u32 b | u32 c
+// A slot holds record i when seq == 2 * i + 2 and i % capacity is its position; an odd
+// seq is a torn slot, mid-write or rewritten while the dump copied it.
+
+#pragma once
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+const uint16_t FLIGHT_VERSION = 1;
+const uint32_t FLIGHT_CAPACITY = 1u << 15;       // ~30 s at 60 fps and about 15 records a frame
+const size_t FLIGHT_HEADER_SIZE = 40;
+const size_t FLIGHT_ALT_STACK_SIZE = 1 << 16;    // per thread, for the crash handler
+
+enum FlightKind : uint16_t {
+    FLIGHT_FRAME = 1,   // b: frame us, c: CPU us of the frame before it was presented
+    FLIGHT_TICK,        // b: tick, c: piece serial
+    FLIGHT_INPUT,       // a: GameAction, b: tick, c: param
+    FLIGHT_GPU,         // a: pass, b: ns, c: the frame it was drawn in
+    FLIGHT_EVENT,       // a: FlightEvent, b and c: per event
+};
+
+enum FlightEvent : uint16_t {
+    FLIGHT_EV_START = 1,    // b: seed
+    FLIGHT_EV_LINES,        // b: lines, c: tick
+    FLIGHT_EV_GAME_OVER,    // b: tick
+    FLIGHT_EV_HITCH,        // b: frame us
+    FLIGHT_EV_DESYNC,       // b: tick
+};
+
+enum FlightGpuPass : uint16_t { GPU_SCENE, GPU_BRIGHT, GPU_BLUR, GPU_COMPOSITE, GPU_UI, GPU_PASS_COUNT };
+
+inline const char* flightGpuPassName(int p) {
+    static const char* names[GPU_PASS_COUNT] = {"scene", "bright", "blur", "composite", "ui"};
+    return p >= 0 && p < GPU_PASS_COUNT ? names[p] : "?";
+}
+
+enum FlightReason : uint32_t { FLIGHT_DUMP_REQUEST = 1, FLIGHT_DUMP_HITCH, FLIGHT_DUMP_CRASH };
+
+struct FlightSlot {
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[3];   // time | kind, a, frame | b, c
+};
+static_assert(sizeof(FlightSlot) == 32 && std::atomic<uint64_t>::is_always_lock_free, "slots are dumped as 32 raw bytes");
+
+// --------------------------- STATE ----------------------------
+inline FlightSlot flightRing[FLIGHT_CAPACITY];
+inline std::atomic<uint64_t> flightHead{0};
+inline std::atomic<uint32_t> flightFrameNo{0};
+inline uint64_t flightStartMono = 0, flightStartUnix = 0;
+inline uint64_t flightHitchUs = 0;                // 0: no dumps on hitches
+inline uint64_t flightLastHitchDump = 0;          // ns since start
+inline char flightDir[256] = ".";
+
+inline uint64_t flightClock(clockid_t id) {
+    timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// --------------------------- RECORDING ----------------------------
+inline void flightRecord(FlightKind kind, uint16_t a, uint32_t b, uint32_t c) {
+    uint64_t i = flightHead.fetch_add(1, std::memory_order_relaxed);
+    FlightSlot& s = flightRing[i % FLIGHT_CAPACITY];
+    uint64_t t = flightClock(CLOCK_MONOTONIC) - flightStartMono;
+    s.seq.store(2 * i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.words[0].store(t, std::memory_order_relaxed);
+    s.words[1].store(kind | (uint64_t)a << 16 | (uint64_t)flightFrameNo.load(std::memory_order_relaxed) << 32, std::memory_order_relaxed);
+    s.words[2].store(b | (uint64_t)c << 32, std::memory_order_relaxed);
+    s.seq.store(2 * i + 2, std::memory_order_release);
+}
+
+inline void flightEvent(FlightEvent e, uint32_t b = 0, uint32_t c = 0) { flightRecord(FLIGHT_EVENT, e, b, c); }
+
+// --------------------------- DUMPING ----------------------------
+inline void flightPut(uint8_t* p, uint64_t v, int bytes) { for (int i = 0; i < bytes; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+
+// Appends v in decimal; no allocation, usable in a signal handler.
+inline char* flightAppendNumber(char* p, char* end, uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do digits[n++] = (char)('0' + v % 10); while ((v /= 10) && n < 20);
+    while (n && p < end) *p++ = digits[--n];
+    return p;
+}
+
+// Writes the ring to <dir>/flight_<unix s>_<reason>.tfl; the path goes to pathOut if
+// given. Async-signal-safe.
+inline bool flightDump(FlightReason reason, uint32_t detail = 0, char* pathOut = nullptr, size_t pathBytes = 0) {
+    static const char* names[] = {"", "request", "hitch", "crash"};
+    char path[400];
+    char *p = path, *end = path + sizeof(path) - 1;
+    for (const char* d = flightDir; *d && p < end;) *p++ = *d++;
+    for (const char* s = "/flight_"; *s && p < end;) *p++ = *s++;
+    p = flightAppendNumber(p, end, flightClock(CLOCK_REALTIME) / 1000000000ull);
+    if (p < end) *p++ = '_';
+    for (const char* s = names[reason <= FLIGHT_DUMP_CRASH ? (int)reason : 0]; *s && p < end;) *p++ = *s++;
+    for (const char* s = ".tfl"; *s && p < end;) *p++ = *s++;
+    *p = 0;
+    if (pathOut && pathBytes) { size_t n = std::min(pathBytes - 1, (size_t)(p - path)); std::memcpy(pathOut, path, n); pathOut[n] = 0; }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    uint8_t buf[4096];
+    std::memcpy(buf, "TFLT", 4);
+    flightPut(buf + 4, FLIGHT_VERSION, 2);
+    flightPut(buf + 6, sizeof(FlightSlot), 2);
+    flightPut(buf + 8, FLIGHT_CAPACITY, 4);
+    flightPut(buf + 12, reason, 4);
+    flightPut(buf + 16, detail, 4);
+    flightPut(buf + 20, (uint32_t)getpid(), 4);
+    flightPut(buf + 24, flightHead.load(std::memory_order_relaxed), 8);
+    flightPut(buf + 32, flightStartUnix, 8);
+    bool ok = write(fd, buf, FLIGHT_HEADER_SIZE) == (ssize_t)FLIGHT_HEADER_SIZE;
+    const uint32_t PER_CHUNK = sizeof(buf) / sizeof(FlightSlot);
+    for (uint32_t i = 0; ok && i < FLIGHT_CAPACITY; i += PER_CHUNK) {
+        for (uint32_t k = 0; k < PER_CHUNK; ++k) {
+            const FlightSlot& s = flightRing[i + k];
+            uint64_t seq = s.seq.load(std::memory_order_acquire);
+            for (int w = 0; w < 3; ++w) flightPut(buf + 32 * k + 8 + 8 * w, s.words[w].load(std::memory_order_relaxed), 8);
+            // a writer that reused the slot meanwhile leaves it torn: store it odd
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq) seq |= 1;
+            flightPut(buf + 32 * k, seq, 8);
+        }
+        ok = write(fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf);
+    }
+    return close(fd) == 0 && ok;
+}
+
+// --------------------------- WRITER ----------------------------
+// One dump at a time, written on the writer thread; the result is picked up with
+// flightDumpFinished.
+struct FlightWriter {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread thread;
+    FlightReason reason = FLIGHT_DUMP_REQUEST;
+    uint32_t detail = 0;
+    bool pending = false, quit = false;
+    std::atomic<bool> busy{false};       // queued or being written
+    std::atomic<bool> finished{false};   // written, not picked up yet
+    bool ok = false;
+    char path[400] = "";
+
+    ~FlightWriter() { stop(); }
+
+    void start();
+    void stop() {
+        if (!thread.joinable()) return;
+        { std::lock_guard<std::mutex> lk(mtx); quit = true; }
+        cv.notify_one();
+        thread.join();
+    }
+
+    void loop() {
+        std::unique_lock<std::mutex> lk(mtx);
+        for (;;) {
+            cv.wait(lk, [&] { return pending || quit; });
+            if (!pending) return;                   // a queued dump still goes out on quit
+            pending = false;
+            FlightReason r = reason;
+            uint32_t d = detail;
+            lk.unlock();
+            char p[sizeof(path)];
+            bool written = flightDump(r, d, p, sizeof(p));
+            lk.lock();
+            std::memcpy(path, p, sizeof(path));
+            ok = written;
+            finished.store(true, std::memory_order_release);
+            busy.store(false, std::memory_order_release);
+        }
+    }
+};
+inline FlightWriter flightWriter;
+
+// Queues a dump for the writer thread; false if one is still queued or being written
+// or flightStart has not run.
+inline bool flightRequestDump(FlightReason reason, uint32_t detail = 0) {
+    if (!flightWriter.thread.joinable() || flightWriter.busy.exchange(true, std::memory_order_acq_rel)) return false;
+    {
+        std::lock_guard<std::mutex> lk(flightWriter.mtx);
+        flightWriter.reason = reason;
+        flightWriter.detail = detail;
+        flightWriter.pending = true;
+    }
+    flightWriter.cv.notify_one();
+    return true;
+}
+
+// True once per dump the writer finished, with its path and whether it was written.
+inline bool flightDumpFinished(char* pathOut, size_t pathBytes, bool& ok) {
+    if (!flightWriter.finished.load(std::memory_order_acquire)) return false;
+    std::lock_guard<std::mutex> lk(flightWriter.mtx);
+    size_t n = std::min(pathBytes - 1, std::strlen(flightWriter.path));
+    std::memcpy(pathOut, flightWriter.path, n);
+    pathOut[n] = 0;
+    ok = flightWriter.ok;
+    flightWriter.finished.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+// Waits for a queued dump and stops the writer thread.
+inline void flightStop() { flightWriter.stop(); }
+
+// --------------------------- FRAMES ----------------------------
+// Once per frame with the frame's length and the CPU part of it, in seconds. Queues a
+// dump when the frame went over the hitch threshold, at most once every 10 seconds.
+// Returns true if it queued one.
+inline bool flightFrame(double frameSeconds, double cpuSeconds) {
+    uint32_t us = (uint32_t)(frameSeconds * 1e6);
+    flightFrameNo.fetch_add(1, std::memory_order_relaxed);
+    flightRecord(FLIGHT_FRAME, 0, us, (uint32_t)(cpuSeconds * 1e6));
+    if (!flightHitchUs || us < flightHitchUs) return false;
+    flightEvent(FLIGHT_EV_HITCH, us);
+    uint64_t now = flightClock(CLOCK_MONOTONIC) - flightStartMono;
+    if (flightLastHitchDump && now - flightLastHitchDump < 10000000000ull) return false;
+    flightLastHitchDump = now;
+    return flightRequestDump(FLIGHT_DUMP_HITCH, us);
+}
+
+// --------------------------- CRASHES ----------------------------
+inline void flightCrashHandler(int sig) {
+    flightDump(FLIGHT_DUMP_CRASH, (uint32_t)sig);
+    raise(sig);                                   // SA_RESETHAND put the default action back
+}
+
+// Gives the calling thread an alternate signal stack for the crash handler, freed when
+// the thread exits. Once per thread; later calls do nothing.
+inline void flightThreadStart() {
+    struct AltStack {
+        void* mem = nullptr;
+        ~AltStack() {
+            if (!mem) return;
+            stack_t ss{};
+            ss.ss_flags = SS_DISABLE;
+            sigaltstack(&ss, nullptr);
+            std::free(mem);
+        }
+    };
+    static thread_local AltStack alt;
+    if (alt.mem || !(alt.mem = std::malloc(FLIGHT_ALT_STACK_SIZE))) return;
+    stack_t ss{};
+    ss.ss_sp = alt.mem;
+    ss.ss_size = FLIGHT_ALT_STACK_SIZE;
+    sigaltstack(&ss, nullptr);
+}
+
+inline void FlightWriter::start() {
+    if (!thread.joinable()) thread = std::thread([this] { flightThreadStart(); loop(); });
+}
+
+// Starts the clock, sets where dumps go and the hitch threshold (0 for none) and
+// installs the crash handlers, on an alternate stack so a stack overflow still dumps,
+// and starts the writer thread.
+inline void flightStart(const char* dir, double hitchMs) {
+    flightStartMono = flightClock(CLOCK_MONOTONIC);
+    flightStartUnix = flightClock(CLOCK_REALTIME);
+    flightHitchUs = hitchMs > 0 ? (uint64_t)(hitchMs * 1000.0) : 0;
+    size_t n = std::min(std::strlen(dir), sizeof(flightDir) - 1);
+    std::memcpy(flightDir, dir, n);
+    flightDir[n] = 0;
+
+    flightThreadStart();
+    struct sigaction sa{};
+    sa.sa_handler = flightCrashHandler;
+    sa.sa_flags = SA_RESETHAND | SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    for (int sig : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) sigaction(sig, &sa, nullptr);
+    flightWriter.start();
+}
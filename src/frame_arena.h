@@ -0,0 +1,102 @@
+// frame_arena.h
+// Per-frame linear arena for temporaries, and heap allocation counters.
+//
+// FrameArena hands out memory from one block reserved up front by bumping a pointer;
+// reset() at the top of a frame takes it all back at once. Nothing is freed one by
+// one and destructors do not run, so it is for trivially destructible data and for
+// FrameVector, whose deallocate is a no-op. A request that does not fit goes to the
+// heap (counted in spills) rather than failing; the high-water mark shows how big the
+// block has to be.
+//
+// heapAllocations() counts operator new calls, on the calling thread and in total,
+// in programs that include alloc_counter.h (the game in debug builds, tools/alloc_check).
+// Elsewhere it stays 0.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// --------------------------- ALLOCATION COUNTERS ----------------------------
+inline std::atomic<uint64_t> heapAllocationsTotal{0};
+inline thread_local uint64_t heapAllocationsThread = 0;
+inline bool heapAllocationsCounted = false;      // set by alloc_counter.h
+
+inline uint64_t heapAllocations() { return heapAllocationsThread; }
+
+// --------------------------- ARENA ----------------------------
+class FrameArena {
+public:
+    explicit FrameArena(size_t bytes) : block(new unsigned char[bytes]), cap(bytes) {}
+    ~FrameArena() { release(); }
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        size_t at = (top + align - 1) & ~(align - 1);
+        if (at + bytes > cap) {
+            ++spills;
+            void* p = ::operator new(bytes, std::align_val_t(align));
+            spilled.push_back({p, align});
+            return p;
+        }
+        top = at + bytes;
+        peak = std::max(peak, top);
+        return block.get() + at;
+    }
+
+    template <class T> T* alloc(size_t n = 1) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is reclaimed without running destructors");
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    bool owns(const void* p) const { return p >= block.get() && p < block.get() + cap; }
+
+    // Start of a frame: everything handed out since the last reset is gone.
+    void reset() {
+        release();
+        top = 0;
+    }
+
+    size_t used() const { return top; }
+    size_t capacity() const { return cap; }
+    size_t highWater() const { return peak; }
+    uint64_t spills = 0;
+
+private:
+    struct Spill { void* p; size_t align; };
+
+    void release() {
+        for (const Spill& s : spilled) ::operator delete(s.p, std::align_val_t(s.align));
+        spilled.clear();   // keeps its capacity: after the first spill this does not allocate again
+    }
+
+    std::unique_ptr<unsigned char[]> block;
+    size_t cap, top = 0, peak = 0;
+    std::vector<Spill> spilled;
+};
+
+// std::allocator stand-in that takes from a FrameArena. Growing a FrameVector leaves the
+// old buffer in the arena until the next reset, so reserve what a frame usually needs.
+template <class T>
+struct FrameAllocator {
+    using value_type = T;
+    FrameArena* arena;
+
+    explicit FrameAllocator(FrameArena& a) : arena(&a) {}
+    template <class U> FrameAllocator(const FrameAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <class U> bool operator==(const FrameAllocator<U>& o) const { return arena == o.arena; }
+    template <class U> bool operator!=(const FrameAllocator<U>& o) const { return arena != o.arena; }
+};
+
+template <class T> using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,475 @@
+// jobs.h
+// Shared work-stealing job scheduler for the game and the tools.
+//
+// Every thread that runs jobs owns a slot: a fixed-size Chase-Lev deque, where the
+// owner pushes and pops at the bottom and idle threads steal from the top, and a ring
+// of job records, so creating and running jobs does not allocate. A job may have a
+// parent; the parent counts as finished once its own function and all its children
+// have run, which is what wait() waits for. parallelFor splits a range in halves on
+// demand, so the deques stay short and the range spreads over whoever is idle.
+//
+// With main-thread participation the thread that builds the system gets a slot of
+// its own and runs jobs while it is in wait(); it does not run jobs otherwise. Other
+// threads (and the main thread without participation) submit through a locked queue
+// and block in wait(). Background jobs, long anytime loops such as the bot search,
+// go to a queue only the workers take from, so a thread waiting for a short job never
+// picks one up and stalls behind it.
+//
+// Each slot counts jobs run, steals and the time spent running jobs versus looking
+// for one or sleeping; report() prints them per worker.
+
+#pragma once
+
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+const int JOB_DEQUE_SIZE = 4096;     // per slot, power of two; a full deque runs the job inline
+const int JOB_POOL_SIZE = 4096;      // job records per slot, reused round-robin
+const int JOB_QUEUE_SIZE = 4096;     // shared and background queues, power of two
+const size_t JOB_PAYLOAD = 88;       // bytes of captured state a job function may carry
+
+// --------------------------- JOB ----------------------------
+struct alignas(64) Job {
+    void (*invoke)(Job&) = nullptr;   // runs the payload, then destroys it
+    Job* parent = nullptr;
+    std::atomic<int> unfinished{0};   // own function + unfinished children; 0: done
+    bool background = false;
+    alignas(std::max_align_t) unsigned char payload[JOB_PAYLOAD];
+
+    bool done() const { return unfinished.load(std::memory_order_acquire) == 0; }
+};
+
+// Fixed-capacity work-stealing deque (Chase-Lev, with the C11 orderings of Lê et al.).
+class JobDeque {
+public:
+    // Owner only. False when full.
+    bool push(Job* j) {
+        int64_t b = bottom.load(std::memory_order_relaxed), t = top.load(std::memory_order_acquire);
+        if (b - t >= JOB_DEQUE_SIZE) return false;
+        ring[b & (JOB_DEQUE_SIZE - 1)].store(j, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only, newest first.
+    Job* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) { bottom.store(b + 1, std::memory_order_relaxed); return nullptr; }
+        Job* j = ring[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+        if (t == b) {   // last one: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) j = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return j;
+    }
+
+    // Any thread, oldest first.
+    Job* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Job* j = ring[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+        return j;
+    }
+
+    bool empty() const { return top.load(std::memory_order_relaxed) >= bottom.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Job*> ring[JOB_DEQUE_SIZE] = {};
+};
+
+struct JobWorkerStats {
+    uint64_t jobs = 0, steals = 0, sleeps = 0;
+    double busySeconds = 0.0, idleSeconds = 0.0;
+};
+
+// Fixed-capacity FIFO of jobs for the shared queues; the scheduler locks around it.
+struct JobRing {
+    std::unique_ptr<Job*[]> items{new Job*[JOB_QUEUE_SIZE]};
+    uint32_t head = 0, tail = 0;
+
+    bool push(Job* j) {
+        if (tail - head == (uint32_t)JOB_QUEUE_SIZE) return false;
+        items[tail++ & (JOB_QUEUE_SIZE - 1)] = j;
+        return true;
+    }
+    Job* pop() { return head == tail ? nullptr : items[head++ & (JOB_QUEUE_SIZE - 1)]; }
+};
+
+// --------------------------- SCHEDULER ----------------------------
+class JobSystem {
+public:
+    // threads: total threads running jobs, the calling thread included when it
+    // participates; 0 for one per hardware thread. There is always at least one worker.
+    explicit JobSystem(int threads = 0, bool mainParticipates = true) {
+        if (threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency());
+        workers = std::max(1, threads - (mainParticipates ? 1 : 0));
+        int n = workers + (mainParticipates ? 1 : 0);
+        slots.reset(new Slot[n]);
+        slotCount = n;
+        for (int i = 0; i < n; ++i) slots[i].pool.reset(new Job[JOB_POOL_SIZE]);
+        externalPool.reset(new Job[JOB_POOL_SIZE]);
+        started = Clock::now();
+        if (mainParticipates) bindSlot(workers);
+        for (int i = 0; i < workers; ++i) threadList.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~JobSystem() {
+        quit.store(true, std::memory_order_seq_cst);
+        { std::lock_guard<std::mutex> lk(sleepMtx); ++wakeEpoch; }
+        sleepCv.notify_all();
+        for (auto& t : threadList) t.join();
+        if (currentSystem == this) currentSystem = nullptr;
+    }
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads that can run jobs: the workers, plus the participating main thread.
+    int threadCount() const { return slotCount; }
+    int workerCount() const { return workers; }
+    // The calling thread's slot in [0, threadCount()), or -1 outside the system. Valid
+    // inside any job, for per-thread scratch indexed by slot.
+    int currentSlot() const { return currentSystem == this ? currentSlotIndex : -1; }
+
+    // A job running f, which takes no arguments or the Job&. With a parent, the parent
+    // is not done until this one is. Nothing runs until run().
+    template <class F>
+    Job* create(F&& f, Job* parent = nullptr) {
+        using Fn = typename std::decay<F>::type;
+        static_assert(sizeof(Fn) <= JOB_PAYLOAD, "job payload too large: capture less or capture a pointer");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned job payload");
+        Job* j = allocate();
+        new (j->payload) Fn(std::forward<F>(f));
+        j->invoke = [](Job& job) {
+            Fn& fn = *std::launder(reinterpret_cast<Fn*>(job.payload));
+            if constexpr (std::is_invocable<Fn&, Job&>::value) fn(job);
+            else fn();
+            fn.~Fn();
+        };
+        j->parent = parent;
+        j->background = false;
+        if (parent) parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        j->unfinished.store(1, std::memory_order_relaxed);
+        return j;
+    }
+
+    // Queues the job: on the calling thread's deque, or the shared queue from outside.
+    void run(Job* j) {
+        int s = currentSlot();
+        if (s >= 0) {
+            if (!slots[s].deque.push(j)) { execute(j, s); return; }   // full: run it here
+            wakeOne();
+        } else enqueue(injected, injectedCount, j);
+    }
+
+    // Queues a long-running job for the workers only. wait() runs these only inside
+    // another background job, never on a thread that waits for short work (a frame).
+    void runBackground(Job* j) {
+        j->background = true;
+        enqueue(background, backgroundCount, j);
+    }
+
+    // Returns once j and its children are done. A thread with a slot runs other jobs
+    // meanwhile; any other thread blocks.
+    void wait(const Job* j) {
+        int s = currentSlot();
+        if (s < 0) { waitBlocking(j); return; }
+        Slot& me = slots[s];
+        // a wait inside a job is part of that job's busy time
+        bool timed = me.depth++ == 0;
+        Clock::time_point mark = Clock::now();
+        int misses = 0;
+        while (!j->done()) {
+            Job* next = findJob(s, me.inBackground);
+            if (!next) {
+                if (++misses > 64) std::this_thread::yield();
+                continue;
+            }
+            misses = 0;
+            if (!timed) { execute(next, s); continue; }
+            Clock::time_point t = Clock::now();
+            me.idleNs.fetch_add(nanos(t - mark), std::memory_order_relaxed);
+            execute(next, s);
+            mark = Clock::now();
+            me.busyNs.fetch_add(nanos(mark - t), std::memory_order_relaxed);
+        }
+        if (timed) me.idleNs.fetch_add(nanos(Clock::now() - mark), std::memory_order_relaxed);
+        --me.depth;
+    }
+
+    // f(i) for every i in [begin, end), in chunks of about grain, then returns. The
+    // calling thread takes part if it has a slot.
+    template <class F>
+    void parallelFor(int begin, int end, int grain, F&& f) {
+        if (end <= begin) return;
+        grain = std::max(1, grain);
+        using Fn = typename std::remove_reference<F>::type;
+        Fn* fp = &f;
+        Job* root = create([this, begin, end, grain, fp](Job& self) { split(&self, begin, end, grain, fp); });
+        run(root);
+        wait(root);
+    }
+
+    // f(i) for every i in [0, count): f(0) on the calling thread, the rest as background
+    // jobs, then returns. For loops that run until they are told to stop (searches,
+    // generators), which must not land in a frame's wait() the way parallelFor chunks can.
+    template <class F>
+    void runLoops(int count, F&& f) {
+        if (count <= 0) return;
+        using Fn = typename std::remove_reference<F>::type;
+        Fn* fp = &f;
+        Job* group = create([] {});
+        for (int i = 1; i < count; ++i) runBackground(create([fp, i] { (*fp)(i); }, group));
+        f(0);
+        run(group);
+        wait(group);
+    }
+
+    // Per-slot counters; the time is since the system started.
+    JobWorkerStats stats(int slot) const {
+        const Slot& s = slots[slot];
+        JobWorkerStats st;
+        st.jobs = s.jobs.load(std::memory_order_relaxed);
+        st.steals = s.steals.load(std::memory_order_relaxed);
+        st.sleeps = s.sleeps.load(std::memory_order_relaxed);
+        st.busySeconds = s.busyNs.load(std::memory_order_relaxed) / 1e9;
+        st.idleSeconds = s.idleNs.load(std::memory_order_relaxed) / 1e9;
+        return st;
+    }
+
+    // One line per slot: jobs, steals, busy and idle time, and the busy share of the
+    // time since the start. The main thread only counts time spent in wait().
+    void report(std::ostream& out) const {
+        double wall = std::chrono::duration<double>(Clock::now() - started).count();
+        out << "Job system: " << workers << (workers == 1 ? " worker" : " workers") << (slotCount > workers ? " + main thread" : "") << ", " << wall << " s\n";
+        char line[160];
+        for (int i = 0; i < slotCount; ++i) {
+            JobWorkerStats st = stats(i);
+            std::snprintf(line, sizeof(line), "  %-7s %2d %10llu jobs %8llu steals %8llu sleeps  busy %8.3f s  idle %8.3f s  %5.1f%% busy\n",
+                          i < workers ? "worker" : "main", i, (unsigned long long)st.jobs, (unsigned long long)st.steals,
+                          (unsigned long long)st.sleeps, st.busySeconds, st.idleSeconds, wall > 0 ? 100.0 * st.busySeconds / wall : 0.0);
+            out << line;
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    static uint64_t nanos(Clock::duration d) { return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(); }
+
+    struct alignas(64) Slot {
+        JobDeque deque;
+        std::unique_ptr<Job[]> pool;
+        uint32_t nextJob = 0;
+        uint32_t rng = 0x9e3779b9u;
+        int depth = 0;                   // jobs and waits in progress on the owner
+        bool inBackground = false;       // running a background job: its waits may take others
+        alignas(64) std::atomic<uint64_t> jobs{0}, steals{0}, sleeps{0}, busyNs{0}, idleNs{0};
+    };
+
+    static inline thread_local JobSystem* currentSystem = nullptr;
+    static inline thread_local int currentSlotIndex = -1;
+
+    void bindSlot(int s) {
+        currentSystem = this;
+        currentSlotIndex = s;
+        slots[s].rng += (uint32_t)s * 0x85ebca6bu;
+    }
+
+    // A record from the calling thread's ring (or the shared one). A record still in
+    // use after JOB_POOL_SIZE newer jobs is waited for before it is reused.
+    Job* allocate() {
+        int s = currentSlot();
+        Job* j;
+        if (s >= 0) {
+            Slot& me = slots[s];
+            j = &me.pool[me.nextJob++ & (JOB_POOL_SIZE - 1)];
+        } else {
+            std::lock_guard<std::mutex> lk(externalMtx);
+            j = &externalPool[externalNext++ & (JOB_POOL_SIZE - 1)];
+        }
+        if (!j->done()) wait(j);
+        return j;
+    }
+
+    void finish(Job* j) {
+        while (j) {
+            Job* parent = j->parent;
+            if (j->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+            if (!parent && blockedWaiters.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lk(doneMtx);
+                doneCv.notify_all();
+            }
+            j = parent;
+        }
+    }
+
+    void execute(Job* j, int slot) {
+        Slot& me = slots[slot];
+        bool outer = me.inBackground;
+        me.inBackground = outer || j->background;
+        j->invoke(*j);
+        me.inBackground = outer;
+        finish(j);
+        me.jobs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template <class Fn>
+    void split(Job* parent, int lo, int hi, int grain, Fn* f) {
+        while (hi - lo > grain) {
+            int mid = lo + (hi - lo) / 2;
+            run(create([this, parent, mid, hi, grain, f] { split(parent, mid, hi, grain, f); }, parent));
+            hi = mid;
+        }
+        for (int i = lo; i < hi; ++i) (*f)(i);
+    }
+
+    // Adds j to a shared ring. When the ring is full, a thread with a slot runs j itself
+    // (as run() does with a full deque) and any other thread waits for the workers.
+    void enqueue(JobRing& q, std::atomic<int>& count, Job* j) {
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lk(queueMtx);
+                if (q.push(j)) { count.fetch_add(1, std::memory_order_relaxed); break; }
+            }
+            int s = currentSlot();
+            if (s >= 0) { execute(j, s); return; }
+            wakeOne();
+            std::this_thread::yield();
+        }
+        wakeOne();
+    }
+
+    Job* takeQueued(JobRing& q, std::atomic<int>& count) {
+        if (count.load(std::memory_order_relaxed) == 0) return nullptr;
+        std::lock_guard<std::mutex> lk(queueMtx);
+        Job* j = q.pop();
+        if (j) count.fetch_sub(1, std::memory_order_relaxed);
+        return j;
+    }
+
+    // Own deque, then the shared queue, then a steal from a random victim; background
+    // jobs last and only for workers outside wait().
+    Job* findJob(int s, bool takeBackground) {
+        Slot& me = slots[s];
+        if (Job* j = me.deque.pop()) return j;
+        if (Job* j = takeQueued(injected, injectedCount)) return j;
+        me.rng ^= me.rng << 13; me.rng ^= me.rng >> 17; me.rng ^= me.rng << 5;
+        for (int k = 0, start = (int)(me.rng % (uint32_t)slotCount); k < slotCount; ++k) {
+            int victim = (start + k) % slotCount;
+            if (victim == s) continue;
+            if (Job* j = slots[victim].deque.steal()) { me.steals.fetch_add(1, std::memory_order_relaxed); return j; }
+        }
+        return takeBackground ? takeQueued(background, backgroundCount) : nullptr;
+    }
+
+    bool anyWork() const {
+        if (injectedCount.load(std::memory_order_relaxed) || backgroundCount.load(std::memory_order_relaxed)) return true;
+        for (int i = 0; i < slotCount; ++i) if (!slots[i].deque.empty()) return true;
+        return false;
+    }
+
+    void wakeOne() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) == 0) return;
+        { std::lock_guard<std::mutex> lk(sleepMtx); ++wakeEpoch; }
+        sleepCv.notify_one();
+    }
+
+    void workerLoop(int s) {
+        flightThreadStart();
+        bindSlot(s);
+        Slot& me = slots[s];
+        Clock::time_point mark = Clock::now();
+        int misses = 0;
+        while (!quit.load(std::memory_order_relaxed)) {
+            Job* j = findJob(s, true);
+            if (j) {
+                misses = 0;
+                Clock::time_point t = Clock::now();
+                me.idleNs.fetch_add(nanos(t - mark), std::memory_order_relaxed);
+                ++me.depth;
+                execute(j, s);
+                --me.depth;
+                mark = Clock::now();
+                me.busyNs.fetch_add(nanos(mark - t), std::memory_order_relaxed);
+                continue;
+            }
+            if (++misses < 64) { std::this_thread::yield(); continue; }
+            // announce the sleep, then look once more so a push that missed it is not lost
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!anyWork() && !quit.load(std::memory_order_relaxed)) {
+                me.sleeps.fetch_add(1, std::memory_order_relaxed);
+                std::unique_lock<std::mutex> lk(sleepMtx);
+                uint64_t epoch = wakeEpoch;
+                sleepCv.wait_for(lk, std::chrono::milliseconds(5), [&] { return wakeEpoch != epoch; });
+            }
+            sleeping.fetch_sub(1, std::memory_order_relaxed);
+            misses = 0;
+        }
+        me.idleNs.fetch_add(nanos(Clock::now() - mark), std::memory_order_relaxed);
+    }
+
+    void waitBlocking(const Job* j) {
+        blockedWaiters.fetch_add(1, std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lk(doneMtx);
+        while (!j->done()) doneCv.wait_for(lk, std::chrono::milliseconds(1));
+        blockedWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    int workers = 1, slotCount = 1;
+    std::unique_ptr<Slot[]> slots;
+    std::vector<std::thread> threadList;
+    Clock::time_point started;
+
+    std::mutex queueMtx;
+    JobRing injected, background;
+    std::atomic<int> injectedCount{0}, backgroundCount{0};
+
+    std::mutex externalMtx;
+    std::unique_ptr<Job[]> externalPool;
+    uint32_t externalNext = 0;
+
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    uint64_t wakeEpoch = 0;
+    std::atomic<int> sleeping{0};
+    std::atomic<bool> quit{false};
+
+    std::mutex doneMtx;
+    std::condition_variable doneCv;
+    std::atomic<int> blockedWaiters{0};
+};
+
+// --------------------------- SHARED INSTANCE ----------------------------
+// Set these before the first jobSystem() call (command line parsing); the system is
+// built on first use by the thread that calls it, which becomes the main thread.
+inline int jobThreads = 0;
+inline bool jobMainParticipates = true;
+
+inline JobSystem& jobSystem() {
+    static JobSystem js(jobThreads, jobMainParticipates);
+    return js;
+}
@@ -0,0 +1,227 @@
+// live_state.h
+// Live game state in POSIX shared memory for outside readers (stream overlays,
+// analytics, a debugger): the game publishes a snapshot once per frame and readers map
+// the segment read-only and copy it out whenever they like. No locks, no sockets, and
+// nothing a reader does can stall the game.
+//
+// The segment is a seqlock. The writer makes the sequence odd, stores the snapshot and
+// makes it even again; a reader copies the snapshot between two reads of the sequence
+// and retries if they differ or were odd. The snapshot is stored as relaxed atomic
+// 64-bit words so the racing copy is well defined; publishing is ~40 plain stores.
+//
+// Segment: "TLIV" | u16 version | u16 snapshot bytes | u32 writer pid | u32 0 | seq | words
+
+#pragma once
+
+#include "bitboard.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+const uint16_t LIVE_VERSION = 1;
+const char LIVE_DEFAULT_NAME[] = "/tetris_live";
+
+enum LiveFlags : uint8_t { LIVE_GAME_OVER = 1, LIVE_VERSUS = 2, LIVE_CASCADE = 4, LIVE_PLAYBACK = 8 };
+
+struct LiveSnapshot {
+    uint64_t frame = 0;           // frames published so far
+    uint32_t tick = 0;            // game clock (replay ticks)
+    uint32_t pieceSerial = 0;
+    uint16_t rows[BOARD_H] = {};  // settled cells, bit x = column x; the falling piece is not in them
+    int8_t piece = 0, next = 0, rotation = 0, x = 0, y = 0;
+    uint8_t flags = 0;            // LiveFlags
+    uint16_t gravityTicks = 0, gravityTimer = 0;
+    uint16_t pad = 0;
+    // frame stats, microseconds
+    uint32_t frameUs = 0;         // last frame
+    uint32_t frameAvgUs = 0;      // exponential average over about a second
+    uint32_t frameWorstUs = 0;    // worst of the last 60 frames
+    uint32_t publishNs = 0;       // what the previous publish cost the game
+};
+static_assert(std::is_trivially_copyable<LiveSnapshot>::value && sizeof(LiveSnapshot) % 8 == 0, "snapshots are copied as 64-bit words");
+
+const size_t LIVE_WORDS = sizeof(LiveSnapshot) / 8;
+
+struct LiveSegment {
+    char magic[4];
+    uint16_t version;
+    uint16_t snapshotBytes;
+    uint32_t writerPid;
+    uint32_t reserved;
+    alignas(64) std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[LIVE_WORDS];
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the seqlock must not hide a lock in shared memory");
+
+// --------------------------- WRITER ----------------------------
+class LivePublisher {
+public:
+    ~LivePublisher() { close(); }
+
+    // Creates the segment. False with errno EEXIST if another running game publishes
+    // under that name; a segment left behind by a game that died is taken over.
+    bool open(const std::string& name = LIVE_DEFAULT_NAME) {
+        close();
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        for (int tries = 0; fd < 0 && errno == EEXIST && tries < 3; ++tries) {
+            if (!removeIfAbandoned(name)) { errno = EEXIST; return false; }
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        }
+        if (fd < 0) return false;
+        bool ok = ftruncate(fd, sizeof(LiveSegment)) == 0;
+        void* p = ok ? mmap(nullptr, sizeof(LiveSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (p == MAP_FAILED) { shm_unlink(name.c_str()); return false; }
+        seg = (LiveSegment*)p;
+        segName = name;
+        std::memcpy(seg->magic, "TLIV", 4);
+        seg->version = LIVE_VERSION;
+        seg->snapshotBytes = (uint16_t)sizeof(LiveSnapshot);
+        seg->writerPid = (uint32_t)getpid();
+        seg->seq.store(0, std::memory_order_relaxed);
+        snap = LiveSnapshot{};
+        return true;
+    }
+
+    // Unmaps and removes the segment, which open created; readers still attached keep
+    // the last snapshot.
+    void close() {
+        if (!seg) return;
+        munmap(seg, sizeof(LiveSegment));
+        shm_unlink(segName.c_str());
+        seg = nullptr;
+    }
+
+    bool isOpen() const { return seg != nullptr; }
+
+    // One call per frame with the frame's length in seconds.
+    void publish(const GameState& g, uint32_t tick, float dt, uint8_t flags) {
+        if (!seg) return;
+        auto t0 = std::chrono::steady_clock::now();
+        uint32_t us = (uint32_t)std::min(dt * 1e6f, 4e9f);
+        snap.frameUs = us;
+        snap.frameAvgUs = snap.frame ? (uint32_t)(snap.frameAvgUs + ((int64_t)us - snap.frameAvgUs) / 60) : us;
+        recent[snap.frame % 60] = us;
+        snap.frameWorstUs = 0;
+        for (uint32_t r : recent) snap.frameWorstUs = std::max(snap.frameWorstUs, r);
+        ++snap.frame;
+        snap.tick = tick;
+        snap.pieceSerial = g.pieceSerial;
+        BitBoard bb;
+        toBitBoard(g.board, bb);
+        std::memcpy(snap.rows, bb.rows, sizeof(snap.rows));
+        snap.piece = (int8_t)g.currentPieceIndex;
+        snap.next = (int8_t)g.nextPieceIndex;
+        snap.rotation = (int8_t)pieceRotation(g.currentPieceIndex, g.currentPiece.blocks);
+        snap.x = (int8_t)g.currentPos.x;
+        snap.y = (int8_t)g.currentPos.y;
+        snap.flags = (uint8_t)(flags | (g.gameOver ? LIVE_GAME_OVER : 0) | (g.cascade ? LIVE_CASCADE : 0));
+        snap.gravityTicks = g.gravityTicks;
+        snap.gravityTimer = g.gravityTimer;
+        write(snap);
+        snap.publishNs = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    void write(const LiveSnapshot& s) {
+        uint64_t w[LIVE_WORDS];
+        std::memcpy(w, &s, sizeof(w));
+        uint64_t q = seg->seq.load(std::memory_order_relaxed);
+        seg->seq.store(q + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < LIVE_WORDS; ++i) seg->words[i].store(w[i], std::memory_order_relaxed);
+        seg->seq.store(q + 2, std::memory_order_release);
+    }
+
+private:
+    // Unlinks name if it is a segment whose writer is gone. The check and the unlink
+    // happen under an exclusive flock, and a segment already unlinked is left alone, so
+    // of two games taking over the same leftover only one removes it. True if creating
+    // the segment is worth another try.
+    static bool removeIfAbandoned(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return errno == ENOENT;
+        bool retry = false;
+        struct stat st;
+        if (flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0) {
+            if (st.st_nlink == 0) retry = true;       // someone else already removed it
+            else if ((size_t)st.st_size >= sizeof(LiveSegment)) {
+                void* p = mmap(nullptr, sizeof(LiveSegment), PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED) {
+                    const LiveSegment* old = (const LiveSegment*)p;
+                    bool ours = std::memcmp(old->magic, "TLIV", 4) == 0;
+                    retry = ours && kill((pid_t)old->writerPid, 0) != 0 && errno == ESRCH && shm_unlink(name.c_str()) == 0;
+                    munmap(p, sizeof(LiveSegment));
+                }
+            }
+        }
+        ::close(fd);
+        return retry;
+    }
+
+    LiveSegment* seg = nullptr;
+    std::string segName;
+    LiveSnapshot snap;
+    uint32_t recent[60] = {};
+};
+
+// --------------------------- READER ----------------------------
+class LiveReader {
+public:
+    ~LiveReader() { close(); }
+
+    // False if there is no segment of that name or it is another version.
+    bool open(const std::string& name = LIVE_DEFAULT_NAME) {
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        void* p = mmap(nullptr, sizeof(LiveSegment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        seg = (const LiveSegment*)p;
+        if (std::memcmp(seg->magic, "TLIV", 4) != 0 || seg->version != LIVE_VERSION || seg->snapshotBytes != sizeof(LiveSnapshot)) { close(); return false; }
+        return true;
+    }
+
+    void close() {
+        if (seg) munmap((void*)seg, sizeof(LiveSegment));
+        seg = nullptr;
+    }
+
+    // Copies a consistent snapshot; false if the writer kept it busy for maxTries attempts.
+    // Yields now and then, in case the writer was preempted halfway through a publish.
+    bool read(LiveSnapshot& out, int maxTries = 1000) {
+        uint64_t w[LIVE_WORDS];
+        for (int t = 0; t < maxTries; ++t) {
+            if (t && t % 64 == 0) std::this_thread::yield();
+            uint64_t a = seg->seq.load(std::memory_order_acquire);
+            if (a & 1) { ++retries; continue; }
+            for (size_t i = 0; i < LIVE_WORDS; ++i) w[i] = seg->words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seg->seq.load(std::memory_order_relaxed) == a) {
+                std::memcpy(&out, w, sizeof(out));
+                return true;
+            }
+            ++retries;
+        }
+        return false;
+    }
+
+    uint32_t writerPid() const { return seg ? seg->writerPid : 0; }
+
+    long long retries = 0;
+
+private:
+    const LiveSegment* seg = nullptr;
+};
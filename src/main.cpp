@@ -18,6 +18,29 @@
 #include <map>
 #include <chrono>
 #include <cstring>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+#include "tetris_core.h"
+#include "bot.h"
+#include "replay.h"
+#include "analytics.h"
+#include "pc_solver.h"
+#include "training_export.h"
+#include "rollback.h"
+#include "spectator.h"
+#include "live_state.h"
+#include "flight_recorder.h"
+#include "perf_counters.h"
+#include "frame_arena.h"
+#include "jobs.h"
+#include "scene_cubes.h"
+#ifndef NDEBUG
+#include "alloc_counter.h"
+#endif
+#include "well3d.h"
 
 // --------------------------- SHADERS ----------------------------
 
@@ -325,133 +348,587 @@ float uiQuad[] = {
     0.0f, 0.0f
 };
 
-// --------------------------- TETRIS LOGIC ----------------------------
-const int BOARD_W = 10;
-const int BOARD_H = 20;
+// --------------------------- GAME STATE ----------------------------
+GameState player;
+
+bool keysProcessed[512] = {false};
+bool materialKeyProcessed[4] = {false,false,false,false};
+int currentMaterial = 0; // 0..2
 
-struct PieceDef {
-    std::vector<glm::ivec2> blocks;
-    glm::vec3 color;
+bool playbackMode = false; // showing a recorded game instead of playing
+bool cascadeMode = false;  // C or --cascade: groups fall after clears (tetris_core.h CASCADE)
+
+// replay heatmap overlay (--heatmap <file>, toggled with H)
+Heatmap heatmap;
+bool heatmapLoaded = false, showHeatmap = false;
+
+// --------------------------- VERSUS (CPU) ----------------------------
+// The CPU searches on worker threads (bot.h) with a per-piece time budget, then
+// types its placement out one input every cpuActionTicks ticks like a player would,
+// each input picked against the board as it is by then (nextPlacementInput).
+// Difficulty is the budget: faster hardware gets deeper into the search.
+struct CpuPlayer {
+    GameState state;
+    std::unique_ptr<BotSearch> bot;
+    Placement plan;
+    bool hasPlan = false;
+    unsigned planSerial = 0;
+    int inputsDone = 0;   // keys pressed for the plan; it drops after PLACEMENT_MAX_INPUTS
+    BotStats lastStats;
+    int actionTicks = 0;
+    // gravity and plan steps run on sim ticks, counted from the frame clock
+    double clock = 0.0;
+    uint32_t tick = 0;
+    // MonteCarlo throughput, printed every few seconds
+    long long rollouts = 0;
+    double rolloutSeconds = 0.0;
 };
 
-std::vector<PieceDef> PIECES;
+bool versusMode = false;
+CpuPlayer cpu;
+double cpuBudgetMs = 2.0;
+const double cpuBudgetMin = 0.25, cpuBudgetMax = 256.0;
+const int cpuActionTicks = 4; // one plan step every 4 ticks (~67 ms)
+// shared with other game and tool processes (placement_cache.h)
+PlacementCache placementCache;
+const char* placementCachePath = "placements.tplc";
+// learned evaluator for the CPU (--net <file>, nn_eval.h); M cycles to it once loaded
+NnEval cpuNet;
+bool cpuNetLoaded = false;
+
+// --------------------------- REPLAYS ----------------------------
+// Every player game is streamed (seed + inputs, entropy coded) into replays/*.trpl;
+// tools/replay_stats re-simulates them. The CPU side is not recorded. The player's
+// gravity runs on replay ticks so the decoder can derive every gravity step.
+ReplayWriter replay;
+double replayClock = 0.0;
+uint32_t replayTick = 0;
+uint16_t replayGravityTicks = 1;
+
+// --export <dir> also streams the player's pieces as training rows (training_export.h).
+TrainingExporter trainingExporter;
+TrainingObserver trainingObserver(trainingExporter);
+
+// The player's finesse: pieces placed with more shifts and turns than needed (finesse.h).
+FinesseCounter playerFinesse;
+
+void finishReplay() {
+    if (replay.isActive() && !replay.finish(replayTick)) std::cerr << "Failed to write replay\n";
+    if (trainingExporter.isOpen()) trainingObserver.onEnd(player, ACT_COUNT);
+}
 
-int board[BOARD_H][BOARD_W];
-PieceDef currentPiece;
-glm::ivec2 currentPos;
-float fallTime = 0.0f;
-const float fallInterval_default = 1.0f;
-float fallInterval = fallInterval_default;
-bool gameOver = false;
+int playerAction(GameAction a, int param = 0);
+
+void startGame() {
+    unsigned seed = gen();
+    flightEvent(FLIGHT_EV_START, seed);
+    finishReplay();
+    playbackMode = false;
+    player.cascade = cpu.state.cascade = cascadeMode;
+    resetGame(player, seed);
+    playerFinesse = FinesseCounter{};
+    std::error_code ec;
+    std::filesystem::create_directories("replays", ec);
+    std::string path = "replays/replay_" + std::to_string((long long)std::chrono::system_clock::now().time_since_epoch().count()) + ".trpl";
+    replayGravityTicks = gravityTicksFor(player);
+    if (!replay.start(path, seed, replayGravityTicks, player.cascade)) std::cerr << "Failed to open " << path << "\n";
+    replayClock = 0.0;
+    replayTick = 0;
+    if (versusMode) {
+        if (!cpu.bot) {
+            cpu.bot.reset(new BotSearch());
+            if (cpuNetLoaded) cpu.bot->setNetwork(&cpuNet);
+            if (placementCache.open(placementCachePath)) cpu.bot->setCache(&placementCache);
+            else std::cerr << "Failed to open " << placementCachePath << ", CPU runs without the placement cache\n";
+        }
+        resetGame(cpu.state, seed); // same seed -> same piece sequence for both sides
+        cpu.hasPlan = false;
+        cpu.actionTicks = 0;
+        cpu.clock = 0.0;
+        cpu.tick = 0;
+    }
+}
 
-int nextPieceIndex = 0;
+// Advances the replay clock and applies the gravity steps it crosses.
+void advancePlayerClock(float dt) {
+    if (player.gameOver) return;
+    replayClock += dt;
+    uint32_t now = (uint32_t)(replayClock * REPLAY_TICK_HZ);
+    while (replayTick < now && !player.gameOver) {
+        PerfScope perf(PERF_TICK);
+        ++replayTick;
+        flightRecord(FLIGHT_TICK, 0, replayTick, player.pieceSerial);
+        if (replayTick % replayGravityTicks != 0) continue;
+        if (actionLocksPiece(player, ACT_GRAVITY)) perf.end();   // the lock is its own region, not part of the tick
+        playerAction(ACT_GRAVITY);
+    }
+}
 
-std::mt19937 gen((unsigned)std::chrono::system_clock::now().time_since_epoch().count());
-std::uniform_int_distribution<> pieceDist(0,6);
+// --------------------------- PLAYBACK ----------------------------
+// --replay <file> plays the first record of the file back in real time, decoding
+// events only as the clock reaches them. Left/Right seek 10 s, Down/Up 60 s (through
+// the keyframe index); R (or V) leaves for a normal game.
+struct Playback {
+    std::vector<uint8_t> file;
+    ReplayView view;
+    std::unique_ptr<ReplayReader> reader;
+    ReplayEvent pending;
+    bool hasPending = false;
+    double clock = 0.0;
+};
+Playback playback;
+
+bool startPlayback(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    playback.file.clear();
+    uint8_t chunk[4096];
+    for (size_t n; (n = std::fread(chunk, 1, sizeof(chunk), f)) > 0;) playback.file.insert(playback.file.end(), chunk, chunk + n);
+    std::fclose(f);
+    if (!parseReplay(playback.file.data(), playback.file.size(), playback.view)) return false;
+    versusMode = false;
+    playbackMode = true;
+    player.cascade = playback.view.cascade;
+    resetGame(player, playback.view.seed);
+    playback.reader.reset(new ReplayReader(playback.view));
+    playback.hasPending = playback.reader->next(playback.pending);
+    playback.clock = 0.0;
+    return true;
+}
 
-bool keysProcessed[512] = {false};
-bool materialKeyProcessed[4] = {false,false,false,false};
-int currentMaterial = 0; // 0..2
+void seekPlayback(double seconds) {
+    double t = std::max(0.0, playback.clock + seconds);
+    uint32_t tick = (uint32_t)(t * playback.view.tickHz);
+    playback.hasPending = seekReplay(playback.view, *playback.reader, player, tick, playback.pending);
+    playback.clock = t;
+}
 
-void initPieces(){
-    PIECES = {
-        {{{ -1,0 }, {0,0}, {1,0}, {2,0} }, {0.0f,0.8f,1.0f}}, // I
-        {{{0,0},{1,0},{0,1},{1,1} }, {1.0f,0.9f,0.0f}},       // O
-        {{{ -1,0 }, {0,0}, {1,0}, {0,1} }, {0.8f,0.0f,0.8f}}, // T
-        {{{ -1,0 }, {0,0}, {0,1}, {1,1} }, {0.0f,0.9f,0.0f}}, // S
-        {{{ 1,0 }, {0,0}, {0,1}, {-1,1} }, {0.9f,0.0f,0.0f}}, // Z
-        {{{ -1,0 }, {0,0}, {1,0}, {1,1} }, {0.0f,0.0f,0.9f}}, // J
-        {{{ -1,0 }, {0,0}, {1,0}, {-1,1} }, {1.0f,0.5f,0.0f}}  // L
-    };
+void updatePlayback(float dt) {
+    playback.clock += dt;
+    double now = playback.clock * playback.view.tickHz;
+    while (playback.hasPending && playback.pending.tick <= now) {
+        applyReplayEvent(player, playback.pending);
+        playback.hasPending = playback.reader->next(playback.pending);
+    }
 }
 
-void resetBoard() { std::memset(board, 0, sizeof(board)); }
+// Routes garbage from a lock that cleared `lines` to the other side.
+void sendGarbage(GameState& target, int lines) {
+    int rows = garbageForLines(lines);
+    if (!versusMode || rows == 0) return;
+    int param = garbageParam(rows, std::uniform_int_distribution<>(0, BOARD_W - 1)(gen));
+    if (&target == &player) playerAction(ACT_GARBAGE, param); // recorded: the hole is random
+    else applyAction(target, ACT_GARBAGE, param);
+}
 
-void spawnNewPiece() {
-    int pieceIndex = nextPieceIndex;
-    currentPiece = PIECES[pieceIndex];
-    currentPos = glm::ivec2(BOARD_W / 2 - 1, 0);
-    nextPieceIndex = pieceDist(gen);
-    for (const auto& b : currentPiece.blocks) {
-        int x = currentPos.x + b.x;
-        int y = currentPos.y + b.y;
-        if (y >= 0 && board[y][x] != 0) {
-            gameOver = true;
-            break;
-        }
+// Every change to the player's game goes through here so it lands in the replay.
+int playerAction(GameAction a, int param) {
+    if (player.gameOver) return 0;
+    if (a != ACT_GRAVITY) flightRecord(FLIGHT_INPUT, a, replayTick, (uint32_t)param);
+    replay.add(replayTick, a, param);
+    playerFinesse.onInput(player, a);
+    PerfScope lockPerf(actionLocksPiece(player, a) ? PERF_LOCK : PERF_REGION_COUNT);
+    int lines = trainingExporter.isOpen() ? applyReplayEvent(player, ReplayEvent{replayTick, (uint8_t)a, (uint8_t)param}, &trainingObserver)
+                                          : applyAction(player, a, param);
+    lockPerf.end();
+    if (replay.keyframeDue()) replay.keyframe(player, replayTick, (replayTick / replayGravityTicks + 1) * replayGravityTicks);
+    if (a != ACT_GARBAGE) sendGarbage(cpu.state, lines);
+    if (lines) flightEvent(FLIGHT_EV_LINES, (uint32_t)lines, replayTick);
+    if (player.gameOver) {
+        flightEvent(FLIGHT_EV_GAME_OVER, replayTick);
+        finishReplay();
+        std::cout << "Finesse: " << playerFinesse.faults << " of " << playerFinesse.pieces << " pieces over par, "
+                  << playerFinesse.extraKeys << " extra keys\n";
     }
+    return lines;
 }
 
-bool isValidMove(const glm::ivec2& newPos, const std::vector<glm::ivec2>& blocks) {
-    for (const auto& block : blocks) {
-        int x = newPos.x + block.x;
-        int y = newPos.y + block.y;
-        if (x < 0 || x >= BOARD_W || y >= BOARD_H) return false;
-        if (y >= 0 && board[y][x] != 0) return false;
+// Picks up the bot's plan for the current piece, starting a search if none runs.
+bool pollCpuPlan(GameState& g) {
+    if (!cpu.bot->busy()) { cpu.bot->start(g, cpuBudgetMs / 1000.0); cpu.planSerial = g.pieceSerial; }
+    if (!cpu.bot->poll(cpu.plan, &cpu.lastStats)) return false;
+    if (cpu.bot->evalMode() == BotEval::MonteCarlo) {
+        cpu.rollouts += cpu.lastStats.rollouts;
+        cpu.rolloutSeconds += cpu.lastStats.seconds;
+        if (cpu.rolloutSeconds >= 0.25) { // ~100 pieces at 2 ms
+            std::cout << "CPU rollouts/s: " << (long long)(cpu.rollouts / cpu.rolloutSeconds) << "\n";
+            cpu.rollouts = 0; cpu.rolloutSeconds = 0.0;
+        }
     }
+    if (cpu.planSerial != g.pieceSerial) return false; // stale result, search again next tick
+    cpu.hasPlan = true;
+    cpu.inputsDone = 0;
+    cpu.actionTicks = 0;
     return true;
 }
 
-void rotatePiece() {
-    bool isOPiece = true;
-    for (const auto& block : currentPiece.blocks) {
-        if (!(block.x >= 0 && block.x <= 1 && block.y >= 0 && block.y <= 1)) { isOPiece = false; break; }
+void updateCpu(float dt) {
+    GameState& g = cpu.state;
+    if (g.gameOver || player.gameOver) return;
+    cpu.clock += dt;
+    for (uint32_t now = (uint32_t)(cpu.clock * SIM_TICK_HZ); cpu.tick < now && !g.gameOver && !player.gameOver; ++cpu.tick) {
+        sendGarbage(player, updateGame(g));
+        if (g.gameOver) return;
+        if (cpu.hasPlan && cpu.planSerial != g.pieceSerial) cpu.hasPlan = false; // gravity locked it first
+        if (!cpu.hasPlan && !pollCpuPlan(g)) continue;
+        if (++cpu.actionTicks < cpuActionTicks) continue;
+        cpu.actionTicks = 0;
+        GameAction a = ++cpu.inputsDone < PLACEMENT_MAX_INPUTS ? nextPlacementInput(g, cpu.plan.rotation, cpu.plan.x) : ACT_HARD_DROP;
+        if (a != ACT_HARD_DROP) { applyAction(g, a); continue; }
+        sendGarbage(player, hardDrop(g));
+        cpu.hasPlan = false;
     }
-    if (isOPiece) return;
-    std::vector<glm::ivec2> rotated = currentPiece.blocks;
-    for (auto& b : rotated) { int nx = b.y; int ny = -b.x; b.x = nx; b.y = ny; }
-    std::vector<glm::ivec2> kicks = {{0,0},{1,0},{-1,0},{0,1},{0,-1},{1,1},{-1,1},{1,-1},{-1,-1}};
-    for (auto &k : kicks) { glm::ivec2 pos = currentPos + k; if (isValidMove(pos, rotated)) { currentPiece.blocks = rotated; currentPos = pos; return; } }
 }
 
-void mergePiece() {
-    for (const auto& b : currentPiece.blocks) {
-        int x = currentPos.x + b.x;
-        int y = currentPos.y + b.y;
-        if (y >= 0) board[y][x] = 1;
+// --------------------------- PERFECT CLEAR HINT ----------------------------
+// P solves the player's board for a perfect clear with the current piece, the next one
+// and the pieces after it (the game has no hold) and prints the placements. The solve
+// is a background job, so frames keep coming; pollPerfectClearHint prints the result
+// once it is there. P while a solve is running does nothing.
+struct PcHint {
+    std::unique_ptr<PcSolver> solver;
+    BitBoard board;
+    std::vector<int> queue;
+    PcResult result;
+    std::atomic<bool> running{false};   // set by the main thread, cleared by the job
+    std::atomic<bool> ready{false};     // set by the job, cleared once printed
+};
+PcHint pcHint;
+const int pcHintPieces = 11;
+
+void startPerfectClearHint() {
+    if (pcHint.running.load(std::memory_order_acquire) || pcHint.ready.load(std::memory_order_acquire)) return;
+    if (!pcHint.solver) pcHint.solver = std::make_unique<PcSolver>(0, 20);
+    toBitBoard(player.board, pcHint.board);
+    pcHint.queue = {player.currentPieceIndex, player.nextPieceIndex};
+    PieceRng peek = player.rng;
+    while ((int)pcHint.queue.size() < pcHintPieces) pcHint.queue.push_back(randomPiece(peek));
+    pcHint.running.store(true, std::memory_order_relaxed);
+    JobSystem& js = jobSystem();
+    js.runBackground(js.create([] {
+        pcHint.result = pcHint.solver->solve(pcHint.board, pcHint.queue, false);
+        pcHint.ready.store(true, std::memory_order_release);
+        pcHint.running.store(false, std::memory_order_release);
+    }));
+}
+
+void pollPerfectClearHint() {
+    if (!pcHint.ready.load(std::memory_order_acquire)) return;
+    const PcResult& r = pcHint.result;
+    if (!r.found) std::cout << "No perfect clear within " << pcHintPieces << " pieces (" << r.seconds * 1000.0 << " ms)\n";
+    else {
+        static const char names[] = "IOTSZJL";
+        std::cout << r.height << "-line perfect clear (" << r.seconds * 1000.0 << " ms):";
+        for (const auto& m : r.moves) std::cout << " " << names[m.piece] << " r" << m.placement.rotation << " x" << m.placement.x;
+        std::cout << "\n";
     }
+    pcHint.ready.store(false, std::memory_order_release);
 }
 
-void clearLines() {
-    for (int y = BOARD_H - 1; y >= 0; --y) {
-        bool full = true;
-        for (int x = 0; x < BOARD_W; ++x) if (!board[y][x]) { full = false; break; }
-        if (full) {
-            for (int yy = y; yy > 0; --yy) for (int x = 0; x < BOARD_W; ++x) board[yy][x] = board[yy-1][x];
-            for (int x = 0; x < BOARD_W; ++x) board[0][x] = 0;
-            ++y;
-        }
+// --------------------------- NETPLAY ----------------------------
+// --host <port> / --join <host:port> play versus against another instance over UDP
+// with rollback (rollback.h). Both boards come from the session's simulation; this
+// side's presses are collected per frame and handed to it. Nothing is recorded.
+bool netMode = false;
+RollbackSession netSession;
+uint8_t netPressed = 0;
+bool netDesyncReported = false;
+
+void updateNetplay(float dt) {
+    bool wasConnected = netSession.connected();
+    netSession.update(dt, netPressed);
+    netPressed = 0;
+    if (!netSession.connected()) return;
+    if (!wasConnected) std::cout << "Connected, you are player " << netSession.localPlayer() + 1 << "\n";
+    player = netSession.state().players[netSession.localPlayer()];
+    cpu.state = netSession.state().players[1 - netSession.localPlayer()];
+    if (netSession.desynced() && !netDesyncReported) {
+        std::cerr << "Netplay desync detected\n";
+        flightEvent(FLIGHT_EV_DESYNC, netSession.state().tick);
+        netDesyncReported = true;
+    }
+}
+
+void printNetplayStats() {
+    const RollbackStats& st = netSession.stats();
+    std::cout << "Netplay: " << st.rollbacks << " rollbacks, deepest " << st.maxRollback << " ticks, slowest re-simulation "
+              << st.maxResimMs << " ms, " << st.stalls << " stalls\n";
+}
+
+// --------------------------- SPECTATORS ----------------------------
+// --spectate <port> streams the boards on screen to watchers (spectator.h);
+// --watch <host:port> shows such a stream instead of playing.
+SpectatorServer spectatorServer;
+SpectatorClient spectatorClient;
+bool watchMode = false;
+
+void publishSpectators() {
+    const GameState* games[2] = {&player, &cpu.state};
+    spectatorServer.submit(games, versusMode ? 2 : 1);
+}
+
+// --live [name] publishes the player's game to shared memory every frame for local
+// readers (live_state.h, tools/live_inspect); the name defaults to /tetris_live.
+LivePublisher livePublisher;
+
+void publishLive(float dt) {
+    uint32_t tick = playbackMode ? (uint32_t)(playback.clock * playback.view.tickHz) : replayTick;
+    uint8_t flags = (uint8_t)((versusMode ? LIVE_VERSUS : 0) | (playbackMode ? LIVE_PLAYBACK : 0));
+    livePublisher.publish(player, tick, dt, flags);
+}
+
+void updateWatch() {
+    if (!spectatorClient.poll()) return;
+    const SpectatorFrame& f = spectatorClient.state();
+    restoreGame(f.games[0], player);
+    if (f.count > 1) restoreGame(f.games[1], cpu.state);
+    versusMode = f.count > 1;
+}
+
+// --------------------------- FLIGHT RECORDER ----------------------------
+// The last ~30 s of inputs, ticks, frame and GPU pass times are always kept
+// (flight_recorder.h) and written to --flight <dir> (default flight/) on a crash, on F9,
+// or after a frame over --hitch-ms (default 100, 0 turns it off).
+std::string flightPath = "flight";
+double flightHitchMs = 100.0;
+
+// Timestamp queries around the render passes. A frame's queries are read back
+// GPU_TIMER_FRAMES frames later, when they are long done, so the CPU never waits on
+// the GPU for them; a set that is still not ready is dropped.
+struct GpuPassTimer {
+    static const int GPU_TIMER_FRAMES = 4;
+    GLuint queries[GPU_TIMER_FRAMES][GPU_PASS_COUNT + 1] = {};
+    uint32_t frameOf[GPU_TIMER_FRAMES] = {};
+    bool pending[GPU_TIMER_FRAMES] = {};
+    int slot = 0;
+
+    void init() { glGenQueries(GPU_TIMER_FRAMES * (GPU_PASS_COUNT + 1), &queries[0][0]); }
+    void destroy() { glDeleteQueries(GPU_TIMER_FRAMES * (GPU_PASS_COUNT + 1), &queries[0][0]); }
+
+    // Start of pass p; mark(GPU_PASS_COUNT) ends the last one.
+    void mark(int p) {
+        if (p == 0) collect();
+        glQueryCounter(queries[slot][p], GL_TIMESTAMP);
+    }
+
+    void endFrame(uint32_t frame) {
+        pending[slot] = true;
+        frameOf[slot] = frame;
+        slot = (slot + 1) % GPU_TIMER_FRAMES;
+    }
+
+private:
+    void collect() {
+        if (!pending[slot]) return;
+        pending[slot] = false;
+        GLint ready = 0;
+        glGetQueryObjectiv(queries[slot][GPU_PASS_COUNT], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) return;
+        GLuint64 t[GPU_PASS_COUNT + 1];
+        for (int p = 0; p <= GPU_PASS_COUNT; ++p) glGetQueryObjectui64v(queries[slot][p], GL_QUERY_RESULT, &t[p]);
+        for (int p = 0; p < GPU_PASS_COUNT; ++p) flightRecord(FLIGHT_GPU, (uint16_t)p, (uint32_t)std::min<GLuint64>(t[p + 1] - t[p], UINT32_MAX), frameOf[slot]);
+    }
+};
+GpuPassTimer gpuTimer;
+
+void dumpFlight(FlightReason reason) {
+    if (!flightRequestDump(reason)) std::cout << "Flight recorder is still being written\n";
+}
+
+// Reports a dump the writer thread finished (F9 or a hitch).
+void pollFlightDump() {
+    char path[512];
+    bool ok = false;
+    if (!flightDumpFinished(path, sizeof(path), ok)) return;
+    if (ok) std::cout << "Flight recorder written to " << path << "\n";
+    else std::cerr << "Failed to write " << path << "\n";
+}
+
+// --------------------------- FRAME MEMORY ----------------------------
+// Per-frame temporaries (the cube lists) come from frameArena, reset at the top of every
+// frame. --alloc-check (debug builds, where alloc_counter.h counts operator new) reports
+// frames that still reach the heap once the first ALLOC_WARMUP_FRAMES are over.
+FrameArena frameArena(1 << 20);
+const uint64_t ALLOC_WARMUP_FRAMES = 120;
+bool allocCheck = false;
+uint64_t allocFrame = 0, allocMark = 0, allocFrames = 0, allocCount = 0;
+
+void checkFrameAllocations() {
+    uint64_t now = heapAllocations();
+    uint64_t made = now - allocMark;
+    allocMark = now;
+    if (++allocFrame <= ALLOC_WARMUP_FRAMES || !made) return;
+    ++allocFrames;
+    allocCount += made;
+    // printing allocates too, so only the first few are reported as they happen
+    if (allocFrames <= 10) std::cerr << "Frame " << allocFrame << ": " << made << " heap allocations\n";
+    allocMark = heapAllocations();
+}
+
+void printAllocationStats() {
+    std::cout << "Allocations: " << allocFrames << " of " << (allocFrame > ALLOC_WARMUP_FRAMES ? allocFrame - ALLOC_WARMUP_FRAMES : 0)
+              << " frames after warm-up allocated (" << allocCount << " in all); frame arena peak " << frameArena.highWater()
+              << " of " << frameArena.capacity() << " bytes, " << frameArena.spills << " spills\n";
+}
+
+// --------------------------- VOLUMETRIC ----------------------------
+// G (or --well WxDxH) switches to the 3D well (well3d.h); the flat game waits meanwhile.
+// Arrows move the piece across the floor relative to the camera, Q/W/E turn it about
+// x/y/z, S soft drops, Space drops. Dragging with the left button orbits the camera,
+// with the right button moves it sideways and up or down, the wheel zooms, C puts it
+// back. Nothing is recorded or streamed.
+bool wellMode = false;
+Game3D well3d;
+int wellW = 5, wellD = 5, wellH = 12;
+double wellClock = 0.0;
+uint32_t wellTick = 0;
+
+struct OrbitCamera {
+    float yaw = 0.6f, pitch = 0.6f, distance = 24.0f;
+    glm::vec3 pan = glm::vec3(0.0f);   // where the camera looks, from the middle of the well
+    double lastX = 0.0, lastY = 0.0;
+    bool dragging = false, panning = false;
+};
+OrbitCamera orbit;
+
+void startWell() {
+    resetGame3D(well3d, gen(), wellW, wellD, wellH);
+    wellClock = 0.0;
+    wellTick = 0;
+    std::cout << "Volumetric mode: " << well3d.well.w << "x" << well3d.well.d << "x" << well3d.well.h << " well\n";
+}
+
+void updateWell(float dt) {
+    if (well3d.gameOver) return;
+    wellClock += dt;
+    uint32_t now = (uint32_t)(wellClock * SIM_TICK_HZ);
+    while (wellTick < now && !well3d.gameOver) {
+        ++wellTick;
+        updateGame3D(well3d);
     }
+    if (well3d.gameOver) std::cout << "Well filled: " << well3d.planes << " planes cleared\n";
+}
+
+void updateOrbit(GLFWwindow* window) {
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    bool down = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    bool panDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+    if (down && orbit.dragging) {
+        orbit.yaw -= (float)(x - orbit.lastX) * 0.01f;
+        orbit.pitch = std::max(-0.2f, std::min(1.5f, orbit.pitch + (float)(y - orbit.lastY) * 0.01f));
+    }
+    if (panDown && orbit.panning) {
+        // the grabbed point follows the cursor: screen-right is the camera's right, screen-up is world up
+        glm::vec3 right(std::cos(orbit.yaw), 0.0f, -std::sin(orbit.yaw));
+        float k = orbit.distance * 0.002f;
+        orbit.pan += -right * (float)(x - orbit.lastX) * k + glm::vec3(0.0f, (float)(y - orbit.lastY) * k, 0.0f);
+    }
+    orbit.dragging = down; orbit.panning = panDown; orbit.lastX = x; orbit.lastY = y;
+}
+
+void orbitScroll(GLFWwindow*, double, double dy) {
+    orbit.distance = std::max(6.0f, std::min(60.0f, orbit.distance * (float)std::pow(0.9, dy)));
+}
+
+glm::vec3 wellCenter() { return glm::vec3((well3d.well.w - 1) * 0.5f, (well3d.well.h - 1) * 0.5f, (well3d.well.d - 1) * 0.5f); }
+
+glm::vec3 orbitCenter() { return wellCenter() + orbit.pan; }
+
+glm::vec3 orbitEye() {
+    return orbitCenter() + orbit.distance * glm::vec3(std::cos(orbit.pitch) * std::sin(orbit.yaw), std::sin(orbit.pitch), std::cos(orbit.pitch) * std::cos(orbit.yaw));
 }
 
-void updateGame(float dt) {
-    if (gameOver) return;
-    fallTime += dt;
-    if (fallTime >= fallInterval) {
-        glm::ivec2 newPos = currentPos; newPos.y += 1;
-        if (isValidMove(newPos, currentPiece.blocks)) currentPos = newPos;
-        else { mergePiece(); clearLines(); spawnNewPiece(); }
-        fallTime = 0.0f;
+void processWellInput(GLFWwindow* window) {
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !keysProcessed[GLFW_KEY_C]) { orbit = OrbitCamera{}; keysProcessed[GLFW_KEY_C] = true; }
+    if (well3d.gameOver) {
+        if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !keysProcessed[GLFW_KEY_R]) { startWell(); keysProcessed[GLFW_KEY_R] = true; }
+        if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) keysProcessed[GLFW_KEY_R] = false;
+        return;
+    }
+    // the floor axis closest to screen-right, then counter-clockwise seen from above
+    static const Action3D ring[4] = {A3_RIGHT, A3_BACK, A3_LEFT, A3_FRONT};
+    int q = (int)std::floor(orbit.yaw / 1.5707964f + 0.5f) & 3;
+    const struct { int key; Action3D a; } binds[] = {
+        {GLFW_KEY_RIGHT, ring[q]}, {GLFW_KEY_UP, ring[(q + 1) & 3]}, {GLFW_KEY_LEFT, ring[(q + 2) & 3]}, {GLFW_KEY_DOWN, ring[(q + 3) & 3]},
+        {GLFW_KEY_Q, A3_TURN_X}, {GLFW_KEY_W, A3_TURN_Y}, {GLFW_KEY_E, A3_TURN_Z},
+        {GLFW_KEY_S, A3_SOFT_DROP}, {GLFW_KEY_SPACE, A3_HARD_DROP}
+    };
+    for (const auto& b : binds) {
+        if (glfwGetKey(window, b.key) == GLFW_PRESS && !keysProcessed[b.key]) { applyAction3D(well3d, b.a); keysProcessed[b.key] = true; }
+        if (glfwGetKey(window, b.key) == GLFW_RELEASE) keysProcessed[b.key] = false;
     }
 }
 
+// Player presses go to the local game, or to the rollback session in net mode.
+void pressAction(GameAction a) {
+    if (watchMode) return;
+    if (netMode) netPressed |= netInputBit(a);
+    else playerAction(a);
+}
+
 void processInput(GLFWwindow* window) {
-    if (gameOver) {
-        if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !keysProcessed[GLFW_KEY_R]) {
-            resetBoard(); gameOver = false; nextPieceIndex = pieceDist(gen); spawnNewPiece(); keysProcessed[GLFW_KEY_R] = true;
+    if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS && !keysProcessed[GLFW_KEY_F9]) { dumpFlight(FLIGHT_DUMP_REQUEST); keysProcessed[GLFW_KEY_F9] = true; }
+    if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_RELEASE) keysProcessed[GLFW_KEY_F9] = false;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && !keysProcessed[GLFW_KEY_V] && !netMode && !watchMode && !wellMode) { versusMode = !versusMode; startGame(); keysProcessed[GLFW_KEY_V] = true; }
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_RELEASE) keysProcessed[GLFW_KEY_V] = false;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !keysProcessed[GLFW_KEY_C] && !netMode && !watchMode && !wellMode) {
+        cascadeMode = !cascadeMode;
+        std::cout << "Cascade gravity: " << (cascadeMode ? "on" : "off") << "\n";
+        startGame();
+        keysProcessed[GLFW_KEY_C] = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE) keysProcessed[GLFW_KEY_C] = false;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !keysProcessed[GLFW_KEY_G] && !netMode && !watchMode && !playbackMode) {
+        wellMode = !wellMode;
+        if (wellMode && !well3d.pieceSerial) startWell();
+        keysProcessed[GLFW_KEY_G] = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) keysProcessed[GLFW_KEY_G] = false;
+    if (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS && !keysProcessed[GLFW_KEY_LEFT_BRACKET]) { cpuBudgetMs = std::max(cpuBudgetMin, cpuBudgetMs * 0.5); std::cout << "CPU budget: " << cpuBudgetMs << " ms\n"; keysProcessed[GLFW_KEY_LEFT_BRACKET] = true; }
+    if (glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_RELEASE) keysProcessed[GLFW_KEY_LEFT_BRACKET] = false;
+    if (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS && !keysProcessed[GLFW_KEY_RIGHT_BRACKET]) { cpuBudgetMs = std::min(cpuBudgetMax, cpuBudgetMs * 2.0); std::cout << "CPU budget: " << cpuBudgetMs << " ms\n"; keysProcessed[GLFW_KEY_RIGHT_BRACKET] = true; }
+    if (glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_RELEASE) keysProcessed[GLFW_KEY_RIGHT_BRACKET] = false;
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !keysProcessed[GLFW_KEY_M] && cpu.bot) {
+        BotEval e = cpu.bot->evalMode();
+        e = e == BotEval::Heuristic ? BotEval::MonteCarlo : (e == BotEval::MonteCarlo && cpuNetLoaded ? BotEval::Network : BotEval::Heuristic);
+        cpu.bot->setEval(e);
+        std::cout << "CPU evaluation: " << (e == BotEval::MonteCarlo ? "Monte Carlo" : e == BotEval::Network ? "network" : "heuristic") << "\n";
+        keysProcessed[GLFW_KEY_M] = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) keysProcessed[GLFW_KEY_M] = false;
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && !keysProcessed[GLFW_KEY_H]) { showHeatmap = heatmapLoaded && !showHeatmap; keysProcessed[GLFW_KEY_H] = true; }
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_RELEASE) keysProcessed[GLFW_KEY_H] = false;
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !keysProcessed[GLFW_KEY_P] && !playbackMode && !wellMode && !player.gameOver) { startPerfectClearHint(); keysProcessed[GLFW_KEY_P] = true; }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) keysProcessed[GLFW_KEY_P] = false;
+
+    if (playbackMode) {
+        static const struct { int key; double seconds; } seeks[] = {{GLFW_KEY_LEFT, -10.0}, {GLFW_KEY_RIGHT, 10.0}, {GLFW_KEY_DOWN, -60.0}, {GLFW_KEY_UP, 60.0}};
+        for (const auto& s : seeks) {
+            if (glfwGetKey(window, s.key) == GLFW_PRESS && !keysProcessed[s.key]) { seekPlayback(s.seconds); keysProcessed[s.key] = true; }
+            if (glfwGetKey(window, s.key) == GLFW_RELEASE) keysProcessed[s.key] = false;
+        }
+    }
+
+    if (wellMode) { processWellInput(window); return; }
+
+    bool over = player.gameOver || (versusMode && cpu.state.gameOver) || playbackMode;
+    if (over) {
+        if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !keysProcessed[GLFW_KEY_R] && !netMode && !watchMode) {
+            startGame(); keysProcessed[GLFW_KEY_R] = true;
         }
         if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) keysProcessed[GLFW_KEY_R] = false;
         return;
     }
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS && !keysProcessed[GLFW_KEY_LEFT]) { glm::ivec2 p = currentPos; p.x -= 1; if (isValidMove(p, currentPiece.blocks)) currentPos = p; keysProcessed[GLFW_KEY_LEFT] = true; }
+    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS && !keysProcessed[GLFW_KEY_LEFT]) { pressAction(ACT_LEFT); keysProcessed[GLFW_KEY_LEFT] = true; }
     if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_RELEASE) keysProcessed[GLFW_KEY_LEFT] = false;
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS && !keysProcessed[GLFW_KEY_RIGHT]) { glm::ivec2 p = currentPos; p.x += 1; if (isValidMove(p, currentPiece.blocks)) currentPos = p; keysProcessed[GLFW_KEY_RIGHT] = true; }
+    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS && !keysProcessed[GLFW_KEY_RIGHT]) { pressAction(ACT_RIGHT); keysProcessed[GLFW_KEY_RIGHT] = true; }
     if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_RELEASE) keysProcessed[GLFW_KEY_RIGHT] = false;
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS && !keysProcessed[GLFW_KEY_DOWN]) { glm::ivec2 p = currentPos; p.y += 1; if (isValidMove(p, currentPiece.blocks)) currentPos = p; keysProcessed[GLFW_KEY_DOWN] = true; }
+    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS && !keysProcessed[GLFW_KEY_DOWN]) { pressAction(ACT_SOFT_DROP); keysProcessed[GLFW_KEY_DOWN] = true; }
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_RELEASE) keysProcessed[GLFW_KEY_DOWN] = false;
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS && !keysProcessed[GLFW_KEY_UP]) { rotatePiece(); keysProcessed[GLFW_KEY_UP] = true; }
+    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS && !keysProcessed[GLFW_KEY_UP]) { pressAction(ACT_ROTATE); keysProcessed[GLFW_KEY_UP] = true; }
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_RELEASE) keysProcessed[GLFW_KEY_UP] = false;
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !keysProcessed[GLFW_KEY_SPACE]) { glm::ivec2 p = currentPos; while (isValidMove(p, currentPiece.blocks)) { currentPos = p; p.y += 1; } mergePiece(); clearLines(); spawnNewPiece(); keysProcessed[GLFW_KEY_SPACE] = true; }
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !keysProcessed[GLFW_KEY_SPACE]) { pressAction(ACT_HARD_DROP); keysProcessed[GLFW_KEY_SPACE] = true; }
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE) keysProcessed[GLFW_KEY_SPACE] = false;
 
     if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS && !materialKeyProcessed[1]) { currentMaterial = 0; materialKeyProcessed[1]=true; }
@@ -463,14 +940,29 @@ void processInput(GLFWwindow* window) {
 }
 
 // --------------------------- UI helpers ----------------------------
-void drawUIRect(GLuint uiProg, GLuint uiVAO, int winW, int winH, float x, float yBottom, float w, float h, glm::vec3 color) {
-    glUseProgram(uiProg);
+// The UI program with its uniform locations, looked up once at startup.
+struct UiUniforms {
+    GLuint prog;
+    GLint ortho, model, color;
+};
+
+UiUniforms loadUiUniforms(GLuint uiProg) {
+    UiUniforms u;
+    u.prog = uiProg;
+    u.ortho = glGetUniformLocation(uiProg, "uOrtho");
+    u.model = glGetUniformLocation(uiProg, "uModel");
+    u.color = glGetUniformLocation(uiProg, "uColor");
+    return u;
+}
+
+void drawUIRect(const UiUniforms& ui, GLuint uiVAO, int winW, int winH, float x, float yBottom, float w, float h, glm::vec3 color) {
+    glUseProgram(ui.prog);
     glm::mat4 ortho = glm::ortho(0.0f, (float)winW, 0.0f, (float)winH, -1.0f, 1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(uiProg, "uOrtho"), 1, GL_FALSE, glm::value_ptr(ortho));
+    glUniformMatrix4fv(ui.ortho, 1, GL_FALSE, glm::value_ptr(ortho));
     glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, yBottom, 0.0f));
     model = glm::scale(model, glm::vec3(w, h, 1.0f));
-    glUniformMatrix4fv(glGetUniformLocation(uiProg, "uModel"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3f(glGetUniformLocation(uiProg, "uColor"), color.r, color.g, color.b);
+    glUniformMatrix4fv(ui.model, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3f(ui.color, color.r, color.g, color.b);
     glBindVertexArray(uiVAO);
     glDisable(GL_DEPTH_TEST);
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -478,7 +970,7 @@ void drawUIRect(GLuint uiProg, GLuint uiVAO, int winW, int winH, float x, float
     glBindVertexArray(0);
 }
 
-void drawPreviewPieceUI(GLuint uiProg, GLuint uiVAO, int winW, int winH, int pieceIdx, float centerX, float centerY, float blockPixelSize) {
+void drawPreviewPieceUI(const UiUniforms& ui, GLuint uiVAO, int winW, int winH, int pieceIdx, float centerX, float centerY, float blockPixelSize) {
     const PieceDef& p = PIECES[pieceIdx];
     int minx=100, maxx=-100, miny=100, maxy=-100;
     for (auto &b : p.blocks) { if (b.x < minx) minx = b.x; if (b.x > maxx) maxx = b.x; if (b.y < miny) miny = b.y; if (b.y > maxy) maxy = b.y; }
@@ -492,13 +984,29 @@ void drawPreviewPieceUI(GLuint uiProg, GLuint uiVAO, int winW, int winH, int pie
         float bx = startX + (b.x - minx) * blockPixelSize;
         float byTop = startYTop + (b.y - miny) * blockPixelSize;
         float byBottom = (float)winH - (byTop + blockPixelSize);
-        drawUIRect(uiProg, uiVAO, winW, winH, bx, byBottom, blockPixelSize, blockPixelSize, p.color);
+        drawUIRect(ui, uiVAO, winW, winH, bx, byBottom, blockPixelSize, blockPixelSize, p.color);
     }
 }
 
+// Next polycube seen from above; cubes on the upper layer are lighter.
+void drawPreviewPolycubeUI(const UiUniforms& ui, GLuint uiVAO, int winW, int winH, int pieceIdx, float centerX, float centerY, float blockPixelSize) {
+    const Polycube& p = POLYCUBES[pieceIdx];
+    const PolycubeOrient& o = p.orients[0];
+    float startX = centerX - o.size.x * blockPixelSize / 2.0f;
+    float startYTop = centerY - o.size.z * blockPixelSize / 2.0f;
+    for (int y = 0; y < o.size.y; ++y)
+        for (const auto& c : o.cubes) {
+            if (c.y != y) continue;
+            float bx = startX + c.x * blockPixelSize;
+            float byBottom = (float)winH - (startYTop + (c.z + 1) * blockPixelSize);
+            drawUIRect(ui, uiVAO, winW, winH, bx, byBottom, blockPixelSize, blockPixelSize, p.color * (1.0f + 0.4f * c.y));
+        }
+}
+
 // --------------------------- Procedural textures ----------------------------
-GLuint genAlbedo(int size, int variant) {
-    std::vector<unsigned char> data(size*size*3);
+// The pixels are filled on the job system at startup; only the upload needs the GL thread.
+void fillAlbedo(std::vector<unsigned char>& data, int size, int variant) {
+    data.resize(size*size*3);
     for (int y=0;y<size;++y) for (int x=0;x<size;++x) {
         int idx = (y*size + x)*3;
         int checker = ((x/8)+(y/8)) & 1;
@@ -506,27 +1014,17 @@ GLuint genAlbedo(int size, int variant) {
         else if (variant==1) { if (checker) { data[idx+0]=220; data[idx+1]=120; data[idx+2]=60; } else { data[idx+0]=60; data[idx+1]=140; data[idx+2]=200; } }
         else { unsigned char v = checker?180:100; data[idx+0]=v; data[idx+1]=v; data[idx+2]=v; }
     }
-    GLuint t; glGenTextures(1,&t); glBindTexture(GL_TEXTURE_2D,t);
-    glTexImage2D(GL_TEXTURE_2D,0,GL_RGB8,size,size,0,GL_RGB,GL_UNSIGNED_BYTE,data.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-    return t;
 }
-GLuint genNormal(int size, int variant) {
-    std::vector<unsigned char> data(size*size*3);
+void fillNormal(std::vector<unsigned char>& data, int size, int variant) {
+    data.resize(size*size*3);
     for (int i=0;i<size*size;++i) { unsigned char nx=128, ny=128, nz=255; if (variant==2 && (i%13==0)) nx=138; data[i*3+0]=nx; data[i*3+1]=ny; data[i*3+2]=nz; }
-    GLuint t; glGenTextures(1,&t); glBindTexture(GL_TEXTURE_2D,t);
-    glTexImage2D(GL_TEXTURE_2D,0,GL_RGB8,size,size,0,GL_RGB,GL_UNSIGNED_BYTE,data.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-    return t;
 }
-GLuint genRough(int size, int variant) {
-    std::vector<unsigned char> data(size*size*3);
+void fillRough(std::vector<unsigned char>& data, int size, int variant) {
+    data.resize(size*size*3);
     unsigned char v = (variant==0?200:(variant==1?100:40));
     for (int i=0;i<size*size;++i) data[i*3+0]=data[i*3+1]=data[i*3+2]=v;
+}
+GLuint uploadTexture(int size, const std::vector<unsigned char>& data) {
     GLuint t; glGenTextures(1,&t); glBindTexture(GL_TEXTURE_2D,t);
     glTexImage2D(GL_TEXTURE_2D,0,GL_RGB8,size,size,0,GL_RGB,GL_UNSIGNED_BYTE,data.data());
     glGenerateMipmap(GL_TEXTURE_2D);
@@ -535,16 +1033,57 @@ GLuint genRough(int size, int variant) {
     return t;
 }
 
-// --------------------------- DRAW CUBE (bind VAO) ----------------------------
-void drawCubePBR(GLuint pbrProg, GLuint cubeVAO, const glm::mat4& model, const glm::vec3& color, float metallic, float ao, bool useAlbedoMap) {
-    glUseProgram(pbrProg);
-    glUniformMatrix4fv(glGetUniformLocation(pbrProg,"uModel"),1,GL_FALSE,glm::value_ptr(model));
-    glUniform3f(glGetUniformLocation(pbrProg,"albedo"), color.r, color.g, color.b);
-    glUniform1f(glGetUniformLocation(pbrProg,"metallic"), metallic);
-    glUniform1f(glGetUniformLocation(pbrProg,"ao"), ao);
-    glUniform1i(glGetUniformLocation(pbrProg,"uUseAlbedoMap"), useAlbedoMap?1:0);
+// --------------------------- DRAW CUBES ----------------------------
+// The scene is queued as cube lists in the frame arena (scene_cubes.h) and drawn here,
+// with the uniform locations looked up once at startup instead of by name for every cube.
+struct PbrUniforms {
+    GLint model, albedo, metallic, ao, useAlbedoMap;
+    GLint proj, view, camPos;
+    GLint lightPositions[4], lightColors[4];
+};
+
+PbrUniforms loadPbrUniforms(GLuint pbrProg) {
+    PbrUniforms u;
+    u.model = glGetUniformLocation(pbrProg,"uModel");
+    u.albedo = glGetUniformLocation(pbrProg,"albedo");
+    u.metallic = glGetUniformLocation(pbrProg,"metallic");
+    u.ao = glGetUniformLocation(pbrProg,"ao");
+    u.useAlbedoMap = glGetUniformLocation(pbrProg,"uUseAlbedoMap");
+    u.proj = glGetUniformLocation(pbrProg,"uProj");
+    u.view = glGetUniformLocation(pbrProg,"uView");
+    u.camPos = glGetUniformLocation(pbrProg,"camPos");
+    for (int i=0;i<4;i++){
+        std::string idx = "[" + std::to_string(i) + "]";
+        u.lightPositions[i] = glGetUniformLocation(pbrProg,("lightPositions" + idx).c_str());
+        u.lightColors[i] = glGetUniformLocation(pbrProg,("lightColors" + idx).c_str());
+    }
+    return u;
+}
+
+// Bloom pass uniforms, looked up once like the PBR ones.
+struct BloomUniforms {
+    GLint threshold, horizontal, bloomFactor;
+};
+
+BloomUniforms loadBloomUniforms(GLuint brightProg, GLuint blurProg, GLuint finalProg) {
+    BloomUniforms u;
+    u.threshold = glGetUniformLocation(brightProg,"threshold");
+    u.horizontal = glGetUniformLocation(blurProg,"horizontal");
+    u.bloomFactor = glGetUniformLocation(finalProg,"bloomFactor");
+    return u;
+}
+
+// Expects pbrProg in use.
+void drawCubes(const PbrUniforms& u, GLuint cubeVAO, const CubeList& cubes) {
     glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    for (const CubeDraw& c : cubes) {
+        glUniformMatrix4fv(u.model,1,GL_FALSE,glm::value_ptr(c.model));
+        glUniform3f(u.albedo, c.color.r, c.color.g, c.color.b);
+        glUniform1f(u.metallic, c.metallic);
+        glUniform1f(u.ao, c.ao);
+        glUniform1i(u.useAlbedoMap, c.useAlbedoMap);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
     glBindVertexArray(0);
 }
 
@@ -616,10 +1155,79 @@ void deleteFramebuffers(Framebuffers& fbo) {
 }
 
 // --------------------------- MAIN ----------------------------
-int main(){
+int main(int argc, char** argv){
     // init
     initPieces();
-    resetBoard();
+    initPolycubes();
+    std::string replayPath;
+    for (int i = 1; i < argc; ++i) if (std::string(argv[i]) == "--cascade") cascadeMode = true;
+    // --perf: hardware counters for the tick, piece locks, bot search and render submission,
+    // printed at exit (perf_counters.h)
+    for (int i = 1; i < argc; ++i) if (std::string(argv[i]) == "--perf" && !perfEnable())
+        std::cerr << "Hardware counters unavailable (" << std::strerror(perfError) << "), --perf ignored\n";
+    for (int i = 1; i < argc; ++i) if (std::string(argv[i]) == "--alloc-check") {
+        allocCheck = heapAllocationsCounted;
+        if (!allocCheck) std::cerr << "Allocation counting is only in debug builds, --alloc-check ignored\n";
+    }
+    // --jobs N: threads for the job system (jobs.h), the main thread included; --job-stats
+    // prints how busy each of them was at exit
+    bool jobStats = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--jobs" && i + 1 < argc) jobThreads = std::atoi(argv[i+1]);
+        if (std::string(argv[i]) == "--job-stats") jobStats = true;
+    }
+    jobSystem();   // built here, so the main thread is the one that takes part
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) != "--live") continue;
+        std::string name = i + 1 < argc && argv[i+1][0] == '/' ? argv[i+1] : LIVE_DEFAULT_NAME;
+        if (livePublisher.open(name)) std::cout << "Publishing live state to " << name << "\n";
+        else if (errno == EEXIST) std::cerr << "Another game is publishing live state to " << name << "; pass --live another name\n";
+        else std::cerr << "Failed to open shared memory " << name << "\n";
+    }
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--heatmap") {
+            heatmapLoaded = showHeatmap = loadHeatmap(argv[i+1], heatmap);
+            if (!heatmapLoaded) std::cerr << "Failed to load heatmap " << argv[i+1] << "\n";
+        }
+        if (std::string(argv[i]) == "--replay") replayPath = argv[i+1];
+        if (std::string(argv[i]) == "--net") {
+            cpuNetLoaded = loadNnEval(argv[i+1], cpuNet);
+            if (cpuNetLoaded) std::cout << "CPU network " << argv[i+1] << " (" << nnKernelName() << " kernel), M to select\n";
+            else std::cerr << "Failed to load network " << argv[i+1] << "\n";
+        }
+        if (std::string(argv[i]) == "--export" && !trainingExporter.open(argv[i+1], true)) std::cerr << "Failed to open " << argv[i+1] << "\n";
+        if (std::string(argv[i]) == "--host") {
+            netMode = netSession.host((uint16_t)std::atoi(argv[i+1]), (uint32_t)gen());
+            if (netMode) std::cout << "Waiting for a player on port " << netSession.port() << "\n";
+            else std::cerr << "Failed to listen on port " << argv[i+1] << "\n";
+        }
+        if (std::string(argv[i]) == "--join") {
+            std::string addr = argv[i+1];
+            size_t colon = addr.rfind(':');
+            netMode = colon != std::string::npos && netSession.join(addr.substr(0, colon), (uint16_t)std::atoi(addr.c_str() + colon + 1));
+            if (!netMode) std::cerr << "Failed to join " << addr << " (expected host:port)\n";
+        }
+        if (std::string(argv[i]) == "--spectate") {
+            if (spectatorServer.start((uint16_t)std::atoi(argv[i+1]))) std::cout << "Spectators can watch on port " << spectatorServer.port() << "\n";
+            else std::cerr << "Failed to open spectator port " << argv[i+1] << "\n";
+        }
+        if (std::string(argv[i]) == "--flight") flightPath = argv[i+1];
+        if (std::string(argv[i]) == "--hitch-ms") flightHitchMs = std::atof(argv[i+1]);
+        if (std::string(argv[i]) == "--well") {
+            wellMode = std::sscanf(argv[i+1], "%dx%dx%d", &wellW, &wellD, &wellH) == 3;
+            if (!wellMode) std::cerr << "Failed to parse well size " << argv[i+1] << " (expected WxDxH)\n";
+        }
+        if (std::string(argv[i]) == "--watch") {
+            std::string addr = argv[i+1];
+            size_t colon = addr.rfind(':');
+            watchMode = colon != std::string::npos && spectatorClient.connect(addr.substr(0, colon), (uint16_t)std::atoi(addr.c_str() + colon + 1));
+            if (!watchMode) std::cerr << "Failed to watch " << addr << " (expected host:port)\n";
+        }
+    }
+    versusMode = versusMode || netMode;
+    std::error_code flightEc;
+    std::filesystem::create_directories(flightPath, flightEc);
+    flightStart(flightPath.c_str(), flightHitchMs);
 
     if (!glfwInit()) { std::cerr<<"GLFW init failed\n"; return -1; }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
@@ -633,6 +1241,7 @@ int main(){
     GLFWwindow* window = glfwCreateWindow(INIT_WIN_W, INIT_WIN_H, "Tetris PBR + HDR+BLOOM (NEXT preview only)", nullptr, nullptr);
     if (!window) { glfwTerminate(); return -1; }
     glfwMakeContextCurrent(window);
+    glfwSetScrollCallback(window, orbitScroll);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { std::cerr<<"Failed to init glad\n"; return -1; }
 
@@ -677,24 +1286,38 @@ int main(){
     // textures (3 materials)
     const int TEX = 128;
     std::array<GLuint,3> albedoT, normalT, roughT;
-    for (int i=0;i<3;i++){ albedoT[i]=genAlbedo(TEX,i); normalT[i]=genNormal(TEX,i); roughT[i]=genRough(TEX,i); }
+    std::array<std::vector<unsigned char>,9> texData;
+    jobSystem().parallelFor(0, 9, 1, [&](int k) {
+        if (k < 3) fillAlbedo(texData[k], TEX, k);
+        else if (k < 6) fillNormal(texData[k], TEX, k - 3);
+        else fillRough(texData[k], TEX, k - 6);
+    });
+    for (int i=0;i<3;i++){ albedoT[i]=uploadTexture(TEX,texData[i]); normalT[i]=uploadTexture(TEX,texData[3+i]); roughT[i]=uploadTexture(TEX,texData[6+i]); }
 
     // assign samplers once
     glUseProgram(pbrProg);
     glUniform1i(glGetUniformLocation(pbrProg,"albedoMap"), 0);
     glUniform1i(glGetUniformLocation(pbrProg,"normalMap"), 1);
     glUniform1i(glGetUniformLocation(pbrProg,"roughnessMap"), 2);
+    const PbrUniforms pbrUniforms = loadPbrUniforms(pbrProg);
     glUseProgram(quadProg_bright); glUniform1i(glGetUniformLocation(quadProg_bright,"scene"), 0);
     glUseProgram(quadProg_blur); glUniform1i(glGetUniformLocation(quadProg_blur,"image"), 0);
     glUseProgram(quadProg_final); glUniform1i(glGetUniformLocation(quadProg_final,"scene"), 0); glUniform1i(glGetUniformLocation(quadProg_final,"bloom"), 1);
+    const BloomUniforms bloomUniforms = loadBloomUniforms(quadProg_bright, quadProg_blur, quadProg_final);
+    const UiUniforms ui = loadUiUniforms(uiProg);
 
     // Create framebuffers with initial size
     Framebuffers mainFBO;
     createFramebuffers(mainFBO, INIT_WIN_W, INIT_WIN_H);
+    gpuTimer.init();
 
     // init pieces and spawn
-    nextPieceIndex = pieceDist(gen);
-    spawnNewPiece();
+    if (!netMode && !watchMode && (replayPath.empty() || !startPlayback(replayPath))) {
+        if (!replayPath.empty()) std::cerr << "Failed to load replay " << replayPath << "\n";
+        startGame();
+    }
+    wellMode = wellMode && !netMode && !watchMode && !playbackMode;
+    if (wellMode) startWell();
 
     // runtime params
     float brightThreshold = 1.0f;
@@ -702,15 +1325,29 @@ int main(){
     float bloomFactor = 1.0f;
 
     double last = glfwGetTime();
+    double cpuSeconds = 0.0;   // the last frame up to its swap
 
     while (!glfwWindowShouldClose(window)){
         double cur = glfwGetTime();
         float dt = (float)(cur - last);
         last = cur;
+        if (flightFrame(dt, cpuSeconds)) std::cout << "Frame took " << dt * 1000.0f << " ms, writing the flight recorder\n";
+        pollFlightDump();
+        if (allocCheck) checkFrameAllocations();
+        frameArena.reset();
 
         processInput(window);
-        updateGame(dt);
-
+        pollPerfectClearHint();
+        if (watchMode) updateWatch();
+        else if (netMode) updateNetplay(dt);
+        else if (wellMode) { updateOrbit(window); updateWell(dt); }
+        else if (playbackMode) updatePlayback(dt);
+        else if (!(versusMode && cpu.state.gameOver)) advancePlayerClock(dt);
+        if (versusMode && !netMode && !watchMode && !wellMode) updateCpu(dt);
+        if (spectatorServer.isOpen()) publishSpectators();
+        if (livePublisher.isOpen()) publishLive(dt);
+
+        PerfScope renderPerf(PERF_RENDER);
         int winW, winH; 
         glfwGetFramebufferSize(window, &winW, &winH);
         
@@ -721,6 +1358,7 @@ int main(){
         }
 
         // 1) Render scene to HDR FBO
+        gpuTimer.mark(GPU_SCENE);
         glBindFramebuffer(GL_FRAMEBUFFER, mainFBO.hdrFBO);
         glViewport(0, 0, winW, winH);
         glClearColor(0.02f,0.02f,0.03f,1.0f);
@@ -734,80 +1372,74 @@ int main(){
         // render scene
         glUseProgram(pbrProg);
         glm::mat4 proj = glm::perspective(glm::radians(45.0f), (float)winW/(float)winH, 0.1f, 100.0f);
-        glm::mat4 view = glm::lookAt(glm::vec3(BOARD_W/2.0f, BOARD_H/2.0f, 25.0f),
-                                     glm::vec3(BOARD_W/2.0f, BOARD_H/2.0f, 0.0f),
-                                     glm::vec3(0.0f,1.0f,0.0f));
-        glUniformMatrix4fv(glGetUniformLocation(pbrProg,"uProj"),1,GL_FALSE,glm::value_ptr(proj));
-        glUniformMatrix4fv(glGetUniformLocation(pbrProg,"uView"),1,GL_FALSE,glm::value_ptr(view));
-        glUniform3f(glGetUniformLocation(pbrProg,"camPos"), BOARD_W/2.0f, BOARD_H/2.0f, 25.0f);
+        // versus: frame both boards by pulling the camera back and centering between them
+        float camX = versusMode ? (BOARD_W + VERSUS_OFFSET_X)/2.0f : BOARD_W/2.0f;
+        float camZ = versusMode ? 32.0f : 25.0f;
+        glm::vec3 eye(camX, BOARD_H/2.0f, camZ), center(camX, BOARD_H/2.0f, 0.0f);
+        // volumetric: free camera, orbiting the point it was moved to
+        if (wellMode) { center = orbitCenter(); eye = orbitEye(); }
+        glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f,1.0f,0.0f));
+        glUniformMatrix4fv(pbrUniforms.proj,1,GL_FALSE,glm::value_ptr(proj));
+        glUniformMatrix4fv(pbrUniforms.view,1,GL_FALSE,glm::value_ptr(view));
+        glUniform3f(pbrUniforms.camPos, eye.x, eye.y, eye.z);
 
         // lights
-        std::array<glm::vec3,4> lightPos = {
+        static const std::array<glm::vec3,4> boardLightPos = {
             glm::vec3(BOARD_W/2.0f, BOARD_H/2.0f, 20.0f),
             glm::vec3(-5.0f, 10.0f, 15.0f),
             glm::vec3(BOARD_W + 5.0f, 10.0f, 15.0f),
             glm::vec3(BOARD_W/2.0f, BOARD_H + 5.0f, 15.0f)
         };
-        std::array<glm::vec3,4> lightCol = {
+        static const std::array<glm::vec3,4> lightCol = {
             glm::vec3(400.0f,350.0f,300.0f),
             glm::vec3(100.0f),
             glm::vec3(100.0f),
             glm::vec3(100.0f)
         };
-        for (int i=0;i<4;i++){
-            std::string posn = "lightPositions[" + std::to_string(i) + "]";
-            std::string coln = "lightColors[" + std::to_string(i) + "]";
-            glUniform3fv(glGetUniformLocation(pbrProg,posn.c_str()),1,&lightPos[i][0]);
-            glUniform3fv(glGetUniformLocation(pbrProg,coln.c_str()),1,&lightCol[i][0]);
+        std::array<glm::vec3,4> lightPos = boardLightPos;
+        if (wellMode) {
+            // key light rides with the camera, fills around and above the well
+            float r = (float)std::max(well3d.well.w, well3d.well.d) + 6.0f;
+            lightPos = {eye + glm::vec3(0.0f, 3.0f, 0.0f), center + glm::vec3(-r, 4.0f, r), center + glm::vec3(r, 4.0f, -r), center + glm::vec3(0.0f, well3d.well.h * 0.5f + 6.0f, 0.0f)};
         }
-
-        // draw board (occupied cells)
-        for (int y=0;y<BOARD_H;++y) for (int x=0;x<BOARD_W;++x) {
-            if (board[y][x] != 0) {
-                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)x, (float)(BOARD_H - y - 1), 0.0f));
-                model = glm::scale(model, glm::vec3(1.0f,1.0f,0.8f));
-                drawCubePBR(pbrProg, cubeVAO, model, glm::vec3(0.5f,0.5f,0.5f), 0.0f, 1.0f, 0);
-            }
-        }
-
-        // draw current piece (with albedo map)
-        if (!gameOver) {
-            for (const auto &b : currentPiece.blocks) {
-                int x = currentPos.x + b.x;
-                int y = currentPos.y + b.y;
-                if (y >= 0) {
-                    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)x, (float)(BOARD_H - y - 1), 0.0f));
-                    model = glm::scale(model, glm::vec3(1.0f,1.0f,0.8f));
-                    float metallic = (currentMaterial==2)?0.6f:0.0f;
-                    drawCubePBR(pbrProg, cubeVAO, model, currentPiece.color, metallic, 1.0f, 1);
-                }
-            }
+        for (int i=0;i<4;i++){
+            glUniform3fv(pbrUniforms.lightPositions[i],1,&lightPos[i][0]);
+            glUniform3fv(pbrUniforms.lightColors[i],1,&lightCol[i][0]);
         }
 
-        // subtle grid lines
-        for (int x=0;x<=BOARD_W;++x) for (int y=0;y<=BOARD_H;++y) {
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x-0.5f, BOARD_H - y - 0.5f, -0.1f));
-            model = glm::scale(model, glm::vec3(1.0f,1.0f,0.05f));
-            drawCubePBR(pbrProg, cubeVAO, model, glm::vec3(0.12f,0.12f,0.12f), 0.0f, 1.0f, 0);
+        SceneInput scene;
+        scene.pieceMetallic = currentMaterial==2 ? 0.6f : 0.0f;
+        if (wellMode) scene.well = &well3d;
+        else {
+            scene.player = &player;
+            if (showHeatmap) scene.heatmap = &heatmap;
+            if (versusMode) scene.cpu = &cpu.state;
         }
+        SceneCubes cubes(frameArena);
+        buildSceneCubes(cubes, scene);
+        drawCubes(pbrUniforms, cubeVAO, cubes.board);
+        drawCubes(pbrUniforms, cubeVAO, cubes.heatmap);
+        drawCubes(pbrUniforms, cubeVAO, cubes.cpu);
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // 2) Bright-pass (from colorBuffer) -> pingpong[0]
+        gpuTimer.mark(GPU_BRIGHT);
         glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, mainFBO.colorBuffer);
         glBindFramebuffer(GL_FRAMEBUFFER, mainFBO.pingpongFBO[0]);
         glViewport(0,0,winW,winH);
         glClear(GL_COLOR_BUFFER_BIT);
         glUseProgram(quadProg_bright);
-        glUniform1f(glGetUniformLocation(quadProg_bright,"threshold"), brightThreshold);
+        glUniform1f(bloomUniforms.threshold, brightThreshold);
         glBindVertexArray(quadVAO); glDrawArrays(GL_TRIANGLES,0,6);
 
         // 3) Blur ping-pong
+        gpuTimer.mark(GPU_BLUR);
         bool horizontal = true; bool first_iter = true;
         glUseProgram(quadProg_blur);
         for (int i=0;i<blurPasses;i++){
             glBindFramebuffer(GL_FRAMEBUFFER, mainFBO.pingpongFBO[horizontal]);
-            glUniform1i(glGetUniformLocation(quadProg_blur,"horizontal"), horizontal?1:0);
+            glUniform1i(bloomUniforms.horizontal, horizontal?1:0);
             glActiveTexture(GL_TEXTURE0);
             if (first_iter) glBindTexture(GL_TEXTURE_2D, mainFBO.pingpongTex[0]);
             else glBindTexture(GL_TEXTURE_2D, mainFBO.pingpongTex[!horizontal]);
@@ -818,15 +1450,17 @@ int main(){
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // 4) Final composite: scene(colorBuffer) + bloom (last pingpongTex)
+        gpuTimer.mark(GPU_COMPOSITE);
         glViewport(0, 0, winW, winH);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glUseProgram(quadProg_final);
         glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, mainFBO.colorBuffer);
         glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, mainFBO.pingpongTex[!horizontal]);
-        glUniform1f(glGetUniformLocation(quadProg_final,"bloomFactor"), bloomFactor);
+        glUniform1f(bloomUniforms.bloomFactor, bloomFactor);
         glBindVertexArray(quadVAO); glDrawArrays(GL_TRIANGLES,0,6);
 
         // 5) UI overlay: only NEXT preview (no score)
+        gpuTimer.mark(GPU_UI);
         glUseProgram(uiProg);
         glBindVertexArray(uiVAO);
 
@@ -837,26 +1471,51 @@ int main(){
         float bgLeft = previewCenterX - bgW/2.0f;
         float bgTop = previewCenterY - bgH/2.0f;
         float bgBottom = (float)winH - (bgTop + bgH);
-        drawUIRect(uiProg, uiVAO, winW, winH, bgLeft, bgBottom, bgW, bgH, glm::vec3(0.03f,0.03f,0.04f));
-        drawPreviewPieceUI(uiProg, uiVAO, winW, winH, nextPieceIndex, previewCenterX, previewCenterY, blockPixel);
+        drawUIRect(ui, uiVAO, winW, winH, bgLeft, bgBottom, bgW, bgH, glm::vec3(0.03f,0.03f,0.04f));
+        if (wellMode) drawPreviewPolycubeUI(ui, uiVAO, winW, winH, well3d.next, previewCenterX, previewCenterY, blockPixel);
+        else drawPreviewPieceUI(ui, uiVAO, winW, winH, player.nextPieceIndex, previewCenterX, previewCenterY, blockPixel);
 
         // Material hint (small)
-        drawUIRect(uiProg, uiVAO, winW, winH, 20, winH - 40, 300, 28, glm::vec3(0.02f,0.02f,0.02f));
+        drawUIRect(ui, uiVAO, winW, winH, 20, winH - 40, 300, 28, glm::vec3(0.02f,0.02f,0.02f));
         // draw three small boxes indicating material 1/2/3
         for (int i=0;i<3;i++){
             float bx = 26 + i*34; float by = winH - 34;
             glm::vec3 col = (i==0)?glm::vec3(0.8f,0.8f,0.8f):(i==1?glm::vec3(0.8f,0.5f,0.2f):glm::vec3(0.6f,0.6f,0.9f));
             if (i==currentMaterial) col += glm::vec3(0.18f);
-            drawUIRect(uiProg, uiVAO, winW, winH, bx, by, 28, 20, col);
+            drawUIRect(ui, uiVAO, winW, winH, bx, by, 28, 20, col);
+        }
+
+        // CPU: search depth reached for the last piece (1..3 boxes)
+        if (versusMode && !netMode && !watchMode && !wellMode) {
+            for (int i=0;i<BOT_LEVELS;i++){
+                glm::vec3 col = (i < cpu.lastStats.level) ? glm::vec3(0.2f,0.8f,0.3f) : glm::vec3(0.1f,0.1f,0.1f);
+                drawUIRect(ui, uiVAO, winW, winH, (float)winW - 140.0f - 1.5f*34 + i*34, 20, 28, 12, col);
+            }
         }
 
         glBindVertexArray(0);
+        gpuTimer.mark(GPU_PASS_COUNT);
+        gpuTimer.endFrame(flightFrameNo.load(std::memory_order_relaxed));
+        renderPerf.end();
+        cpuSeconds = glfwGetTime() - cur;
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
     // cleanup
+    finishReplay();
+    if (netMode) printNetplayStats();
+    if (perfEnabled) perfReport(std::cout);
+    if (allocCheck) printAllocationStats();
+    if (jobStats) jobSystem().report(std::cout);
+    spectatorServer.stop();
+    livePublisher.close();
+    if (trainingExporter.isOpen() && !trainingExporter.close()) std::cerr << "Failed to write training data\n";
+    cpu.bot.reset();
+    while (pcHint.running.load(std::memory_order_acquire)) std::this_thread::sleep_for(std::chrono::milliseconds(1));   // the job uses pcHint
+    flightStop();
+    gpuTimer.destroy();
     deleteFramebuffers(mainFBO);
     glDeleteProgram(pbrProg); glDeleteProgram(quadProg_bright); glDeleteProgram(quadProg_blur);
     glDeleteProgram(quadProg_final); glDeleteProgram(uiProg);
@@ -0,0 +1,69 @@
+// montecarlo.h
+// Monte Carlo rollout evaluation: a candidate board is scored by the mean outcome
+// of many short games played from it over sampled future piece sequences.
+// Rollouts run on a private GameState, so they go through the real
+// spawnNewPiece/lockPiece/clearLines rules and share nothing between threads.
+
+#pragma once
+
+#include "bot_eval.h"
+
+const int ROLLOUT_TOPOUT = -100000;
+
+enum class RolloutPolicy { Random, Greedy };
+
+struct RolloutConfig {
+    int depth = 6;                              // pieces per rollout
+    RolloutPolicy policy = RolloutPolicy::Greedy;
+};
+
+// Picks the next placement for a rollout. Random uses reservoir sampling over the
+// reachable placements, Greedy takes the best one-piece heuristic.
+inline bool chooseRolloutPlacement(GameState& sim, RolloutPolicy policy, Placement& out) {
+    BitBoard bb;
+    toBitBoard(sim.board, bb);
+    if (policy == RolloutPolicy::Random) {
+        bool found = false;
+        unsigned seen = 0;
+        forEachPlacement(bb, sim.currentPieceIndex, [&](const Placement& p, const BitBoard&, int) {
+            if (sim.rng() % ++seen == 0) { out = p; found = true; }
+        }, sim.cascade);
+        return found;
+    }
+    Placement moves[MAX_PLACEMENTS];
+    BitBoard after[MAX_PLACEMENTS];
+    int lines[MAX_PLACEMENTS], scores[MAX_PLACEMENTS];
+    int n = 0;
+    forEachPlacement(bb, sim.currentPieceIndex, [&](const Placement& p, const BitBoard& b, int l) {
+        if (n < MAX_PLACEMENTS) { moves[n] = p; after[n] = b; lines[n] = l; ++n; }
+    }, sim.cascade);
+    evaluateBoards(after, lines, n, scores);
+    int best = 0;
+    for (int i = 1; i < n; ++i) if (scores[i] > scores[best]) best = i;
+    if (n) out = moves[best];
+    return n > 0;
+}
+
+// One rollout from `start` where `nextPiece` is the known next piece and everything
+// after it comes from sim.rng. Reward: line bonus along the way plus the leaf heuristic.
+inline int rollout(GameState& sim, const BitBoard& start, int nextPiece, const RolloutConfig& cfg) {
+    fromBitBoard(start, sim.board);
+    sim.gameOver = false;
+    sim.nextPieceIndex = nextPiece;
+    spawnNewPiece(sim);
+    int reward = 0;
+    for (int d = 0; d < cfg.depth; ++d) {
+        Placement p;
+        if (sim.gameOver || !chooseRolloutPlacement(sim, cfg.policy, p)) return reward + ROLLOUT_TOPOUT;
+        reward += 76 * applyPlacement(sim, p);
+    }
+    if (sim.gameOver) return reward + ROLLOUT_TOPOUT;
+    BitBoard leaf;
+    toBitBoard(sim.board, leaf);
+    return reward + evaluateBoard(leaf, 0);
+}
+
+// Independent stream per (seed, thread) so workers never touch a shared generator.
+inline void seedRolloutStream(GameState& sim, unsigned seed, unsigned stream) {
+    sim.rng.seed(seed, stream);
+}
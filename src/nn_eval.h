@@ -0,0 +1,275 @@
+// nn_eval.h
+// Optional learned evaluator: a small MLP over the board features (bitboard.h), with
+// int8 weights and 7-bit activations, so a learned bot ships as a 2 KB weights file and
+// a few dozen instructions per layer instead of an ML runtime. Boards are scored in
+// batches of NN_BATCH: each layer runs over the whole batch, so a block of weight rows
+// is loaded into registers once and used for every board. On x86 the AVX2 kernel is
+// always compiled (target("avx2")) and picked at run time when the CPU has it; ARM
+// builds use NEON. The scalar kernel is both the fallback and the reference the SIMD
+// paths must match.
+//
+// Layers: NN_INPUTS -> NN_HIDDEN -> NN_HIDDEN -> 1. A hidden unit is
+// clamp((w . x + b) >> shift, 0, 127); the output is w . h + b, on the same scale as the
+// heuristic's scores (x100 per feature unit). Activations stay below 128 so the u8 x s8
+// pair sums of maddubs cannot saturate.
+//
+// File: "TNNE" | u16 version | u16 inputs | u16 hidden | u16 shift1 | u16 shift2 | u16 0
+//       | w1 int8[hidden][inputs] | b1 i32[hidden] | w2 int8[hidden][hidden] | b2 i32[hidden]
+//       | w3 int8[hidden] | b3 i32
+
+#pragma once
+
+#include "bitboard.h"
+#include "replay.h"
+
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NN_AVX2 1
+#define NN_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(BITBOARD_NEON)
+#define NN_NEON 1
+#endif
+
+const int NN_INPUTS = 32;
+const int NN_HIDDEN = 32;
+const int NN_USED_INPUTS = 19;   // the rest are zero, room for more features in a later version
+const uint16_t NN_VERSION = 1;
+const int NN_BATCH = 8;          // boards per pass through the layers
+
+struct NnEval {
+    alignas(32) int8_t w1[NN_HIDDEN][NN_INPUTS] = {};
+    alignas(32) int8_t w2[NN_HIDDEN][NN_HIDDEN] = {};
+    alignas(32) int8_t w3[NN_HIDDEN] = {};
+    alignas(32) int32_t b1[NN_HIDDEN] = {};
+    alignas(32) int32_t b2[NN_HIDDEN] = {};
+    int32_t b3 = 0;
+    int shift1 = 6, shift2 = 6;
+};
+
+// True when the AVX2 kernel can run on this CPU; checked once.
+inline bool nnAvx2Available() {
+#if defined(NN_AVX2)
+    static const bool ok = [] { __builtin_cpu_init(); return __builtin_cpu_supports("avx2") != 0; }();
+    return ok;
+#else
+    return false;
+#endif
+}
+
+inline const char* nnKernelName() {
+#if defined(NN_AVX2)
+    return nnAvx2Available() ? "AVX2" : "scalar";
+#elif defined(NN_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+// --------------------------- INPUTS ----------------------------
+// heights[10], aggregate/2, max height, holes, covered/2, bumpiness, row and column
+// transitions/2, well sums/8, lines cleared; each clamped to 0..127. Holes and
+// bumpiness keep full resolution: one hole is the difference between placements.
+inline void nnInputs(const BoardFeatures& f, int lines, uint8_t* x) {
+    auto q = [](int v) { return (uint8_t)std::min(std::max(v, 0), 127); };
+    for (int i = 0; i < BOARD_W; ++i) x[i] = q(f.heights[i]);
+    x[10] = q(f.aggregateHeight >> 1);
+    x[11] = q(f.maxHeight);
+    x[12] = q(f.holes);
+    x[13] = q(f.coveredCells >> 1);
+    x[14] = q(f.bumpiness);
+    x[15] = q(f.rowTransitions >> 1);
+    x[16] = q(f.colTransitions >> 1);
+    x[17] = q(f.wellSums >> 3);
+    x[18] = q(lines);
+    std::memset(x + NN_USED_INPUTS, 0, NN_INPUTS - NN_USED_INPUTS);
+}
+
+// --------------------------- KERNELS ----------------------------
+inline uint8_t nnActivation(int32_t acc, int shift) { return (uint8_t)std::min(std::max(acc >> shift, 0), 127); }
+
+// Reference forward pass for one input row.
+inline int nnForwardScalar(const NnEval& net, const uint8_t* x) {
+    uint8_t h1[NN_HIDDEN], h2[NN_HIDDEN];
+    for (int j = 0; j < NN_HIDDEN; ++j) {
+        int32_t acc = net.b1[j];
+        for (int i = 0; i < NN_INPUTS; ++i) acc += (int32_t)x[i] * net.w1[j][i];
+        h1[j] = nnActivation(acc, net.shift1);
+    }
+    for (int j = 0; j < NN_HIDDEN; ++j) {
+        int32_t acc = net.b2[j];
+        for (int i = 0; i < NN_HIDDEN; ++i) acc += (int32_t)h1[i] * net.w2[j][i];
+        h2[j] = nnActivation(acc, net.shift2);
+    }
+    int32_t out = net.b3;
+    for (int i = 0; i < NN_HIDDEN; ++i) out += (int32_t)h2[i] * net.w3[i];
+    return out;
+}
+
+#if defined(NN_AVX2)
+static_assert(NN_INPUTS == 32 && NN_HIDDEN == 32, "the AVX2 kernel works on 32-byte rows");
+
+// Eight vectors of eight partial sums -> one vector of the eight totals.
+NN_AVX2_TARGET inline __m256i nnHadd8(const __m256i* s) {
+    __m256i a = _mm256_hadd_epi32(_mm256_hadd_epi32(s[0], s[1]), _mm256_hadd_epi32(s[2], s[3]));
+    __m256i c = _mm256_hadd_epi32(_mm256_hadd_epi32(s[4], s[5]), _mm256_hadd_epi32(s[6], s[7]));
+    return _mm256_add_epi32(_mm256_permute2x128_si256(a, c, 0x20), _mm256_permute2x128_si256(a, c, 0x31));
+}
+
+// n rows of 32 inputs -> n rows of 32 activations, eight units per pass: the eight
+// weight rows of a pass stay in registers for all n rows.
+NN_AVX2_TARGET inline void nnLayerAvx2(const int8_t (*w)[32], const int32_t* b, int shift, const uint8_t (*in)[32], uint8_t (*out)[32], int n) {
+    const __m256i ones = _mm256_set1_epi16(1), zero = _mm256_setzero_si256(), top = _mm256_set1_epi32(127);
+    const __m128i sh = _mm_cvtsi32_si128(shift);
+    __m256i acc[NN_BATCH][4];
+    for (int g = 0; g < 4; ++g) {
+        __m256i wg[8];
+        for (int k = 0; k < 8; ++k) wg[k] = _mm256_load_si256((const __m256i*)w[g * 8 + k]);
+        const __m256i bias = _mm256_load_si256((const __m256i*)(b + g * 8));
+        for (int r = 0; r < n; ++r) {
+            const __m256i x = _mm256_load_si256((const __m256i*)in[r]);
+            __m256i s[8];
+            for (int k = 0; k < 8; ++k) s[k] = _mm256_madd_epi16(_mm256_maddubs_epi16(x, wg[k]), ones);
+            __m256i v = _mm256_sra_epi32(_mm256_add_epi32(nnHadd8(s), bias), sh);
+            acc[r][g] = _mm256_min_epi32(_mm256_max_epi32(v, zero), top);
+        }
+    }
+    // the packs work per 128-bit lane; the permute puts the 4-byte groups back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    for (int r = 0; r < n; ++r) {
+        __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(acc[r][0], acc[r][1]), _mm256_packs_epi32(acc[r][2], acc[r][3]));
+        _mm256_store_si256((__m256i*)out[r], _mm256_permutevar8x32_epi32(bytes, order));
+    }
+}
+
+NN_AVX2_TARGET inline void nnForwardAvx2(const NnEval& net, const uint8_t (*x)[NN_INPUTS], int n, int* out) {
+    alignas(32) uint8_t h1[NN_BATCH][NN_HIDDEN], h2[NN_BATCH][NN_HIDDEN];
+    nnLayerAvx2(net.w1, net.b1, net.shift1, x, h1, n);
+    nnLayerAvx2(net.w2, net.b2, net.shift2, h1, h2, n);
+    const __m256i w = _mm256_load_si256((const __m256i*)net.w3), ones = _mm256_set1_epi16(1);
+    for (int r = 0; r < n; ++r) {
+        __m256i s = _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_load_si256((const __m256i*)h2[r]), w), ones);
+        __m128i t = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0x4e));
+        t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0xb1));
+        out[r] = net.b3 + _mm_cvtsi128_si32(t);
+    }
+}
+#elif defined(NN_NEON)
+// Two u8 x s8 products per int16 lane (inputs are below 128, so they fit), then widened.
+inline int32_t nnDotNeon(const uint8_t* x, const int8_t* w, int n) {
+    int32x4_t s = vdupq_n_s32(0);
+    for (int i = 0; i < n; i += 16) {
+        int8x16_t a = vreinterpretq_s8_u8(vld1q_u8(x + i)), b = vld1q_s8(w + i);
+        int16x8_t p = vmull_s8(vget_low_s8(a), vget_low_s8(b));
+        p = vmlal_s8(p, vget_high_s8(a), vget_high_s8(b));
+        s = vpadalq_s16(s, p);
+    }
+    return vaddvq_s32(s);
+}
+
+// Unit by unit over the whole batch, so each weight row is loaded once per batch.
+inline void nnForwardNeon(const NnEval& net, const uint8_t (*x)[NN_INPUTS], int n, int* out) {
+    alignas(16) uint8_t h1[NN_BATCH][NN_HIDDEN], h2[NN_BATCH][NN_HIDDEN];
+    for (int j = 0; j < NN_HIDDEN; ++j)
+        for (int r = 0; r < n; ++r) h1[r][j] = nnActivation(net.b1[j] + nnDotNeon(x[r], net.w1[j], NN_INPUTS), net.shift1);
+    for (int j = 0; j < NN_HIDDEN; ++j)
+        for (int r = 0; r < n; ++r) h2[r][j] = nnActivation(net.b2[j] + nnDotNeon(h1[r], net.w2[j], NN_HIDDEN), net.shift2);
+    for (int r = 0; r < n; ++r) out[r] = net.b3 + nnDotNeon(h2[r], net.w3, NN_HIDDEN);
+}
+#endif
+
+// Up to NN_BATCH input rows (32-byte aligned) through the network with the best kernel
+// this CPU runs.
+inline void nnForwardBatch(const NnEval& net, const uint8_t (*x)[NN_INPUTS], int n, int* out) {
+#if defined(NN_AVX2)
+    if (nnAvx2Available()) { nnForwardAvx2(net, x, n, out); return; }
+#elif defined(NN_NEON)
+    nnForwardNeon(net, x, n, out);
+    return;
+#endif
+    for (int r = 0; r < n; ++r) out[r] = nnForwardScalar(net, x[r]);
+}
+
+// One input row through the network.
+inline int nnForward(const NnEval& net, const uint8_t* x) {
+    int out;
+    nnForwardBatch(net, reinterpret_cast<const uint8_t (*)[NN_INPUTS]>(x), 1, &out);
+    return out;
+}
+
+// --------------------------- BATCHES ----------------------------
+// Scores a whole move list in one call, like evaluateBoards, NN_BATCH boards per pass.
+inline void nnEvaluateBoards(const NnEval& net, const BitBoard* boards, const int* lines, int count, int* scores) {
+    alignas(32) uint8_t x[NN_BATCH][NN_INPUTS];
+    BoardFeatures f;
+    for (int i = 0; i < count; i += NN_BATCH) {
+        int n = std::min(NN_BATCH, count - i);
+        for (int r = 0; r < n; ++r) {
+            extractFeatures(boards[i + r], f);
+            nnInputs(f, lines[i + r], x[r]);
+        }
+        nnForwardBatch(net, x, n, scores + i);
+    }
+}
+
+inline int nnEvaluateBoard(const NnEval& net, const BitBoard& board, int lines) {
+    int s;
+    nnEvaluateBoards(net, &board, &lines, 1, &s);
+    return s;
+}
+
+// --------------------------- FILES ----------------------------
+inline bool saveNnEval(const std::string& path, const NnEval& net) {
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'T','N','N','E'});
+    putU16(out, NN_VERSION); putU16(out, NN_INPUTS); putU16(out, NN_HIDDEN);
+    putU16(out, (uint16_t)net.shift1); putU16(out, (uint16_t)net.shift2); putU16(out, 0);
+    auto bytes = [&](const int8_t* p, size_t n) { out.insert(out.end(), (const uint8_t*)p, (const uint8_t*)p + n); };
+    auto words = [&](const int32_t* p, size_t n) { for (size_t i = 0; i < n; ++i) putU32(out, (uint32_t)p[i]); };
+    bytes(&net.w1[0][0], sizeof(net.w1)); words(net.b1, NN_HIDDEN);
+    bytes(&net.w2[0][0], sizeof(net.w2)); words(net.b2, NN_HIDDEN);
+    bytes(net.w3, sizeof(net.w3)); words(&net.b3, 1);
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+inline bool loadNnEval(const std::string& path, NnEval& net) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    const size_t size = 16 + sizeof(net.w1) + 4 * NN_HIDDEN + sizeof(net.w2) + 4 * NN_HIDDEN + sizeof(net.w3) + 4;
+    std::vector<uint8_t> in(size + 1);
+    size_t got = std::fread(in.data(), 1, in.size(), f);
+    std::fclose(f);
+    const uint8_t* p = in.data();
+    if (got != size || std::memcmp(p, "TNNE", 4) != 0 || getU16(p + 4) != NN_VERSION || getU16(p + 6) != NN_INPUTS ||
+        getU16(p + 8) != NN_HIDDEN || getU16(p + 10) > 31 || getU16(p + 12) > 31) return false;
+    net.shift1 = getU16(p + 10);
+    net.shift2 = getU16(p + 12);
+    p += 16;
+    auto bytes = [&](int8_t* d, size_t n) { std::memcpy(d, p, n); p += n; };
+    auto words = [&](int32_t* d, size_t n) { for (size_t i = 0; i < n; ++i, p += 4) d[i] = (int32_t)getU32(p); };
+    bytes(&net.w1[0][0], sizeof(net.w1)); words(net.b1, NN_HIDDEN);
+    bytes(&net.w2[0][0], sizeof(net.w2)); words(net.b2, NN_HIDDEN);
+    bytes(net.w3, sizeof(net.w3)); words(&net.b3, 1);
+    return true;
+}
+
+// --------------------------- HEURISTIC NETWORK ----------------------------
+// Weights that reproduce the four-feature heuristic (bot_eval.h scoreFeatures) up to
+// the input rounding: both hidden layers pass the inputs through, the output layer
+// holds the heuristic's weights. A known-good starting point and a kernel test.
+inline NnEval heuristicNnEval() {
+    NnEval net;
+    for (int j = 0; j < NN_USED_INPUTS; ++j) { net.w1[j][j] = 1 << net.shift1; net.w2[j][j] = 1 << net.shift2; }
+    net.w3[10] = -102;   // aggregate height, input halved
+    net.w3[12] = -36;    // holes
+    net.w3[14] = -18;    // bumpiness
+    net.w3[18] = 76;     // lines
+    return net;
+}
@@ -0,0 +1,342 @@
+// pc_solver.h
+// Perfect-clear solver: finds placements for a piece queue (optionally with hold)
+// that leave the board empty. Moves are the bots' rotate-at-spawn, shift, hard drop
+// placements (bot_eval.h), so every solution can be typed out in the game.
+//
+// A perfect clear of height h needs cells + 4 * pieces == 10 * h, so h is fixed up
+// front and nothing may land above the rows still to be cleared. That keeps the whole
+// problem in the bottom PC_MAX_HEIGHT rows, which pack into one uint64 (10 bits per
+// row, bottom row first): a placement is an OR, a line clear a shift, and drops come
+// from column heights instead of stepping the piece down.
+//
+// Failed (board, queue position, hold) states go into a lock-free table shared by all
+// threads. Top-level branches (first move) are handed out one at a time to background
+// jobs on the shared job system (jobs.h); the first to find a solution stops the others. Each
+// height is searched with an extra, inexact region prune first and exhaustively only
+// if that finds nothing.
+
+#pragma once
+
+#include "bot_eval.h"
+#include "jobs.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+const int PC_MAX_HEIGHT = 5;
+const int PC_MAX_QUEUE = 31;
+const int PC_NO_HOLD = 7;
+const uint64_t PC_ROW = (1u << BOARD_W) - 1;
+
+struct PcMove {
+    int piece = 0;
+    Placement placement;
+    bool hold = false;       // hold was pressed before placing
+};
+
+struct PcResult {
+    bool found = false;
+    int height = 0;          // lines cleared by the solution
+    std::vector<PcMove> moves;
+    long long nodes = 0;
+    double seconds = 0.0;
+};
+
+// --------------------------- PACKED BOARD ----------------------------
+inline uint64_t pcPack(const BitBoard& bb) {
+    uint64_t b = 0;
+    for (int i = 0; i < PC_MAX_HEIGHT; ++i) b |= (uint64_t)bb.rows[BOARD_H - 1 - i] << (BOARD_W * i);
+    return b;
+}
+
+inline bool pcFitsPacked(const BitBoard& bb) {
+    for (int y = 0; y < BOARD_H - PC_MAX_HEIGHT; ++y) if (bb.rows[y]) return false;
+    return true;
+}
+
+inline int pcClearRows(uint64_t& b, int rows) {
+    int cleared = 0;
+    for (int i = rows - 1; i >= 0; --i) {
+        if (((b >> (BOARD_W * i)) & PC_ROW) != PC_ROW) continue;
+        uint64_t below = b & ((1ull << (BOARD_W * i)) - 1);
+        b = ((b >> (BOARD_W * (i + 1))) << (BOARD_W * i)) | below;
+        ++cleared;
+    }
+    return cleared;
+}
+
+// Columns filled all the way up split the board into parts no piece can straddle, and
+// line clears take whole rows, so each part must be filled by whole pieces on its own.
+inline bool pcSplitsFillable(uint64_t b, int rows) {
+    uint64_t full = PC_ROW;
+    for (int i = 0; i < rows; ++i) full &= b >> (BOARD_W * i);
+    if (!full) return true;
+    int empty = 0;
+    for (int x = 0; x < BOARD_W; ++x) {
+        if ((full >> x) & 1) { if (empty % 4) return false; empty = 0; continue; }
+        for (int i = 0; i < rows; ++i) empty += !((b >> (BOARD_W * i + x)) & 1);
+    }
+    return empty % 4 == 0;
+}
+
+// Stronger but not exact: every enclosed region of empty cells holds a multiple of 4.
+// A line clear can drop cells from one region into another, so this can reject boards
+// that still have a solution; the solver only uses it for a first, fast pass.
+inline bool pcRegionsFillable(uint64_t b, int rows) {
+    static const uint64_t notLeft = []{ uint64_t m = 0; for (int i = 0; i < PC_MAX_HEIGHT; ++i) m |= (PC_ROW - 1) << (BOARD_W * i); return m; }();
+    static const uint64_t notRight = notLeft >> 1;
+    uint64_t empty = ~b & ((1ull << (BOARD_W * rows)) - 1);
+    while (empty) {
+        uint64_t region = empty & (0 - empty), grown;
+        for (;;) {
+            grown = (region | ((region << 1) & notLeft) | ((region >> 1) & notRight) | (region << BOARD_W) | (region >> BOARD_W)) & empty;
+            if (grown == region) break;
+            region = grown;
+        }
+        if ((popcount32((uint32_t)region) + popcount32((uint32_t)(region >> 32))) % 4) return false;
+        empty &= ~region;
+    }
+    return true;
+}
+
+// One rotation state of a piece, in up-is-positive coordinates relative to its origin.
+struct PcShape {
+    int rotation = 0;
+    int minX = 0, maxX = 0;              // block x offsets
+    int cols = 0;                        // columns spanned
+    int bottom[4] = {};                  // lowest block per column (from minX)
+    glm::ivec2 cells[4];
+    int n = 0;
+};
+
+struct PcPieceShapes {
+    PcShape shapes[4];
+    int count = 0;
+};
+
+// Rotation states reachable at spawn on an open board (no kicks move the origin there),
+// with duplicates that cover the same cells from a shifted origin kept: their Placement differs.
+// Built on first use, so initPieces() must have run.
+inline const PcPieceShapes* pcShapes() {
+    static const std::vector<PcPieceShapes> table = []{
+        std::vector<PcPieceShapes> t(PIECE_COUNT);
+        for (int p = 0; p < PIECE_COUNT; ++p) {
+            PieceBlocks blocks = pieceBlocks(PIECES[p].blocks);
+            int rotations = isOPiece(blocks) ? 1 : 4;
+            for (int r = 0; r < rotations; ++r) {
+                PcShape& s = t[p].shapes[t[p].count++];
+                s.rotation = r;
+                s.n = blocks.n;
+                s.minX = 100; s.maxX = -100;
+                for (int i = 0; i < blocks.n; ++i) { s.minX = std::min(s.minX, blocks.b[i].x); s.maxX = std::max(s.maxX, blocks.b[i].x); }
+                s.cols = s.maxX - s.minX + 1;
+                for (int c = 0; c < s.cols; ++c) s.bottom[c] = 100;
+                for (int i = 0; i < blocks.n; ++i) {
+                    s.cells[i] = glm::ivec2(blocks.b[i].x, -blocks.b[i].y);
+                    int& lo = s.bottom[blocks.b[i].x - s.minX];
+                    lo = std::min(lo, -blocks.b[i].y);
+                }
+                for (int i = 0; i < blocks.n; ++i) { int nx = blocks.b[i].y; int ny = -blocks.b[i].x; blocks.b[i].x = nx; blocks.b[i].y = ny; }
+            }
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// Calls f(placement, boardAfter, linesCleared) for every hard-drop placement of piece that
+// stays inside the bottom `rows` rows. Placements giving the same board are reported once.
+template<class F>
+bool pcForEachPlacement(uint64_t board, int rows, int piece, F&& f) {
+    int height[BOARD_W];
+    for (int x = 0; x < BOARD_W; ++x) {
+        height[x] = 0;
+        for (int i = rows - 1; i >= 0; --i) if ((board >> (BOARD_W * i + x)) & 1) { height[x] = i + 1; break; }
+    }
+    uint64_t seen[4 * BOARD_W];
+    int seenCount = 0;
+    const PcPieceShapes& ps = pcShapes()[piece];
+    for (int si = 0; si < ps.count; ++si) {
+        const PcShape& s = ps.shapes[si];
+        for (int x = -s.minX; x + s.maxX < BOARD_W; ++x) {
+            int base = -BOARD_H;
+            for (int c = 0; c < s.cols; ++c) base = std::max(base, height[x + s.minX + c] - s.bottom[c]);
+            uint64_t mask = 0;
+            bool fits = true;
+            for (int i = 0; i < s.n; ++i) {
+                int y = base + s.cells[i].y;
+                if (y >= rows) { fits = false; break; }
+                mask |= 1ull << (BOARD_W * y + x + s.cells[i].x);
+            }
+            if (!fits) continue;
+            uint64_t after = board | mask;
+            int lines = pcClearRows(after, rows);
+            bool dup = false;
+            for (int i = 0; i < seenCount && !dup; ++i) dup = seen[i] == after;
+            if (dup) continue;
+            seen[seenCount++] = after;
+            if (f(Placement{s.rotation, x}, after, lines)) return true;
+        }
+    }
+    return false;
+}
+
+// Pieces that can be placed from (index, hold) of queue q: the current one, or with hold
+// the held one (or the next one into an empty hold). Calls f(piece, nextIndex, nextHold, held).
+template<class F>
+bool pcForEachChoice(const std::vector<int>& q, bool useHold, int index, int hold, F&& f) {
+    int n = (int)q.size();
+    if (index < n && f(q[index], index + 1, hold, false)) return true;
+    if (!useHold) return false;
+    if (hold != PC_NO_HOLD) {
+        if (index < n && hold != q[index]) return f(hold, index + 1, q[index], true);
+        if (index >= n) return f(hold, index, PC_NO_HOLD, true);
+    } else if (index + 1 < n) {
+        return f(q[index + 1], index + 2, q[index], true);
+    }
+    return false;
+}
+
+inline int pcCells(uint64_t board) { return popcount32((uint32_t)board) + popcount32((uint32_t)(board >> 32)); }
+
+// --------------------------- SOLVER ----------------------------
+class PcSolver {
+public:
+    explicit PcSolver(int threads = 0, int tableBits = 22) : table((size_t)1 << tableBits) {
+        threadCount = threads > 0 ? threads : jobSystem().threadCount();
+        for (auto& e : table) e.store(0, std::memory_order_relaxed);
+    }
+
+    // queue[0] is the current piece. hold is the piece already held, or -1.
+    PcResult solve(const BitBoard& board, const std::vector<int>& queue, bool allowHold = true, int hold = -1, int maxHeight = 4) {
+        auto t0 = std::chrono::steady_clock::now();
+        PcResult res;
+        maxHeight = std::min(maxHeight, PC_MAX_HEIGHT);
+        int n = std::min((int)queue.size(), PC_MAX_QUEUE);
+        if (!pcFitsPacked(board) || n == 0) return res;
+        q.assign(queue.begin(), queue.begin() + n);
+        useHold = allowHold;
+        uint64_t packed = pcPack(board);
+        int cells = popcount32((uint32_t)packed) + popcount32((uint32_t)(packed >> 32));
+        int topRow = 0;
+        for (int i = 0; i < PC_MAX_HEIGHT; ++i) if ((packed >> (BOARD_W * i)) & PC_ROW) topRow = i + 1;
+        int available = n + (allowHold && hold >= 0 ? 1 : 0);
+
+        for (int h = std::max(1, topRow); h <= maxHeight && !res.found; ++h) {
+            int empty = BOARD_W * h - cells;
+            if (empty <= 0 || empty % 4 != 0 || empty / 4 > available) continue;
+            // region-pruned pass first; only if it fails, the exhaustive one
+            for (int exact = 0; exact < 2 && !res.found; ++exact) {
+                nextEpoch();
+                Search s(*this, h, exact != 0);
+                s.run(packed, hold < 0 || !allowHold ? PC_NO_HOLD : hold);
+                res.nodes += s.nodes.load();
+                if (s.found) { res.found = true; res.height = h; res.moves = s.solution; }
+            }
+        }
+        res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return res;
+    }
+
+    int threads() const { return threadCount; }
+
+private:
+    // Table entries: board (50 bits) | queue index (5) | hold (3) | epoch (6). Zero is empty.
+    // Lossy: a full probe window just drops the entry.
+    bool known(uint64_t key) const {
+        size_t i = slot(key);
+        for (int k = 0; k < 4; ++k) if (table[(i + k) & (table.size() - 1)].load(std::memory_order_relaxed) == key) return true;
+        return false;
+    }
+    void remember(uint64_t key) {
+        size_t i = slot(key);
+        for (int k = 0; k < 4; ++k) {
+            auto& e = table[(i + k) & (table.size() - 1)];
+            uint64_t cur = e.load(std::memory_order_relaxed);
+            if (cur == key) return;
+            if ((cur == 0 || (cur >> 58) != epoch) && e.compare_exchange_strong(cur, key, std::memory_order_relaxed)) return;
+        }
+    }
+    size_t slot(uint64_t key) const { key ^= key >> 29; key *= 0xbf58476d1ce4e5b9ULL; key ^= key >> 32; return (size_t)key & (table.size() - 1); }
+    void nextEpoch() {
+        if (++epoch == 64) { for (auto& e : table) e.store(0, std::memory_order_relaxed); epoch = 1; }
+    }
+
+    struct Branch { PcMove move; uint64_t board; int rows, index, hold; };
+
+    struct Search {
+        PcSolver& S;
+        int height;
+        bool exact;
+        std::atomic<bool> stop{false};
+        std::atomic<long long> nodes{0};
+        bool found = false;
+        std::vector<PcMove> solution;
+        std::mutex mtx;
+
+        Search(PcSolver& s, int h, bool exact) : S(s), height(h), exact(exact) {}
+
+        uint64_t key(uint64_t board, int index, int hold) const {
+            return board | ((uint64_t)index << 50) | ((uint64_t)hold << 55) | ((uint64_t)S.epoch << 58);
+        }
+
+        template<class F>
+        bool forEachChoice(int index, int hold, F&& f) { return pcForEachChoice(S.q, S.useHold, index, hold, f); }
+
+        bool dfs(uint64_t board, int rows, int index, int hold, std::vector<PcMove>& path, long long& count) {
+            if (board == 0) return true;
+            if (stop.load(std::memory_order_relaxed)) return false;
+            ++count;
+            int cells = popcount32((uint32_t)board) + popcount32((uint32_t)(board >> 32));
+            int available = (int)S.q.size() - index + (hold != PC_NO_HOLD);
+            if ((BOARD_W * rows - cells) / 4 > available || !pcSplitsFillable(board, rows)) return false;
+            if (!exact && !pcRegionsFillable(board, rows)) return false;
+            uint64_t k = key(board, index, hold);
+            if (S.known(k)) return false;
+            bool ok = forEachChoice(index, hold, [&](int piece, int nextIndex, int nextHold, bool held) {
+                return pcForEachPlacement(board, rows, piece, [&](const Placement& pl, uint64_t after, int lines) {
+                    path.push_back(PcMove{piece, pl, held});
+                    if (dfs(after, rows - lines, nextIndex, nextHold, path, count)) return true;
+                    path.pop_back();
+                    return false;
+                });
+            });
+            if (!ok && !stop.load(std::memory_order_relaxed)) S.remember(k);
+            return ok;
+        }
+
+        void run(uint64_t board, int hold) {
+            std::vector<Branch> branches;
+            forEachChoice(0, hold, [&](int piece, int nextIndex, int nextHold, bool held) {
+                return pcForEachPlacement(board, height, piece, [&](const Placement& pl, uint64_t after, int lines) {
+                    branches.push_back(Branch{PcMove{piece, pl, held}, after, height - lines, nextIndex, nextHold});
+                    return false;
+                });
+            });
+            std::atomic<size_t> next{0};
+            auto work = [&]{
+                std::vector<PcMove> path;
+                long long count = 0;
+                for (size_t i; !stop.load(std::memory_order_relaxed) && (i = next.fetch_add(1)) < branches.size();) {
+                    const Branch& b = branches[i];
+                    path.assign(1, b.move);
+                    if (dfs(b.board, b.rows, b.index, b.hold, path, count)) {
+                        std::lock_guard<std::mutex> lk(mtx);
+                        if (!found) { found = true; solution = path; }
+                        stop.store(true);
+                    }
+                }
+                nodes.fetch_add(count);
+            };
+            int t = std::min(S.threadCount, (int)branches.size());
+            jobSystem().runLoops(t, [&](int) { work(); });
+        }
+    };
+
+    std::vector<std::atomic<uint64_t>> table;
+    uint64_t epoch = 0;
+    int threadCount = 1;
+    std::vector<int> q;
+    bool useHold = true;
+};
@@ -0,0 +1,178 @@
+// perf_counters.h
+// Optional hardware counters around a few marked regions: cycles, instructions, cache
+// misses and branch misses from perf_event_open, summed per region over every thread
+// that enters it. Off until perfEnable(); a disabled PerfScope is one relaxed load.
+//
+// Each thread opens its own counter group the first time it enters a region. Where
+// the kernel refuses (perf_event_paranoid, a container, a VM without a PMU, not Linux)
+// the region turns into a no-op and perfReport says why. Reading the group is a
+// read() per region boundary, about a microsecond, which is noise for a tick or a bot
+// search but not for the tightest loops: an opaque region (the bot search) folds the
+// regions inside it into its own numbers instead of counting them separately. Other
+// regions do not nest, so no region's numbers include another one's reads.
+
+#pragma once
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+enum PerfRegion { PERF_TICK, PERF_LOCK, PERF_AI_SEARCH, PERF_RENDER, PERF_REGION_COUNT };
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_BRANCH_MISSES, PERF_EVENT_COUNT };
+
+inline const char* perfRegionName(int r) {
+    static const char* names[PERF_REGION_COUNT] = {"tick", "lock", "ai search", "render"};
+    return names[r];
+}
+
+struct PerfTotals {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> counts[PERF_EVENT_COUNT] = {};
+};
+
+inline std::atomic<bool> perfEnabled{false};
+inline std::atomic<int> perfError{0};              // errno of the first thread that could not open its counters
+inline PerfTotals perfTotals[PERF_REGION_COUNT];
+
+// --------------------------- COUNTER GROUP ----------------------------
+// The four counters of one thread, opened as a group so they run together.
+struct PerfGroup {
+    int fds[PERF_EVENT_COUNT] = {-1, -1, -1, -1};
+    bool tried = false, ok = false;
+    int opaque = 0;                                // open opaque regions on this thread
+
+    ~PerfGroup() { release(); }
+
+    void release() {
+#if defined(__linux__)
+        for (int& fd : fds) if (fd >= 0) { close(fd); fd = -1; }
+#endif
+        ok = false;
+    }
+
+    // Opens the counters for the calling thread; false (and errno set) if refused.
+    bool open() {
+        tried = true;
+#if defined(__linux__)
+        static const uint64_t configs[PERF_EVENT_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            perf_event_attr a;
+            std::memset(&a, 0, sizeof(a));
+            a.size = sizeof(a);
+            a.type = PERF_TYPE_HARDWARE;
+            a.config = configs[e];
+            a.exclude_kernel = 1;                  // user space only: allowed at perf_event_paranoid 2
+            a.exclude_hv = 1;
+            a.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[e] = (int)syscall(SYS_perf_event_open, &a, 0, -1, e == 0 ? -1 : fds[0], 0);
+            if (fds[e] < 0) { int err = errno; release(); errno = err; return false; }
+        }
+        ok = true;
+        return true;
+#else
+        errno = ENOSYS;
+        return false;
+#endif
+    }
+
+    // Current counts, scaled up if the kernel had to multiplex the group.
+    bool sample(uint64_t out[PERF_EVENT_COUNT]) {
+#if defined(__linux__)
+        uint64_t buf[3 + PERF_EVENT_COUNT];
+        if (read(fds[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[0] != PERF_EVENT_COUNT || buf[2] == 0) return false;
+        double scale = buf[2] < buf[1] ? (double)buf[1] / (double)buf[2] : 1.0;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) out[e] = (uint64_t)((double)buf[3 + e] * scale);
+        return true;
+#else
+        (void)out;
+        return false;
+#endif
+    }
+};
+
+inline thread_local PerfGroup perfThreadGroup;
+
+// Turns the regions on and opens the calling thread's counters; false if the kernel
+// refused them, in which case everything stays a no-op.
+inline bool perfEnable() {
+    PerfGroup& g = perfThreadGroup;
+    if (!g.ok && !g.open()) { perfError.store(errno, std::memory_order_relaxed); return false; }
+    perfEnabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// --------------------------- REGIONS ----------------------------
+// Counts from construction to end() or destruction into region r. PERF_REGION_COUNT
+// counts nothing, for a call site that is a region only some of the time.
+class PerfScope {
+public:
+    explicit PerfScope(PerfRegion r, bool opaque = false) {
+        if (r == PERF_REGION_COUNT || !perfEnabled.load(std::memory_order_relaxed)) return;
+        PerfGroup& g = perfThreadGroup;
+        if (g.opaque) return;
+        if (!g.tried && !g.open()) { int expected = 0; perfError.compare_exchange_strong(expected, errno, std::memory_order_relaxed); }
+        if (!g.ok || !g.sample(start)) return;
+        group = &g;
+        region = r;
+        this->opaque = opaque;
+        g.opaque += opaque;
+    }
+    ~PerfScope() { end(); }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+    void end() {
+        if (!group) return;
+        uint64_t now[PERF_EVENT_COUNT];
+        group->opaque -= opaque;
+        if (group->sample(now)) {
+            PerfTotals& t = perfTotals[region];
+            t.calls.fetch_add(1, std::memory_order_relaxed);
+            for (int e = 0; e < PERF_EVENT_COUNT; ++e) t.counts[e].fetch_add(now[e] - start[e], std::memory_order_relaxed);
+        }
+        group = nullptr;
+    }
+
+private:
+    PerfGroup* group = nullptr;
+    PerfRegion region = PERF_TICK;
+    bool opaque = false;
+    uint64_t start[PERF_EVENT_COUNT];
+};
+
+// --------------------------- REPORT ----------------------------
+// One line per region that ran: calls, cycles and instructions per call, IPC, and
+// cache and branch misses per thousand instructions.
+inline void perfReport(std::ostream& out) {
+    int err = perfError.load(std::memory_order_relaxed);
+    if (!perfEnabled.load(std::memory_order_relaxed)) {
+        out << "Hardware counters unavailable (" << std::strerror(err ? err : ENOSYS) << ")\n";
+        return;
+    }
+    out << "Hardware counters:\n";
+    char line[192];
+    for (int r = 0; r < PERF_REGION_COUNT; ++r) {
+        const PerfTotals& t = perfTotals[r];
+        uint64_t calls = t.calls.load(std::memory_order_relaxed);
+        if (!calls) continue;
+        double c[PERF_EVENT_COUNT];
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) c[e] = (double)t.counts[e].load(std::memory_order_relaxed);
+        double kilo = c[PERF_INSTRUCTIONS] > 0 ? c[PERF_INSTRUCTIONS] / 1000.0 : 1.0;
+        std::snprintf(line, sizeof(line), "  %-10s %10llu calls %12.0f cycles/call %12.0f instr/call  IPC %.2f  cache MPKI %.2f  branch MPKI %.2f\n",
+                      perfRegionName(r), (unsigned long long)calls, c[PERF_CYCLES] / (double)calls, c[PERF_INSTRUCTIONS] / (double)calls,
+                      c[PERF_CYCLES] > 0 ? c[PERF_INSTRUCTIONS] / c[PERF_CYCLES] : 0.0, c[PERF_CACHE_MISSES] / kilo, c[PERF_BRANCH_MISSES] / kilo);
+        out << line;
+    }
+    if (err) out << "  (some threads could not open counters: " << std::strerror(err) << ")\n";
+}
@@ -0,0 +1,205 @@
+// placement_cache.h
+// Persistent placement cache: a memory-mapped hash table from (board, piece, next piece)
+// to the bot's chosen placement, its score and how many search levels were complete
+// when it was chosen. Every process that maps the file shares one copy in the page
+// cache, so openings and common stack shapes searched once are free for everyone after.
+//
+// Slots are two 64-bit words, check = key ^ data and data, stored and loaded separately
+// without locks: a reader that sees half of a concurrent write gets a check that does
+// not match its key and treats it as a miss.
+//
+// File: "TPLC" | u32 version | u32 slotBits | u32 reserved | slots (16 bytes each).
+
+#pragma once
+
+#include "bitboard.h"
+#include "bot_eval.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+// Bump when evaluation or search changes, so stale files are rebuilt instead of trusted.
+const uint32_t PLACEMENT_CACHE_VERSION = 1;
+const size_t PLACEMENT_CACHE_HEADER = 16;
+const int PLACEMENT_CACHE_WAYS = 4;
+const int PLACEMENT_CACHE_MIN_BITS = 2;      // one bucket of ways
+const int PLACEMENT_CACHE_MAX_BITS = 30;     // 16 GB
+
+struct CachedPlacement {
+    Placement placement;
+    int score = 0;
+    int levels = 0;          // search levels completed for this entry (1..BOT_LEVELS)
+};
+
+// --------------------------- KEY ----------------------------
+inline uint64_t mixKey(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t placementKey(const BitBoard& board, int piece, int nextPiece) {
+    uint64_t h = mixKey(0x7470636bULL + (uint64_t)(piece * PIECE_COUNT + nextPiece));
+    for (int y = 0; y < BOARD_H; y += 4) {
+        uint64_t rows = (uint64_t)board.rows[y] | (uint64_t)board.rows[y + 1] << 16 | (uint64_t)board.rows[y + 2] << 32 | (uint64_t)board.rows[y + 3] << 48;
+        h = mixKey(h ^ rows);
+    }
+    return h ? h : 1;
+}
+
+// --------------------------- CACHE ----------------------------
+class PlacementCache {
+public:
+    PlacementCache() = default;
+    ~PlacementCache() { close(); }
+    PlacementCache(const PlacementCache&) = delete;
+    PlacementCache& operator=(const PlacementCache&) = delete;
+
+    // Maps path, creating it (2^slotBits slots) if it is missing. A file from another
+    // version, of the wrong size or with a slot count out of range is rebuilt in a
+    // temporary file and renamed over the old one, never truncated in place, so
+    // processes that still map the old file keep valid memory. Only the rebuild takes
+    // a lock (an exclusive flock on the old file); lookups take none.
+    bool open(const std::string& path, int slotBits = 20) {
+        close();
+        slotBits = std::min(std::max(slotBits, PLACEMENT_CACHE_MIN_BITS), PLACEMENT_CACHE_MAX_BITS);
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            int fd = ::open(path.c_str(), O_RDWR);
+            if (fd < 0) {
+                // missing: publish a new file, unless another process got there first
+                if (errno != ENOENT || (!create(path, slotBits, false) && errno != EEXIST)) return false;
+                continue;
+            }
+            struct stat st;
+            int bits = fstat(fd, &st) == 0 ? validBits(fd, st) : -1;
+            if (bits >= 0) {
+                size_t bytes = PLACEMENT_CACHE_HEADER + ((size_t)16 << bits);
+                void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                ::close(fd);
+                if (p == MAP_FAILED) return false;
+                base = (uint8_t*)p;
+                size = bytes;
+                slots = reinterpret_cast<std::atomic<uint64_t>*>(base + PLACEMENT_CACHE_HEADER);
+                mask = ((size_t)1 << bits) - 1;
+                return true;
+            }
+            // stale: one process replaces it; the others find a new file at path once
+            // they get the lock and open that
+            flock(fd, LOCK_EX);
+            struct stat now;
+            bool current = ::stat(path.c_str(), &now) == 0 && now.st_ino == st.st_ino && now.st_dev == st.st_dev;
+            bool ok = !current || create(path, slotBits, true);
+            flock(fd, LOCK_UN);
+            ::close(fd);
+            if (!ok) return false;
+        }
+        return false;
+    }
+
+    void close() {
+        if (base) munmap(base, size);
+        base = nullptr; slots = nullptr; size = 0;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+
+    bool lookup(uint64_t key, CachedPlacement& out) const {
+        if (!slots) return false;
+        size_t b = bucket(key);
+        for (int w = 0; w < PLACEMENT_CACHE_WAYS; ++w) {
+            uint64_t check = slots[2 * (b + w)].load(std::memory_order_relaxed);
+            uint64_t data = slots[2 * (b + w) + 1].load(std::memory_order_relaxed);
+            if (data && (check ^ data) == key) { out = unpack(data); return true; }
+        }
+        return false;
+    }
+
+    // Keeps the deeper of the stored and the new entry. Replaces an empty way, else
+    // the shallowest one in the bucket.
+    void store(uint64_t key, const CachedPlacement& e) {
+        if (!slots) return;
+        size_t b = bucket(key), victim = b;
+        int victimLevels = INT_MAX;
+        for (int w = 0; w < PLACEMENT_CACHE_WAYS; ++w) {
+            uint64_t check = slots[2 * (b + w)].load(std::memory_order_relaxed);
+            uint64_t data = slots[2 * (b + w) + 1].load(std::memory_order_relaxed);
+            if (data && (check ^ data) == key) {
+                if (unpack(data).levels >= e.levels) return;
+                victim = b + w; break;
+            }
+            int levels = data ? unpack(data).levels : -1;
+            if (levels < victimLevels) { victimLevels = levels; victim = b + w; }
+        }
+        uint64_t data = pack(e);
+        slots[2 * victim + 1].store(data, std::memory_order_relaxed);
+        slots[2 * victim].store(key ^ data, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return slots ? mask + 1 : 0; }
+
+private:
+    static_assert(sizeof(std::atomic<uint64_t>) == 8, "cache slots are mapped as raw 64-bit words");
+
+    // [score : 32][levels : 4][rotation : 4][x + 8 : 8][valid : 1]
+    static uint64_t pack(const CachedPlacement& e) {
+        return (uint64_t)(uint32_t)e.score << 32 | (uint64_t)(e.levels & 15) << 16 | (uint64_t)(e.placement.rotation & 15) << 12
+             | (uint64_t)((e.placement.x + 8) & 255) << 1 | 1u;
+    }
+    static CachedPlacement unpack(uint64_t d) {
+        CachedPlacement e;
+        e.score = (int)(uint32_t)(d >> 32);
+        e.levels = (int)(d >> 16) & 15;
+        e.placement.rotation = (int)(d >> 12) & 15;
+        e.placement.x = (int)((d >> 1) & 255) - 8;
+        return e;
+    }
+    size_t bucket(uint64_t key) const { return (size_t)(key >> 16) & mask & ~(size_t)(PLACEMENT_CACHE_WAYS - 1); }
+
+    // The slot bits of a complete file of this version, or -1.
+    static int validBits(int fd, const struct stat& st) {
+        uint8_t header[PLACEMENT_CACHE_HEADER];
+        if ((size_t)st.st_size < PLACEMENT_CACHE_HEADER || pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header)) return -1;
+        if (memcmp(header, "TPLC", 4) != 0 || getU32(header + 4) != PLACEMENT_CACHE_VERSION) return -1;
+        uint32_t bits = getU32(header + 8);
+        if (bits < (uint32_t)PLACEMENT_CACHE_MIN_BITS || bits > (uint32_t)PLACEMENT_CACHE_MAX_BITS) return -1;
+        return (size_t)st.st_size == PLACEMENT_CACHE_HEADER + ((size_t)16 << bits) ? (int)bits : -1;
+    }
+
+    // Writes an empty table to a temporary file, then moves it to path: rename over a
+    // stale file, or link so that a file another process published first is kept (the
+    // call then fails with EEXIST).
+    static bool create(const std::string& path, int slotBits, bool replace) {
+        std::string tmp = path + ".tmp" + std::to_string(getpid());
+        int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        uint8_t header[PLACEMENT_CACHE_HEADER] = {};
+        memcpy(header, "TPLC", 4);
+        putU32(header + 4, PLACEMENT_CACHE_VERSION);
+        putU32(header + 8, (uint32_t)slotBits);
+        bool ok = ftruncate(fd, (off_t)(PLACEMENT_CACHE_HEADER + ((size_t)16 << slotBits))) == 0
+               && pwrite(fd, header, sizeof(header), 0) == (ssize_t)sizeof(header);
+        ok = ::close(fd) == 0 && ok;
+        if (ok) ok = replace ? ::rename(tmp.c_str(), path.c_str()) == 0 : ::link(tmp.c_str(), path.c_str()) == 0;
+        int err = errno;
+        if (!ok || !replace) ::unlink(tmp.c_str());
+        errno = err;
+        return ok;
+    }
+
+    static uint32_t getU32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+    static void putU32(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    std::atomic<uint64_t>* slots = nullptr;
+    size_t mask = 0;
+};
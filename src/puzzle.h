@@ -0,0 +1,194 @@
+// puzzle.h
+// Puzzle generator: boards plus piece queues whose perfect clear ("clear 4 lines with
+// these 5 pieces") has exactly one solution, or at most a given number. Works on the
+// perfect-clear solver's packed bottom rows and placements (pc_solver.h).
+//
+// A candidate comes from taking a random queue back out of the full target rows, last
+// piece first, each from a spot it could have been hard-dropped into; what is left is
+// the board, so the pieces fit by count and usually by shape. Every candidate is counted
+// exactly: a depth-first search over the placements that stops as soon as the count
+// passes the limit, with dead (board, queue position, hold) states remembered.
+// Worker threads each generate and count their own candidates; the run stops for
+// all of them, mid-search included, once enough puzzles are accepted.
+
+#pragma once
+
+#include "pc_solver.h"
+
+#include <functional>
+#include <unordered_set>
+
+struct PuzzleSpec {
+    int height = 4;          // lines the solution clears (the board is this many rows)
+    int pieces = 5;          // queue length; the board has 10 * height - 4 * pieces cells
+    bool hold = false;
+    int maxSolutions = 1;    // accept 1..maxSolutions distinct solutions
+};
+
+struct Puzzle {
+    uint64_t board = 0;      // pc_solver packing: bottom row first
+    int height = 0;
+    std::vector<int> queue;
+    bool hold = false;
+    int solutions = 0;
+};
+
+struct PuzzleStats {
+    long long candidates = 0, accepted = 0;
+    long long discarded = 0;                              // some piece found no spot to come out of
+    long long unsolvable = 0, ambiguous = 0, duplicates = 0;
+    long long nodes = 0;
+    double seconds = 0.0;
+};
+
+// --------------------------- COUNTING ----------------------------
+// Solution counter for one candidate at a time. Solutions are distinct placement
+// sequences (placements giving the same board count once, as in pcForEachPlacement).
+class PuzzleCounter {
+public:
+    explicit PuzzleCounter(int tableBits = 16) : table((size_t)1 << tableBits, 0) {}
+
+    // Counts up to limit + 1; 0 if unsolvable. stop (if given) aborts with -1.
+    int count(const Puzzle& p, int limit, const std::atomic<bool>* stop = nullptr) {
+        if (++epoch == 64) { std::fill(table.begin(), table.end(), 0); epoch = 1; }
+        q = &p.queue;
+        hold = p.hold;
+        cap = limit + 1;
+        abort = stop;
+        int n = countFrom(p.board, p.height, 0, PC_NO_HOLD);
+        return abort && abort->load(std::memory_order_relaxed) ? -1 : n;
+    }
+
+    long long nodes = 0;
+
+private:
+    int countFrom(uint64_t board, int rows, int index, int heldPiece) {
+        if (rows == 0) return 1;   // every target line cleared (an empty board alone is not done)
+        if (abort && abort->load(std::memory_order_relaxed)) return 0;
+        ++nodes;
+        int available = (int)q->size() - index + (heldPiece != PC_NO_HOLD);
+        if ((BOARD_W * rows - pcCells(board)) / 4 > available || !pcSplitsFillable(board, rows)) return 0;
+        uint64_t key = board | ((uint64_t)index << 50) | ((uint64_t)heldPiece << 55) | ((uint64_t)epoch << 58);
+        size_t slot = (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 40) & (table.size() - 1);
+        if (table[slot] == key) return 0;
+        int total = 0;
+        pcForEachChoice(*q, hold, index, heldPiece, [&](int piece, int nextIndex, int nextHold, bool) {
+            return pcForEachPlacement(board, rows, piece, [&](const Placement&, uint64_t after, int lines) {
+                total += countFrom(after, rows - lines, nextIndex, nextHold);
+                return total >= cap;
+            });
+        });
+        if (total == 0 && !(abort && abort->load(std::memory_order_relaxed))) table[slot] = key;
+        return std::min(total, cap);
+    }
+
+    std::vector<uint64_t> table;   // dead states, one per slot, lossy
+    uint64_t epoch = 0;
+    const std::vector<int>* q = nullptr;
+    bool hold = false;
+    int cap = 2;
+    const std::atomic<bool>* abort = nullptr;
+};
+
+// --------------------------- CANDIDATES ----------------------------
+// Pieces are taken out of the full target rows in reverse queue order, each from a spot
+// a hard drop of that piece would land in on what is left (the pcForEachPlacement rule).
+// Rows completed before the last piece clear early in play, so this makes solvable
+// boards likely, not certain; the count decides. False if some piece found no spot.
+inline bool makePuzzleCandidate(PieceRng& rng, const PuzzleSpec& spec, Puzzle& out) {
+    int rows = spec.height;
+    out.height = rows;
+    out.hold = spec.hold;
+    out.queue.resize((size_t)spec.pieces);
+    uint64_t board = rows * BOARD_W >= 64 ? ~0ull : (1ull << (rows * BOARD_W)) - 1;
+    for (int i = spec.pieces - 1; i >= 0; --i) {
+        int piece = randomPiece(rng);
+        out.queue[(size_t)i] = piece;
+        const PcPieceShapes& ps = pcShapes()[piece];
+        uint64_t pick = 0;
+        unsigned seen = 0;
+        for (int si = 0; si < ps.count; ++si) {
+            const PcShape& s = ps.shapes[si];
+            for (int x = -s.minX; x + s.maxX < BOARD_W; ++x)
+                for (int base = 0; base < rows; ++base) {
+                    uint64_t mask = 0;
+                    bool inside = true;
+                    for (int k = 0; k < s.n && inside; ++k) {
+                        int y = base + s.cells[k].y;
+                        inside = y >= 0 && y < rows;
+                        if (inside) mask |= 1ull << (BOARD_W * y + x + s.cells[k].x);
+                    }
+                    if (!inside || (board & mask) != mask) continue;
+                    uint64_t rest = board & ~mask;
+                    // dropped onto rest, the piece must stop at base: column heights decide
+                    int landing = -BOARD_H;
+                    for (int c = 0; c < s.cols; ++c) {
+                        int col = x + s.minX + c, h = 0;
+                        for (int y = rows - 1; y >= 0; --y) if ((rest >> (BOARD_W * y + col)) & 1) { h = y + 1; break; }
+                        landing = std::max(landing, h - s.bottom[c]);
+                    }
+                    if (landing == base && rng() % ++seen == 0) pick = rest;
+                }
+        }
+        if (!seen) return false;
+        board = pick;
+    }
+    out.board = board;
+    return true;
+}
+
+inline uint64_t puzzleHash(const Puzzle& p) {
+    uint64_t h = p.board * 0x9e3779b97f4a7c15ULL ^ (uint64_t)p.height;
+    for (int piece : p.queue) h = (h ^ (uint64_t)piece) * 0x100000001b3ULL;
+    return h ^ (p.hold ? 0x5bd1e995u : 0);
+}
+
+// --------------------------- GENERATOR ----------------------------
+// Runs threads workers until count puzzles are accepted or the time runs out: the
+// calling thread and background jobs on the shared job system (0 for one per job
+// thread). sink is called under a lock, once per accepted puzzle, in acceptance order.
+inline PuzzleStats generatePuzzles(const PuzzleSpec& spec, int count, uint64_t seed, int threads, double seconds,
+                                   const std::function<void(const Puzzle&)>& sink) {
+    PuzzleStats st;
+    int empty = BOARD_W * spec.height - 4 * spec.pieces;
+    if (spec.height < 1 || spec.height > PC_MAX_HEIGHT || spec.pieces < 1 || spec.pieces > PC_MAX_QUEUE || empty < 0 || count <= 0) return st;
+    if (threads <= 0) threads = jobSystem().threadCount();
+    auto t0 = std::chrono::steady_clock::now();
+    auto deadline = t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    std::atomic<bool> stop{false};
+    std::atomic<long long> accepted{0};
+    std::mutex mtx;
+    std::unordered_set<uint64_t> seen;
+
+    auto work = [&](int index) {
+        PieceRng rng;
+        rng.seed(seed, (uint64_t)index);
+        PuzzleCounter counter;
+        PuzzleStats local;
+        Puzzle p;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if ((local.candidates & 63) == 0 && std::chrono::steady_clock::now() >= deadline) { stop = true; break; }
+            ++local.candidates;
+            if (!makePuzzleCandidate(rng, spec, p)) { ++local.discarded; continue; }
+            int n = counter.count(p, spec.maxSolutions, &stop);
+            if (n < 0) break;
+            if (n == 0) { ++local.unsolvable; continue; }
+            if (n > spec.maxSolutions) { ++local.ambiguous; continue; }
+            p.solutions = n;
+            std::lock_guard<std::mutex> lk(mtx);
+            if (stop.load(std::memory_order_relaxed)) break;
+            if (!seen.insert(puzzleHash(p)).second) { ++local.duplicates; continue; }
+            ++local.accepted;
+            sink(p);
+            if (accepted.fetch_add(1) + 1 >= count) stop = true;
+        }
+        local.nodes = counter.nodes;
+        std::lock_guard<std::mutex> lk(mtx);
+        st.candidates += local.candidates; st.accepted += local.accepted; st.discarded += local.discarded;
+        st.unsolvable += local.unsolvable; st.ambiguous += local.ambiguous; st.duplicates += local.duplicates;
+        st.nodes += local.nodes;
+    };
+    jobSystem().runLoops(threads, work);
+    st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return st;
+}
@@ -0,0 +1,129 @@
+// range_coder.h
+// Adaptive binary range coder (the LZMA scheme): 11-bit probabilities that adapt
+// by 1/16 per coded bit, multi-bit symbols coded through bit trees. Both sides
+// stream: the encoder hands finished bytes to a sink as it goes, the decoder pulls
+// bytes only when it needs them.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+const int RC_PROB_BITS = 11;
+const uint16_t RC_PROB_INIT = 1 << (RC_PROB_BITS - 1);
+const int RC_MOVE_BITS = 4;
+const uint32_t RC_TOP = 1u << 24;
+
+// Probabilities for an n-bit symbol coded MSB first (index 1 is the root).
+// A tree can also code fewer bits than it was sized for, which shares the upper levels.
+template<int NBITS>
+struct BitTree {
+    uint16_t probs[1 << NBITS];
+    BitTree() { for (auto& p : probs) p = RC_PROB_INIT; }
+};
+
+class RangeEncoder {
+public:
+    explicit RangeEncoder(std::vector<uint8_t>* out = nullptr) : out(out) {}
+    void setOutput(std::vector<uint8_t>* o) { out = o; }
+
+    void encodeBit(uint16_t& prob, int bit) {
+        uint32_t bound = (range >> RC_PROB_BITS) * prob;
+        if (!bit) { range = bound; prob += ((1 << RC_PROB_BITS) - prob) >> RC_MOVE_BITS; }
+        else { low += bound; range -= bound; prob -= prob >> RC_MOVE_BITS; }
+        while (range < RC_TOP) { range <<= 8; shiftLow(); }
+    }
+
+    // Equiprobable bits, for values with no useful statistics.
+    void encodeDirect(uint32_t value, int nbits) {
+        for (int i = nbits - 1; i >= 0; --i) {
+            range >>= 1;
+            if ((value >> i) & 1) low += range;
+            while (range < RC_TOP) { range <<= 8; shiftLow(); }
+        }
+    }
+
+    template<int NBITS>
+    void encodeTree(BitTree<NBITS>& t, uint32_t symbol, int nbits = NBITS) {
+        uint32_t m = 1;
+        for (int i = nbits - 1; i >= 0; --i) {
+            int bit = (symbol >> i) & 1;
+            encodeBit(t.probs[m], bit);
+            m = (m << 1) | bit;
+        }
+    }
+
+    // Pushes out the remaining state; the encoder must be reset() before reuse.
+    void flush() { for (int i = 0; i < 5; ++i) shiftLow(); }
+    void reset() { low = 0; range = 0xFFFFFFFFu; cache = 0; cacheSize = 1; }
+
+private:
+    void shiftLow() {
+        if ((uint32_t)low < 0xFF000000u || (low >> 32) != 0) {
+            uint8_t carry = (uint8_t)(low >> 32);
+            uint8_t temp = cache;
+            do { out->push_back((uint8_t)(temp + carry)); temp = 0xFF; } while (--cacheSize != 0);
+            cache = (uint8_t)(low >> 24);
+        }
+        ++cacheSize;
+        low = (low & 0x00FFFFFFu) << 8;
+    }
+
+    std::vector<uint8_t>* out;
+    uint64_t low = 0;
+    uint32_t range = 0xFFFFFFFFu;
+    uint8_t cache = 0;
+    uint64_t cacheSize = 1;
+};
+
+class RangeDecoder {
+public:
+    // Reads past `end` as zeros, so a truncated stream decodes garbage instead of crashing.
+    void init(const uint8_t* begin, const uint8_t* end) {
+        p = begin; e = end; range = 0xFFFFFFFFu; code = 0;
+        for (int i = 0; i < 5; ++i) code = (code << 8) | next();
+    }
+
+    // Starts a new stream at the current read position (after a flushed one ended).
+    void restart() { init(p, e); }
+
+    int decodeBit(uint16_t& prob) {
+        uint32_t bound = (range >> RC_PROB_BITS) * prob;
+        int bit;
+        if (code < bound) { range = bound; prob += ((1 << RC_PROB_BITS) - prob) >> RC_MOVE_BITS; bit = 0; }
+        else { code -= bound; range -= bound; prob -= prob >> RC_MOVE_BITS; bit = 1; }
+        while (range < RC_TOP) { range <<= 8; code = (code << 8) | next(); }
+        return bit;
+    }
+
+    uint32_t decodeDirect(int nbits) {
+        uint32_t v = 0;
+        for (int i = 0; i < nbits; ++i) {
+            range >>= 1;
+            uint32_t bit = code >= range;
+            if (bit) code -= range;
+            v = (v << 1) | bit;
+            while (range < RC_TOP) { range <<= 8; code = (code << 8) | next(); }
+        }
+        return v;
+    }
+
+    template<int NBITS>
+    uint32_t decodeTree(BitTree<NBITS>& t, int nbits = NBITS) {
+        uint32_t m = 1;
+        for (int i = 0; i < nbits; ++i) m = (m << 1) | decodeBit(t.probs[m]);
+        return m - (1u << nbits);
+    }
+
+    // True once the decoder has needed more bytes than the stream held (corrupt or truncated).
+    bool overrun() const { return p > e; }
+
+private:
+    uint8_t next() { return p < e ? *p++ : (++p, 0); }
+
+    const uint8_t* p = nullptr;
+    const uint8_t* e = nullptr;
+    uint32_t range = 0xFFFFFFFFu;
+    uint32_t code = 0;
+};
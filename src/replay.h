@@ -0,0 +1,525 @@
+// replay.h
+// Replay records: only what cannot be derived. Piece order comes from the seed and
+// gravity from the clock (one step every gravityTicks), so a record is the seed plus
+// the player's inputs, each coded as (input symbol, delta ticks) under the adaptive
+// range coder in range_coder.h. Encoding streams to disk during play; decoding pulls
+// one event at a time, so playback and re-simulation never expand a whole record.
+// Records are self-delimiting, so an archive is just replay files concatenated
+// together and can be scanned straight out of mmap.
+//
+// Layout, little-endian:
+//   header   "TRPL" | u16 version | u16 flags | u32 seed | u32 payloadBytes | u16 tickHz | u16 gravityTicks   (20 bytes)
+//   payload  coded events, closed by an END symbol that carries the final tick
+//   index    keyframe footer, present when flags & REPLAY_FLAG_INDEX (see KEYFRAMES)
+// flags & REPLAY_FLAG_CASCADE marks a game played with cascade gravity.
+// payloadBytes and flags are patched when the recording finishes; payloadBytes 0 means
+// it never finished (the game died) and the payload runs to the end of the file.
+//
+// Version 1 (16-byte header with an event count, then u32 timeMs | u8 action | u8 param
+// per event, gravity stored explicitly) is still read.
+
+#pragma once
+
+#include "tetris_core.h"
+#include "range_coder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+const uint16_t REPLAY_VERSION = 2;
+const size_t REPLAY_HEADER_SIZE = 20;
+const size_t REPLAY_V1_HEADER_SIZE = 16;
+const size_t REPLAY_V1_EVENT_SIZE = 6;
+const uint16_t REPLAY_TICK_HZ = SIM_TICK_HZ;   // inputs are stamped with the frame they arrived in
+const uint16_t REPLAY_FLAG_INDEX = 1;
+const uint16_t REPLAY_FLAG_CASCADE = 2;   // played with cascade gravity (GameState::cascade)
+
+struct ReplayEvent {
+    uint32_t tick;     // 1/tickHz s since the start of the game
+    uint8_t action;
+    uint8_t param;
+};
+
+inline void putU16(std::vector<uint8_t>& out, uint16_t v) { out.push_back((uint8_t)v); out.push_back((uint8_t)(v >> 8)); }
+inline void putU32(std::vector<uint8_t>& out, uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i))); }
+inline uint16_t getU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+inline uint32_t getU32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Gravity period of a game in replay ticks; the game and the decoder must agree on it.
+inline uint16_t gravityTicksFor(const GameState& g) { return std::max<uint16_t>(1, g.gravityTicks); }
+
+// --------------------------- EVENT MODEL ----------------------------
+// Symbols are the GameAction values plus END; gravity is never an input, so its
+// value marks a segment break instead (see KEYFRAMES).
+// Input symbols are predicted from the previous two; delta ticks are coded as a
+// bit length (predicted from the symbol) followed by the top mantissa bits
+// modelled and the rest raw. Typed-out placements and steady DAS-like tapping
+// end up costing a fraction of a bit per input.
+const int REPLAY_SYM_SEGMENT = ACT_GRAVITY;
+const int REPLAY_SYM_END = 7;
+const int REPLAY_MANTISSA_MODELLED = 3;
+
+struct ReplayModel {
+    BitTree<3> symbol[8][8];
+    BitTree<5> length[8];
+    BitTree<REPLAY_MANTISSA_MODELLED> mantissa[32];
+    BitTree<2> garbageRows;
+    BitTree<4> garbageHole;
+    int prev1 = REPLAY_SYM_END, prev2 = REPLAY_SYM_END;
+};
+
+inline int deltaLength(uint32_t d) { int n = 0; while (d) { ++n; d >>= 1; } return n; }
+
+inline void encodeReplayEvent(RangeEncoder& rc, ReplayModel& m, int sym, uint32_t delta, int param) {
+    rc.encodeTree(m.symbol[m.prev1][m.prev2], (uint32_t)sym);
+    int len = deltaLength(delta);
+    rc.encodeTree(m.length[sym], (uint32_t)len);
+    if (len > 1) {
+        int bits = len - 1, top = std::min(bits, REPLAY_MANTISSA_MODELLED);
+        uint32_t mant = delta - (1u << bits);
+        rc.encodeTree(m.mantissa[len], mant >> (bits - top), top);
+        rc.encodeDirect(mant & ((1u << (bits - top)) - 1), bits - top);
+    }
+    if (sym == ACT_GARBAGE) {
+        rc.encodeTree(m.garbageRows, (uint32_t)((param >> 4) - 1) & 3);
+        rc.encodeTree(m.garbageHole, (uint32_t)param & 15);
+    }
+    m.prev2 = m.prev1; m.prev1 = sym;
+}
+
+inline int decodeReplayEvent(RangeDecoder& rc, ReplayModel& m, uint32_t& delta, int& param) {
+    int sym = (int)rc.decodeTree(m.symbol[m.prev1][m.prev2]);
+    int len = (int)rc.decodeTree(m.length[sym]);
+    delta = len > 0 ? 1u : 0u;
+    if (len > 1) {
+        int bits = len - 1, top = std::min(bits, REPLAY_MANTISSA_MODELLED);
+        uint32_t mant = rc.decodeTree(m.mantissa[len], top) << (bits - top);
+        mant |= rc.decodeDirect(bits - top);
+        delta = (1u << bits) + mant;
+    }
+    param = 0;
+    if (sym == ACT_GARBAGE) {
+        int rows = (int)rc.decodeTree(m.garbageRows) + 1;
+        param = garbageParam(rows, (int)rc.decodeTree(m.garbageHole));
+    }
+    m.prev2 = m.prev1; m.prev1 = sym;
+    return sym;
+}
+
+// Shared starting point for every record: the model after a canned set of
+// placements (each rotation count with each column offset, typed a few ticks apart),
+// so short games do not pay for learning what inputs look like from scratch.
+// Changing it changes the format.
+inline const ReplayModel& primedReplayModel() {
+    static const ReplayModel primed = []{
+        ReplayModel m;
+        std::vector<uint8_t> scratch;
+        RangeEncoder rc(&scratch);
+        for (int pass = 0; pass < 2; ++pass)
+            for (int r = 0; r < 4; ++r)
+                for (int dx = -4; dx <= 5; ++dx) {
+                    uint32_t d = pass ? 8 : 4;
+                    for (int i = 0; i < r; ++i) encodeReplayEvent(rc, m, ACT_ROTATE, d, 0);
+                    for (int i = 0; i < std::abs(dx); ++i) encodeReplayEvent(rc, m, dx < 0 ? ACT_LEFT : ACT_RIGHT, d, 0);
+                    encodeReplayEvent(rc, m, ACT_HARD_DROP, d, 0);
+                }
+        m.prev1 = m.prev2 = REPLAY_SYM_END;
+        return m;
+    }();
+    return primed;
+}
+
+// --------------------------- KEYFRAMES ----------------------------
+// Once a segment holds REPLAY_KEYFRAME_BYTES of coded input the writer ends it (a
+// SEGMENT symbol and a coder flush; the next segment starts from the primed model)
+// and snapshots the game. Spacing by coded size keeps the footer plus the restart
+// cost near 6% of the payload however sparse or dense the input is. Seeking restores
+// the last snapshot before the target and re-simulates the rest of its segment, a few
+// thousand events at most, which takes well under a millisecond.
+//   footer  "TKFI" | u32 count | count x 92-byte entries, in tick order:
+//           u32 tick | u32 offset | u32 lastTick | u32 nextGravity | u32 pieceSerial | u64 rng state | u64 rng inc
+//           | u16 rows[BOARD_H] (bit x = column x) | u8 piece | u8 next | i8 x | i8 y | u8 gameOver | i8 blocks[4][2] | 3 pad
+const size_t REPLAY_KEYFRAME_BYTES = 2048;
+const size_t REPLAY_INDEX_HEADER_SIZE = 8;
+const size_t REPLAY_KEYFRAME_SIZE = 92;
+
+struct ReplayKeyframe {
+    uint32_t tick = 0;         // replay clock when the snapshot was taken
+    uint32_t offset = 0;       // payload offset of the segment that follows
+    uint32_t lastTick = 0;     // tick of the last input before it; deltas continue from here
+    uint32_t nextGravity = 0;  // first gravity step not yet applied to state
+    GameState state;
+};
+
+inline void putKeyframe(std::vector<uint8_t>& out, const ReplayKeyframe& k) {
+    const GameState& g = k.state;
+    size_t start = out.size();
+    putU32(out, k.tick); putU32(out, k.offset); putU32(out, k.lastTick); putU32(out, k.nextGravity);
+    putU32(out, g.pieceSerial);
+    putU32(out, (uint32_t)g.rng.state); putU32(out, (uint32_t)(g.rng.state >> 32));
+    putU32(out, (uint32_t)g.rng.inc); putU32(out, (uint32_t)(g.rng.inc >> 32));
+    for (int y = 0; y < BOARD_H; ++y) {
+        uint16_t row = 0;
+        for (int x = 0; x < BOARD_W; ++x) row |= (uint16_t)((g.board[y][x] != 0) << x);
+        putU16(out, row);
+    }
+    out.push_back((uint8_t)g.currentPieceIndex);
+    out.push_back((uint8_t)g.nextPieceIndex);
+    out.push_back((uint8_t)(int8_t)g.currentPos.x);
+    out.push_back((uint8_t)(int8_t)g.currentPos.y);
+    out.push_back(g.gameOver ? 1 : 0);
+    for (size_t i = 0; i < 4; ++i) {
+        glm::ivec2 b = i < g.currentPiece.blocks.size() ? g.currentPiece.blocks[i] : glm::ivec2(0, 0);
+        out.push_back((uint8_t)(int8_t)b.x);
+        out.push_back((uint8_t)(int8_t)b.y);
+    }
+    out.resize(start + REPLAY_KEYFRAME_SIZE, 0);
+}
+
+inline void getKeyframe(const uint8_t* p, ReplayKeyframe& k) {
+    GameState& g = k.state;
+    k.tick = getU32(p); k.offset = getU32(p + 4); k.lastTick = getU32(p + 8); k.nextGravity = getU32(p + 12);
+    g.pieceSerial = getU32(p + 16);
+    g.rng.state = getU32(p + 20) | ((uint64_t)getU32(p + 24) << 32);
+    g.rng.inc = getU32(p + 28) | ((uint64_t)getU32(p + 32) << 32);
+    p += 36;
+    for (int y = 0; y < BOARD_H; ++y, p += 2)
+        for (int x = 0; x < BOARD_W; ++x) g.board[y][x] = (getU16(p) >> x) & 1;
+    g.currentPieceIndex = p[0] % PIECE_COUNT;
+    g.nextPieceIndex = p[1] % PIECE_COUNT;
+    g.currentPos = glm::ivec2((int8_t)p[2], (int8_t)p[3]);
+    g.gameOver = p[4] != 0;
+    g.currentPiece = PIECES[g.currentPieceIndex];
+    for (int i = 0; i < 4; ++i) g.currentPiece.blocks[i] = glm::ivec2((int8_t)p[5 + 2 * i], (int8_t)p[6 + 2 * i]);
+    g.gravityTimer = 0;
+}
+
+// --------------------------- WRITER ----------------------------
+// Encodes one game as it is played. With a path the coded bytes go to the file in
+// small chunks; without one the record stays in memory (bytes()).
+class ReplayWriter {
+public:
+    ~ReplayWriter() { if (f) std::fclose(f); }
+
+    bool start(const std::string& path, uint32_t seed, uint16_t gravityTicks, bool cascade = false) {
+        if (f) { std::fclose(f); f = nullptr; }
+        buf.clear();
+        buf.reserve(8192);   // a file writer spills at 4 KB, so the buffer never grows while playing
+        buf.insert(buf.end(), {'T','R','P','L'});
+        putU16(buf, REPLAY_VERSION);
+        ruleFlags = cascade ? REPLAY_FLAG_CASCADE : 0;
+        putU16(buf, ruleFlags);
+        putU32(buf, seed);
+        putU32(buf, 0);
+        putU16(buf, REPLAY_TICK_HZ);
+        putU16(buf, gravityTicks);
+        model = primedReplayModel();
+        rc.reset();
+        rc.setOutput(&buf);
+        index.clear();
+        index.reserve(32 * REPLAY_KEYFRAME_SIZE);   // ~64 KB of input before it has to grow mid-game
+        key.state.currentPiece.blocks.reserve(PIECE_BLOCKS);
+        written = 0;
+        lastTick = 0;
+        events = 0;
+        segmentStart = buf.size();
+        active = !path.empty() ? (f = std::fopen(path.c_str(), "wb")) != nullptr : true;
+        return active;
+    }
+
+    // Gravity is derived on decode and not stored.
+    void add(uint32_t tick, GameAction a, int param = 0) {
+        if (!active || a == ACT_GRAVITY || a >= ACT_COUNT) return;
+        encodeReplayEvent(rc, model, a, delta(tick), param);
+        ++events;
+        if (f && buf.size() >= 4096) spill();
+    }
+
+    bool keyframeDue() const { return active && written + buf.size() - segmentStart >= REPLAY_KEYFRAME_BYTES; }
+
+    // Ends the current segment and snapshots g, which must include every input added
+    // so far and every gravity step before nextGravity. tick is the current replay clock.
+    void keyframe(const GameState& g, uint32_t tick, uint32_t nextGravity) {
+        if (!active) return;
+        encodeReplayEvent(rc, model, REPLAY_SYM_SEGMENT, 0, 0);
+        rc.flush();
+        rc.reset();
+        model = primedReplayModel();
+        ReplayKeyframe& k = key;   // reused: assigning the state keeps the piece's block vector
+        k.tick = tick;
+        k.offset = (uint32_t)(written + buf.size() - REPLAY_HEADER_SIZE);
+        k.lastTick = lastTick;
+        k.nextGravity = nextGravity;
+        k.state = g;
+        putKeyframe(index, k);
+        segmentStart = written + buf.size();
+    }
+
+    // Closes the stream at endTick (gravity up to and including it is replayed), appends
+    // the keyframe footer, patches the header and closes the file. Inactive until the next start().
+    bool finish(uint32_t endTick) {
+        if (!active) return false;
+        active = false;
+        encodeReplayEvent(rc, model, REPLAY_SYM_END, delta(endTick), 0);
+        rc.flush();
+        uint32_t payload = (uint32_t)(written + buf.size() - REPLAY_HEADER_SIZE);
+        uint16_t flags = ruleFlags;
+        if (!index.empty()) {
+            flags |= REPLAY_FLAG_INDEX;
+            buf.insert(buf.end(), {'T','K','F','I'});
+            putU32(buf, (uint32_t)(index.size() / REPLAY_KEYFRAME_SIZE));
+            buf.insert(buf.end(), index.begin(), index.end());
+        }
+        uint8_t flagBytes[2] = {(uint8_t)flags, (uint8_t)(flags >> 8)};
+        uint8_t sizeBytes[4];
+        for (int i = 0; i < 4; ++i) sizeBytes[i] = (uint8_t)(payload >> (8 * i));
+        bool ok = true;
+        if (f) {
+            ok = spill();
+            ok = ok && std::fseek(f, 6, SEEK_SET) == 0 && std::fwrite(flagBytes, 1, 2, f) == 2;
+            ok = ok && std::fseek(f, 12, SEEK_SET) == 0 && std::fwrite(sizeBytes, 1, 4, f) == 4;
+            ok = (std::fclose(f) == 0) && ok;
+            f = nullptr;
+        } else {
+            std::memcpy(&buf[6], flagBytes, 2);
+            std::memcpy(&buf[12], sizeBytes, 4);
+        }
+        return ok;
+    }
+
+    bool isActive() const { return active; }
+    uint32_t eventCount() const { return events; }
+    const std::vector<uint8_t>& bytes() const { return buf; }   // in-memory records only
+
+private:
+    uint32_t delta(uint32_t tick) {
+        uint32_t d = tick > lastTick ? tick - lastTick : 0;
+        if (d >= 0x80000000u) d = 0x7FFFFFFFu;
+        lastTick += d;
+        return d;
+    }
+
+    bool spill() {
+        bool ok = std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+        written += buf.size();
+        buf.clear();
+        return ok;
+    }
+
+    FILE* f = nullptr;
+    std::vector<uint8_t> buf;
+    std::vector<uint8_t> index;   // serialized keyframes, written out by finish()
+    ReplayKeyframe key;
+    RangeEncoder rc;
+    ReplayModel model;
+    size_t written = 0;
+    uint32_t lastTick = 0;
+    uint32_t events = 0;
+    uint16_t ruleFlags = 0;       // REPLAY_FLAG_CASCADE, kept when finish() patches the flags
+    size_t segmentStart = 0;      // file position where the current segment began
+    bool active = false;
+};
+
+// --------------------------- READER ----------------------------
+// A view into one record inside a mapped file; nothing is copied.
+struct ReplayView {
+    const uint8_t* data = nullptr;
+    size_t bytes = 0;
+    uint16_t version = 0;
+    uint32_t seed = 0;
+    uint16_t tickHz = REPLAY_TICK_HZ;
+    uint16_t gravityTicks = 0;       // 0: gravity is stored as events (version 1)
+    bool cascade = false;
+    const uint8_t* payload = nullptr;
+    size_t payloadBytes = 0;
+    const uint8_t* keyframes = nullptr;
+    uint32_t keyframeCount = 0;
+
+    size_t size() const { return bytes; }
+    uint32_t keyframeTick(uint32_t i) const { return getU32(keyframes + (size_t)i * REPLAY_KEYFRAME_SIZE); }
+    void keyframe(uint32_t i, ReplayKeyframe& k) const { getKeyframe(keyframes + (size_t)i * REPLAY_KEYFRAME_SIZE, k); }
+};
+
+// Parses the record at p. Returns false on a bad magic/version or a truncated record.
+inline bool parseReplay(const uint8_t* p, size_t avail, ReplayView& out) {
+    if (avail < REPLAY_V1_HEADER_SIZE || std::memcmp(p, "TRPL", 4) != 0) return false;
+    out.data = p;
+    out.version = getU16(p + 4);
+    out.seed = getU32(p + 8);
+    if (out.version == 1) {
+        out.tickHz = 1000;
+        out.gravityTicks = 0;
+        out.payload = p + REPLAY_V1_HEADER_SIZE;
+        out.payloadBytes = (size_t)getU32(p + 12) * REPLAY_V1_EVENT_SIZE;
+    } else if (out.version == REPLAY_VERSION) {
+        if (avail < REPLAY_HEADER_SIZE) return false;
+        out.tickHz = getU16(p + 16);
+        out.gravityTicks = getU16(p + 18);
+        out.payload = p + REPLAY_HEADER_SIZE;
+        out.payloadBytes = getU32(p + 12);
+        if (out.payloadBytes == 0) out.payloadBytes = avail - REPLAY_HEADER_SIZE; // unfinished recording
+        if (out.tickHz == 0 || out.gravityTicks == 0) return false;
+    } else {
+        return false;
+    }
+    out.bytes = (size_t)(out.payload - p) + out.payloadBytes;
+    out.keyframes = nullptr;
+    out.keyframeCount = 0;
+    out.cascade = out.version != 1 && (getU16(p + 6) & REPLAY_FLAG_CASCADE);
+    if (out.version != 1 && (getU16(p + 6) & REPLAY_FLAG_INDEX)) {
+        const uint8_t* idx = p + out.bytes;
+        if (out.bytes + REPLAY_INDEX_HEADER_SIZE > avail || std::memcmp(idx, "TKFI", 4) != 0) return false;
+        out.keyframeCount = getU32(idx + 4);
+        out.keyframes = idx + REPLAY_INDEX_HEADER_SIZE;
+        out.bytes += REPLAY_INDEX_HEADER_SIZE + (size_t)out.keyframeCount * REPLAY_KEYFRAME_SIZE;
+    }
+    return out.bytes <= avail;
+}
+
+// Streams the events of a record in order, with gravity steps merged back in: the
+// step due at tick T comes before inputs stamped T, the same order the game applies them.
+class ReplayReader {
+public:
+    explicit ReplayReader(const ReplayView& v) : view(v) { rewind(); }
+
+    void rewind() {
+        index = 0;
+        restart(0, 0, view.gravityTicks);
+    }
+
+    // Continues from a keyframe of this record; the caller restores k.state.
+    void seek(const ReplayKeyframe& k) { restart(k.offset, k.lastTick, k.nextGravity); }
+
+    bool next(ReplayEvent& e) {
+        if (view.version == 1) {
+            if (index * REPLAY_V1_EVENT_SIZE >= view.payloadBytes) return false;
+            const uint8_t* p = view.payload + index++ * REPLAY_V1_EVENT_SIZE;
+            e = ReplayEvent{getU32(p), p[4], p[5]};
+            return true;
+        }
+        if (!hasPending && !finished) decodeNext();
+        uint32_t limit = hasPending ? pending.tick : endTick;
+        if (nextGravity <= limit) {
+            e = ReplayEvent{nextGravity, ACT_GRAVITY, 0};
+            nextGravity += view.gravityTicks;
+            return true;
+        }
+        if (!hasPending) return false;
+        e = pending;
+        hasPending = false;
+        return true;
+    }
+
+    // False if the payload ran out before its END symbol.
+    bool intact() const { return !corrupt; }
+
+private:
+    void restart(uint32_t offset, uint32_t tick, uint32_t gravity) {
+        if (view.version != 1) rc.init(view.payload + std::min((size_t)offset, view.payloadBytes), view.payload + view.payloadBytes);
+        model = primedReplayModel();
+        hasPending = finished = corrupt = false;
+        lastTick = tick;
+        endTick = 0;
+        nextGravity = gravity;
+    }
+
+    void decodeNext() {
+        uint32_t delta;
+        int param;
+        int sym = decodeReplayEvent(rc, model, delta, param);
+        while (sym == REPLAY_SYM_SEGMENT && !rc.overrun()) {
+            rc.restart();   // the flushed segment ends exactly where the decoder stopped reading
+            model = primedReplayModel();
+            sym = decodeReplayEvent(rc, model, delta, param);
+        }
+        if (rc.overrun() || (sym != REPLAY_SYM_END && sym >= ACT_COUNT) || sym == REPLAY_SYM_SEGMENT) {
+            corrupt = finished = true;  // replay what was intact, no trailing gravity
+            endTick = 0;
+            nextGravity = 0xFFFFFFFFu;
+            return;
+        }
+        lastTick += delta;
+        if (sym == REPLAY_SYM_END) { finished = true; endTick = lastTick; return; }
+        pending = ReplayEvent{lastTick, (uint8_t)sym, (uint8_t)param};
+        hasPending = true;
+    }
+
+    ReplayView view;
+    RangeDecoder rc;
+    ReplayModel model;
+    size_t index = 0;
+    ReplayEvent pending{};
+    bool hasPending = false, finished = false, corrupt = false;
+    uint32_t lastTick = 0, endTick = 0, nextGravity = 0;
+};
+
+// Index of the last keyframe at or before tick, or -1.
+inline int findKeyframe(const ReplayView& v, uint32_t tick) {
+    int lo = 0, hi = (int)v.keyframeCount;
+    while (lo < hi) { int mid = (lo + hi) / 2; if (v.keyframeTick((uint32_t)mid) <= tick) lo = mid + 1; else hi = mid; }
+    return lo - 1;
+}
+
+// --------------------------- RE-SIMULATION ----------------------------
+// Hooks for anything that watches a replay being re-simulated.
+struct ReplayObserver {
+    virtual ~ReplayObserver() {}
+    virtual void onStart(const GameState&) {}
+    virtual void onInput(const GameState& /*before*/, GameAction) {}                 // every event, gravity included
+    virtual void onPlace(const GameState& /*before*/, GameAction /*locking*/) {} // the action will lock the piece
+    virtual void onLock(const GameState& /*after*/, int /*pieceIdx*/, int /*lines*/) {}
+    virtual void onEnd(const GameState&, GameAction /*lastAction*/) {}
+};
+
+// Applies one replay event to g; returns lines cleared and reports locks to obs.
+inline int applyReplayEvent(GameState& g, const ReplayEvent& e, ReplayObserver* obs = nullptr) {
+    if (e.action >= ACT_COUNT) return 0;
+    int piece = g.currentPieceIndex;
+    unsigned serial = g.pieceSerial;
+    if (obs) obs->onInput(g, (GameAction)e.action);
+    if (obs && actionLocksPiece(g, (GameAction)e.action)) obs->onPlace(g, (GameAction)e.action);
+    int lines = applyAction(g, (GameAction)e.action, e.param);
+    if (obs && g.pieceSerial != serial) obs->onLock(g, piece, lines);
+    return lines;
+}
+
+// Plays the record into g (reused between calls, so steady-state re-simulation does not allocate).
+inline void simulateReplay(const ReplayView& r, GameState& g, ReplayObserver* obs = nullptr) {
+    g.cascade = r.cascade;
+    resetGame(g, r.seed);
+    if (obs) obs->onStart(g);
+    GameAction last = ACT_COUNT;
+    ReplayReader reader(r);
+    ReplayEvent e;
+    while (!g.gameOver && reader.next(e)) {
+        if (e.action >= ACT_COUNT) continue;
+        last = (GameAction)e.action;
+        applyReplayEvent(g, e, obs);
+    }
+    if (obs) obs->onEnd(g, last);
+}
+
+// Puts g and r at `tick`: restores the last keyframe at or before it (or starts over
+// without one) and re-simulates up to and including tick. pending receives the first
+// later event; returns false if there is none.
+inline bool seekReplay(const ReplayView& v, ReplayReader& r, GameState& g, uint32_t tick, ReplayEvent& pending) {
+    int k = findKeyframe(v, tick);
+    if (k < 0) {
+        resetGame(g, v.seed);
+        r.rewind();
+    } else {
+        ReplayKeyframe kf;
+        v.keyframe((uint32_t)k, kf);
+        g = kf.state;
+        r.seek(kf);
+    }
+    g.cascade = v.cascade;
+    while (r.next(pending)) {
+        if (pending.tick > tick) return true;
+        applyReplayEvent(g, pending);
+    }
+    return false;
+}
@@ -0,0 +1,334 @@
+// rollback.h
+// Rollback netcode for two-player versus over UDP (GGPO style).
+//
+// Both peers run the same VersusSim: two GameStates stepped on the 60 Hz sim tick
+// with per-tick input bitmasks, gravity counted in ticks by updateGame, and garbage
+// holes drawn from a generator inside the sim. Nothing depends on frame
+// time or on state outside the struct, so equal inputs give equal states everywhere.
+//
+// Local inputs are scheduled NET_INPUT_DELAY ticks ahead and sent every frame with
+// every input the peer has not acknowledged. Each packet also carries the sender's
+// tick and how far ahead of the other side it thinks it is; the peer that runs ahead
+// slows its clock a little so both predict about equally often. Missing remote inputs are predicted as
+// "nothing pressed" (inputs are key presses, not held buttons). When a remote input
+// arrives that differs from the prediction, the state saved at the start of that
+// tick is restored and the ticks up to the present are simulated again. Snapshots
+// are plain copies into a preallocated ring; once every slot has been written the
+// copies reuse the slots' storage, so saving and restoring do not allocate.
+//
+// Peers also exchange a checksum of the newest fully confirmed state once a second;
+// a mismatch means the simulations diverged and is reported through desynced().
+
+#pragma once
+
+#include "tetris_core.h"
+#include "replay.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+const int NET_TICK_HZ = REPLAY_TICK_HZ;
+const int NET_INPUT_DELAY = 2;           // ticks between a key press and the tick it applies to
+const int NET_MAX_ROLLBACK = 12;         // stall instead of predicting further ahead than this
+const int NET_RING = 64;                 // ticks of snapshots and inputs kept (> rollback + delay)
+const int NET_CHECKSUM_INTERVAL = NET_TICK_HZ;
+const int NET_CHECKSUMS_KEPT = 4;
+const uint32_t NET_MAGIC = 0x504e5254;   // "TRNP"
+
+// One bit per player action (ACT_LEFT .. ACT_HARD_DROP).
+inline uint8_t netInputBit(GameAction a) { return (uint8_t)(1u << a); }
+
+// --------------------------- DETERMINISTIC VERSUS ----------------------------
+struct VersusSim {
+    GameState players[2];
+    PieceRng garbageRng;
+    uint32_t tick = 0;
+    bool over = false;
+
+    void reset(uint32_t seed) {
+        resetGame(players[0], seed);
+        resetGame(players[1], seed); // same piece sequence for both sides
+        garbageRng.seed(seed, 1);
+        tick = 0;
+        over = false;
+    }
+
+    // Applies one tick: each player's gravity (before inputs, like in replays), then
+    // its inputs in action order. Garbage sent during the
+    // tick arrives after both players moved, so neither side goes first.
+    void step(const uint8_t inputs[2]) {
+        if (over) { ++tick; return; }
+        int sent[2] = {0, 0};
+        for (int p = 0; p < 2; ++p) {
+            GameState& g = players[p];
+            sent[p] += updateGame(g);
+            for (int a = ACT_LEFT; a <= ACT_HARD_DROP; ++a)
+                if (inputs[p] & netInputBit((GameAction)a)) sent[p] += applyAction(g, (GameAction)a);
+        }
+        for (int p = 0; p < 2; ++p) {
+            int rows = garbageForLines(sent[p]);
+            if (rows) applyAction(players[1 - p], ACT_GARBAGE, garbageParam(rows, (int)(((uint64_t)garbageRng() * BOARD_W) >> 32)));
+        }
+        over = players[0].gameOver || players[1].gameOver;
+        ++tick;
+    }
+
+    uint32_t checksum() const {
+        uint32_t h = hashGame(players[1], hashGame(players[0]));
+        auto mix = [&](uint32_t v) { h = (h ^ v) * 16777619u; };
+        mix((uint32_t)garbageRng.state); mix((uint32_t)(garbageRng.state >> 32)); mix(tick);
+        return h;
+    }
+};
+
+// --------------------------- SESSION ----------------------------
+struct RollbackStats {
+    long long rollbacks = 0;
+    long long resimTicks = 0;
+    int maxRollback = 0;       // deepest rollback so far, in ticks
+    double maxResimMs = 0.0;   // slowest restore + re-simulation
+    long long stalls = 0;      // frames that waited for the peer
+    long long checksumsMatched = 0;
+};
+
+class RollbackSession {
+public:
+    ~RollbackSession() { if (fd >= 0) ::close(fd); }
+
+    // The host is player 0 and picks the seed; the joiner is player 1.
+    bool host(uint16_t port, uint32_t gameSeed) {
+        seed = gameSeed;
+        local = 0;
+        return openSocket(port);
+    }
+    bool join(const std::string& hostName, uint16_t port) {
+        local = 1;
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if (getaddrinfo(hostName.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) return false;
+        std::memcpy(&peer, res->ai_addr, sizeof(peer));
+        freeaddrinfo(res);
+        havePeer = true;
+        return openSocket(0);
+    }
+
+    uint16_t port() const {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        return fd >= 0 && getsockname(fd, (sockaddr*)&addr, &len) == 0 ? ntohs(addr.sin_port) : 0;
+    }
+    bool connected() const { return started; }
+    int localPlayer() const { return local; }
+    const VersusSim& state() const { return sim; }
+    const RollbackStats& stats() const { return st; }
+    bool desynced() const { return desync; }
+    uint32_t confirmedTick() const { return remoteKnown; }
+
+    // Once per frame: receive, roll back if a prediction was wrong, advance the ticks
+    // dt covers (pressed goes to the first of them, or waits if the peer is too far
+    // behind to advance at all), send.
+    void update(double dt, uint8_t pressed) {
+        pending |= pressed;
+        receive();
+        if (!started) { if (local == 1) sendHello(); return; }
+        if (rollbackFrom < sim.tick) rollback();
+        rollbackFrom = UINT32_MAX;
+        // the packets we see are a trip old on both sides, so the difference of the two
+        // advantages is twice how far this side is really ahead
+        double ahead = ((int32_t)(sim.tick - remoteTick) - remoteAdvantage) / 2.0;
+        clock += ahead > 1.0 ? dt * 0.9 : dt;
+        const double tickSeconds = 1.0 / NET_TICK_HZ;
+        if (clock > 4 * tickSeconds) clock = 4 * tickSeconds; // after a hitch, catch up a little at a time
+        while (clock >= tickSeconds) {
+            if (sim.tick >= remoteKnown + NET_MAX_ROLLBACK) { ++st.stalls; clock = 0.0; break; }
+            clock -= tickSeconds;
+            localInputs[(sim.tick + NET_INPUT_DELAY) % NET_RING] = pending;
+            pending = 0;
+            advance();
+        }
+        // the state at the start of a checksum tick is final once every input before it is known
+        for (uint32_t t = lastChecksum + NET_CHECKSUM_INTERVAL; t <= remoteKnown && t < sim.tick; t += NET_CHECKSUM_INTERVAL) {
+            lastChecksum = t;
+            checksumTicks[(t / NET_CHECKSUM_INTERVAL) % NET_CHECKSUMS_KEPT] = t;
+            checksums[(t / NET_CHECKSUM_INTERVAL) % NET_CHECKSUMS_KEPT] = snapshots[t % NET_RING].checksum();
+        }
+        compareChecksum();
+        sendInputs();
+    }
+
+    // For benchmarks: restores the snapshot from ticks ago and re-simulates to the
+    // present, like a rollback would, without touching the stats. Returns seconds.
+    double benchmarkRollback(int ticks) {
+        ticks = std::min<int>(ticks, (int)std::min<uint32_t>(sim.tick, NET_RING - 1));
+        auto t0 = std::chrono::steady_clock::now();
+        resimulate(sim.tick - (uint32_t)ticks);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+private:
+    enum : uint8_t { PKT_HELLO, PKT_WELCOME, PKT_INPUT };
+
+    bool openSocket(uint16_t port) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) { ::close(fd); fd = -1; return false; }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return true;
+    }
+
+    void begin() {
+        sim.reset(seed);
+        for (int i = 0; i < NET_CHECKSUMS_KEPT; ++i) checksumTicks[i] = 0;
+        for (int i = 0; i < NET_RING; ++i) { localInputs[i] = remoteInputs[i] = usedRemote[i] = 0; remoteTicks[i] = UINT32_MAX; }
+        // nobody can press anything for the first NET_INPUT_DELAY ticks
+        for (uint32_t t = 0; t < (uint32_t)NET_INPUT_DELAY; ++t) remoteTicks[t] = t;
+        remoteKnown = NET_INPUT_DELAY;
+        started = true;
+    }
+
+    uint8_t remoteInputFor(uint32_t t) const { return remoteTicks[t % NET_RING] == t ? remoteInputs[t % NET_RING] : 0; }
+
+    void advance() {
+        uint32_t t = sim.tick;
+        snapshots[t % NET_RING] = sim;
+        uint8_t in[2];
+        in[local] = localInputs[t % NET_RING];
+        in[1 - local] = usedRemote[t % NET_RING] = remoteInputFor(t);
+        sim.step(in);
+    }
+
+    void rollback() {
+        auto t0 = std::chrono::steady_clock::now();
+        int depth = (int)(sim.tick - rollbackFrom);
+        resimulate(rollbackFrom);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        ++st.rollbacks;
+        st.resimTicks += depth;
+        st.maxRollback = std::max(st.maxRollback, depth);
+        st.maxResimMs = std::max(st.maxResimMs, ms);
+    }
+
+    void resimulate(uint32_t from) {
+        uint32_t target = sim.tick;
+        sim = snapshots[from % NET_RING];
+        while (sim.tick < target) advance();
+    }
+
+    void receive() {
+        uint8_t buf[512];
+        for (;;) {
+            sockaddr_in from{};
+            socklen_t len = sizeof(from);
+            ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &len);
+            if (n < 5 || getU32(buf) != NET_MAGIC) { if (n < 0) return; continue; }
+            uint8_t type = buf[4];
+            if (type == PKT_HELLO && local == 0) {
+                if (!havePeer) { peer = from; havePeer = true; }
+                if (!started) begin();
+                sendWelcome();
+            } else if (type == PKT_WELCOME && local == 1 && n >= 9) {
+                if (!started) { seed = getU32(buf + 5); begin(); }
+            } else if (type == PKT_INPUT && started && n >= 10 + 20) {
+                readInputs(buf, (size_t)n);
+            }
+        }
+    }
+
+    // PKT_INPUT: u32 first | u8 count | inputs[count] | u32 ack | u32 checksumTick | u32 checksum
+    //            | u32 tick | i32 advantage
+    void readInputs(const uint8_t* p, size_t n) {
+        uint32_t first = getU32(p + 5);
+        uint8_t count = p[9];
+        if (n < 10 + (size_t)count + 20) return;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t t = first + i;
+            if (t < remoteKnown || t >= remoteKnown + NET_RING - NET_MAX_ROLLBACK) continue;
+            if (remoteTicks[t % NET_RING] == t) continue;
+            remoteTicks[t % NET_RING] = t;
+            remoteInputs[t % NET_RING] = p[10 + i];
+            if (t < sim.tick && usedRemote[t % NET_RING] != p[10 + i]) rollbackFrom = std::min(rollbackFrom, t);
+        }
+        while (remoteTicks[remoteKnown % NET_RING] == remoteKnown) ++remoteKnown;
+        const uint8_t* q = p + 10 + count;
+        peerAck = std::max(peerAck, getU32(q));
+        uint32_t ct = getU32(q + 4);
+        if (ct) { remoteChecksumTick = ct; remoteChecksum = getU32(q + 8); }
+        if ((int32_t)(getU32(q + 12) - remoteTick) > 0) { remoteTick = getU32(q + 12); remoteAdvantage = (int32_t)getU32(q + 16); }
+    }
+
+    void compareChecksum() {
+        int i = (int)(remoteChecksumTick / NET_CHECKSUM_INTERVAL) % NET_CHECKSUMS_KEPT;
+        if (!remoteChecksumTick || remoteChecksumTick == comparedTick || checksumTicks[i] != remoteChecksumTick) return;
+        comparedTick = remoteChecksumTick;
+        if (checksums[i] != remoteChecksum) desync = true;
+        else ++st.checksumsMatched;
+    }
+
+    void sendHello() {
+        uint8_t b[5];
+        putHeader(b, PKT_HELLO);
+        sendto(fd, b, sizeof(b), 0, (const sockaddr*)&peer, sizeof(peer));
+    }
+    void sendWelcome() {
+        uint8_t b[9];
+        putHeader(b, PKT_WELCOME);
+        putLE(b + 5, seed);
+        sendto(fd, b, sizeof(b), 0, (const sockaddr*)&peer, sizeof(peer));
+    }
+    void sendInputs() {
+        uint8_t b[10 + NET_RING + 20];
+        putHeader(b, PKT_INPUT);
+        uint32_t first = peerAck, end = sim.tick + NET_INPUT_DELAY;
+        if (end - first > (uint32_t)NET_RING - 1) first = end - (NET_RING - 1);
+        uint8_t count = (uint8_t)(end - first);
+        putLE(b + 5, first);
+        b[9] = count;
+        for (uint32_t i = 0; i < count; ++i) b[10 + i] = localInputs[(first + i) % NET_RING];
+        uint8_t* q = b + 10 + count;
+        putLE(q, remoteKnown); putLE(q + 4, lastChecksum); putLE(q + 8, lastChecksum ? checksums[(lastChecksum / NET_CHECKSUM_INTERVAL) % NET_CHECKSUMS_KEPT] : 0);
+        putLE(q + 12, sim.tick); putLE(q + 16, sim.tick - remoteTick);
+        sendto(fd, b, 10 + count + 20, 0, (const sockaddr*)&peer, sizeof(peer));
+    }
+
+    static void putHeader(uint8_t* b, uint8_t type) { putLE(b, NET_MAGIC); b[4] = type; }
+    static void putLE(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+
+    int fd = -1;
+    sockaddr_in peer{};
+    bool havePeer = false;
+    bool started = false;
+    int local = 0;
+    uint32_t seed = 0;
+    double clock = 0.0;
+    uint8_t pending = 0;
+
+    VersusSim sim;
+    VersusSim snapshots[NET_RING];          // state at the start of tick t, at t % NET_RING
+    uint8_t localInputs[NET_RING] = {};
+    uint8_t remoteInputs[NET_RING] = {};
+    uint32_t remoteTicks[NET_RING] = {};    // which tick remoteInputs[i] belongs to
+    uint8_t usedRemote[NET_RING] = {};      // what the simulation assumed for that tick
+    uint32_t remoteKnown = 0;               // every remote input before this tick has arrived
+    uint32_t peerAck = 0;                   // the peer has every local input before this tick
+    uint32_t rollbackFrom = UINT32_MAX;
+    uint32_t lastChecksum = 0;              // newest confirmed tick we took a checksum of
+    uint32_t checksumTicks[NET_CHECKSUMS_KEPT] = {}, checksums[NET_CHECKSUMS_KEPT] = {};
+    uint32_t remoteTick = 0;                // newest tick the peer reported being at
+    int32_t remoteAdvantage = 0;            // how far ahead of us the peer thought it was
+    uint32_t remoteChecksumTick = 0, remoteChecksum = 0, comparedTick = 0;
+    bool desync = false;
+    RollbackStats st;
+};
@@ -0,0 +1,169 @@
+// scene_cubes.h
+// The scene as lists of cubes, built once per frame in the frame arena: the boards,
+// the replay heatmap and the volumetric well. No GL here; main.cpp draws the lists and
+// tools/alloc_check builds the very same ones to check that a frame does not allocate.
+//
+// buildSceneCubes queues each board and the heatmap from a job of its own (jobs.h).
+// Every list is reserved for its worst case before the jobs start, so they never grow
+// it: the arena is not shared between threads.
+
+#pragma once
+
+#include "analytics.h"
+#include "frame_arena.h"
+#include "jobs.h"
+#include "tetris_core.h"
+#include "well3d.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+struct CubeDraw {
+    glm::mat4 model;
+    glm::vec3 color;
+    float metallic, ao;
+    int useAlbedoMap;
+};
+using CubeList = FrameVector<CubeDraw>;
+
+const float VERSUS_OFFSET_X = BOARD_W + 4.0f;
+// Most cubes queueBoardCubes queues: every cell, the piece and the grid.
+const size_t BOARD_CUBES_MAX = BOARD_W*BOARD_H + 4 + (BOARD_W+1)*(BOARD_H+1);
+
+inline void queueCube(CubeList& cubes, const glm::mat4& model, const glm::vec3& color, float metallic, float ao, bool useAlbedoMap) {
+    cubes.push_back(CubeDraw{model, color, metallic, ao, useAlbedoMap?1:0});
+}
+
+// --------------------------- BOARD ----------------------------
+// Board cells, the falling piece and the grid for one player, shifted right by offsetX.
+inline void queueBoardCubes(CubeList& cubes, const GameState& g, float offsetX, float pieceMetallic) {
+    // board (occupied cells)
+    for (int y=0;y<BOARD_H;++y) for (int x=0;x<BOARD_W;++x) {
+        if (g.board[y][x] != 0) {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(offsetX + (float)x, (float)(BOARD_H - y - 1), 0.0f));
+            model = glm::scale(model, glm::vec3(1.0f,1.0f,0.8f));
+            queueCube(cubes, model, glm::vec3(0.5f,0.5f,0.5f), 0.0f, 1.0f, 0);
+        }
+    }
+
+    // current piece (with albedo map)
+    if (!g.gameOver) {
+        for (const auto &b : g.currentPiece.blocks) {
+            int x = g.currentPos.x + b.x;
+            int y = g.currentPos.y + b.y;
+            if (y >= 0) {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(offsetX + (float)x, (float)(BOARD_H - y - 1), 0.0f));
+                model = glm::scale(model, glm::vec3(1.0f,1.0f,0.8f));
+                queueCube(cubes, model, g.currentPiece.color, pieceMetallic, 1.0f, 1);
+            }
+        }
+    }
+
+    // subtle grid lines
+    for (int x=0;x<=BOARD_W;++x) for (int y=0;y<=BOARD_H;++y) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(offsetX + x-0.5f, BOARD_H - y - 0.5f, -0.1f));
+        model = glm::scale(model, glm::vec3(1.0f,1.0f,0.05f));
+        queueCube(cubes, model, glm::vec3(0.12f,0.12f,0.12f), 0.0f, 1.0f, 0);
+    }
+}
+
+// Occupancy heatmap from tools/replay_stats: a thin tile behind every cell,
+// cold blue to hot orange; hot cells are bright enough to bloom.
+inline void queueHeatmapCubes(CubeList& cubes, const Heatmap& h) {
+    if (!h.samples) return;
+    for (int y=0;y<BOARD_H;++y) for (int x=0;x<BOARD_W;++x) {
+        float v = (float)((double)h.cells[y][x] / (double)h.samples);
+        if (v <= 0.0f) continue;
+        glm::vec3 col = glm::mix(glm::vec3(0.05f,0.1f,0.6f), glm::vec3(4.0f,1.2f,0.2f), v);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)x, (float)(BOARD_H - y - 1), -0.05f));
+        model = glm::scale(model, glm::vec3(0.9f,0.9f,0.02f));
+        queueCube(cubes, model, col, 0.0f, 1.0f, 0);
+    }
+}
+
+// --------------------------- WELL ----------------------------
+// Volumetric well: floor tiles and corner posts, landed cubes shaded by layer (blue at
+// the floor to orange at the top), the falling piece with the material maps and a
+// flat marker where it would land.
+inline void queueWellCubes(CubeList& cubes, const Game3D& g, float pieceMetallic) {
+    const Well3D& w = g.well;
+    for (int z=0;z<w.d;++z) for (int x=0;x<w.w;++x) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)x, -0.55f, (float)z));
+        model = glm::scale(model, glm::vec3(0.95f,0.05f,0.95f));
+        queueCube(cubes, model, glm::vec3(0.12f,0.12f,0.12f), 0.0f, 1.0f, 0);
+    }
+    for (int c=0;c<4;++c) {
+        float px = (c & 1) ? w.w - 0.5f : -0.5f, pz = (c & 2) ? w.d - 0.5f : -0.5f;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(px, w.h * 0.5f - 0.5f, pz));
+        model = glm::scale(model, glm::vec3(0.05f,(float)w.h,0.05f));
+        queueCube(cubes, model, glm::vec3(0.2f,0.2f,0.2f), 0.0f, 1.0f, 0);
+    }
+
+    for (int y=0;y<w.h;++y) {
+        if (!w.layers[y]) continue;
+        glm::vec3 col = glm::mix(glm::vec3(0.1f,0.25f,0.8f), glm::vec3(0.9f,0.45f,0.1f), (float)y / (float)(w.h - 1));
+        for (int z=0;z<w.d;++z) for (int x=0;x<w.w;++x) {
+            if (!wellCell(w, x, y, z)) continue;
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)x, (float)y, (float)z));
+            model = glm::scale(model, glm::vec3(0.95f));
+            queueCube(cubes, model, col, 0.0f, 1.0f, 0);
+        }
+    }
+
+    if (g.gameOver) return;
+    const PolycubeOrient& o = currentOrient(g);
+    int landY = dropHeight(w, o, g.pos);
+    for (const auto& c : o.cubes) {
+        glm::vec3 p((float)(g.pos.x + c.x), (float)(g.pos.y + c.y), (float)(g.pos.z + c.z));
+        queueCube(cubes, glm::translate(glm::mat4(1.0f), p), POLYCUBES[g.piece].color, pieceMetallic, 1.0f, 1);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(p.x, (float)(landY + c.y) - 0.45f, p.z));
+        model = glm::scale(model, glm::vec3(0.9f,0.02f,0.9f));
+        queueCube(cubes, model, POLYCUBES[g.piece].color * 0.3f, 0.0f, 1.0f, 0);
+    }
+}
+
+// Most cubes queueWellCubes queues: floor, posts, every cell, and the piece's four
+// cubes with their markers.
+inline size_t wellCubesMax(const Game3D& g) {
+    return (size_t)(g.well.w * g.well.d) * (1 + g.well.h) + 4 + 2 * 4;
+}
+
+// --------------------------- FRAME ----------------------------
+// What a frame shows. With well set the rest is ignored; heatmap and cpu may be null.
+struct SceneInput {
+    const GameState* player = nullptr;
+    const GameState* cpu = nullptr;
+    const Heatmap* heatmap = nullptr;
+    const Game3D* well = nullptr;
+    float pieceMetallic = 0.0f;
+};
+
+// The frame's cube lists, drawn in this order.
+struct SceneCubes {
+    CubeList board, heatmap, cpu;
+    explicit SceneCubes(FrameArena& arena)
+        : board{FrameAllocator<CubeDraw>(arena)}, heatmap{FrameAllocator<CubeDraw>(arena)}, cpu{FrameAllocator<CubeDraw>(arena)} {}
+};
+
+inline void buildSceneCubes(SceneCubes& out, const SceneInput& in) {
+    if (in.well) {
+        out.board.reserve(wellCubesMax(*in.well));
+        queueWellCubes(out.board, *in.well, in.pieceMetallic);
+        return;
+    }
+    JobSystem& js = jobSystem();
+    Job* prep = js.create([] {});
+    const SceneInput* p = &in;
+    out.board.reserve(BOARD_CUBES_MAX);
+    js.run(js.create([&out, p] { queueBoardCubes(out.board, *p->player, 0.0f, p->pieceMetallic); }, prep));
+    if (in.heatmap) {
+        out.heatmap.reserve(BOARD_W*BOARD_H);
+        js.run(js.create([&out, p] { queueHeatmapCubes(out.heatmap, *p->heatmap); }, prep));
+    }
+    if (in.cpu) {
+        out.cpu.reserve(BOARD_CUBES_MAX);
+        js.run(js.create([&out, p] { queueBoardCubes(out.cpu, *p->cpu, VERSUS_OFFSET_X, p->pieceMetallic); }, prep));
+    }
+    js.run(prep);
+    js.wait(prep);
+}
@@ -0,0 +1,125 @@
+// sha256.h
+// SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104), enough to fingerprint a replay and
+// sign a verdict without pulling in a crypto library.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void reset() {
+        static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(h, init, sizeof(h));
+        total = 0;
+        fill = 0;
+    }
+
+    void update(const void* data, size_t n) {
+        const uint8_t* p = (const uint8_t*)data;
+        total += n;
+        if (fill) {
+            size_t k = std::min(n, (size_t)64 - fill);
+            std::memcpy(block + fill, p, k);
+            fill += k; p += k; n -= k;
+            if (fill < 64) return;
+            compress(block);
+            fill = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) compress(p);
+        std::memcpy(block, p, n);
+        fill = n;
+    }
+
+    Sha256Digest finish() {
+        uint64_t bits = total * 8;
+        uint8_t pad[72] = {0x80};
+        size_t padBytes = (fill < 56 ? 56 : 120) - fill;
+        for (int i = 0; i < 8; ++i) pad[padBytes + i] = (uint8_t)(bits >> (56 - 8 * i));
+        update(pad, padBytes + 8);
+        Sha256Digest d;
+        for (int i = 0; i < 8; ++i) for (int j = 0; j < 4; ++j) d[(size_t)(4 * i + j)] = (uint8_t)(h[i] >> (24 - 8 * j));
+        return d;
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t* p) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+
+    uint32_t h[8];
+    uint8_t block[64];
+    uint64_t total;
+    size_t fill;
+};
+
+inline Sha256Digest sha256(const void* data, size_t n) {
+    Sha256 s;
+    s.update(data, n);
+    return s.finish();
+}
+
+inline Sha256Digest hmacSha256(const std::string& key, const void* data, size_t n) {
+    uint8_t k[64] = {};
+    if (key.size() > 64) { Sha256Digest d = sha256(key.data(), key.size()); std::memcpy(k, d.data(), d.size()); }
+    else std::memcpy(k, key.data(), key.size());
+    uint8_t pad[64];
+    Sha256 inner, outer;
+    for (int i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x36;
+    inner.update(pad, 64);
+    inner.update(data, n);
+    Sha256Digest d = inner.finish();
+    for (int i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x5c;
+    outer.update(pad, 64);
+    outer.update(d.data(), d.size());
+    return outer.finish();
+}
+
+// Compares n bytes in time that does not depend on where they differ, for checking a
+// signature without telling a forger how much of a guess was right.
+inline bool constantTimeEqual(const void* a, const void* b, size_t n) {
+    const volatile uint8_t* x = (const volatile uint8_t*)a;
+    const volatile uint8_t* y = (const volatile uint8_t*)b;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; ++i) diff |= x[i] ^ y[i];
+    return diff == 0;
+}
+
+inline std::string toHex(const uint8_t* p, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    std::string s(2 * n, '0');
+    for (size_t i = 0; i < n; ++i) { s[2 * i] = digits[p[i] >> 4]; s[2 * i + 1] = digits[p[i] & 15]; }
+    return s;
+}
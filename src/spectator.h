@@ -0,0 +1,598 @@
+// spectator.h
+// Spectator streams: the game hands its boards to a SpectatorServer once per frame and
+// one server thread fans them out over UDP to every watcher.
+//
+// Each frame is encoded once, bit-packed, as a delta against the frame before it: the
+// previous piece locking (where it was, or dropped straight down; full rows clear like
+// in the game), garbage pushed in from below (row count and hole), the rows that still
+// differ, and the piece's moves. Every SPECTATE_KEYFRAME_INTERVAL frames a full state
+// is encoded as well. Encoded frames live in a byte ring shared by all clients; a
+// client is sent every frame after the one it last acknowledged (or the newest full
+// state and the frames after it, when it is new or too far behind) with sendmsg
+// gathering straight from the ring, so nothing is encoded per client.
+//
+// Datagram: "TRSP" | u8 type | u32 first frame | u16 frame count | u8 flags | frames,
+// each a u8 length and its bytes. Clients send "TRSP" | u8 type | u32 newest frame.
+
+#pragma once
+
+#include "bitboard.h"
+#include "flight_recorder.h"
+#include "replay.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+const int SPECTATE_MAX_GAMES = 2;
+const int SPECTATE_KEYFRAME_INTERVAL = 120;      // frames between full states
+const int SPECTATE_RING_FRAMES = 1024;           // frames a client may fall behind before it gets a full state again
+const int SPECTATE_MAX_FRAME = 80;               // bytes, length prefix included (two changed boards need ~66)
+const size_t SPECTATE_MAX_DATAGRAM = 1200;
+const size_t SPECTATE_HEADER_BYTES = 12;
+const int SPECTATE_IOV = 4;                      // header, full state, ring bytes (split at most once where the ring wraps)
+const size_t SPECTATE_SEND_BATCH = 256;          // datagrams per sendmmsg
+const size_t SPECTATE_MAX_CLIENTS = 16384;
+const double SPECTATE_CLIENT_TIMEOUT = 5.0;      // seconds without an ack before a client is dropped
+const double SPECTATE_KEEPALIVE = 0.5;
+const uint32_t SPECTATE_MAGIC = 0x50535254;      // "TRSP"
+const uint32_t SPECTATE_NONE = UINT32_MAX;
+const int SPECTATE_X_BIAS = 2, SPECTATE_Y_BIAS = 4;
+
+enum : uint8_t { SPECTATE_HELLO, SPECTATE_FRAMES, SPECTATE_ACK };
+const uint8_t SPECTATE_FLAG_FULL = 1;            // the first frame of the datagram is a full state
+
+// --------------------------- STATE ----------------------------
+// What a spectator sees of one game.
+struct SpectatedGame {
+    BitBoard board;
+    uint8_t piece = 0, rotation = 0, next = 0;
+    int8_t x = 0, y = 0;
+    bool over = false;
+
+    bool operator==(const SpectatedGame& o) const {
+        return std::memcmp(board.rows, o.board.rows, sizeof(board.rows[0]) * BOARD_H) == 0 && piece == o.piece
+            && rotation == o.rotation && next == o.next && x == o.x && y == o.y && over == o.over;
+    }
+};
+
+struct SpectatorFrame {
+    int count = 0;
+    SpectatedGame games[SPECTATE_MAX_GAMES];
+};
+
+// Positions are clamped to what the encoding holds so both ends keep the same state.
+inline SpectatedGame captureGame(const GameState& g) {
+    SpectatedGame s;
+    toBitBoard(g.board, s.board);
+    s.piece = (uint8_t)g.currentPieceIndex;
+    s.rotation = (uint8_t)pieceRotation(g.currentPieceIndex, g.currentPiece.blocks);
+    s.next = (uint8_t)g.nextPieceIndex;
+    s.x = (int8_t)std::clamp(g.currentPos.x, -SPECTATE_X_BIAS, 15 - SPECTATE_X_BIAS);
+    s.y = (int8_t)std::clamp(g.currentPos.y, -SPECTATE_Y_BIAS, 31 - SPECTATE_Y_BIAS);
+    s.over = g.gameOver;
+    return s;
+}
+
+// Enough of a GameState to draw it.
+inline void restoreGame(const SpectatedGame& s, GameState& g) {
+    fromBitBoard(s.board, g.board);
+    g.currentPieceIndex = s.piece;
+    g.currentPiece = PIECES[s.piece];
+    PieceBlocks p = rotatedBlocks(s.piece, s.rotation);
+    g.currentPiece.blocks.assign(p.b, p.b + p.n);
+    g.currentPos = glm::ivec2(s.x, s.y);
+    g.nextPieceIndex = s.next;
+    g.gameOver = s.over;
+}
+
+// --------------------------- BIT PACKING ----------------------------
+struct BitWriter {
+    uint8_t* out;
+    size_t pos = 0;
+    uint64_t acc = 0;
+    int bits = 0;
+    explicit BitWriter(uint8_t* o) : out(o) {}
+    void put(uint32_t v, int n) {
+        acc |= (uint64_t)(v & ((1u << n) - 1)) << bits;
+        for (bits += n; bits >= 8; bits -= 8) { out[pos++] = (uint8_t)acc; acc >>= 8; }
+    }
+    size_t finish() { if (bits) out[pos++] = (uint8_t)acc; acc = 0; bits = 0; return pos; }
+};
+
+struct BitReader {
+    const uint8_t* p;
+    size_t size, pos = 0;
+    uint64_t acc = 0;
+    int bits = 0;
+    bool bad = false;
+    BitReader(const uint8_t* data, size_t n) : p(data), size(n) {}
+    uint32_t get(int n) {
+        while (bits < n) {
+            if (pos >= size) { bad = true; return 0; }
+            acc |= (uint64_t)p[pos++] << bits;
+            bits += 8;
+        }
+        uint32_t v = (uint32_t)(acc & ((1u << n) - 1));
+        acc >>= n; bits -= n;
+        return v;
+    }
+};
+
+// --------------------------- CODEC ----------------------------
+// Board ops a delta can start with: 0 none, 1 lock the previous piece where it was,
+// 2 lock it dropped straight down; then optionally push 1-4 garbage rows in.
+inline bool spectateLock(BitBoard& bb, const SpectatedGame& prev, int lock) {
+    if (prev.over || prev.piece >= PIECE_COUNT) return false;
+    PieceBlocks p = rotatedBlocks(prev.piece, prev.rotation);
+    glm::ivec2 pos(prev.x, prev.y);
+    if (!isValidMove(bb, pos, p)) return false;
+    if (lock == 2) while (isValidMove(bb, pos + glm::ivec2(0, 1), p)) ++pos.y;
+    mergePiece(bb, pos, p);
+    clearLines(bb);
+    return true;
+}
+
+inline void spectateGarbage(BitBoard& bb, int rows, int hole) {
+    for (int y = 0; y + rows < BOARD_H; ++y) bb.rows[y] = bb.rows[y + rows];
+    for (int y = BOARD_H - rows; y < BOARD_H; ++y) bb.rows[y] = (uint16_t)(FULL_ROW & ~(1u << hole));
+}
+
+inline void encodeGame(BitWriter& w, const SpectatedGame* prev, const SpectatedGame& cur) {
+    w.put(prev ? 0 : 1, 1);
+    if (!prev) {
+        for (int y = 0; y < BOARD_H; ++y) w.put(cur.board.rows[y], BOARD_W);
+        w.put(cur.piece, 3); w.put(cur.rotation, 2);
+        w.put((uint32_t)(cur.x + SPECTATE_X_BIAS), 4); w.put((uint32_t)(cur.y + SPECTATE_Y_BIAS), 5);
+        w.put(cur.next, 3); w.put(cur.over, 1);
+        return;
+    }
+    if (*prev == cur) { w.put(0, 1); return; }
+    w.put(1, 1);
+
+    // pick the ops that leave the fewest rows to send
+    uint16_t bottom = cur.board.rows[BOARD_H - 1];
+    int hole = popcount32(bottom) == BOARD_W - 1 ? ctz32(~bottom & FULL_ROW) : -1;
+    int bestLock = 0, bestRows = 0, bestCost = INT_MAX;
+    uint32_t bestMask = 0;
+    for (int lock = 0; lock < 3; ++lock) {
+        BitBoard locked = prev->board;
+        if (lock && !spectateLock(locked, *prev, lock)) continue;
+        for (int rows = 0; rows <= 4; ++rows) {
+            if (rows && hole < 0) break;
+            BitBoard base = locked;
+            if (rows) spectateGarbage(base, rows, hole);
+            uint32_t mask = 0;
+            for (int y = 0; y < BOARD_H; ++y) if (base.rows[y] != cur.board.rows[y]) mask |= 1u << y;
+            int cost = (rows ? 6 : 0) + (mask ? BOARD_H + popcount32(mask) * BOARD_W : 0);
+            if (cost < bestCost) { bestCost = cost; bestLock = lock; bestRows = rows; bestMask = mask; }
+        }
+    }
+    w.put((uint32_t)bestLock, 2);
+    w.put(bestRows ? 1 : 0, 1);
+    if (bestRows) { w.put((uint32_t)bestRows - 1, 2); w.put((uint32_t)hole, 4); }
+    w.put(bestMask ? 1 : 0, 1);
+    if (bestMask) {
+        w.put(bestMask, BOARD_H);
+        for (int y = 0; y < BOARD_H; ++y) if (bestMask >> y & 1) w.put(cur.board.rows[y], BOARD_W);
+    }
+
+    // piece moves: one step sideways or one row down are the common ones
+    w.put(cur.piece != prev->piece, 1);
+    if (cur.piece != prev->piece) w.put(cur.piece, 3);
+    w.put(cur.rotation != prev->rotation, 1);
+    if (cur.rotation != prev->rotation) w.put(cur.rotation, 2);
+    int dx = cur.x - prev->x, dy = cur.y - prev->y;
+    w.put(dx != 0, 1);
+    if (dx == 1 || dx == -1) w.put(dx > 0 ? 1 : 0, 2);
+    else if (dx) { w.put(2, 2); w.put((uint32_t)(cur.x + SPECTATE_X_BIAS), 4); }
+    w.put(dy != 0, 1);
+    if (dy == 1) w.put(1, 1);
+    else if (dy) { w.put(0, 1); w.put((uint32_t)(cur.y + SPECTATE_Y_BIAS), 5); }
+    w.put(cur.next != prev->next, 1);
+    if (cur.next != prev->next) w.put(cur.next, 3);
+    w.put(cur.over != prev->over, 1);
+}
+
+inline void decodeGame(BitReader& r, SpectatedGame& g) {
+    if (r.get(1)) {
+        for (int y = 0; y < BOARD_H; ++y) g.board.rows[y] = (uint16_t)r.get(BOARD_W);
+        g.piece = (uint8_t)r.get(3); g.rotation = (uint8_t)r.get(2);
+        g.x = (int8_t)((int)r.get(4) - SPECTATE_X_BIAS); g.y = (int8_t)((int)r.get(5) - SPECTATE_Y_BIAS);
+        g.next = (uint8_t)r.get(3); g.over = r.get(1) != 0;
+        return;
+    }
+    if (!r.get(1)) return;
+    SpectatedGame prev = g;
+    int lock = (int)r.get(2);
+    if (lock == 3 || (lock && !spectateLock(g.board, prev, lock))) { r.bad = true; return; }
+    if (r.get(1)) { int rows = (int)r.get(2) + 1; int hole = (int)r.get(4); if (hole >= BOARD_W) { r.bad = true; return; } spectateGarbage(g.board, rows, hole); }
+    if (r.get(1)) {
+        uint32_t mask = r.get(BOARD_H);
+        for (int y = 0; y < BOARD_H; ++y) if (mask >> y & 1) g.board.rows[y] = (uint16_t)r.get(BOARD_W);
+    }
+    if (r.get(1)) g.piece = (uint8_t)r.get(3);
+    if (r.get(1)) g.rotation = (uint8_t)r.get(2);
+    if (r.get(1)) {
+        uint32_t step = r.get(2);
+        if (step == 2) g.x = (int8_t)((int)r.get(4) - SPECTATE_X_BIAS);
+        else if (step == 3) { r.bad = true; return; }
+        else g.x = (int8_t)(g.x + (step ? 1 : -1));
+    }
+    if (r.get(1)) g.y = r.get(1) ? (int8_t)(g.y + 1) : (int8_t)((int)r.get(5) - SPECTATE_Y_BIAS);
+    if (r.get(1)) g.next = (uint8_t)r.get(3);
+    if (r.get(1)) g.over = !g.over;
+}
+
+// Writes the u8 length and the frame; prev == nullptr encodes a full state.
+inline size_t encodeFrame(const SpectatorFrame* prev, const SpectatorFrame& cur, uint8_t* out) {
+    BitWriter w(out + 1);
+    w.put((uint32_t)cur.count - 1, 1);
+    for (int i = 0; i < cur.count; ++i) encodeGame(w, prev && i < prev->count ? &prev->games[i] : nullptr, cur.games[i]);
+    size_t n = w.finish();
+    out[0] = (uint8_t)n;
+    return n + 1;
+}
+
+// Applies one frame (without its length byte) to state; leaves state alone if it is malformed.
+inline bool decodeFrame(const uint8_t* p, size_t n, SpectatorFrame& state) {
+    SpectatorFrame next = state;
+    BitReader r(p, n);
+    next.count = (int)r.get(1) + 1;
+    for (int i = 0; i < next.count && !r.bad; ++i) {
+        decodeGame(r, next.games[i]);
+        const SpectatedGame& g = next.games[i];
+        if (g.piece >= PIECE_COUNT || g.next >= PIECE_COUNT) r.bad = true;
+    }
+    if (r.bad) return false;
+    state = next;
+    return true;
+}
+
+// --------------------------- SERVER ----------------------------
+struct SpectatorServerStats {
+    uint64_t frames = 0, encodedBytes = 0, keyframeBytes = 0;
+    uint64_t datagrams = 0, bytesSent = 0, fullStatesSent = 0, clientsDropped = 0;
+    uint64_t pumps = 0;
+    double pumpSeconds = 0.0, maxPumpSeconds = 0.0;
+    size_t peakClients = 0;
+};
+
+class SpectatorServer {
+public:
+    SpectatorServer() : ring((SPECTATE_RING_FRAMES + 1) * SPECTATE_MAX_FRAME) {}
+    ~SpectatorServer() { stop(); }
+    SpectatorServer(const SpectatorServer&) = delete;
+    SpectatorServer& operator=(const SpectatorServer&) = delete;
+
+    // Binds the port and starts the server thread.
+    bool start(uint16_t port) {
+        stop();
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) { ::close(fd); fd = -1; return false; }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int buf = 4 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+        running = true;
+        worker = std::thread([this]{ run(); });
+        return true;
+    }
+
+    void stop() {
+        if (worker.joinable()) {
+            { std::lock_guard<std::mutex> lock(mtx); running = false; }
+            cv.notify_one();
+            worker.join();
+        }
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    uint16_t port() const {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        return fd >= 0 && getsockname(fd, (sockaddr*)&addr, &len) == 0 ? ntohs(addr.sin_port) : 0;
+    }
+
+    // Called by the game once per frame; the server thread encodes and sends it.
+    void submit(const GameState* const* games, int count) {
+        SpectatorFrame f;
+        f.count = std::clamp(count, 1, SPECTATE_MAX_GAMES);
+        for (int i = 0; i < f.count; ++i) f.games[i] = captureGame(*games[i]);
+        { std::lock_guard<std::mutex> lock(mtx); inbox.push_back(f); }
+        cv.notify_one();
+    }
+
+    // Read these after stop().
+    const SpectatorServerStats& stats() const { return st; }
+    const SpectatorFrame& latest() const { return last; }
+    uint32_t frameCount() const { return frames; }
+
+private:
+    struct FrameRef { uint32_t offset = 0; uint16_t size = 0; };
+    struct Client {
+        sockaddr_in addr;
+        uint32_t acked = SPECTATE_NONE;
+        std::chrono::steady_clock::time_point heard;
+    };
+
+    void run() {
+        flightThreadStart();
+        std::vector<SpectatorFrame> batch;
+        std::unique_lock<std::mutex> lock(mtx);
+        while (running) {
+            cv.wait_for(lock, std::chrono::milliseconds(1000 / REPLAY_TICK_HZ), [&]{ return !running || !inbox.empty(); });
+            batch.swap(inbox);
+            lock.unlock();
+            for (const auto& f : batch) publish(f);
+            batch.clear();
+            pump();
+            lock.lock();
+        }
+    }
+
+    void publish(const SpectatorFrame& f) {
+        uint32_t id = frames;
+        if (head + SPECTATE_MAX_FRAME > ring.size()) head = 0;
+        size_t n = encodeFrame(id ? &last : nullptr, f, &ring[head]);
+        refs[id % SPECTATE_RING_FRAMES] = FrameRef{(uint32_t)head, (uint16_t)n};
+        head += n;
+        st.encodedBytes += n;
+        if (id % SPECTATE_KEYFRAME_INTERVAL == 0) {
+            keyframe.resize(SPECTATE_MAX_FRAME);
+            keyframe.resize(encodeFrame(nullptr, f, keyframe.data()));
+            keyframeId = id;
+            st.keyframeBytes += keyframe.size();
+        }
+        last = f;
+        frames = id + 1;
+        ++st.frames;
+    }
+
+    void pump() {
+        auto t0 = std::chrono::steady_clock::now();
+        receive(t0);
+        for (size_t i = 0; i < clients.size();) {
+            if (std::chrono::duration<double>(t0 - clients[i].heard).count() > SPECTATE_CLIENT_TIMEOUT) { removeClient(i); ++st.clientsDropped; }
+            else ++i;
+        }
+        if (frames) {
+            for (const auto& c : clients)
+                if (prepare(c, msgs.size()) && msgs.size() == SPECTATE_SEND_BATCH) flush();
+            flush();
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        ++st.pumps;
+        st.pumpSeconds += s;
+        st.maxPumpSeconds = std::max(st.maxPumpSeconds, s);
+        st.peakClients = std::max(st.peakClients, clients.size());
+    }
+
+    // Lays out the datagram for c in slot m of the send batch. False if c is up to date.
+    bool prepare(const Client& c, size_t m) {
+        uint32_t latestId = frames - 1;
+        if (c.acked == latestId) return false;
+        bool full = c.acked == SPECTATE_NONE || c.acked > latestId || latestId - c.acked > (uint32_t)SPECTATE_RING_FRAMES - 1;
+        uint32_t first = full ? keyframeId : c.acked + 1;
+        Slot& s = slots[m];
+        int iov = 1;
+        size_t bytes = SPECTATE_HEADER_BYTES;
+        uint32_t id = first;
+        if (full) { s.iov[iov++] = iovec{keyframe.data(), keyframe.size()}; bytes += keyframe.size(); ++id; }
+        for (; id <= latestId; ++id) {
+            const FrameRef& r = refs[id % SPECTATE_RING_FRAMES];
+            if (bytes + r.size > SPECTATE_MAX_DATAGRAM) break;
+            uint8_t* p = &ring[r.offset];
+            if (iov > (full ? 2 : 1) && (uint8_t*)s.iov[iov - 1].iov_base + s.iov[iov - 1].iov_len == p) s.iov[iov - 1].iov_len += r.size;
+            else if (iov < SPECTATE_IOV) s.iov[iov++] = iovec{p, r.size};
+            else break;
+            bytes += r.size;
+        }
+        uint16_t count = (uint16_t)(id - first);
+        putLE32(s.header, SPECTATE_MAGIC);
+        s.header[4] = SPECTATE_FRAMES;
+        putLE32(s.header + 5, first);
+        s.header[9] = (uint8_t)count; s.header[10] = (uint8_t)(count >> 8);
+        s.header[11] = full ? SPECTATE_FLAG_FULL : 0;
+        s.iov[0] = iovec{s.header, SPECTATE_HEADER_BYTES};
+        s.addr = c.addr;
+        msghdr h{};
+        h.msg_name = &s.addr;
+        h.msg_namelen = sizeof(s.addr);
+        h.msg_iov = s.iov;
+        h.msg_iovlen = (size_t)iov;
+        msgs.push_back(h);
+        st.bytesSent += bytes;
+        if (full) ++st.fullStatesSent;
+        return true;
+    }
+
+    // Sends the batch: one sendmmsg on Linux, sendmsg per client elsewhere.
+    void flush() {
+        size_t sent = 0;
+#ifdef __linux__
+        std::vector<mmsghdr>& mm = mmsgs;
+        mm.resize(msgs.size());
+        for (size_t i = 0; i < msgs.size(); ++i) { mm[i].msg_hdr = msgs[i]; mm[i].msg_len = 0; }
+        while (sent < mm.size()) {
+            int n = sendmmsg(fd, mm.data() + sent, (unsigned)(mm.size() - sent), 0);
+            if (n <= 0) break; // socket buffer full: the rest retry next pump
+            sent += (size_t)n;
+        }
+#else
+        for (const auto& h : msgs) if (sendmsg(fd, &h, 0) >= 0) ++sent;
+#endif
+        st.datagrams += sent;
+        msgs.clear();
+    }
+
+    void receive(std::chrono::steady_clock::time_point now) {
+        uint8_t buf[64];
+        for (;;) {
+            sockaddr_in from{};
+            socklen_t len = sizeof(from);
+            ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &len);
+            if (n < 0) return;
+            if (n < 5 || getU32(buf) != SPECTATE_MAGIC || (buf[4] != SPECTATE_HELLO && buf[4] != SPECTATE_ACK)) continue;
+            uint64_t key = (uint64_t)from.sin_addr.s_addr << 16 | from.sin_port;
+            auto it = index.find(key);
+            if (it == index.end()) {
+                if (clients.size() >= SPECTATE_MAX_CLIENTS) continue;
+                it = index.emplace(key, clients.size()).first;
+                clients.push_back(Client{from, SPECTATE_NONE, now});
+            }
+            Client& c = clients[it->second];
+            c.heard = now;
+            if (buf[4] == SPECTATE_ACK && n >= 9) {
+                uint32_t ack = getU32(buf + 5);
+                if (ack < frames && (c.acked == SPECTATE_NONE || c.acked >= frames || ack > c.acked)) c.acked = ack;
+            }
+        }
+    }
+
+    void removeClient(size_t i) {
+        auto key = [](const Client& c) { return (uint64_t)c.addr.sin_addr.s_addr << 16 | c.addr.sin_port; };
+        index.erase(key(clients[i]));
+        if (i + 1 != clients.size()) { clients[i] = clients.back(); index[key(clients[i])] = i; }
+        clients.pop_back();
+    }
+
+    static void putLE32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+
+    struct Slot { uint8_t header[SPECTATE_HEADER_BYTES]; iovec iov[SPECTATE_IOV]; sockaddr_in addr; };
+
+    int fd = -1;
+    std::vector<uint8_t> ring;                      // encoded deltas, shared by every client
+    size_t head = 0;
+    FrameRef refs[SPECTATE_RING_FRAMES];
+    uint32_t frames = 0;                            // frames published; ids are 0 .. frames - 1
+    SpectatorFrame last;
+    std::vector<uint8_t> keyframe;                  // full state of frame keyframeId
+    uint32_t keyframeId = 0;
+
+    std::vector<Client> clients;
+    std::unordered_map<uint64_t, size_t> index;
+    Slot slots[SPECTATE_SEND_BATCH];
+    std::vector<msghdr> msgs;
+#ifdef __linux__
+    std::vector<mmsghdr> mmsgs;
+#endif
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<SpectatorFrame> inbox;
+    bool running = false;
+    std::thread worker;
+    SpectatorServerStats st;
+};
+
+// --------------------------- CLIENT ----------------------------
+class SpectatorClient {
+public:
+    ~SpectatorClient() { if (fd >= 0) ::close(fd); }
+
+    bool connect(const std::string& hostName, uint16_t port) {
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if (getaddrinfo(hostName.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) return false;
+        std::memcpy(&server, res->ai_addr, sizeof(server));
+        freeaddrinfo(res);
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return false;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        sendAck(SPECTATE_HELLO);
+        return true;
+    }
+
+    // Applies whatever arrived and acknowledges it. True if the state moved on.
+    bool poll() {
+        uint32_t before = have;
+        uint8_t buf[SPECTATE_MAX_DATAGRAM];
+        for (;;) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n < 0) break;
+            if (simulatedLoss > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng) < simulatedLoss) continue;
+            received += (uint64_t)n;
+            readDatagram(buf, (size_t)n);
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (have != before || std::chrono::duration<double>(now - lastSent).count() > SPECTATE_KEEPALIVE)
+            sendAck(have == SPECTATE_NONE ? SPECTATE_HELLO : SPECTATE_ACK);
+        return have != before;
+    }
+
+    bool hasState() const { return have != SPECTATE_NONE; }
+    uint32_t frame() const { return have; }
+    const SpectatorFrame& state() const { return current; }
+    uint64_t bytesReceived() const { return received; }
+
+    double simulatedLoss = 0.0;   // drop this share of incoming datagrams (for tests)
+
+private:
+    void readDatagram(const uint8_t* p, size_t n) {
+        if (n < SPECTATE_HEADER_BYTES || getU32(p) != SPECTATE_MAGIC || p[4] != SPECTATE_FRAMES) return;
+        uint32_t id = getU32(p + 5);
+        int count = p[9] | p[10] << 8;
+        bool full = p[11] & SPECTATE_FLAG_FULL;
+        size_t pos = SPECTATE_HEADER_BYTES;
+        for (int i = 0; i < count; ++i, ++id) {
+            if (pos >= n || pos + 1 + p[pos] > n) return;
+            const uint8_t* frame = p + pos + 1;
+            size_t len = p[pos];
+            pos += 1 + len;
+            if (i == 0 && full) {
+                if (have != SPECTATE_NONE && id <= have) continue;
+                SpectatorFrame f;
+                if (!decodeFrame(frame, len, f)) return;
+                current = f;
+                have = id;
+            } else if (have != SPECTATE_NONE && id == have + 1) {
+                if (!decodeFrame(frame, len, current)) return;
+                have = id;
+            } else if (have == SPECTATE_NONE || id > have + 1) {
+                return; // a gap: wait for the server to resend from our ack
+            }
+        }
+    }
+
+    void sendAck(uint8_t type) {
+        uint8_t b[9];
+        for (int i = 0; i < 4; ++i) b[i] = (uint8_t)(SPECTATE_MAGIC >> (8 * i));
+        b[4] = type;
+        for (int i = 0; i < 4; ++i) b[5 + i] = (uint8_t)(have >> (8 * i));
+        sendto(fd, b, sizeof(b), 0, (const sockaddr*)&server, sizeof(server));
+        lastSent = std::chrono::steady_clock::now();
+    }
+
+    int fd = -1;
+    sockaddr_in server{};
+    uint32_t have = SPECTATE_NONE;
+    SpectatorFrame current;
+    uint64_t received = 0;
+    std::chrono::steady_clock::time_point lastSent;
+    std::mt19937 rng{std::random_device{}()};
+};
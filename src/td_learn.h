@@ -0,0 +1,183 @@
+// td_learn.h
+// Self-play training of the evaluation by temporal-difference learning. The value of
+// a board after a placement ("afterstate") is linear in the network inputs (nn_eval.h)
+// plus a bias; the bot picks the placement with the best lines + value, and TD(0)
+// moves the value of each afterstate toward the next reward + gamma * value of the
+// next afterstate, or toward zero when the game is lost. The reward is the lines
+// cleared plus a little for every piece placed: starting from zero weights, lines are
+// too rare to learn from, and surviving longer is what clears them later.
+//
+// Every learner, a background job on the shared job system (jobs.h), plays its own
+// games against one shared weight vector, Hogwild style: no locks, relaxed atomic
+// loads and stores, lost updates accepted. The updates are dense (every feature of
+// every board), so a learner keeps a private copy and adds its summed steps to the
+// shared vector every syncEvery pieces rather than touching the shared cache lines on
+// every piece; that is what lets it scale with cores.
+//
+// The result is exported as a network that passes the inputs through and holds the
+// weights in its output layer, so the game and the bot tools load it with --net.
+
+#pragma once
+
+#include "bot_eval.h"
+#include "jobs.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+const int TD_FEATURES = NN_USED_INPUTS + 1;     // the last one is the bias
+const float TD_INPUT_SCALE = 1.0f / 32.0f;      // network inputs 0..127 -> 0..4
+
+struct TdConfig {
+    float alpha = 0.05f;         // step size, divided by the squared length of the features
+    float gamma = 0.995f;
+    float epsilon = 0.0f;        // chance of a random placement instead of the best one
+    float survival = 1.0f;       // reward per piece placed, on top of one per line
+    int maxPieces = 10000;       // a game this long ends without a terminal update
+    int syncEvery = 64;          // pieces between pushes to the shared weights
+};
+
+struct TdStats {
+    long long games = 0, pieces = 0, lines = 0;
+    double seconds = 0.0;
+};
+
+inline void tdFeatures(const BitBoard& board, int lines, float* phi) {
+    BoardFeatures f;
+    uint8_t x[NN_INPUTS];
+    extractFeatures(board, f);
+    nnInputs(f, lines, x);
+    for (int i = 0; i < NN_USED_INPUTS; ++i) phi[i] = x[i] * TD_INPUT_SCALE;
+    phi[NN_USED_INPUTS] = 1.0f;
+}
+
+inline float tdValue(const float* w, const float* phi) {
+    float v = 0.0f;
+    for (int i = 0; i < TD_FEATURES; ++i) v += w[i] * phi[i];
+    return v;
+}
+
+// The greedy policy (lines + value) as a network. Only the ordering of placements
+// matters to the bot, so the weights are scaled to use the whole int8 range.
+inline NnEval tdNetwork(const float* w) {
+    float c[NN_USED_INPUTS], top = 1e-9f;
+    for (int i = 0; i < NN_USED_INPUTS; ++i) c[i] = w[i];
+    c[18] += 1.0f / TD_INPUT_SCALE;              // the immediate reward: one per line cleared
+    for (float v : c) top = std::max(top, std::fabs(v));
+    NnEval net;
+    for (int j = 0; j < NN_USED_INPUTS; ++j) {
+        net.w1[j][j] = (int8_t)(1 << net.shift1);
+        net.w2[j][j] = (int8_t)(1 << net.shift2);
+        net.w3[j] = (int8_t)std::lround(c[j] / top * 127.0f);
+    }
+    return net;
+}
+
+// --------------------------- TRAINER ----------------------------
+// Trains with threads learners for the given time, at most one per job worker (0 for
+// all of them). Every checkpointSeconds (and at the end) checkpoint is called on the
+// calling thread with a snapshot of the weights and the totals so far; the learners
+// keep playing meanwhile.
+inline TdStats trainTd(const TdConfig& cfg, std::vector<float>& weights, int threads, double seconds, double checkpointSeconds,
+                       uint64_t seed, const std::function<void(const std::vector<float>&, const TdStats&)>& checkpoint) {
+    JobSystem& js = jobSystem();
+    threads = threads > 0 ? std::min(threads, js.workerCount()) : js.workerCount();
+    weights.resize(TD_FEATURES, 0.0f);
+    struct alignas(64) Shared { std::atomic<float> w[TD_FEATURES]; } shared;
+    for (int i = 0; i < TD_FEATURES; ++i) shared.w[i].store(weights[(size_t)i], std::memory_order_relaxed);
+    struct alignas(64) Counters { std::atomic<long long> games{0}, pieces{0}, lines{0}; };
+    std::vector<Counters> counters((size_t)threads);
+    std::atomic<bool> stop{false};
+
+    auto work = [&](int index) {
+        PieceRng rng;
+        rng.seed(seed, (uint64_t)index + 1);
+        float w[TD_FEATURES], step[TD_FEATURES] = {}, prev[TD_FEATURES], phi[TD_FEATURES], best[TD_FEATURES];
+        auto sync = [&] {
+            for (int i = 0; i < TD_FEATURES; ++i) {
+                float v = shared.w[i].load(std::memory_order_relaxed) + step[i];
+                shared.w[i].store(v, std::memory_order_relaxed);
+                w[i] = v;
+                step[i] = 0.0f;
+            }
+        };
+        sync();
+        auto learn = [&](float target) {
+            float norm = 1e-6f;
+            for (float v : prev) norm += v * v;
+            float delta = cfg.alpha / norm * (target - tdValue(w, prev));
+            for (int i = 0; i < TD_FEATURES; ++i) step[i] += delta * prev[i];
+        };
+        Counters& c = counters[(size_t)index];
+        GameState g;
+        int sinceSync = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            resetGame(g, rng());
+            bool havePrev = false;
+            long long lines = 0;
+            int n = 0;
+            for (; n < cfg.maxPieces && !g.gameOver && !stop.load(std::memory_order_relaxed); ++n) {
+                BitBoard bb;
+                toBitBoard(g.board, bb);
+                Placement pick{0, g.currentPos.x};
+                float pickValue = -1e30f;
+                int options = 0;
+                bool explore = cfg.epsilon > 0.0f && rng() < cfg.epsilon * 4294967296.0f;
+                forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int cleared) {
+                    tdFeatures(after, cleared, phi);
+                    float v = (float)cleared + tdValue(w, phi);
+                    bool take = explore ? rng() % (unsigned)++options == 0 : v > pickValue;
+                    if (take) { pickValue = v; pick = p; std::copy(phi, phi + TD_FEATURES, best); }
+                });
+                if (pickValue == -1e30f) break;   // nowhere to go: lost
+                int cleared = applyPlacement(g, pick);
+                if (havePrev) learn(cfg.survival + cleared + cfg.gamma * tdValue(w, best));
+                std::copy(best, best + TD_FEATURES, prev);
+                havePrev = true;
+                lines += cleared;
+                if (++sinceSync == cfg.syncEvery) { sync(); sinceSync = 0; }
+            }
+            if (havePrev && n < cfg.maxPieces && !stop.load(std::memory_order_relaxed)) learn(0.0f);
+            c.games.fetch_add(1, std::memory_order_relaxed);
+            c.pieces.fetch_add(n, std::memory_order_relaxed);
+            c.lines.fetch_add(lines, std::memory_order_relaxed);
+        }
+        sync();
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto totals = [&] {
+        TdStats st;
+        for (const Counters& c : counters) {
+            st.games += c.games.load(std::memory_order_relaxed);
+            st.pieces += c.pieces.load(std::memory_order_relaxed);
+            st.lines += c.lines.load(std::memory_order_relaxed);
+        }
+        st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return st;
+    };
+    auto snapshot = [&] {
+        for (int i = 0; i < TD_FEATURES; ++i) weights[(size_t)i] = shared.w[i].load(std::memory_order_relaxed);
+    };
+    // learners run until stop, so they go to the background queue; the calling thread
+    // only sleeps between checkpoints
+    Job* learners = js.create([] {});
+    for (int i = 0; i < threads; ++i) js.runBackground(js.create([&work, i] { work(i); }, learners));
+    js.run(learners);
+    for (double next = checkpointSeconds;; next += checkpointSeconds) {
+        double until = std::min(next, seconds);
+        std::this_thread::sleep_for(std::chrono::duration<double>(until - totals().seconds));
+        if (until >= seconds) break;
+        snapshot();
+        checkpoint(weights, totals());
+    }
+    stop = true;
+    js.wait(learners);
+    snapshot();
+    TdStats st = totals();
+    checkpoint(weights, st);
+    return st;
+}
@@ -0,0 +1,386 @@
+// tetris_core.h
+// Headless Tetris rules: board, pieces, movement, line clears.
+// No GL/GLFW here, so the same rules run on the render thread, in bots and in tools.
+// Зависимости: glm (header-only).
+
+#pragma once
+
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+// --------------------------- TETRIS LOGIC ----------------------------
+const int BOARD_W = 10;
+const int BOARD_H = 20;
+const int PIECE_COUNT = 7;
+const int PIECE_BLOCKS = 4;     // cells per piece
+
+typedef int Board[BOARD_H][BOARD_W];
+
+struct PieceDef {
+    std::vector<glm::ivec2> blocks;
+    glm::vec3 color;
+};
+
+inline std::vector<PieceDef> PIECES;
+
+// The rules advance in whole ticks; frame time only decides how many ticks to run.
+// Gravity counts ticks instead of accumulating float seconds, so every compiler,
+// flag set and CPU steps a game through exactly the same states.
+const int SIM_TICK_HZ = 60;
+const uint16_t GRAVITY_TICKS_DEFAULT = SIM_TICK_HZ; // one row per second
+
+// Portable PCG32. std::uniform_int_distribution differs between standard libraries,
+// so the piece sequence comes from here to stay identical everywhere (replays re-simulate from the seed).
+struct PieceRng {
+    uint64_t state = 0x853c49e6748fea9bULL;
+    uint64_t inc = 0xda3e39cb94b95bdbULL;
+    void seed(uint64_t s, uint64_t stream = 0) {
+        state = 0; inc = (stream << 1) | 1u;
+        (*this)(); state += s; (*this)();
+    }
+    uint32_t operator()() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = (uint32_t)(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+};
+
+inline int randomPiece(PieceRng& rng) { return (int)(((uint64_t)rng() * PIECE_COUNT) >> 32); }
+
+// One player's game. Versus mode runs two of these side by side.
+struct GameState {
+    Board board;
+    PieceDef currentPiece;
+    int currentPieceIndex = 0;
+    glm::ivec2 currentPos;
+    uint16_t gravityTicks = GRAVITY_TICKS_DEFAULT;  // ticks per gravity step
+    uint16_t gravityTimer = 0;                      // ticks since the last one
+    bool gameOver = false;
+    bool cascade = false;     // cascade gravity after clears (see CASCADE); kept across resetGame
+    int nextPieceIndex = 0;
+    unsigned pieceSerial = 0; // bumped on every spawn, lets observers notice a new piece
+    PieceRng rng;
+};
+
+// Seeds, garbage holes and other choices that are not part of the replayed rules.
+inline std::mt19937 gen((unsigned)std::chrono::system_clock::now().time_since_epoch().count());
+
+inline void initPieces(){
+    PIECES = {
+        {{{ -1,0 }, {0,0}, {1,0}, {2,0} }, {0.0f,0.8f,1.0f}}, // I
+        {{{0,0},{1,0},{0,1},{1,1} }, {1.0f,0.9f,0.0f}},       // O
+        {{{ -1,0 }, {0,0}, {1,0}, {0,1} }, {0.8f,0.0f,0.8f}}, // T
+        {{{ -1,0 }, {0,0}, {0,1}, {1,1} }, {0.0f,0.9f,0.0f}}, // S
+        {{{ 1,0 }, {0,0}, {0,1}, {-1,1} }, {0.9f,0.0f,0.0f}}, // Z
+        {{{ -1,0 }, {0,0}, {1,0}, {1,1} }, {0.0f,0.0f,0.9f}}, // J
+        {{{ -1,0 }, {0,0}, {1,0}, {-1,1} }, {1.0f,0.5f,0.0f}}  // L
+    };
+}
+
+inline glm::ivec2 spawnPosition() { return glm::ivec2(BOARD_W / 2 - 1, 0); }
+
+inline bool isValidMove(const Board& board, const glm::ivec2& newPos, const glm::ivec2* blocks, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        int x = newPos.x + blocks[i].x;
+        int y = newPos.y + blocks[i].y;
+        if (x < 0 || x >= BOARD_W || y >= BOARD_H) return false;
+        if (y >= 0 && board[y][x] != 0) return false;
+    }
+    return true;
+}
+
+inline bool isValidMove(const Board& board, const glm::ivec2& newPos, const std::vector<glm::ivec2>& blocks) {
+    return isValidMove(board, newPos, blocks.data(), blocks.size());
+}
+
+inline bool isOPiece(const std::vector<glm::ivec2>& blocks) {
+    for (const auto& block : blocks) {
+        if (!(block.x >= 0 && block.x <= 1 && block.y >= 0 && block.y <= 1)) return false;
+    }
+    return true;
+}
+
+// Rotates clockwise with the simple kick table. Returns false (and leaves blocks/pos untouched) if no kick fits.
+// Works on a copy on the stack: rotating is on the input and bot paths and must not allocate.
+inline bool tryRotate(const Board& board, std::vector<glm::ivec2>& blocks, glm::ivec2& pos) {
+    if (isOPiece(blocks)) return true;
+    glm::ivec2 rotated[PIECE_BLOCKS];
+    size_t n = std::min(blocks.size(), (size_t)PIECE_BLOCKS);
+    for (size_t i = 0; i < n; ++i) { rotated[i].x = blocks[i].y; rotated[i].y = -blocks[i].x; }
+    static const glm::ivec2 kicks[] = {{0,0},{1,0},{-1,0},{0,1},{0,-1},{1,1},{-1,1},{1,-1},{-1,-1}};
+    for (auto &k : kicks) {
+        glm::ivec2 p = pos + k;
+        if (isValidMove(board, p, rotated, n)) { std::copy(rotated, rotated + n, blocks.begin()); pos = p; return true; }
+    }
+    return false;
+}
+
+inline void mergePiece(Board& board, const glm::ivec2& pos, const std::vector<glm::ivec2>& blocks) {
+    for (const auto& b : blocks) {
+        int x = pos.x + b.x;
+        int y = pos.y + b.y;
+        if (y >= 0) board[y][x] = 1;
+    }
+}
+
+// Returns the number of lines removed.
+inline int clearLines(Board& board) {
+    int cleared = 0;
+    for (int y = BOARD_H - 1; y >= 0; --y) {
+        bool full = true;
+        for (int x = 0; x < BOARD_W; ++x) if (!board[y][x]) { full = false; break; }
+        if (full) {
+            for (int yy = y; yy > 0; --yy) for (int x = 0; x < BOARD_W; ++x) board[yy][x] = board[yy-1][x];
+            for (int x = 0; x < BOARD_W; ++x) board[0][x] = 0;
+            ++y;
+            ++cleared;
+        }
+    }
+    return cleared;
+}
+
+// --------------------------- CASCADE ----------------------------
+// Cascade ("sticky") gravity: after a clear, every group of edge-connected blocks falls
+// on its own until it lands, and rows it completes clear in turn (a chain). Works on
+// row masks (bit x = column x, row 0 on top) of any width up to the bits in Row, so
+// the same code runs on Board, on BitBoard and on 40+ wide test boards.
+const int CASCADE_MAX_ROWS = 64;
+
+// Cells of mask connected to seed within one row: Kogge-Stone occluded fill both ways,
+// log2(width) steps instead of one step per column.
+template<class Row>
+inline Row fillRow(Row seed, Row mask) {
+    Row up = seed & mask, down = up, pu = mask, pd = mask;
+    for (int s = 1; s < (int)(8 * sizeof(Row)); s <<= 1) {
+        up |= pu & (Row)(up << s); pu &= (Row)(pu << s);
+        down |= pd & (Row)(down >> s); pd &= (Row)(pd >> s);
+    }
+    return up | down;
+}
+
+// Grows comp (a seed in row lo == hi) to its whole connected group, a row at a time,
+// sweeping down and up over the rows it spans (plus one) until nothing changes.
+// lo/hi return the group's first and last row.
+template<class Row>
+inline void floodRows(const Row* rows, Row* comp, int h, int& lo, int& hi) {
+    for (bool changed = true; changed;) {
+        changed = false;
+        int a = lo > 0 ? lo - 1 : 0, b = hi + 1 < h ? hi + 1 : h - 1;
+        for (int pass = 0; pass < 2; ++pass)
+            for (int i = a; i <= b; ++i) {
+                int y = pass ? a + b - i : i;
+                Row touch = comp[y] | (y > 0 ? comp[y - 1] : 0) | (y + 1 < h ? comp[y + 1] : 0);
+                if (!touch) continue;
+                Row r = fillRow<Row>(touch & rows[y], rows[y]);
+                if (r == comp[y]) continue;
+                comp[y] = r;
+                changed = true;
+                if (y < lo) lo = y;
+                if (y > hi) hi = y;
+            }
+    }
+}
+
+// One pass over the floating groups, lowest first: each drops as far as it falls onto
+// what is below it now. Everything connected to the floor is found by a single flood
+// up from the bottom row and skipped. True if anything moved.
+template<class Row>
+inline bool settlePass(Row* rows, int h) {
+    Row left[CASCADE_MAX_ROWS], comp[CASCADE_MAX_ROWS];
+    std::memset(left, 0, sizeof(Row) * h);
+    left[h - 1] = rows[h - 1];
+    int lo = h - 1, hi = h - 1;
+    if (left[h - 1]) floodRows(rows, left, h, lo, hi);
+    bool floating = false;
+    for (int y = 0; y < h; ++y) { left[y] = rows[y] & (Row)~left[y]; floating = floating || left[y]; }
+    if (!floating) return false;
+    bool moved = false;
+    for (int bottom = h - 1;;) {
+        while (bottom >= 0 && !left[bottom]) --bottom;
+        if (bottom < 0) return moved;
+        std::memset(comp, 0, sizeof(Row) * h);
+        comp[bottom] = (Row)(left[bottom] & (Row)(0 - left[bottom]));  // lowest bit of the lowest row left
+        // a group can reach down into one that already landed; they fall together
+        int lo = bottom, hi = bottom;
+        floodRows(rows, comp, h, lo, hi);
+        for (int y = lo; y <= hi; ++y) { rows[y] &= (Row)~comp[y]; left[y] &= (Row)~comp[y]; }
+        int d = 0;
+        for (bool fits = true; fits && hi + d + 1 < h;) {
+            for (int y = lo; y <= hi && fits; ++y) fits = !(comp[y] & rows[y + d + 1]);
+            if (fits) ++d;
+        }
+        for (int y = lo; y <= hi; ++y) rows[y + d] |= comp[y];
+        moved = moved || d > 0;
+    }
+}
+
+// Repeats passes until every group rests (a lower group can be held up by a higher one
+// hooked under it). True if anything moved.
+template<class Row>
+inline bool settleRows(Row* rows, int h) {
+    bool moved = false;
+    while (settlePass(rows, h)) moved = true;
+    return moved;
+}
+
+// Clears full rows, then settles and clears again while anything falls. Returns lines
+// cleared in total; chains (if given) receives the number of clearing rounds.
+template<class Row>
+inline int cascadeRows(Row* rows, int h, Row full, int* chains = nullptr) {
+    int total = 0, rounds = 0;
+    for (;;) {
+        int write = h - 1;
+        for (int y = h - 1; y >= 0; --y) if (rows[y] != full) rows[write--] = rows[y];
+        int cleared = write + 1;
+        for (int y = 0; y <= write; ++y) rows[y] = 0;
+        if (!cleared) break;
+        total += cleared;
+        ++rounds;
+        if (!settleRows(rows, h)) break;
+    }
+    if (chains) *chains = rounds;
+    return total;
+}
+
+inline int cascadeClear(Board& board, int* chains = nullptr) {
+    uint16_t rows[BOARD_H];
+    for (int y = 0; y < BOARD_H; ++y) { rows[y] = 0; for (int x = 0; x < BOARD_W; ++x) rows[y] |= (uint16_t)((board[y][x] != 0) << x); }
+    int lines = cascadeRows<uint16_t>(rows, BOARD_H, (uint16_t)((1u << BOARD_W) - 1), chains);
+    for (int y = 0; y < BOARD_H; ++y) for (int x = 0; x < BOARD_W; ++x) board[y][x] = (rows[y] >> x) & 1;
+    return lines;
+}
+
+// --------------------------- GAME STATE ----------------------------
+inline void resetBoard(GameState& g) { std::memset(g.board, 0, sizeof(g.board)); }
+
+inline void spawnNewPiece(GameState& g) {
+    g.currentPieceIndex = g.nextPieceIndex;
+    g.currentPiece = PIECES[g.currentPieceIndex];
+    g.currentPos = spawnPosition();
+    g.nextPieceIndex = randomPiece(g.rng);
+    ++g.pieceSerial;
+    for (const auto& b : g.currentPiece.blocks) {
+        int x = g.currentPos.x + b.x;
+        int y = g.currentPos.y + b.y;
+        if (y >= 0 && g.board[y][x] != 0) {
+            g.gameOver = true;
+            break;
+        }
+    }
+}
+
+inline void resetGame(GameState& g, unsigned seed) {
+    resetBoard(g);
+    g.rng.seed(seed);
+    g.gameOver = false;
+    g.gravityTimer = 0;
+    g.nextPieceIndex = randomPiece(g.rng);
+    spawnNewPiece(g);
+}
+
+inline bool movePiece(GameState& g, int dx, int dy) {
+    glm::ivec2 p = g.currentPos; p.x += dx; p.y += dy;
+    if (!isValidMove(g.board, p, g.currentPiece.blocks)) return false;
+    g.currentPos = p;
+    return true;
+}
+
+inline void rotatePiece(GameState& g) { tryRotate(g.board, g.currentPiece.blocks, g.currentPos); }
+
+// Merge + clear + spawn. Returns lines cleared.
+inline int lockPiece(GameState& g) {
+    mergePiece(g.board, g.currentPos, g.currentPiece.blocks);
+    int lines = g.cascade ? cascadeClear(g.board) : clearLines(g.board);
+    spawnNewPiece(g);
+    return lines;
+}
+
+inline int hardDrop(GameState& g) {
+    while (movePiece(g, 0, 1)) {}
+    return lockPiece(g);
+}
+
+// --------------------------- VERSUS ----------------------------
+// Lines sent to the opponent for a single lock: 2->1, 3->2, 4->4.
+inline int garbageForLines(int lines) { return lines >= 4 ? 4 : (lines > 1 ? lines - 1 : 0); }
+
+// Pushes the stack up and fills the bottom rows with one shared hole column.
+inline void addGarbage(GameState& g, int rows, int holeX) {
+    if (rows <= 0 || g.gameOver) return;
+    for (int y = 0; y < rows && y < BOARD_H; ++y)
+        for (int x = 0; x < BOARD_W; ++x) if (g.board[y][x]) g.gameOver = true;
+    for (int y = 0; y + rows < BOARD_H; ++y) std::memcpy(g.board[y], g.board[y + rows], sizeof(g.board[y]));
+    for (int y = BOARD_H - rows; y < BOARD_H; ++y) {
+        if (y < 0) continue;
+        for (int x = 0; x < BOARD_W; ++x) g.board[y][x] = (x == holeX) ? 0 : 1;
+    }
+    // nudge the falling piece up instead of letting it overlap the new rows
+    for (int i = 0; i < rows && !isValidMove(g.board, g.currentPos, g.currentPiece.blocks); ++i) g.currentPos.y -= 1;
+}
+
+// --------------------------- ACTIONS ----------------------------
+// Everything that changes the simulation. Replays are a seed plus a list of these.
+enum GameAction : uint8_t {
+    ACT_LEFT, ACT_RIGHT, ACT_SOFT_DROP, ACT_ROTATE, ACT_HARD_DROP,
+    ACT_GRAVITY,   // one gravity step: move down or lock
+    ACT_GARBAGE,   // param = rows << 4 | hole column
+    ACT_COUNT
+};
+
+inline int garbageParam(int rows, int holeX) { return (rows << 4) | holeX; }
+
+// Returns lines cleared if the action locked the piece, 0 otherwise.
+inline int applyAction(GameState& g, GameAction a, int param = 0) {
+    if (g.gameOver) return 0;
+    switch (a) {
+    case ACT_LEFT: movePiece(g, -1, 0); return 0;
+    case ACT_RIGHT: movePiece(g, 1, 0); return 0;
+    case ACT_SOFT_DROP: movePiece(g, 0, 1); return 0;
+    case ACT_ROTATE: rotatePiece(g); return 0;
+    case ACT_HARD_DROP: return hardDrop(g);
+    case ACT_GRAVITY: return movePiece(g, 0, 1) ? 0 : lockPiece(g);
+    case ACT_GARBAGE: addGarbage(g, param >> 4, param & 15); return 0;
+    default: return 0;
+    }
+}
+
+// True if applying a to g would lock the current piece.
+inline bool actionLocksPiece(const GameState& g, GameAction a) {
+    if (g.gameOver) return false;
+    return a == ACT_HARD_DROP || (a == ACT_GRAVITY && !isValidMove(g.board, g.currentPos + glm::ivec2(0, 1), g.currentPiece.blocks));
+}
+
+// Advances the gravity timer by one tick; true when a gravity step is due.
+inline bool tickGravity(GameState& g) {
+    if (g.gameOver) return false;
+    if (++g.gravityTimer < g.gravityTicks) return false;
+    g.gravityTimer = 0;
+    return true;
+}
+
+// Runs one tick. Returns lines cleared if gravity locked the piece, 0 otherwise.
+inline int updateGame(GameState& g) {
+    return tickGravity(g) ? applyAction(g, ACT_GRAVITY) : 0;
+}
+
+// FNV-1a over everything that decides how the game continues (not colors).
+inline uint32_t hashGame(const GameState& g, uint32_t h = 2166136261u) {
+    auto mix = [&](uint32_t v) { h = (h ^ v) * 16777619u; };
+    for (int y = 0; y < BOARD_H; ++y) { uint32_t row = 0; for (int x = 0; x < BOARD_W; ++x) row |= (uint32_t)(g.board[y][x] != 0) << x; mix(row); }
+    mix((uint32_t)g.currentPieceIndex); mix((uint32_t)g.nextPieceIndex);
+    mix((uint32_t)g.currentPos.x); mix((uint32_t)g.currentPos.y);
+    for (const auto& b : g.currentPiece.blocks) { mix((uint32_t)b.x); mix((uint32_t)b.y); }
+    mix(g.gravityTicks); mix(g.gravityTimer);
+    mix((uint32_t)g.rng.state); mix((uint32_t)(g.rng.state >> 32)); mix(g.gameOver); mix(g.cascade);
+    return h;
+}
+
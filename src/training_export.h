@@ -0,0 +1,292 @@
+// training_export.h
+// Training data export: one (state, action, reward, outcome) row per placed piece,
+// streamed to one file per column, so a loader maps only the columns it trains on.
+//
+// Rows are staged per game (the outcome is only known at the end), then appended to
+// one of two column blocks. A full block goes to a background thread, which encodes
+// and writes it while the simulation fills the other one; the simulation only waits
+// if the writer is a whole block behind.
+//
+// Column file <dir>/<name>.tcol:
+//   "TCOL" | u16 version | u16 width (bytes per row) | u32 reserved | u32 reserved
+//   chunks: u32 rows | u32 storedBytes | u32 rawBytes | u8 codec | 3 pad | payload, padded to 8
+// codec 0 is the raw rows (a mapped chunk is a plain array), codec 1 range codes each
+// byte XOR the same byte of the previous row, with one model per byte position. Chunks
+// decode on their own.
+
+#pragma once
+
+#include "replay.h"
+#include "range_coder.h"
+#include "bitboard.h"
+#include "flight_recorder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+const uint16_t TCOL_VERSION = 1;
+const size_t TCOL_HEADER_SIZE = 16;
+const size_t TCOL_CHUNK_HEADER_SIZE = 16;
+const int TCOL_RAW = 0;
+const int TCOL_RANGE = 1;
+
+struct TrainingColumn {
+    const char* name;
+    int width;
+};
+
+// Boards are the locked cells before the piece, one u16 per row (top row first, bit x = column x).
+// The action is the pose the piece locked in: rotations from spawn, origin x and y.
+const TrainingColumn TRAINING_COLUMNS[] = {
+    {"board", 2 * BOARD_H},
+    {"piece", 1},
+    {"next", 1},
+    {"rotation", 1},
+    {"x", 1},          // int8
+    {"y", 1},          // int8
+    {"reward", 1},     // lines cleared by this piece
+    {"outcome", 4},    // u32 lines cleared from this piece to the end of the game
+    {"terminal", 1},   // 1 on the last piece of a game that topped out
+    {"episode", 4},    // u32 game number within the file
+};
+const int TRAINING_COLUMN_COUNT = sizeof(TRAINING_COLUMNS) / sizeof(TRAINING_COLUMNS[0]);
+
+struct TrainingSample {
+    uint16_t board[BOARD_H];
+    uint8_t piece, next, rotation;
+    int8_t x, y;
+    uint8_t reward;
+};
+
+// --------------------------- COLUMN CODEC ----------------------------
+inline void encodeColumnChunk(const uint8_t* rows, size_t count, int width, std::vector<uint8_t>& out) {
+    std::vector<BitTree<8>> models(width);
+    RangeEncoder rc(&out);
+    const uint8_t* prev = nullptr;
+    for (size_t r = 0; r < count; ++r, prev = rows, rows += width)
+        for (int i = 0; i < width; ++i) rc.encodeTree(models[i], rows[i] ^ (prev ? prev[i] : 0));
+    rc.flush();
+}
+
+inline bool decodeColumnChunk(const uint8_t* data, size_t bytes, size_t count, int width, uint8_t* rows) {
+    std::vector<BitTree<8>> models(width);
+    RangeDecoder rc;
+    rc.init(data, data + bytes);
+    const uint8_t* prev = nullptr;
+    for (size_t r = 0; r < count; ++r, prev = rows, rows += width)
+        for (int i = 0; i < width; ++i) rows[i] = (uint8_t)(rc.decodeTree(models[i]) ^ (prev ? prev[i] : 0));
+    return !rc.overrun();
+}
+
+// Reads a whole column file (any codecs) into rows; width receives the row size.
+inline bool readColumnFile(const std::string& path, std::vector<uint8_t>& rows, int& width) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::vector<uint8_t> file;
+    uint8_t buf[1 << 16];
+    for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;) file.insert(file.end(), buf, buf + n);
+    std::fclose(f);
+    if (file.size() < TCOL_HEADER_SIZE || std::memcmp(file.data(), "TCOL", 4) != 0 || getU16(file.data() + 4) != TCOL_VERSION) return false;
+    width = getU16(file.data() + 6);
+    rows.clear();
+    size_t off = TCOL_HEADER_SIZE;
+    while (off + TCOL_CHUNK_HEADER_SIZE <= file.size()) {
+        const uint8_t* h = file.data() + off;
+        uint32_t count = getU32(h), stored = getU32(h + 4), raw = getU32(h + 8);
+        int codec = h[12];
+        off += TCOL_CHUNK_HEADER_SIZE;
+        if (raw != (uint64_t)count * width || off + stored > file.size()) return false;
+        size_t at = rows.size();
+        rows.resize(at + raw);
+        if (codec == TCOL_RAW && stored == raw) std::memcpy(rows.data() + at, file.data() + off, raw);
+        else if (codec != TCOL_RANGE || !decodeColumnChunk(file.data() + off, stored, count, width, rows.data() + at)) return false;
+        off += (stored + 7) & ~(size_t)7;
+    }
+    return off == file.size();
+}
+
+// --------------------------- EXPORTER ----------------------------
+class TrainingExporter {
+public:
+    TrainingExporter() = default;
+    ~TrainingExporter() { close(); }
+    TrainingExporter(const TrainingExporter&) = delete;
+    TrainingExporter& operator=(const TrainingExporter&) = delete;
+
+    // Creates dir and one file per column (existing ones are overwritten).
+    bool open(const std::string& dir, bool compress, size_t blockRows = 1 << 16) {
+        close();
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        codec = compress ? TCOL_RANGE : TCOL_RAW;
+        rowsPerBlock = std::max<size_t>(1, blockRows);
+        for (int c = 0; c < TRAINING_COLUMN_COUNT; ++c) {
+            files[c] = std::fopen((dir + "/" + TRAINING_COLUMNS[c].name + ".tcol").c_str(), "wb");
+            if (!files[c]) { close(); return false; }
+            std::vector<uint8_t> h = {'T', 'C', 'O', 'L'};
+            putU16(h, TCOL_VERSION); putU16(h, (uint16_t)TRAINING_COLUMNS[c].width); putU32(h, 0); putU32(h, 0);
+            std::fwrite(h.data(), 1, h.size(), files[c]);
+            bytesWritten += h.size();
+        }
+        for (auto& b : blocks) for (int c = 0; c < TRAINING_COLUMN_COUNT; ++c) b.cols[c].reserve(rowsPerBlock * TRAINING_COLUMNS[c].width);
+        failed = stopping = false;
+        full = nullptr;
+        writer = std::thread([this]{ writerLoop(); });
+        return true;
+    }
+
+    bool isOpen() const { return writer.joinable(); }
+
+    void add(const TrainingSample& s) { episode.push_back(s); }
+
+    // Closes the current game: fills in outcome and terminal and queues its rows.
+    void endEpisode(bool toppedOut) {
+        if (episode.empty()) return;
+        uint32_t togo = 0;
+        for (const auto& s : episode) togo += s.reward;
+        for (size_t i = 0; i < episode.size(); ++i) {
+            const TrainingSample& s = episode[i];
+            Block& b = blocks[active];
+            auto& c = b.cols;
+            for (int y = 0; y < BOARD_H; ++y) putU16(c[0], s.board[y]);
+            c[1].push_back(s.piece); c[2].push_back(s.next); c[3].push_back(s.rotation);
+            c[4].push_back((uint8_t)s.x); c[5].push_back((uint8_t)s.y); c[6].push_back(s.reward);
+            putU32(c[7], togo);
+            togo -= s.reward;
+            c[8].push_back(toppedOut && i + 1 == episode.size() ? 1 : 0);
+            putU32(c[9], episodeIndex);
+            if (++b.rows >= rowsPerBlock) handOff();
+        }
+        ++episodeIndex;
+        rowsExported += episode.size();
+        episode.clear();
+    }
+
+    // Drops an unfinished game, writes the last partial block and closes the files.
+    // False if any write failed.
+    bool close() {
+        episode.clear();
+        if (writer.joinable()) {
+            if (blocks[active].rows) handOff();
+            { std::lock_guard<std::mutex> lk(mtx); stopping = true; }
+            cv.notify_all();
+            writer.join();
+        }
+        for (auto& f : files) if (f) { if (std::fclose(f) != 0) failed = true; f = nullptr; }
+        return !failed;
+    }
+
+    uint64_t rows() const { return rowsExported; }
+    uint64_t bytes() const { return bytesWritten; }
+    double waitSeconds() const { return producerWait; }  // time the producer spent blocked on the writer
+
+private:
+    struct Block {
+        std::vector<uint8_t> cols[TRAINING_COLUMN_COUNT];
+        size_t rows = 0;
+    };
+
+    void handOff() {
+        std::unique_lock<std::mutex> lk(mtx);
+        if (full) {
+            auto t0 = std::chrono::steady_clock::now();
+            cv.wait(lk, [&]{ return full == nullptr; });
+            producerWait += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+        full = &blocks[active];
+        active ^= 1;
+        cv.notify_all();
+    }
+
+    void writerLoop() {
+        flightThreadStart();
+        std::vector<uint8_t> encoded, header;
+        for (;;) {
+            Block* b;
+            {
+                std::unique_lock<std::mutex> lk(mtx);
+                cv.wait(lk, [&]{ return full || stopping; });
+                if (!full) return;
+                b = full;
+            }
+            for (int c = 0; c < TRAINING_COLUMN_COUNT; ++c) {
+                const std::vector<uint8_t>& raw = b->cols[c];
+                const std::vector<uint8_t>* payload = &raw;
+                int used = codec;
+                if (codec == TCOL_RANGE) {
+                    encoded.clear();
+                    encodeColumnChunk(raw.data(), b->rows, TRAINING_COLUMNS[c].width, encoded);
+                    if (encoded.size() < raw.size()) payload = &encoded;
+                    else used = TCOL_RAW;
+                }
+                header.clear();
+                putU32(header, (uint32_t)b->rows); putU32(header, (uint32_t)payload->size()); putU32(header, (uint32_t)raw.size());
+                header.push_back((uint8_t)used); header.resize(TCOL_CHUNK_HEADER_SIZE, 0);
+                static const uint8_t pad[8] = {};
+                size_t padding = (8 - payload->size() % 8) % 8;
+                bool ok = std::fwrite(header.data(), 1, header.size(), files[c]) == header.size()
+                       && std::fwrite(payload->data(), 1, payload->size(), files[c]) == payload->size()
+                       && std::fwrite(pad, 1, padding, files[c]) == padding;
+                if (!ok) failed = true;
+                bytesWritten += header.size() + payload->size() + padding;
+            }
+            for (auto& col : b->cols) col.clear();
+            b->rows = 0;
+            { std::lock_guard<std::mutex> lk(mtx); full = nullptr; }
+            cv.notify_all();
+        }
+    }
+
+    FILE* files[TRAINING_COLUMN_COUNT] = {};
+    int codec = TCOL_RAW;
+    size_t rowsPerBlock = 1 << 16;
+    std::vector<TrainingSample> episode;
+    uint32_t episodeIndex = 0;
+    Block blocks[2];
+    int active = 0;
+    Block* full = nullptr;      // handed to the writer, guarded by mtx
+    bool stopping = false;
+    std::atomic<bool> failed{false};
+    std::atomic<uint64_t> bytesWritten{0};
+    uint64_t rowsExported = 0;
+    double producerWait = 0.0;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread writer;
+};
+
+// --------------------------- REPLAY OBSERVER ----------------------------
+// Turns a simulated game (replays, self-play, or the live game fed through
+// applyReplayEvent) into exporter rows.
+struct TrainingObserver : ReplayObserver {
+    TrainingExporter& out;
+    TrainingSample pending;
+    explicit TrainingObserver(TrainingExporter& e) : out(e) {}
+
+    void onPlace(const GameState& g, GameAction a) override {
+        TrainingSample& s = pending;
+        for (int y = 0; y < BOARD_H; ++y) {
+            uint16_t row = 0;
+            for (int x = 0; x < BOARD_W; ++x) row |= (uint16_t)((g.board[y][x] != 0) << x);
+            s.board[y] = row;
+        }
+        glm::ivec2 pos = g.currentPos;
+        if (a == ACT_HARD_DROP) while (isValidMove(g.board, pos + glm::ivec2(0, 1), g.currentPiece.blocks)) pos.y += 1;
+        s.piece = (uint8_t)g.currentPieceIndex;
+        s.next = (uint8_t)g.nextPieceIndex;
+        s.rotation = (uint8_t)pieceRotation(g.currentPieceIndex, g.currentPiece.blocks);
+        s.x = (int8_t)pos.x;
+        s.y = (int8_t)pos.y;
+    }
+    void onLock(const GameState&, int, int lines) override {
+        pending.reward = (uint8_t)lines;
+        out.add(pending);
+    }
+    void onEnd(const GameState& g, GameAction) override { out.endEpisode(g.gameOver); }
+};
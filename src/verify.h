@@ -0,0 +1,275 @@
+// verify.h
+// Leaderboard replay verification. A submission is a replay plus the lines and score
+// its player claims; the verifier re-simulates the replay with the headless rules,
+// recounts both and writes a verdict line signed with HMAC-SHA256, so a leaderboard
+// can accept verdicts from any verifier box that holds the key.
+//
+// Submission, little-endian, self-delimiting so a socket stream or a file can carry
+// several back to back:
+//   "TSUB" | u16 version | u16 idBytes | u32 lines | u32 score | u32 replayBytes | id | replay
+// Verdict, one text line, the signature covering everything before " sig=":
+//   <id> <OK|MISMATCH|CORRUPT|RULES|TOO_LARGE> lines=N score=N pieces=N ticks=N
+//        mode=<normal|cascade> replay=<sha256> sig=<hmac-sha256>
+//
+// Each job is bounded: the replay is at most maxBytes and is decoded one event at a
+// time (replay.h), the simulation stops after maxEvents, and each worker thread reuses
+// one GameState. The queue in front of the workers holds a fixed number of jobs;
+// submit() blocks when it is full, which is what pushes back on the spool scanner
+// and the socket readers.
+
+#pragma once
+
+#include "jobs.h"
+#include "replay.h"
+#include "sha256.h"
+
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+const uint16_t SUBMISSION_VERSION = 1;
+const size_t SUBMISSION_HEADER_SIZE = 20;
+const size_t SUBMISSION_MAX_ID = 64;
+
+struct ReplayClaim {
+    uint32_t lines = 0;
+    uint32_t score = 0;
+};
+
+// Points for one lock: 100/300/500/800 for 1-4 lines, 200 more per line beyond
+// (cascade chains).
+inline uint32_t clearScore(int lines) {
+    static const uint32_t table[5] = {0, 100, 300, 500, 800};
+    return lines <= 4 ? table[lines < 0 ? 0 : lines] : 800 + 200 * (uint32_t)(lines - 4);
+}
+
+// --------------------------- SUBMISSIONS ----------------------------
+inline void putSubmission(std::vector<uint8_t>& out, const std::string& id, const ReplayClaim& claim, const uint8_t* replay, size_t bytes) {
+    out.insert(out.end(), {'T','S','U','B'});
+    putU16(out, SUBMISSION_VERSION);
+    putU16(out, (uint16_t)std::min(id.size(), SUBMISSION_MAX_ID));
+    putU32(out, claim.lines);
+    putU32(out, claim.score);
+    putU32(out, (uint32_t)bytes);
+    out.insert(out.end(), id.begin(), id.begin() + (ptrdiff_t)std::min(id.size(), SUBMISSION_MAX_ID));
+    out.insert(out.end(), replay, replay + bytes);
+}
+
+struct SubmissionView {
+    std::string id;
+    ReplayClaim claim;
+    const uint8_t* replay = nullptr;
+    size_t replayBytes = 0;
+    size_t bytes = 0;              // the whole submission
+};
+
+// 1: a whole submission is at p; 0: need more bytes; -1: not a submission, or its
+// replay is over maxReplay (out.replayBytes is still set, to skip or report it).
+inline int parseSubmission(const uint8_t* p, size_t avail, size_t maxReplay, SubmissionView& out) {
+    if (avail < SUBMISSION_HEADER_SIZE) return avail >= 4 && std::memcmp(p, "TSUB", 4) != 0 ? -1 : 0;
+    if (std::memcmp(p, "TSUB", 4) != 0 || getU16(p + 4) != SUBMISSION_VERSION || getU16(p + 6) > SUBMISSION_MAX_ID) return -1;
+    size_t idBytes = getU16(p + 6);
+    out.claim.lines = getU32(p + 8);
+    out.claim.score = getU32(p + 12);
+    out.replayBytes = getU32(p + 16);
+    out.bytes = SUBMISSION_HEADER_SIZE + idBytes + out.replayBytes;
+    if (out.replayBytes > maxReplay) return -1;
+    if (avail < out.bytes) return 0;
+    // ids end up in verdict lines: keep them to one printable word
+    out.id.assign((const char*)p + SUBMISSION_HEADER_SIZE, idBytes);
+    for (char& c : out.id) if (!std::isalnum((unsigned char)c) && c != '-' && c != '_' && c != '.') c = '_';
+    if (out.id.empty()) out.id = "-";
+    out.replay = p + SUBMISSION_HEADER_SIZE + idBytes;
+    return 1;
+}
+
+// --------------------------- VERIFICATION ----------------------------
+enum class Verdict { Ok, Mismatch, Corrupt, Rules, TooLarge };
+
+inline const char* verdictName(Verdict v) {
+    static const char* names[] = {"OK", "MISMATCH", "CORRUPT", "RULES", "TOO_LARGE"};
+    return names[(int)v];
+}
+
+struct VerifyLimits {
+    size_t maxBytes = 1 << 20;           // replay size
+    uint64_t maxEvents = 1 << 22;        // decoded events, gravity included
+    int maxInputsPerTick = 8;            // more than this in one frame is not a person
+};
+
+struct VerifyResult {
+    Verdict verdict = Verdict::Ok;
+    uint32_t lines = 0, score = 0, pieces = 0, ticks = 0;
+    bool cascade = false;
+};
+
+// Re-simulates one replay into g (reused across jobs) and checks it against claim.
+// Leaderboard rules: a current-version record at the game's tick rate, gravity no
+// slower than the default, and no burst of inputs inside one frame.
+inline VerifyResult verifyReplay(const uint8_t* data, size_t bytes, const ReplayClaim& claim, const VerifyLimits& limits, GameState& g) {
+    VerifyResult r;
+    if (bytes > limits.maxBytes) { r.verdict = Verdict::TooLarge; return r; }
+    ReplayView v;
+    if (!parseReplay(data, bytes, v) || v.size() != bytes) { r.verdict = Verdict::Corrupt; return r; }
+    r.cascade = v.cascade;
+    if (v.version != REPLAY_VERSION || v.tickHz != REPLAY_TICK_HZ || v.gravityTicks > GRAVITY_TICKS_DEFAULT) { r.verdict = Verdict::Rules; return r; }
+    g.cascade = v.cascade;
+    resetGame(g, v.seed);
+    ReplayReader reader(v);
+    ReplayEvent e;
+    uint64_t events = 0;
+    uint32_t burstTick = 0;
+    int burst = 0;
+    while (!g.gameOver && reader.next(e)) {
+        if (++events > limits.maxEvents) { r.verdict = Verdict::TooLarge; return r; }
+        if (e.action >= ACT_COUNT) continue;
+        if (e.action != ACT_GRAVITY) {
+            burst = e.tick == burstTick ? burst + 1 : 1;
+            burstTick = e.tick;
+            if (burst > limits.maxInputsPerTick) { r.verdict = Verdict::Rules; return r; }
+        }
+        unsigned serial = g.pieceSerial;
+        int lines = applyReplayEvent(g, e);
+        if (g.pieceSerial != serial) {
+            ++r.pieces;
+            r.lines += (uint32_t)lines;
+            r.score += clearScore(lines);
+        }
+        r.ticks = e.tick;
+    }
+    if (!reader.intact()) r.verdict = Verdict::Corrupt;
+    else if (r.lines != claim.lines || r.score != claim.score) r.verdict = Verdict::Mismatch;
+    return r;
+}
+
+// The signed verdict line, without a newline.
+inline std::string verdictLine(const std::string& key, const std::string& id, const VerifyResult& r, const uint8_t* replay, size_t bytes) {
+    Sha256Digest h = sha256(replay, bytes);
+    std::string line = id + " " + verdictName(r.verdict) + " lines=" + std::to_string(r.lines) + " score=" + std::to_string(r.score) +
+                       " pieces=" + std::to_string(r.pieces) + " ticks=" + std::to_string(r.ticks) +
+                       " mode=" + (r.cascade ? "cascade" : "normal") + " replay=" + toHex(h.data(), h.size());
+    Sha256Digest sig = hmacSha256(key, line.data(), line.size());
+    return line + " sig=" + toHex(sig.data(), sig.size());
+}
+
+// True if line carries a valid signature under key.
+inline bool checkVerdictLine(const std::string& key, const std::string& line) {
+    size_t at = line.rfind(" sig=");
+    if (at == std::string::npos) return false;
+    Sha256Digest sig = hmacSha256(key, line.data(), at);
+    std::string expected = toHex(sig.data(), sig.size());
+    return line.size() - (at + 5) == expected.size() && constantTimeEqual(line.data() + at + 5, expected.data(), expected.size());
+}
+
+// --------------------------- SERVICE ----------------------------
+struct VerifyJob {
+    std::string id;
+    ReplayClaim claim;
+    std::vector<uint8_t> replay;
+    uint64_t tag = 0;              // the caller's, handed back with the verdict (e.g. a connection)
+};
+
+// Bounded queue drained by background jobs on the shared job system (jobs.h), at most
+// threads of them at once (0: one per job worker). A drainer is started when a job is
+// queued and fewer are running, and ends when it finds the queue empty, so an idle
+// service holds no worker. done is called on a worker thread, possibly several at
+// once, with the job, its result and the signed line.
+class VerifyService {
+public:
+    using Done = std::function<void(const VerifyJob&, const VerifyResult&, const std::string&)>;
+
+    VerifyService(const std::string& key, const VerifyLimits& limits, int threads, size_t queueJobs, Done done)
+        : key(key), limits(limits), capacity(std::max<size_t>(1, queueJobs)), done(std::move(done)) {
+        JobSystem& js = jobSystem();
+        workers = (size_t)(threads > 0 ? std::min(threads, js.workerCount()) : js.workerCount());
+        states.resize((size_t)js.threadCount());
+    }
+    ~VerifyService() { close(); }
+
+    // Blocks while the queue is full.
+    void submit(VerifyJob&& job) {
+        std::unique_lock<std::mutex> lk(mtx);
+        notFull.wait(lk, [&] { return queue.size() < capacity; });
+        queue.push_back(std::move(job));
+        ++submitted;
+        startDrainer(lk);
+    }
+
+    // False, without taking the job, if the queue is full.
+    bool trySubmit(VerifyJob& job) {
+        std::unique_lock<std::mutex> lk(mtx);
+        if (queue.size() >= capacity) return false;
+        queue.push_back(std::move(job));
+        ++submitted;
+        startDrainer(lk);
+        return true;
+    }
+
+    // Waits until every job submitted so far has its verdict.
+    void drain() {
+        std::unique_lock<std::mutex> lk(mtx);
+        idle.wait(lk, [&] { return finished == submitted; });
+    }
+
+    // Finishes the queued jobs; no drainer runs after this returns.
+    void close() {
+        std::unique_lock<std::mutex> lk(mtx);
+        idle.wait(lk, [&] { return running == 0; });
+    }
+
+    size_t queued() { std::lock_guard<std::mutex> lk(mtx); return queue.size(); }
+    int threadCount() const { return (int)workers; }
+
+private:
+    // Called with the lock held, which it releases.
+    void startDrainer(std::unique_lock<std::mutex>& lk) {
+        bool start = running < workers;
+        if (start) ++running;
+        lk.unlock();
+        if (start) {
+            JobSystem& js = jobSystem();
+            js.runBackground(js.create([this] { work(); }));
+        }
+    }
+
+    // Takes up to BATCH jobs per lock, so the queue lock is not the bottleneck when
+    // replays verify in tens of microseconds. Each worker thread has its own GameState.
+    void work() {
+        const size_t BATCH = 8;
+        GameState& g = states[(size_t)jobSystem().currentSlot()];
+        std::vector<VerifyJob> batch;
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                if (queue.empty()) {
+                    --running;
+                    if (running == 0) idle.notify_all();
+                    return;
+                }
+                size_t n = std::min(BATCH, std::max<size_t>(1, queue.size() / workers));
+                for (size_t i = 0; i < n; ++i) { batch.push_back(std::move(queue.front())); queue.pop_front(); }
+            }
+            notFull.notify_all();
+            for (const VerifyJob& job : batch) {
+                VerifyResult r = verifyReplay(job.replay.data(), job.replay.size(), job.claim, limits, g);
+                done(job, r, verdictLine(key, job.id, r, job.replay.data(), job.replay.size()));
+            }
+            std::lock_guard<std::mutex> lk(mtx);
+            finished += batch.size();
+            batch.clear();
+            if (finished == submitted) idle.notify_all();
+        }
+    }
+
+    std::string key;
+    VerifyLimits limits;
+    size_t capacity, workers = 1, running = 0;
+    Done done;
+    std::mutex mtx;
+    std::condition_variable notFull, idle;
+    std::deque<VerifyJob> queue;
+    std::vector<GameState> states;   // by job slot
+    uint64_t submitted = 0, finished = 0;
+};
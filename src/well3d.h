@@ -0,0 +1,341 @@
+// well3d.h
+// Volumetric mode: a W x D x H well, tetracubes that turn about all three axes,
+// and plane clears. Headless like tetris_core.h, so bots and tools run it too.
+// Every layer of the well is one 64-bit mask (bit z * 8 + x): an 8 x 8 x 24 well is
+// 24 words, and a collision test is one AND per piece layer (at most four).
+
+#pragma once
+
+#include "tetris_core.h"
+#include "bitboard.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+
+// --------------------------- POLYCUBES ----------------------------
+const int WELL_MAX_W = 8;
+const int WELL_MAX_D = 8;
+const int WELL_MAX_H = 24;
+const int WELL_MIN_SIDE = 4;         // the long piece must fit across
+const int POLYCUBE_COUNT = 8;
+const int POLYCUBE_MAX_ORIENTS = 24;
+const int POLYCUBE_MAX_SPAN = 4;     // longest side of any orientation
+
+// One orientation, anchored at the min corner of its bounding box.
+struct PolycubeOrient {
+    glm::ivec3 cubes[4];
+    glm::ivec3 size;
+    uint64_t layers[POLYCUBE_MAX_SPAN];    // mask of each y layer, placed at x = z = 0
+    uint8_t turn[3];                       // orientation after a quarter turn about x, y, z
+    uint8_t toward[POLYCUBE_MAX_ORIENTS];  // first turn (axis) on a shortest way to each orientation
+};
+
+struct Polycube {
+    glm::vec3 color;
+    int orientCount = 0;
+    PolycubeOrient orients[POLYCUBE_MAX_ORIENTS];
+};
+
+inline std::vector<Polycube> POLYCUBES;
+
+typedef std::array<glm::ivec3, 4> CubeSet;
+
+// Quarter turns about x, y and z.
+inline glm::ivec3 turnCube(const glm::ivec3& c, int axis) {
+    if (axis == 0) return glm::ivec3(c.x, -c.z, c.y);
+    if (axis == 1) return glm::ivec3(c.z, c.y, -c.x);
+    return glm::ivec3(-c.y, c.x, c.z);
+}
+
+// Moves the set to the origin and sorts it, so equal shapes compare equal.
+inline CubeSet normalizeCubes(CubeSet s) {
+    glm::ivec3 lo = s[0];
+    for (const auto& c : s) { lo.x = std::min(lo.x, c.x); lo.y = std::min(lo.y, c.y); lo.z = std::min(lo.z, c.z); }
+    for (auto& c : s) c = c - lo;
+    std::sort(s.begin(), s.end(), [](const glm::ivec3& a, const glm::ivec3& b) {
+        return a.y != b.y ? a.y < b.y : (a.z != b.z ? a.z < b.z : a.x < b.x);
+    });
+    return s;
+}
+
+// The eight tetracubes; orientations are every distinct result of the three quarter turns.
+inline void initPolycubes() {
+    static const int shapes[POLYCUBE_COUNT][4][3] = {
+        {{0,0,0},{1,0,0},{2,0,0},{3,0,0}},  // I
+        {{0,0,0},{1,0,0},{0,0,1},{1,0,1}},  // O
+        {{0,0,0},{1,0,0},{2,0,0},{1,0,1}},  // T
+        {{0,0,0},{1,0,0},{2,0,0},{2,0,1}},  // L
+        {{0,0,0},{1,0,0},{1,0,1},{2,0,1}},  // S
+        {{0,0,0},{1,0,0},{1,0,1},{1,1,1}},  // right screw
+        {{0,0,1},{1,0,1},{1,0,0},{1,1,0}},  // left screw
+        {{0,0,0},{1,0,0},{0,0,1},{0,1,0}}   // branch
+    };
+    static const glm::vec3 colors[POLYCUBE_COUNT] = {
+        {0.0f,0.8f,1.0f}, {1.0f,0.9f,0.0f}, {0.8f,0.0f,0.8f}, {1.0f,0.5f,0.0f},
+        {0.0f,0.9f,0.0f}, {0.9f,0.0f,0.0f}, {0.0f,0.0f,0.9f}, {0.9f,0.9f,0.9f}
+    };
+    POLYCUBES.assign(POLYCUBE_COUNT, Polycube());
+    for (int p = 0; p < POLYCUBE_COUNT; ++p) {
+        Polycube& pc = POLYCUBES[p];
+        pc.color = colors[p];
+        CubeSet base;
+        for (int i = 0; i < 4; ++i) base[i] = glm::ivec3(shapes[p][i][0], shapes[p][i][1], shapes[p][i][2]);
+        std::vector<CubeSet> found{normalizeCubes(base)};
+        for (size_t i = 0; i < found.size(); ++i)
+            for (int axis = 0; axis < 3; ++axis) {
+                CubeSet t = found[i];
+                for (auto& c : t) c = turnCube(c, axis);
+                t = normalizeCubes(t);
+                size_t j = std::find(found.begin(), found.end(), t) - found.begin();
+                if (j == found.size()) found.push_back(t);
+                pc.orients[i].turn[axis] = (uint8_t)j;
+            }
+        pc.orientCount = (int)found.size();
+        for (int i = 0; i < pc.orientCount; ++i) {
+            PolycubeOrient& o = pc.orients[i];
+            o.size = glm::ivec3(0, 0, 0);
+            std::memset(o.layers, 0, sizeof(o.layers));
+            for (int c = 0; c < 4; ++c) {
+                const glm::ivec3& q = found[i][c];
+                o.cubes[c] = q;
+                o.size.x = std::max(o.size.x, q.x + 1); o.size.y = std::max(o.size.y, q.y + 1); o.size.z = std::max(o.size.z, q.z + 1);
+                o.layers[q.y] |= 1ull << (q.z * 8 + q.x);
+            }
+        }
+        // breadth-first search backwards from every target gives the first turn toward it
+        for (int target = 0; target < pc.orientCount; ++target) {
+            int dist[POLYCUBE_MAX_ORIENTS];
+            std::fill(dist, dist + POLYCUBE_MAX_ORIENTS, INT_MAX);
+            dist[target] = 0;
+            for (int d = 0, changed = 1; changed; ++d) {
+                changed = 0;
+                for (int i = 0; i < pc.orientCount; ++i) {
+                    if (dist[i] != INT_MAX) continue;
+                    for (int axis = 0; axis < 3; ++axis)
+                        if (dist[pc.orients[i].turn[axis]] == d) { dist[i] = d + 1; pc.orients[i].toward[target] = (uint8_t)axis; changed = 1; break; }
+                }
+            }
+            pc.orients[target].toward[target] = 0;
+        }
+    }
+}
+
+inline int randomPolycube(PieceRng& rng) { return (int)(((uint64_t)rng() * POLYCUBE_COUNT) >> 32); }
+
+// --------------------------- WELL ----------------------------
+inline int popcount64(uint64_t v) { return popcount32((uint32_t)v) + popcount32((uint32_t)(v >> 32)); }
+
+struct Well3D {
+    int w = 5, d = 5, h = 12;
+    uint64_t full = 0;   // mask of a complete layer
+    uint64_t layers[WELL_MAX_H + POLYCUBE_MAX_SPAN];  // layer 0 at the bottom; the padding above h stays empty
+};
+
+inline void resetWell(Well3D& well, int w, int d, int h) {
+    well.w = std::max(WELL_MIN_SIDE, std::min(WELL_MAX_W, w));
+    well.d = std::max(WELL_MIN_SIDE, std::min(WELL_MAX_D, d));
+    well.h = std::max(2 * POLYCUBE_MAX_SPAN, std::min(WELL_MAX_H, h));
+    well.full = 0;
+    for (int z = 0; z < well.d; ++z) well.full |= ((1ull << well.w) - 1) << (8 * z);
+    std::memset(well.layers, 0, sizeof(well.layers));
+}
+
+inline bool wellCell(const Well3D& well, int x, int y, int z) { return (well.layers[y] >> (z * 8 + x)) & 1; }
+
+// Pieces may reach above h (a turn near the top); they only collide with the walls there.
+inline bool fitsPolycube(const Well3D& well, const PolycubeOrient& o, const glm::ivec3& p) {
+    if (p.x < 0 || p.z < 0 || p.y < 0 || p.x + o.size.x > well.w || p.z + o.size.z > well.d || p.y + o.size.y > well.h + POLYCUBE_MAX_SPAN) return false;
+    int shift = p.x + 8 * p.z;
+    uint64_t hit = 0;
+    for (int i = 0; i < o.size.y; ++i) hit |= well.layers[p.y + i] & (o.layers[i] << shift);
+    return hit == 0;
+}
+
+// Returns false if part of the piece stays above the top (lock out).
+inline bool mergePolycube(Well3D& well, const PolycubeOrient& o, const glm::ivec3& p) {
+    int shift = p.x + 8 * p.z;
+    for (int i = 0; i < o.size.y && p.y + i < well.h; ++i) well.layers[p.y + i] |= o.layers[i] << shift;
+    return p.y + o.size.y <= well.h;
+}
+
+// Removes complete layers. Returns the number of planes cleared.
+inline int clearPlanes(Well3D& well) {
+    int dst = 0;
+    for (int y = 0; y < well.h; ++y) if (well.layers[y] != well.full) well.layers[dst++] = well.layers[y];
+    int cleared = well.h - dst;
+    for (; dst < well.h; ++dst) well.layers[dst] = 0;
+    return cleared;
+}
+
+// Lowest y the piece falls to from p (p must fit).
+inline int dropHeight(const Well3D& well, const PolycubeOrient& o, glm::ivec3 p) {
+    while (p.y > 0 && fitsPolycube(well, o, glm::ivec3(p.x, p.y - 1, p.z))) --p.y;
+    return p.y;
+}
+
+// --------------------------- GAME ----------------------------
+struct Game3D {
+    Well3D well;
+    int piece = 0, orient = 0, next = 0;
+    glm::ivec3 pos = glm::ivec3(0, 0, 0);          // min corner of the piece's bounding box
+    uint16_t gravityTicks = GRAVITY_TICKS_DEFAULT;
+    uint16_t gravityTimer = 0;
+    bool gameOver = false;
+    unsigned pieceSerial = 0;
+    int planes = 0;
+    PieceRng rng;
+};
+
+inline const PolycubeOrient& currentOrient(const Game3D& g) { return POLYCUBES[g.piece].orients[g.orient]; }
+
+inline void spawnPolycube(Game3D& g) {
+    g.piece = g.next;
+    g.orient = 0;
+    g.next = randomPolycube(g.rng);
+    const PolycubeOrient& o = currentOrient(g);
+    g.pos = glm::ivec3((g.well.w - o.size.x) / 2, g.well.h - o.size.y, (g.well.d - o.size.z) / 2);
+    ++g.pieceSerial;
+    if (!fitsPolycube(g.well, o, g.pos)) g.gameOver = true;
+}
+
+inline void resetGame3D(Game3D& g, unsigned seed, int w, int d, int h) {
+    resetWell(g.well, w, d, h);
+    g.rng.seed(seed);
+    g.gameOver = false;
+    g.gravityTimer = 0;
+    g.planes = 0;
+    g.next = randomPolycube(g.rng);
+    spawnPolycube(g);
+}
+
+inline bool movePolycube(Game3D& g, int dx, int dy, int dz) {
+    glm::ivec3 p = g.pos + glm::ivec3(dx, dy, dz);
+    if (!fitsPolycube(g.well, currentOrient(g), p)) return false;
+    g.pos = p;
+    return true;
+}
+
+// Turns about the bounding box centre, pulled back inside the walls, then tries the kicks.
+inline bool turnPolycube(Game3D& g, int axis) {
+    const PolycubeOrient& from = currentOrient(g);
+    int to = from.turn[axis];
+    const PolycubeOrient& o = POLYCUBES[g.piece].orients[to];
+    glm::ivec3 p = g.pos + (from.size - o.size) / 2;
+    p.x = std::max(0, std::min(p.x, g.well.w - o.size.x));
+    p.z = std::max(0, std::min(p.z, g.well.d - o.size.z));
+    p.y = std::max(0, p.y);
+    static const glm::ivec3 kicks[] = {{0,0,0},{1,0,0},{-1,0,0},{0,0,1},{0,0,-1},{0,1,0},{0,-1,0}};
+    for (const auto& k : kicks)
+        if (fitsPolycube(g.well, o, p + k)) { g.orient = to; g.pos = p + k; return true; }
+    return false;
+}
+
+// Merge + clear + spawn. Returns planes cleared.
+inline int lockPolycube(Game3D& g) {
+    if (!mergePolycube(g.well, currentOrient(g), g.pos)) { g.gameOver = true; return 0; }
+    int planes = clearPlanes(g.well);
+    g.planes += planes;
+    spawnPolycube(g);
+    return planes;
+}
+
+// x runs left to right, z from the back wall toward the viewer, y up.
+enum Action3D : uint8_t {
+    A3_LEFT, A3_RIGHT, A3_BACK, A3_FRONT,
+    A3_TURN_X, A3_TURN_Y, A3_TURN_Z,
+    A3_SOFT_DROP, A3_HARD_DROP,
+    A3_GRAVITY,
+    A3_COUNT
+};
+
+// Returns planes cleared if the action locked the piece, 0 otherwise.
+inline int applyAction3D(Game3D& g, Action3D a) {
+    if (g.gameOver) return 0;
+    switch (a) {
+    case A3_LEFT: movePolycube(g, -1, 0, 0); return 0;
+    case A3_RIGHT: movePolycube(g, 1, 0, 0); return 0;
+    case A3_BACK: movePolycube(g, 0, 0, -1); return 0;
+    case A3_FRONT: movePolycube(g, 0, 0, 1); return 0;
+    case A3_TURN_X: turnPolycube(g, 0); return 0;
+    case A3_TURN_Y: turnPolycube(g, 1); return 0;
+    case A3_TURN_Z: turnPolycube(g, 2); return 0;
+    case A3_SOFT_DROP: movePolycube(g, 0, -1, 0); return 0;
+    case A3_HARD_DROP: g.pos.y = dropHeight(g.well, currentOrient(g), g.pos); return lockPolycube(g);
+    case A3_GRAVITY: return movePolycube(g, 0, -1, 0) ? 0 : lockPolycube(g);
+    default: return 0;
+    }
+}
+
+// Runs one tick, same gravity clock as the flat game.
+inline int updateGame3D(Game3D& g) {
+    if (g.gameOver) return 0;
+    if (++g.gravityTimer < g.gravityTicks) return 0;
+    g.gravityTimer = 0;
+    return applyAction3D(g, A3_GRAVITY);
+}
+
+// --------------------------- BOT ----------------------------
+// A placement is "turn into orientation o at the top, shift to (x, z), hard drop".
+struct Placement3D {
+    int orient = 0;
+    int x = 0, z = 0;
+};
+
+// Calls f(placement, wellAfter, planesCleared) for every orientation and column whose
+// drop starts clear at the top of the well. Placements that lock out are skipped.
+template<class F>
+void forEachPlacement3D(const Well3D& well, int piece, F&& f) {
+    const Polycube& pc = POLYCUBES[piece];
+    for (int r = 0; r < pc.orientCount; ++r) {
+        const PolycubeOrient& o = pc.orients[r];
+        int top = well.h - o.size.y;
+        for (int z = 0; z + o.size.z <= well.d; ++z)
+            for (int x = 0; x + o.size.x <= well.w; ++x) {
+                glm::ivec3 p(x, top, z);
+                if (!fitsPolycube(well, o, p)) continue;
+                p.y = dropHeight(well, o, p);
+                Well3D after = well;
+                if (!mergePolycube(after, o, p)) continue;
+                int planes = clearPlanes(after);
+                f(Placement3D{r, x, z}, after, planes);
+            }
+    }
+}
+
+// Height, holes and layer density, all straight from the layer masks. Dense layers
+// are close to clearing; squaring the fill rewards finishing one over spreading out.
+inline int evaluateWell3D(const Well3D& well, int planes) {
+    uint64_t covered = 0;
+    int height = 0, holes = 0, density = 0;
+    for (int y = well.h - 1; y >= 0; --y) {
+        uint64_t l = well.layers[y];
+        height += popcount64(l & ~covered) * (y + 1);
+        holes += popcount64(covered & ~l);
+        covered |= l;
+        int n = popcount64(l);
+        density += n * n;
+    }
+    int cells = well.w * well.d;
+    return 100 * cells * planes - 4 * height - 40 * holes + 2 * density / cells;
+}
+
+// Best placement of the current piece; false if it cannot be placed anywhere.
+inline bool bestPlacement3D(const Game3D& g, Placement3D& best) {
+    int bestScore = INT_MIN;
+    forEachPlacement3D(g.well, g.piece, [&](const Placement3D& p, const Well3D& after, int planes) {
+        int s = evaluateWell3D(after, planes);
+        if (s > bestScore) { bestScore = s; best = p; }
+    });
+    return bestScore != INT_MIN;
+}
+
+// One input toward placement t: turns first, then shifts, then the drop.
+inline Action3D placementInput3D(const Game3D& g, const Placement3D& t) {
+    if (g.orient != t.orient) return (Action3D)(A3_TURN_X + currentOrient(g).toward[t.orient]);
+    if (t.x < g.pos.x) return A3_LEFT;
+    if (t.x > g.pos.x) return A3_RIGHT;
+    if (t.z < g.pos.z) return A3_BACK;
+    if (t.z > g.pos.z) return A3_FRONT;
+    return A3_HARD_DROP;
+}
@@ -0,0 +1,184 @@
+// alloc_check.cpp
+// Checks that steady-state frames do not touch the heap. Plays a greedy bot game
+// through the per-frame work of the game loop that does not need a window: inputs
+// one per frame through the replay writer, finesse counter and flight recorder,
+// gravity ticks, line clears, keyframes, the live state segment, a versus CPU driven
+// like the game's (BotSearch started and polled from this thread, inputs steered per
+// action tick), and the scene's cube lists built by the game's own code
+// (scene_cubes.h): both versus boards and the heatmap through jobs, and the volumetric
+// well. operator new is counted on every
+// thread (alloc_counter.h); after the warm-up every frame must make zero allocations.
+// Restarts after a top-out are not steady state and are left out. Exit status 1 on
+// any allocating frame.
+//
+//   alloc_check [--frames N] [--warmup N] [--seed N]
+
+#include "alloc_counter.h"
+#include "bot.h"
+#include "finesse.h"
+#include "flight_recorder.h"
+#include "live_state.h"
+#include "perf_counters.h"
+#include "replay.h"
+#include "scene_cubes.h"
+
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// The inputs that take the current piece to the greedy bot's placement, hard drop last.
+int planInputs(const GameState& g, GameAction* out) {
+    BitBoard bb;
+    toBitBoard(g.board, bb);
+    Placement best{0, g.currentPos.x};
+    int bestScore = INT_MIN;
+    forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int lines) {
+        int s = evaluateBoard(after, lines);
+        if (s > bestScore) { bestScore = s; best = p; }
+    });
+    return placementInputs(g, best.rotation, best.x, out);
+}
+
+int main(int argc, char** argv) {
+    long long frames = 20000, warmup = 120;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--frames" && i + 1 < argc) frames = std::atoll(argv[++i]);
+        else if (a == "--warmup" && i + 1 < argc) warmup = std::atoll(argv[++i]);
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else { std::cerr << "usage: alloc_check [--frames N] [--warmup N] [--seed N]\n"; return 1; }
+    }
+    initPieces();
+    initPolycubes();
+    flightStart(".", 0);
+    const std::string replayPath = (std::filesystem::temp_directory_path() / ("alloc_check_" + std::to_string(getpid()) + ".trpl")).string();
+    const std::string liveName = "/tetris_alloc_check." + std::to_string(getpid());
+    LivePublisher live;
+    if (!live.open(liveName)) std::cerr << "Failed to open shared memory " << liveName << ", checking without it\n";
+
+    jobSystem();   // built here, so this thread takes part like the game's main thread
+    FrameArena arena(1 << 20);
+    Heatmap heat;
+    Game3D well;
+    resetGame3D(well, seed, 5, 5, 12);
+    GameState g, cpu;
+    resetGame(cpu, seed + 1000);
+    BotSearch bot;
+    Placement cpuPlan;
+    bool cpuHasPlan = false;
+    unsigned cpuSerial = 0;
+    int cpuInputs = 0, cpuActionTicks = 0;
+    long long cpuPieces = 0;
+    ReplayWriter replay;
+    FinesseCounter finesse;
+    GameAction plan[PLACEMENT_MAX_INPUTS];
+    int planned = 0, next = 0;
+    uint32_t tick = 0;
+    const uint32_t gravityTicks = 30;
+    long long checked = 0, allocating = 0, allocations = 0, restarts = 0, lines = 0;
+    bool restarted = true;
+
+    for (long long frame = 0; frame < frames; ++frame) {
+        uint64_t before = heapAllocationsTotal.load();
+        if (restarted) {
+            resetGame(g, seed++);
+            if (!replay.start(replayPath, seed, gravityTicks)) { std::cerr << "Failed to open " << replayPath << "\n"; return 1; }
+            finesse = FinesseCounter{};
+            tick = 0;
+            planned = next = 0;
+            flightEvent(FLIGHT_EV_START, seed);
+        }
+        bool steady = !restarted && frame >= warmup;
+        restarted = false;
+
+        flightFrame(1.0 / 60.0, 0.004);
+        arena.reset();
+
+        // one input per frame, then gravity for the ticks this frame covers (120 Hz clock)
+        if (next == planned) { planned = planInputs(g, plan); next = 0; }
+        GameAction act = plan[next++];
+        flightRecord(FLIGHT_INPUT, act, tick, 0);
+        replay.add(tick, act);
+        finesse.onInput(g, act);
+        int cleared = applyAction(g, act);
+        if (act == ACT_HARD_DROP) next = planned;
+        for (int t = 0; t < 2 && !g.gameOver; ++t) {
+            PerfScope perf(PERF_TICK);
+            ++tick;
+            flightRecord(FLIGHT_TICK, 0, tick, g.pieceSerial);
+            if (tick % gravityTicks == 0) {
+                replay.add(tick, ACT_GRAVITY);
+                finesse.onInput(g, ACT_GRAVITY);
+                if (actionLocksPiece(g, ACT_GRAVITY)) next = planned;
+                cleared += applyAction(g, ACT_GRAVITY);
+            }
+        }
+        // the CPU side, as updateCpu: gravity, then a plan step every 4 ticks
+        for (int t = 0; t < 2 && !cpu.gameOver; ++t) {
+            updateGame(cpu);
+            if (cpuHasPlan && cpuSerial != cpu.pieceSerial) cpuHasPlan = false;
+            if (!cpuHasPlan) {
+                if (!bot.busy()) { bot.start(cpu, 0.0005); cpuSerial = cpu.pieceSerial; }
+                if (!bot.poll(cpuPlan) || cpuSerial != cpu.pieceSerial) continue;
+                cpuHasPlan = true;
+                cpuInputs = cpuActionTicks = 0;
+            }
+            if (++cpuActionTicks < 4) continue;
+            cpuActionTicks = 0;
+            GameAction a = ++cpuInputs < PLACEMENT_MAX_INPUTS ? nextPlacementInput(cpu, cpuPlan.rotation, cpuPlan.x) : ACT_HARD_DROP;
+            if (a != ACT_HARD_DROP) { applyAction(cpu, a); continue; }
+            hardDrop(cpu);
+            cpuHasPlan = false;
+            ++cpuPieces;
+        }
+        if (replay.keyframeDue()) replay.keyframe(g, tick, (tick / gravityTicks + 1) * gravityTicks);
+        if (cleared) { flightEvent(FLIGHT_EV_LINES, (uint32_t)cleared, tick); lines += cleared; }
+        if (live.isOpen()) live.publish(g, tick, 1.0f / 60.0f, 0);
+
+        // the game's scene: this board on both sides of a versus match with the heatmap,
+        // then the well view
+        for (int y = 0; y < BOARD_H; ++y) for (int x = 0; x < BOARD_W; ++x) heat.cells[y][x] += g.board[y][x] != 0;
+        ++heat.samples;
+        SceneInput scene;
+        scene.player = &g;
+        scene.cpu = &cpu;
+        scene.heatmap = &heat;
+        SceneCubes cubes(arena);
+        buildSceneCubes(cubes, scene);
+        SceneInput wellScene;
+        wellScene.well = &well;
+        SceneCubes wellCubes(arena);
+        buildSceneCubes(wellCubes, wellScene);
+
+        if (g.gameOver) {
+            flightEvent(FLIGHT_EV_GAME_OVER, tick);
+            replay.finish(tick);
+            restarted = true;
+            ++restarts;
+        }
+        if (cpu.gameOver) {
+            resetGame(cpu, seed + 1000);
+            cpuHasPlan = false;
+            restarted = true;
+            ++restarts;
+        }
+        uint64_t made = heapAllocationsTotal.load() - before;
+        if (!steady || restarted) continue;
+        ++checked;
+        if (made) {
+            if (++allocating <= 10) std::cerr << "frame " << frame << ": " << made << " heap allocations\n";
+            allocations += (long long)made;
+        }
+    }
+    replay.finish(tick);
+    live.close();
+    std::remove(replayPath.c_str());
+
+    std::cout << checked << " steady-state frames, " << allocating << " allocated (" << allocations << " allocations); "
+              << lines << " lines, " << cpuPieces << " CPU pieces, " << restarts << " restarts, " << heapAllocationsTotal.load() << " allocations in all; arena peak "
+              << arena.highWater() << " bytes, " << arena.spills << " spills\n";
+    return allocating == 0 ? 0 : 1;
+}
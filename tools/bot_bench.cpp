@@ -0,0 +1,110 @@
+// bot_bench.cpp
+// Headless CPU benchmark: plays seeded games with BotSearch and reports how far each
+// evaluation mode gets on the same per-piece budget. Monte Carlo also reports rollouts/s.
+//
+// With --cache the heuristic runs share a placement cache file (placement_cache.h) and
+// report how many pieces it answered; run twice to see a warm cache.
+//
+// --net loads a learned evaluator (nn_eval.h) for --eval network. --perf adds hardware
+// counters for the bot search and the piece locks (perf_counters.h). The search runs on
+// the shared job system (jobs.h) with --threads workers; --job-stats prints how busy
+// each one was.
+//
+//   bot_bench [--budget ms] [--games N] [--pieces N] [--threads N] [--eval heuristic|mc|network|both] [--policy greedy|random] [--depth N] [--cache file] [--net file] [--perf] [--job-stats]
+
+#include "bot.h"
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+struct BenchResult {
+    long long pieces = 0, lines = 0, rollouts = 0, cached = 0;
+    int topouts = 0;
+    double searchSeconds = 0.0;
+};
+
+BenchResult runGames(BotSearch& bot, int games, int maxPieces, double budgetMs) {
+    BenchResult r;
+    for (int game = 0; game < games; ++game) {
+        GameState g;
+        resetGame(g, 1000u + (unsigned)game); // same seeds for every mode
+        for (int n = 0; n < maxPieces && !g.gameOver; ++n) {
+            bot.start(g, budgetMs / 1000.0);
+            Placement p;
+            BotStats st;
+            while (!bot.poll(p, &st)) std::this_thread::yield();
+            r.rollouts += st.rollouts;
+            r.cached += st.cached;
+            r.searchSeconds += st.seconds;
+            PerfScope lockPerf(PERF_LOCK);
+            r.lines += applyPlacement(g, p);
+            lockPerf.end();
+            ++r.pieces;
+        }
+        if (g.gameOver) ++r.topouts;
+    }
+    return r;
+}
+
+void report(const char* name, const BenchResult& r, int games) {
+    std::cout << name << ": pieces/game " << (double)r.pieces / games
+              << ", lines/game " << (double)r.lines / games
+              << ", topouts " << r.topouts << "/" << games;
+    if (r.rollouts) std::cout << ", rollouts/s " << (long long)(r.rollouts / r.searchSeconds);
+    if (r.cached) std::cout << ", cache hits " << r.cached << "/" << r.pieces;
+    std::cout << ", search ms/piece " << r.searchSeconds * 1000.0 / std::max(1LL, r.pieces);
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    double budgetMs = 2.0;
+    int games = 5, maxPieces = 500, threads = 0;
+    std::string eval = "both", cachePath, netPath;
+    RolloutConfig rc;
+    bool perf = false, jobStats = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--perf") perf = true;
+        else if (a == "--job-stats") jobStats = true;
+        else if (i + 1 == argc) { std::cerr << "missing value for " << a << "\n"; return 1; }
+        else if (a == "--budget") budgetMs = std::atof(argv[++i]);
+        else if (a == "--games") games = std::atoi(argv[++i]);
+        else if (a == "--pieces") maxPieces = std::atoi(argv[++i]);
+        else if (a == "--threads") threads = std::atoi(argv[++i]);
+        else if (a == "--eval") eval = argv[++i];
+        else if (a == "--policy") rc.policy = std::string(argv[++i]) == "random" ? RolloutPolicy::Random : RolloutPolicy::Greedy;
+        else if (a == "--depth") rc.depth = std::atoi(argv[++i]);
+        else if (a == "--cache") cachePath = argv[++i];
+        else if (a == "--net") netPath = argv[++i];
+        else { std::cerr << "unknown option " << a << "\n"; return 1; }
+    }
+    initPieces();
+    if (perf) perfEnable();
+    if (threads > 0) jobThreads = threads + 1;   // the main thread only polls
+    BotSearch bot(threads);
+    PlacementCache cache;
+    if (!cachePath.empty()) {
+        if (!cache.open(cachePath)) { std::cerr << "cannot open cache " << cachePath << "\n"; return 1; }
+        bot.setCache(&cache);
+    }
+    std::cout << "budget " << budgetMs << " ms, " << bot.threadCount() << " worker threads, " << games << " games x " << maxPieces << " pieces\n";
+    if (eval == "heuristic" || eval == "both") {
+        bot.setEval(BotEval::Heuristic);
+        report("heuristic", runGames(bot, games, maxPieces, budgetMs), games);
+    }
+    if (eval == "mc" || eval == "both") {
+        bot.setEval(BotEval::MonteCarlo, rc);
+        report("montecarlo", runGames(bot, games, maxPieces, budgetMs), games);
+    }
+    if (eval == "network") {
+        NnEval net;
+        if (netPath.empty() || !loadNnEval(netPath, net)) { std::cerr << "--eval network needs a weights file (--net)\n"; return 1; }
+        bot.setNetwork(&net);
+        bot.setEval(BotEval::Network);
+        report("network", runGames(bot, games, maxPieces, budgetMs), games);
+    }
+    if (perf) perfReport(std::cout);
+    if (jobStats) jobSystem().report(std::cout);
+    return 0;
+}
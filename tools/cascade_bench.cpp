@@ -0,0 +1,155 @@
+// cascade_bench.cpp
+// Cascade gravity (tetris_core.h CASCADE) under load. Random boards full of loose
+// groups and completed rows are settled with the row-mask code and checked against a
+// plain per-cell flood fill doing the same passes; timings are per board, at the game's
+// 10 x 20 and on 40-wide boards. Then greedy bot games with and without cascade
+// gravity compare placements evaluated per second.
+//
+//   cascade_bench [--boards N] [--games N] [--pieces N] [--seed S]
+
+#include "bot_eval.h"
+
+#include <cstdio>
+#include <iostream>
+
+// Reference: the same lowest-group-first passes, groups found cell by cell.
+template<class Row>
+int referenceCascade(Row* rows, int h, int w, Row full) {
+    int total = 0;
+    auto cell = [&](int x, int y) { return (rows[y] >> x) & 1; };
+    for (;;) {
+        int write = h - 1;
+        for (int y = h - 1; y >= 0; --y) if (rows[y] != full) rows[write--] = rows[y];
+        int cleared = write + 1;
+        for (int y = 0; y <= write; ++y) rows[y] = 0;
+        if (!cleared) return total;
+        total += cleared;
+        bool anyMoved = false;
+        for (bool moved = true; moved;) {
+            moved = false;
+            std::vector<char> done((size_t)w * h, 0);
+            for (int y = h - 1; y >= 0; --y)
+                for (int x = 0; x < w; ++x) {
+                    if (!cell(x, y) || done[(size_t)y * w + x]) continue;
+                    std::vector<std::pair<int,int>> group{{x, y}}, stack{{x, y}};
+                    std::vector<char> in((size_t)w * h, 0);
+                    in[(size_t)y * w + x] = 1;
+                    while (!stack.empty()) {
+                        auto c = stack.back(); stack.pop_back();
+                        const int dx[] = {1, -1, 0, 0}, dy[] = {0, 0, 1, -1};
+                        for (int k = 0; k < 4; ++k) {
+                            int nx = c.first + dx[k], ny = c.second + dy[k];
+                            if (nx < 0 || nx >= w || ny < 0 || ny >= h || in[(size_t)ny * w + nx] || !cell(nx, ny)) continue;
+                            in[(size_t)ny * w + nx] = 1;
+                            group.push_back({nx, ny});
+                            stack.push_back({nx, ny});
+                        }
+                    }
+                    for (auto& c : group) { rows[c.second] &= (Row)~((Row)1 << c.first); done[(size_t)c.second * w + c.first] = 1; }
+                    int d = 0;
+                    for (;; ++d) {
+                        bool fits = true;
+                        for (auto& c : group) if (c.second + d + 1 >= h || cell(c.first, c.second + d + 1)) { fits = false; break; }
+                        if (!fits) break;
+                    }
+                    for (auto& c : group) rows[c.second + d] |= (Row)((Row)1 << c.first);
+                    for (auto& c : group) done[(size_t)(c.second + d) * w + c.first] = 1;
+                    moved = moved || d > 0;
+                }
+            anyMoved = anyMoved || moved;
+        }
+        if (!anyMoved) return total;
+    }
+}
+
+// Lower half dense with some full rows, upper part sparse speckle: many loose groups.
+template<class Row>
+void randomBoard(std::mt19937_64& rng, Row* rows, int h, Row full) {
+    for (int y = 0; y < h; ++y) {
+        Row r = (Row)rng() & full;
+        if (y > h / 2) r |= (Row)rng() & full;
+        if (y > h / 3 && rng() % 4 == 0) r = full;
+        if (y < h / 3) r &= (Row)rng() & (Row)rng();
+        rows[y] = r;
+    }
+}
+
+template<class Row>
+bool benchBoards(const char* name, int w, int h, int boards, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    Row full = (Row)(w >= (int)(8 * sizeof(Row)) ? ~(Row)0 : (Row)(((Row)1 << w) - 1));
+    std::vector<Row> start((size_t)boards * h);
+    for (int i = 0; i < boards; ++i) randomBoard<Row>(rng, &start[(size_t)i * h], h, full);
+
+    std::vector<Row> fast = start, ref = start;
+    long long lines = 0, chains = 0;
+    int maxChain = 0;
+    std::vector<double> times((size_t)boards);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < boards; ++i) {
+        auto b0 = std::chrono::steady_clock::now();
+        int c = 0;
+        lines += cascadeRows<Row>(&fast[(size_t)i * h], h, full, &c);
+        times[(size_t)i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - b0).count();
+        chains += c;
+        maxChain = std::max(maxChain, c);
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::nth_element(times.begin(), times.begin() + boards * 99 / 100, times.end());
+    double p99 = times[(size_t)boards * 99 / 100];
+    for (int i = 0; i < boards; ++i) referenceCascade<Row>(&ref[(size_t)i * h], h, w, full);
+    bool same = fast == ref;
+    std::cout << name << " " << w << "x" << h << ": " << boards << " boards, " << (double)lines / boards << " lines and "
+              << (double)chains / boards << " rounds per board (longest chain " << maxChain << "), "
+              << secs / boards * 1e6 << " us avg, " << p99 * 1e6 << " us p99"
+              << (same ? ", matches the reference\n" : ", DIFFERS from the reference\n");
+    return same;
+}
+
+double greedyPlacementsPerSecond(bool cascade, int games, int maxPieces, long long& lines) {
+    long long evaluated = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < games; ++n) {
+        GameState g;
+        g.cascade = cascade;
+        resetGame(g, 4000u + (unsigned)n);
+        for (int p = 0; p < maxPieces && !g.gameOver; ++p) {
+            BitBoard bb;
+            toBitBoard(g.board, bb);
+            Placement best;
+            int bestScore = INT_MIN;
+            forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& pl, const BitBoard& after, int l) {
+                int s = evaluateBoard(after, l);
+                if (s > bestScore) { bestScore = s; best = pl; }
+                ++evaluated;
+            }, cascade);
+            if (bestScore == INT_MIN) break;
+            lines += applyPlacement(g, best);
+        }
+    }
+    return evaluated / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int boards = 20000, games = 20, maxPieces = 2000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--boards" && i + 1 < argc) boards = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--games" && i + 1 < argc) games = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--pieces" && i + 1 < argc) maxPieces = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else { std::cerr << "usage: cascade_bench [--boards N] [--games N] [--pieces N] [--seed S]\n"; return 1; }
+    }
+    initPieces();
+
+    bool ok = benchBoards<uint16_t>("game", BOARD_W, BOARD_H, boards, seed);
+    ok = benchBoards<uint64_t>("wide", 40, 40, boards / 4, seed + 1) && ok;
+
+    long long plainLines = 0, cascadeLines = 0;
+    double plain = greedyPlacementsPerSecond(false, games, maxPieces, plainLines);
+    double cascade = greedyPlacementsPerSecond(true, games, maxPieces, cascadeLines);
+    std::cout << "greedy bot: " << plain / 1e6 << " M placements/s plain, " << cascade / 1e6 << " M/s cascade ("
+              << plainLines / games << " vs " << cascadeLines / games << " lines per game)\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+// export_training.cpp
+// Writes columnar training data (training_export.h) from replay files or from greedy
+// self-play games. Each thread feeds its own exporter into <out>/part-<n>/.
+//
+//   export_training --out dir [--compress] [--threads N] [--block ROWS] <file|dir>...
+//   export_training --out dir [--compress] [--threads N] --selfplay GAMES [--pieces N] [--bench]
+//
+// --bench plays the self-play games twice, without and with the exporter, and reports
+// the slowdown exporting causes.
+
+#include "training_export.h"
+#include "bot_eval.h"
+#include "jobs.h"
+#include "replay_files.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Plays one piece with the one-ply heuristic, typed out as inputs so obs sees it like a replay.
+int playGreedyPiece(GameState& g, ReplayObserver* obs) {
+    BitBoard bb;
+    toBitBoard(g.board, bb);
+    Placement best{0, g.currentPos.x};
+    int bestScore = INT_MIN;
+    forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int lines) {
+        int s = evaluateBoard(after, lines);
+        if (s > bestScore) { bestScore = s; best = p; }
+    });
+    GameAction keys[PLACEMENT_MAX_INPUTS];
+    int n = placementInputs(g, best.rotation, best.x, keys), lines = 0;
+    for (int i = 0; i < n; ++i) lines = applyReplayEvent(g, ReplayEvent{0, (uint8_t)keys[i], 0}, obs);
+    return lines;
+}
+
+// Runs jobs [0, count) on the job system; job(thread slot, index). Returns wall seconds.
+template<class F>
+double runParallel(size_t count, F&& job) {
+    auto t0 = std::chrono::steady_clock::now();
+    JobSystem& js = jobSystem();
+    js.parallelFor(0, (int)count, 1, [&](int i) { job(js.currentSlot(), (size_t)i); });
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int threads = (int)std::thread::hardware_concurrency(), selfplay = 0, maxPieces = 2000, blockRows = 1 << 16;
+    bool compress = false, bench = false;
+    std::string outDir;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (a == "--out" && i + 1 < argc) outDir = argv[++i];
+        else if (a == "--selfplay" && i + 1 < argc) selfplay = std::atoi(argv[++i]);
+        else if (a == "--pieces" && i + 1 < argc) maxPieces = std::atoi(argv[++i]);
+        else if (a == "--block" && i + 1 < argc) blockRows = std::atoi(argv[++i]);
+        else if (a == "--compress") compress = true;
+        else if (a == "--bench") bench = true;
+        else collectInputs(a, files);
+    }
+    if (outDir.empty() || (files.empty() && selfplay <= 0)) {
+        std::cerr << "usage: export_training --out dir [--compress] [--threads N] (<file|dir>... | --selfplay GAMES [--pieces N] [--bench])\n";
+        return 1;
+    }
+    jobThreads = std::max(1, threads);   // the main thread works too
+    threads = jobSystem().threadCount();
+    initPieces();
+
+    std::vector<std::unique_ptr<TrainingExporter>> exporters;
+    std::vector<std::unique_ptr<TrainingObserver>> observers;
+    for (int t = 0; t < threads; ++t) {
+        exporters.emplace_back(new TrainingExporter());
+        std::string dir = outDir + "/part-" + std::to_string(t);
+        if (!exporters.back()->open(dir, compress, (size_t)std::max(1, blockRows))) { std::cerr << "cannot write " << dir << "\n"; return 1; }
+        observers.emplace_back(new TrainingObserver(*exporters.back()));
+    }
+    std::vector<GameState> states(threads);
+
+    double seconds = 0.0, baseline = 0.0;
+    if (selfplay > 0) {
+        auto play = [&](bool exporting) {
+            return runParallel((size_t)selfplay, [&](int t, size_t game) {
+                GameState& g = states[t];
+                ReplayObserver* obs = exporting ? observers[t].get() : nullptr;
+                resetGame(g, 5000u + (unsigned)game);
+                if (obs) obs->onStart(g);
+                for (int n = 0; n < maxPieces && !g.gameOver; ++n) playGreedyPiece(g, obs);
+                if (obs) obs->onEnd(g, ACT_HARD_DROP);
+            });
+        };
+        if (bench) baseline = play(false);
+        seconds = play(true);
+    } else {
+        std::vector<MappedFile> maps;
+        std::vector<ReplayView> records;
+        mapRecords(files, maps, records);
+        seconds = runParallel(records.size(), [&](int t, size_t i) { simulateReplay(records[i], states[t], observers[t].get()); });
+        for (auto& mf : maps) munmap((void*)mf.data, mf.size);
+    }
+
+    // closing flushes the last blocks; that time counts too
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t rows = 0, bytes = 0;
+    double wait = 0.0;
+    bool ok = true;
+    for (auto& e : exporters) { ok = e->close() && ok; rows += e->rows(); bytes += e->bytes(); wait += e->waitSeconds(); }
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!ok) { std::cerr << "write error in " << outDir << "\n"; return 1; }
+
+    std::cout << rows << " rows, " << bytes / (1024.0 * 1024.0) << " MB (" << (rows ? (double)bytes / rows : 0.0) << " B/row"
+              << (compress ? ", compressed" : "") << ") in " << seconds << " s, " << threads << " threads, producers blocked "
+              << wait * 1000.0 << " ms\n";
+    if (bench) std::cout << "self-play without export " << baseline << " s, with export " << seconds << " s ("
+                         << (baseline > 0 ? (seconds / baseline - 1.0) * 100.0 : 0.0) << "% slower)\n";
+    return 0;
+}
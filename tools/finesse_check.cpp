@@ -0,0 +1,149 @@
+// finesse_check.cpp
+// Checks the finesse tables (finesse.h) and what they save. Every placement of every
+// piece is typed from spawn on an empty board and must land the same cells as
+// rotate-then-shift; keys per placement are compared. Then greedy bot games are typed
+// both ways side by side, checking the games stay identical, and recorded as replays
+// to compare inputs per piece and bytes per piece. The player fault counter scores both;
+// faults left on the finesse side are pieces the stack forced off the open-board path.
+//
+//   finesse_check [--games N] [--pieces N] [--seed S]
+
+#include "bot_eval.h"
+#include "replay.h"
+
+#include <iostream>
+
+static const char PIECE_NAMES[] = "IOTSZJL";
+
+// Rotate at spawn, then shift: the inputs before the tables.
+int legacyInputs(const GameState& g, const Placement& p, GameAction* out) {
+    GameState s = g;
+    int n = 0;
+    for (int r = 0; r < p.rotation; ++r) { rotatePiece(s); out[n++] = ACT_ROTATE; }
+    while (s.currentPos.x != p.x) {
+        GameAction a = p.x > s.currentPos.x ? ACT_RIGHT : ACT_LEFT;
+        if (!movePiece(s, a == ACT_RIGHT ? 1 : -1, 0)) break;
+        out[n++] = a;
+    }
+    out[n++] = ACT_HARD_DROP;
+    return n;
+}
+
+struct Typed {
+    GameState g;
+    ReplayWriter replay;
+    uint32_t tick = 0;
+    long long inputs = 0;
+    FinesseCounter finesse;
+
+    void start(unsigned seed) {
+        resetGame(g, seed);
+        replay.start("", seed, 30);
+        tick = 0;
+    }
+    // one input every 4 ticks, gravity every 30 as in a real record
+    void type(const GameAction* keys, int n) {
+        for (int i = 0; i < n && !g.gameOver; ++i) {
+            for (int k = 0; k < 4; ++k) if (++tick % 30 == 0) { finesse.onInput(g, ACT_GRAVITY); applyAction(g, ACT_GRAVITY); }
+            replay.add(tick, keys[i]);
+            finesse.onInput(g, keys[i]);
+            applyAction(g, keys[i]);
+            ++inputs;
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    int games = 20, maxPieces = 1000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--games" && i + 1 < argc) games = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--pieces" && i + 1 < argc) maxPieces = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else { std::cerr << "usage: finesse_check [--games N] [--pieces N] [--seed S]\n"; return 1; }
+    }
+    initPieces();
+
+    auto t0 = std::chrono::steady_clock::now();
+    finesseTables();
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    // every placement on an empty board
+    bool ok = true;
+    GameAction keys[PLACEMENT_MAX_INPUTS];
+    for (int piece = 0; piece < PIECE_COUNT; ++piece) {
+        GameState g;
+        resetGame(g, 1);
+        g.currentPieceIndex = piece;
+        g.currentPiece = PIECES[piece];
+        g.currentPos = spawnPosition();
+        int placements = 0, finesse = 0, legacy = 0, worst = 0;
+        BitBoard empty{};
+        forEachPlacement(empty, piece, [&](const Placement& p, const BitBoard&, int) {
+            GameState a = g, b = g;
+            int n = placementInputs(a, p.rotation, p.x, keys);
+            for (int i = 0; i < n; ++i) applyAction(a, keys[i]);
+            int m = legacyInputs(b, p, keys);
+            for (int i = 0; i < m; ++i) applyAction(b, keys[i]);
+            if (std::memcmp(a.board, b.board, sizeof(a.board)) != 0 || n - 1 != finesseKeys(piece, p.rotation, p.x)) {
+                std::cout << "  " << PIECE_NAMES[piece] << " r" << p.rotation << " x" << p.x << ": MISMATCH\n";
+                ok = false;
+            }
+            ++placements;
+            finesse += n - 1;
+            legacy += m - 1;
+            worst = std::max(worst, n - 1);
+        });
+        std::cout << PIECE_NAMES[piece] << ": " << placements << " placements, " << (double)finesse / placements
+                  << " keys avg (rotate-then-shift " << (double)legacy / placements << "), worst " << worst << "\n";
+    }
+
+    // greedy games, typed both ways
+    long long pieces = 0, diverged = 0;
+    size_t finesseBytes = 0, legacyBytes = 0;
+    long long finesseInputs = 0, legacyInputsTotal = 0;
+    FinesseCounter finesseFaults, legacyFaults;
+    double planSeconds = 0.0;
+    long long plans = 0;
+    for (int n = 0; n < games; ++n) {
+        Typed a, b;
+        a.start(seed + (unsigned)n);
+        b.start(seed + (unsigned)n);
+        for (int p = 0; p < maxPieces && !a.g.gameOver; ++p) {
+            BitBoard bb;
+            toBitBoard(a.g.board, bb);
+            Placement best{0, a.g.currentPos.x};
+            int bestScore = INT_MIN;
+            forEachPlacement(bb, a.g.currentPieceIndex, [&](const Placement& pl, const BitBoard& after, int lines) {
+                int s = evaluateBoard(after, lines);
+                if (s > bestScore) { bestScore = s; best = pl; }
+            });
+            auto p0 = std::chrono::steady_clock::now();
+            int k = placementInputs(a.g, best.rotation, best.x, keys);
+            planSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - p0).count();
+            ++plans;
+            a.type(keys, k);
+            k = legacyInputs(b.g, best, keys);
+            b.type(keys, k);
+            ++pieces;
+            if (hashGame(a.g) != hashGame(b.g)) { ++diverged; break; }
+        }
+        a.replay.finish(a.tick);
+        b.replay.finish(b.tick);
+        finesseBytes += a.replay.bytes().size();
+        legacyBytes += b.replay.bytes().size();
+        finesseInputs += a.inputs;
+        legacyInputsTotal += b.inputs;
+        finesseFaults.merge(a.finesse);
+        legacyFaults.merge(b.finesse);
+    }
+    std::cout << "tables built in " << buildMs << " ms, placementInputs " << planSeconds / std::max(1LL, plans) * 1e9 << " ns\n"
+              << games << " greedy games, " << pieces << " pieces: " << (double)finesseInputs / pieces << " inputs per piece ("
+              << (double)legacyInputsTotal / pieces << " rotate-then-shift), replays " << (double)finesseBytes / pieces
+              << " bytes per piece (" << (double)legacyBytes / pieces << ")"
+              << (diverged ? ", GAMES DIVERGED\n" : ", same games\n")
+              << "finesse faults: " << finesseFaults.faults << " of " << finesseFaults.pieces << " pieces (rotate-then-shift "
+              << legacyFaults.faults << ")\n";
+    return ok && !diverged ? 0 : 1;
+}
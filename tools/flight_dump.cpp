@@ -0,0 +1,147 @@
+// flight_dump.cpp
+// Prints a flight recorder file (flight_recorder.h): the records in order with their
+// time before the dump, then a summary of frame times, GPU passes and events. --last
+// keeps only the final seconds; --summary skips the timeline.
+//
+//   flight_dump FILE [--last SECONDS] [--summary]
+
+#include "flight_recorder.h"
+#include "replay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct FlightEntry {
+    uint64_t index = 0, time = 0;
+    uint16_t kind = 0, a = 0;
+    uint32_t frame = 0, b = 0, c = 0;
+};
+
+inline uint64_t getU64(const uint8_t* p) { return getU32(p) | (uint64_t)getU32(p + 4) << 32; }
+
+const char* actionName(int a) {
+    static const char* names[] = {"left", "right", "soft drop", "rotate", "hard drop", "gravity", "garbage"};
+    return a >= 0 && a < (int)(sizeof(names) / sizeof(names[0])) ? names[a] : "?";
+}
+
+std::string describe(const FlightEntry& e) {
+    char s[160];
+    switch (e.kind) {
+    case FLIGHT_FRAME: std::snprintf(s, sizeof(s), "frame    %.2f ms (cpu %.2f ms)", e.b / 1000.0, e.c / 1000.0); break;
+    case FLIGHT_TICK: std::snprintf(s, sizeof(s), "tick     %u (piece %u)", e.b, e.c); break;
+    case FLIGHT_INPUT: std::snprintf(s, sizeof(s), "input    %s at tick %u", actionName(e.a), e.b); break;
+    case FLIGHT_GPU: std::snprintf(s, sizeof(s), "gpu      %s %.3f ms (frame %u)", flightGpuPassName(e.a), e.b / 1e6, e.c); break;
+    case FLIGHT_EVENT:
+        switch (e.a) {
+        case FLIGHT_EV_START: std::snprintf(s, sizeof(s), "event    game start, seed %u", e.b); break;
+        case FLIGHT_EV_LINES: std::snprintf(s, sizeof(s), "event    %u lines at tick %u", e.b, e.c); break;
+        case FLIGHT_EV_GAME_OVER: std::snprintf(s, sizeof(s), "event    game over at tick %u", e.b); break;
+        case FLIGHT_EV_HITCH: std::snprintf(s, sizeof(s), "event    HITCH %.2f ms", e.b / 1000.0); break;
+        case FLIGHT_EV_DESYNC: std::snprintf(s, sizeof(s), "event    netplay desync at tick %u", e.b); break;
+        default: std::snprintf(s, sizeof(s), "event    %u (%u, %u)", e.a, e.b, e.c);
+        }
+        break;
+    default: std::snprintf(s, sizeof(s), "kind %u (%u, %u, %u)", e.kind, e.a, e.b, e.c);
+    }
+    return s;
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    double last = 0;
+    bool summaryOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--last" && i + 1 < argc) last = std::atof(argv[++i]);
+        else if (a == "--summary") summaryOnly = true;
+        else if (path.empty() && a[0] != '-') path = a;
+        else { std::cerr << "usage: flight_dump FILE [--last SECONDS] [--summary]\n"; return 1; }
+    }
+    if (path.empty()) { std::cerr << "usage: flight_dump FILE [--last SECONDS] [--summary]\n"; return 1; }
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (file.size() < FLIGHT_HEADER_SIZE || std::memcmp(file.data(), "TFLT", 4) != 0 || getU16(file.data() + 4) != FLIGHT_VERSION) {
+        std::cerr << path << ": not a flight recorder file\n";
+        return 1;
+    }
+    const uint8_t* h = file.data();
+    size_t slotBytes = getU16(h + 6);
+    uint32_t capacity = getU32(h + 8), reason = getU32(h + 12), detail = getU32(h + 16), pid = getU32(h + 20);
+    uint64_t head = getU64(h + 24);
+    if (slotBytes != sizeof(FlightSlot) || file.size() != FLIGHT_HEADER_SIZE + (size_t)capacity * slotBytes) {
+        std::cerr << path << ": truncated or from another build\n";
+        return 1;
+    }
+
+    std::vector<FlightEntry> entries;
+    size_t torn = 0;
+    for (uint32_t i = 0; i < capacity; ++i) {
+        const uint8_t* s = h + FLIGHT_HEADER_SIZE + (size_t)i * slotBytes;
+        uint64_t seq = getU64(s);
+        if (seq == 0) continue;
+        if ((seq & 1) || (seq / 2 - 1) % capacity != i) { ++torn; continue; }
+        FlightEntry e;
+        e.index = seq / 2 - 1;
+        e.time = getU64(s + 8);
+        e.kind = getU16(s + 16);
+        e.a = getU16(s + 18);
+        e.frame = getU32(s + 20);
+        e.b = getU32(s + 24);
+        e.c = getU32(s + 28);
+        entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(), [](const FlightEntry& x, const FlightEntry& y) { return x.index < y.index; });
+    static const char* reasons[] = {"?", "request", "hitch", "crash"};
+    std::cout << path << ": " << reasons[reason <= FLIGHT_DUMP_CRASH ? reason : 0];
+    if (reason == FLIGHT_DUMP_CRASH) std::cout << " (signal " << detail << ")";
+    if (reason == FLIGHT_DUMP_HITCH) std::cout << " (" << detail / 1000.0 << " ms frame)";
+    std::cout << ", pid " << pid << ", " << entries.size() << " records of " << head << " written";
+    if (torn) std::cout << ", " << torn << " being written at the dump";
+    std::cout << "\n";
+    if (entries.empty()) return 0;
+
+    uint64_t end = entries.back().time;
+    if (last > 0) {
+        uint64_t from = end > (uint64_t)(last * 1e9) ? end - (uint64_t)(last * 1e9) : 0;
+        entries.erase(entries.begin(), std::find_if(entries.begin(), entries.end(), [&](const FlightEntry& e) { return e.time >= from; }));
+    }
+    std::cout << "covers " << (end - entries.front().time) / 1e9 << " s\n";
+
+    if (!summaryOnly) {
+        for (const FlightEntry& e : entries) {
+            char t[48];
+            std::snprintf(t, sizeof(t), "%10.4f s  #%-7u ", -(double)(end - e.time) / 1e9, e.frame);
+            std::cout << t << describe(e) << "\n";
+        }
+    }
+
+    // summary
+    std::vector<uint32_t> frames;
+    double gpuSum[GPU_PASS_COUNT] = {}, gpuMax[GPU_PASS_COUNT] = {};
+    int gpuCount[GPU_PASS_COUNT] = {};
+    int inputs = 0, ticks = 0, hitches = 0;
+    for (const FlightEntry& e : entries) {
+        if (e.kind == FLIGHT_FRAME) frames.push_back(e.b);
+        else if (e.kind == FLIGHT_GPU && e.a < GPU_PASS_COUNT) { gpuSum[e.a] += e.b / 1e6; gpuMax[e.a] = std::max(gpuMax[e.a], e.b / 1e6); ++gpuCount[e.a]; }
+        else if (e.kind == FLIGHT_INPUT) ++inputs;
+        else if (e.kind == FLIGHT_TICK) ++ticks;
+        else if (e.kind == FLIGHT_EVENT && e.a == FLIGHT_EV_HITCH) ++hitches;
+    }
+    std::cout << inputs << " inputs, " << ticks << " ticks, " << frames.size() << " frames, " << hitches << " hitches\n";
+    if (!frames.empty()) {
+        std::vector<uint32_t> sorted = frames;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (uint32_t f : frames) sum += f;
+        std::printf("frame ms: avg %.2f, median %.2f, p99 %.2f, worst %.2f\n", sum / frames.size() / 1000.0,
+                    sorted[sorted.size() / 2] / 1000.0, sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] / 1000.0, sorted.back() / 1000.0);
+    }
+    for (int p = 0; p < GPU_PASS_COUNT; ++p)
+        if (gpuCount[p]) std::printf("gpu %-9s avg %.3f ms, worst %.3f ms\n", flightGpuPassName(p), gpuSum[p] / gpuCount[p], gpuMax[p]);
+    return 0;
+}
@@ -0,0 +1,178 @@
+// live_inspect.cpp
+// Reader for the live state segment (live_state.h) that the game publishes with
+// --live: prints the board, the falling piece and the frame stats a few times a
+// second, or once. --demo publishes a greedy bot game into the segment instead, for
+// working on readers without the game; --bench measures both ends of the seqlock
+// with a writer thread publishing flat out.
+//
+//   live_inspect [--name /tetris_live] [--hz N] [--once]
+//   live_inspect --demo [--name /tetris_live] [--seed N] [--drop FRAMES] [--seconds S]
+//   live_inspect --bench [--seconds S]
+
+#include "bot_eval.h"
+#include "live_state.h"
+
+#include <signal.h>
+
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static const char PIECE_NAMES[] = "IOTSZJL";
+
+volatile sig_atomic_t stopRequested = 0;
+
+void printSnapshot(const LiveSnapshot& s, uint32_t pid) {
+    char cells[BOARD_H][BOARD_W];
+    for (int y = 0; y < BOARD_H; ++y)
+        for (int x = 0; x < BOARD_W; ++x) cells[y][x] = (s.rows[y] >> x) & 1 ? '#' : '.';
+    if (!(s.flags & LIVE_GAME_OVER) && s.piece >= 0 && s.piece < PIECE_COUNT) {
+        PieceBlocks p = rotatedBlocks(s.piece, s.rotation);
+        for (int i = 0; i < p.n; ++i) {
+            int x = s.x + p.b[i].x, y = s.y + p.b[i].y;
+            if (x >= 0 && x < BOARD_W && y >= 0 && y < BOARD_H) cells[y][x] = '@';
+        }
+    }
+    std::string out;
+    for (int y = 0; y < BOARD_H; ++y) {
+        out += "  |";
+        out.append(cells[y], BOARD_W);
+        out += "|";
+        if (y == 0) out += "  writer pid " + std::to_string(pid);
+        if (y == 1) out += "  frame " + std::to_string(s.frame) + ", tick " + std::to_string(s.tick);
+        if (y == 3 && s.piece >= 0 && s.piece < PIECE_COUNT) out += "  piece " + std::string(1, PIECE_NAMES[s.piece]) + " rot " + std::to_string(s.rotation) + " at " + std::to_string(s.x) + "," + std::to_string(s.y);
+        if (y == 4 && s.next >= 0 && s.next < PIECE_COUNT) out += "  next " + std::string(1, PIECE_NAMES[s.next]);
+        if (y == 5) out += "  pieces " + std::to_string(s.pieceSerial);
+        if (y == 6) out += "  gravity " + std::to_string(s.gravityTimer) + "/" + std::to_string(s.gravityTicks) + " ticks";
+        if (y == 8) out += "  frame " + std::to_string(s.frameUs) + " us, avg " + std::to_string(s.frameAvgUs) + " us, worst " + std::to_string(s.frameWorstUs) + " us";
+        if (y == 9 && s.frameAvgUs) out += "  " + std::to_string(1000000 / s.frameAvgUs) + " fps";
+        if (y == 10) out += "  publish " + std::to_string(s.publishNs) + " ns";
+        if (y == 12) {
+            if (s.flags & LIVE_GAME_OVER) out += "  GAME OVER";
+            if (s.flags & LIVE_VERSUS) out += "  versus";
+            if (s.flags & LIVE_CASCADE) out += "  cascade";
+            if (s.flags & LIVE_PLAYBACK) out += "  playback";
+        }
+        out += "\n";
+    }
+    out += "  +" + std::string(BOARD_W, '-') + "+\n";
+    std::cout << out << std::flush;
+}
+
+// Greedy bot game, one placement every dropFrames frames at 60 Hz.
+int runDemo(const std::string& name, unsigned seed, int dropFrames, double seconds) {
+    LivePublisher pub;
+    if (!pub.open(name)) {
+        if (errno == EEXIST) std::cerr << "Something else is publishing live state to " << name << "\n";
+        else std::cerr << "Failed to open shared memory " << name << "\n";
+        return 1;
+    }
+    std::cout << "Publishing a bot game to " << name << "\n";
+    GameState g;
+    resetGame(g, seed);
+    auto start = std::chrono::steady_clock::now(), last = start;
+    for (uint32_t frame = 1; !stopRequested; ++frame) {
+        auto now = std::chrono::steady_clock::now();
+        if (seconds > 0 && std::chrono::duration<double>(now - start).count() >= seconds) break;
+        if (frame % (uint32_t)dropFrames == 0) {
+            if (g.gameOver) resetGame(g, ++seed);
+            else {
+                BitBoard bb;
+                toBitBoard(g.board, bb);
+                Placement best{0, g.currentPos.x};
+                int bestScore = INT_MIN;
+                forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int lines) {
+                    int s = evaluateBoard(after, lines);
+                    if (s > bestScore) { bestScore = s; best = p; }
+                });
+                applyPlacement(g, best);
+            }
+        }
+        pub.publish(g, frame, std::chrono::duration<float>(now - last).count(), 0);
+        last = now;
+        std::this_thread::sleep_until(start + std::chrono::microseconds(16667LL * frame));
+    }
+    return 0;
+}
+
+// A writer thread publishes back to back while this thread reads back to back.
+int runBench(double seconds) {
+    const std::string name = "/tetris_live_bench." + std::to_string(getpid());
+    LivePublisher pub;
+    LiveReader rd;
+    if (!pub.open(name) || !rd.open(name)) { std::cerr << "Failed to open shared memory " << name << "\n"; return 1; }
+    GameState g;
+    resetGame(g, 1);
+    std::atomic<bool> done{false};
+    long long published = 0;
+    std::thread writer([&] {
+        while (!done.load(std::memory_order_relaxed)) { pub.publish(g, (uint32_t)published, 0.0167f, 0); ++published; }
+    });
+    long long reads = 0, failed = 0, torn = 0;
+    LiveSnapshot s;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while ((elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()) < seconds) {
+        if (!rd.read(s)) { ++failed; continue; }
+        if (s.frame == 0) continue;       // the writer thread has not started yet
+        ++reads;
+        // every copy must be one publish: the tick and the frame counter move together
+        torn += s.frame != (uint64_t)s.tick + 1;
+    }
+    done = true;
+    writer.join();
+    std::cout << "publish " << elapsed * 1e9 / std::max(1LL, published) << " ns, read " << elapsed * 1e9 / std::max(1LL, reads)
+              << " ns, " << rd.retries << " retries, " << failed << " failed reads, " << torn << " torn snapshots\n";
+    return torn == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::string name = LIVE_DEFAULT_NAME;
+    double hz = 10, seconds = 0;
+    bool once = false, demo = false, bench = false;
+    unsigned seed = 1;
+    int dropFrames = 15;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--name" && i + 1 < argc) name = argv[++i];
+        else if (a == "--hz" && i + 1 < argc) hz = std::atof(argv[++i]);
+        else if (a == "--once") once = true;
+        else if (a == "--demo") demo = true;
+        else if (a == "--bench") bench = true;
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else if (a == "--drop" && i + 1 < argc) dropFrames = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else {
+            std::cerr << "usage: live_inspect [--name /tetris_live] [--hz N] [--once]\n"
+                         "       live_inspect --demo [--name /tetris_live] [--seed N] [--drop FRAMES] [--seconds S]\n"
+                         "       live_inspect --bench [--seconds S]\n";
+            return 1;
+        }
+    }
+    initPieces();
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGTERM, [](int) { stopRequested = 1; });
+    if (bench) return runBench(seconds > 0 ? seconds : 2.0);
+    if (demo) return runDemo(name, seed, dropFrames, seconds);
+
+    LiveReader rd;
+    if (!rd.open(name)) { std::cerr << "No live state at " << name << " (start the game with --live)\n"; return 1; }
+    LiveSnapshot s;
+    uint64_t lastFrame = 0;
+    int stale = 0;
+    auto period = std::chrono::duration<double>(1.0 / std::max(0.1, hz));
+    while (!stopRequested) {
+        if (!rd.read(s)) { std::cerr << "The writer never let go of the segment\n"; return 1; }
+        if (!once) std::cout << "\x1b[H\x1b[2J";
+        printSnapshot(s, rd.writerPid());
+        if (once) break;
+        // the writer unlinks the segment when it exits, but a crash leaves it behind
+        stale = s.frame == lastFrame ? stale + 1 : 0;
+        if (stale * period.count() >= 2.0) std::cout << "  (no new frames for " << (int)(stale * period.count()) << " s)\n";
+        lastFrame = s.frame;
+        std::this_thread::sleep_for(period);
+    }
+    return 0;
+}
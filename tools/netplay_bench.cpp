@@ -0,0 +1,127 @@
+// netplay_bench.cpp
+// Plays two rollback sessions (rollback.h) against each other in one process over
+// loopback UDP, with a relay socket between them that delays, jitters and drops
+// packets. Time is simulated, so a minute of play runs in well under a second.
+// Reports rollback depth and re-simulation cost, and fails if the peers desync.
+//
+//   netplay_bench [--frames N] [--latency MS] [--jitter MS] [--loss PERCENT] [--seed S]
+
+#include "rollback.h"
+
+#include <deque>
+#include <iostream>
+#include <random>
+
+// Forwards datagrams between the joiner and the host after a simulated delay.
+struct Relay {
+    int fd = -1;
+    sockaddr_in host{}, client{};
+    bool haveClient = false;
+    struct Packet { double at; bool toHost; std::vector<uint8_t> data; };
+    std::deque<Packet> queue;
+    double latency = 0.0, jitter = 0.0, loss = 0.0;
+    std::mt19937 rng{7};
+
+    bool open(uint16_t hostPort) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        host = addr;
+        host.sin_port = htons(hostPort);
+        return true;
+    }
+    uint16_t port() const {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        getsockname(fd, (sockaddr*)&addr, &len);
+        return ntohs(addr.sin_port);
+    }
+
+    void pump(double now) {
+        uint8_t buf[512];
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        for (;;) {
+            sockaddr_in from{};
+            socklen_t len = sizeof(from);
+            ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &len);
+            if (n < 0) break;
+            bool toHost = from.sin_port != host.sin_port;
+            if (toHost && !haveClient) { client = from; haveClient = true; }
+            if (u(rng) < loss) continue;
+            double at = now + latency + jitter * u(rng);
+            // UDP may reorder; keep the queue sorted by delivery time so jitter does too
+            auto it = queue.end();
+            while (it != queue.begin() && (it - 1)->at > at) --it;
+            queue.insert(it, Packet{at, toHost, std::vector<uint8_t>(buf, buf + n)});
+        }
+        while (!queue.empty() && queue.front().at <= now) {
+            const Packet& p = queue.front();
+            const sockaddr_in& to = p.toHost ? host : client;
+            sendto(fd, p.data.data(), p.data.size(), 0, (const sockaddr*)&to, sizeof(to));
+            queue.pop_front();
+        }
+    }
+};
+
+// Random presses: mostly moves and rotations, now and then a drop.
+uint8_t randomInput(std::mt19937& rng) {
+    static const GameAction weighted[] = {ACT_LEFT, ACT_LEFT, ACT_RIGHT, ACT_RIGHT, ACT_ROTATE, ACT_ROTATE, ACT_SOFT_DROP, ACT_HARD_DROP};
+    if (rng() % 6) return 0;
+    return netInputBit(weighted[rng() % 8]);
+}
+
+void printStats(const char* name, const RollbackSession& s) {
+    const RollbackStats& st = s.stats();
+    std::cout << name << ": tick " << s.state().tick << ", " << st.rollbacks << " rollbacks (avg "
+              << (st.rollbacks ? (double)st.resimTicks / st.rollbacks : 0.0) << ", max " << st.maxRollback << " ticks, slowest "
+              << st.maxResimMs << " ms), " << st.stalls << " stalls, " << st.checksumsMatched << " checksums matched"
+              << (s.state().over ? ", game over" : "") << "\n";
+}
+
+int main(int argc, char** argv) {
+    int frames = 60 * 60;
+    double latencyMs = 40.0, jitterMs = 20.0, lossPercent = 2.0;
+    uint32_t seed = 1234;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--frames" && i + 1 < argc) frames = std::atoi(argv[++i]);
+        else if (a == "--latency" && i + 1 < argc) latencyMs = std::atof(argv[++i]);
+        else if (a == "--jitter" && i + 1 < argc) jitterMs = std::atof(argv[++i]);
+        else if (a == "--loss" && i + 1 < argc) lossPercent = std::atof(argv[++i]);
+        else if (a == "--seed" && i + 1 < argc) seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else { std::cerr << "usage: netplay_bench [--frames N] [--latency MS] [--jitter MS] [--loss PERCENT] [--seed S]\n"; return 1; }
+    }
+    initPieces();
+
+    RollbackSession a, b;
+    Relay relay;
+    relay.latency = latencyMs / 1000.0; relay.jitter = jitterMs / 1000.0; relay.loss = lossPercent / 100.0;
+    if (!a.host(0, seed) || !relay.open(a.port()) || !b.join("127.0.0.1", relay.port())) { std::cerr << "cannot open loopback sockets\n"; return 1; }
+
+    // two players mashing keys for the given frames, then a quiet second so everything confirms;
+    // a quarter in, time the deepest rollback the session allows, back to back
+    std::mt19937 rng(seed);
+    const double dt = 1.0 / 60.0;
+    const int reps = 2000;
+    double total = 0.0, worst = 0.0;
+    for (int f = 0; f < frames + 60; ++f) {
+        bool playing = f < frames;
+        if (f == frames / 4)
+            for (int i = 0; i < reps; ++i) { double s = a.benchmarkRollback(NET_MAX_ROLLBACK); total += s; worst = std::max(worst, s); }
+        relay.pump(f * dt);
+        a.update(dt, playing ? randomInput(rng) : 0);
+        relay.pump(f * dt);
+        b.update(dt, playing ? randomInput(rng) : 0);
+        if (a.desynced() || b.desynced()) break;
+    }
+    printStats("host", a);
+    printStats("join", b);
+    if (!a.connected() || !b.connected()) { std::cerr << "peers never connected\n"; return 1; }
+    if (a.desynced() || b.desynced() || !a.stats().checksumsMatched) { std::cerr << "DESYNC\n"; return 1; }
+
+    std::cout << "rollback of " << NET_MAX_ROLLBACK << " ticks: avg " << total / reps * 1e6 << " us, worst " << worst * 1e6 << " us\n";
+    return 0;
+}
@@ -0,0 +1,117 @@
+// nn_bench.cpp
+// Learned evaluator check and benchmark (nn_eval.h). Collects the move lists of seeded
+// greedy games, checks the kernel this CPU runs (one board and batched) against the
+// scalar reference on every board (with the loaded net and with random-weight nets),
+// then times batched scoring against the heuristic and reports how often both pick
+// the same placement.
+// --save writes the heuristic-equivalent net, a starting point for training.
+//
+//   nn_bench [--net file] [--save file] [--positions N] [--seed S]
+
+#include "bot_eval.h"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    std::string netPath, savePath;
+    int positions = 2000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--net" && i + 1 < argc) netPath = argv[++i];
+        else if (a == "--save" && i + 1 < argc) savePath = argv[++i];
+        else if (a == "--positions" && i + 1 < argc) positions = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else { std::cerr << "usage: nn_bench [--net file] [--save file] [--positions N] [--seed S]\n"; return 1; }
+    }
+    initPieces();
+
+    NnEval net = heuristicNnEval();
+    if (!netPath.empty() && !loadNnEval(netPath, net)) { std::cerr << "cannot load " << netPath << "\n"; return 1; }
+    if (!savePath.empty()) {
+        if (!saveNnEval(savePath, net)) { std::cerr << "cannot write " << savePath << "\n"; return 1; }
+        std::cout << "wrote " << savePath << "\n";
+    }
+
+    // move lists of greedy games: one position = every placement of the piece
+    std::vector<BitBoard> boards;
+    std::vector<int> lines, starts;
+    GameState g;
+    resetGame(g, seed);
+    for (int n = 0; n < positions; ++n) {
+        if (g.gameOver) resetGame(g, seed + (unsigned)n);
+        BitBoard bb;
+        toBitBoard(g.board, bb);
+        starts.push_back((int)boards.size());
+        Placement best{0, g.currentPos.x};
+        int bestScore = INT_MIN;
+        forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int cleared) {
+            boards.push_back(after);
+            lines.push_back(cleared);
+            int s = evaluateBoard(after, cleared);
+            if (s > bestScore) { bestScore = s; best = p; }
+        });
+        applyPlacement(g, best);
+    }
+    starts.push_back((int)boards.size());
+    const int count = (int)boards.size();
+
+    // kernel vs reference, on this net and on random ones
+    long long mismatches = 0;
+    PieceRng rng;
+    rng.seed(seed, 7);
+    alignas(32) uint8_t x[NN_INPUTS];
+    for (int trial = 0; trial < 5; ++trial) {
+        NnEval r = net;
+        if (trial > 0) {
+            for (auto& row : r.w1) for (auto& w : row) w = (int8_t)rng();
+            for (auto& row : r.w2) for (auto& w : row) w = (int8_t)rng();
+            for (auto& w : r.w3) w = (int8_t)rng();
+            for (int j = 0; j < NN_HIDDEN; ++j) { r.b1[j] = (int32_t)(rng() % 8192) - 4096; r.b2[j] = (int32_t)(rng() % 8192) - 4096; }
+            r.shift1 = 4 + (int)(rng() % 6);
+            r.shift2 = 4 + (int)(rng() % 6);
+        }
+        std::vector<int> batched((size_t)count);
+        nnEvaluateBoards(r, boards.data(), lines.data(), count, batched.data());
+        BoardFeatures f;
+        for (int i = 0; i < count; ++i) {
+            extractFeatures(boards[(size_t)i], f);
+            nnInputs(f, lines[(size_t)i], x);
+            int ref = nnForwardScalar(r, x);
+            if (nnForward(r, x) != ref || batched[(size_t)i] != ref) ++mismatches;
+        }
+    }
+
+    // timing: whole move lists, as the bot scores them
+    std::vector<int> heur((size_t)count), nn((size_t)count);
+    auto time = [&](auto&& score) {
+        double best = 1e30;
+        for (int rep = 0; rep < 5; ++rep) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int p = 0; p + 1 < (int)starts.size(); ++p) score(starts[(size_t)p], starts[(size_t)p + 1] - starts[(size_t)p]);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        }
+        return best;
+    };
+    double heurSeconds = time([&](int s, int n) { evaluateBoards(&boards[(size_t)s], &lines[(size_t)s], n, &heur[(size_t)s]); });
+    double nnSeconds = time([&](int s, int n) { nnEvaluateBoards(net, &boards[(size_t)s], &lines[(size_t)s], n, &nn[(size_t)s]); });
+
+    int agree = 0;
+    for (int p = 0; p + 1 < (int)starts.size(); ++p) {
+        int a = starts[(size_t)p], b = a;
+        for (int i = starts[(size_t)p]; i < starts[(size_t)p + 1]; ++i) {
+            if (heur[(size_t)i] > heur[(size_t)a]) a = i;
+            if (nn[(size_t)i] > nn[(size_t)b]) b = i;
+        }
+        agree += a == b;
+    }
+
+    std::cout << "kernel " << nnKernelName() << ", " << positions << " positions, " << count << " boards ("
+              << (double)count / positions << " per move list)\n"
+              << "kernel vs scalar: " << mismatches << " mismatches in " << 5LL * count << " forward passes\n"
+              << "heuristic " << heurSeconds / count * 1e9 << " ns/board, network " << nnSeconds / count * 1e9
+              << " ns/board (" << nnSeconds / count * 256 * 1e6 << " us per 256 boards)\n"
+              << "same best placement as the heuristic: " << agree << "/" << positions << "\n";
+    return mismatches ? 1 : 0;
+}
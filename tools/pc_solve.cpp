@@ -0,0 +1,101 @@
+// pc_solve.cpp
+// Perfect-clear solver front end. Solves one position given on the command line,
+// or with --bench solves random queues on an empty board and reports the timing.
+//
+//   pc_solve [--board ROWS] [--queue IOTSZJL] [--hold P] [--no-hold] [--height N] [--threads N]
+//   pc_solve --bench N [--pieces N] [--seed S] [--threads N]
+//
+// ROWS are bottom rows of the board, top first, separated by '/': "#.....####/##....####".
+
+#include "pc_solver.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+
+static const char PIECE_NAMES[] = "IOTSZJL";
+
+int pieceFromName(char c) {
+    for (int i = 0; i < PIECE_COUNT; ++i) if (PIECE_NAMES[i] == toupper(c)) return i;
+    return -1;
+}
+
+bool parseBoard(const std::string& s, BitBoard& bb) {
+    std::vector<std::string> rows;
+    std::stringstream ss(s);
+    for (std::string r; std::getline(ss, r, '/');) rows.push_back(r);
+    if ((int)rows.size() > BOARD_H) return false;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if ((int)rows[i].size() != BOARD_W) return false;
+        int y = BOARD_H - (int)rows.size() + (int)i;
+        for (int x = 0; x < BOARD_W; ++x) if (rows[i][x] != '.') bb.rows[y] |= (uint16_t)(1u << x);
+    }
+    return true;
+}
+
+void printSolution(const PcResult& r) {
+    if (!r.found) { std::cout << "no perfect clear (" << r.nodes << " nodes, " << r.seconds * 1000.0 << " ms)\n"; return; }
+    std::cout << r.height << "-line perfect clear in " << r.moves.size() << " pieces (" << r.nodes << " nodes, "
+              << r.seconds * 1000.0 << " ms)\n";
+    for (const auto& m : r.moves)
+        std::cout << "  " << (m.hold ? "hold, " : "") << PIECE_NAMES[m.piece] << " rotate " << m.placement.rotation
+                  << " column " << m.placement.x << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::string board, queue;
+    int hold = -1, height = 4, threads = 0, bench = 0, pieces = 11;
+    bool allowHold = true;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--board" && i + 1 < argc) board = argv[++i];
+        else if (a == "--queue" && i + 1 < argc) queue = argv[++i];
+        else if (a == "--hold" && i + 1 < argc) hold = pieceFromName(argv[++i][0]);
+        else if (a == "--no-hold") allowHold = false;
+        else if (a == "--height" && i + 1 < argc) height = std::atoi(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (a == "--bench" && i + 1 < argc) bench = std::atoi(argv[++i]);
+        else if (a == "--pieces" && i + 1 < argc) pieces = std::atoi(argv[++i]);
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else { std::cerr << "unknown argument " << a << "\n"; return 1; }
+    }
+
+    jobThreads = threads;
+    initPieces();
+    PcSolver solver(threads);
+
+    if (bench > 0) {
+        PieceRng rng;
+        rng.seed(seed);
+        BitBoard empty{};
+        int solved = 0;
+        double total = 0.0, worst = 0.0;
+        long long nodes = 0;
+        for (int n = 0; n < bench; ++n) {
+            std::vector<int> q(pieces);
+            for (auto& p : q) p = randomPiece(rng);
+            PcResult r = solver.solve(empty, q, allowHold, -1, height);
+            solved += r.found;
+            total += r.seconds;
+            worst = std::max(worst, r.seconds);
+            nodes += r.nodes;
+        }
+        std::cout << bench << " queues of " << pieces << ", " << solver.threads() << " threads: " << solved << " solved, "
+                  << total * 1000.0 / bench << " ms avg, " << worst * 1000.0 << " ms worst, " << nodes / bench << " nodes avg\n";
+        return 0;
+    }
+
+    BitBoard bb{};
+    if (!parseBoard(board, bb)) { std::cerr << "bad --board (rows of " << BOARD_W << " cells, '/' separated)\n"; return 1; }
+    std::vector<int> q;
+    for (char c : queue) {
+        int p = pieceFromName(c);
+        if (p < 0) { std::cerr << "bad piece " << c << " in --queue\n"; return 1; }
+        q.push_back(p);
+    }
+    if (q.empty()) { std::cerr << "usage: pc_solve [--board ROWS] --queue IOTSZJL [--hold P] [--no-hold] [--height N] [--threads N]\n"; return 1; }
+    printSolution(solver.solve(bb, q, allowHold, hold, height));
+    return 0;
+}
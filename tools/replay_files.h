@@ -0,0 +1,66 @@
+// replay_files.h
+// Input handling shared by the replay tools: memory-mapped inputs and .trpl
+// collection from directories.
+
+#pragma once
+
+#include "replay.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+inline bool mapFile(const std::string& path, MappedFile& out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+    out.data = (const uint8_t*)p;
+    out.size = (size_t)st.st_size;
+    return true;
+}
+
+inline void collectInputs(const std::string& path, std::vector<std::string>& files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) { std::cerr << "cannot stat " << path << "\n"; return; }
+    if (!S_ISDIR(st.st_mode)) { files.push_back(path); return; }
+    DIR* d = opendir(path.c_str());
+    if (!d) return;
+    while (dirent* e = readdir(d)) {
+        std::string n = e->d_name;
+        if (n.size() > 5 && n.compare(n.size() - 5, 5, ".trpl") == 0) files.push_back(path + "/" + n);
+    }
+    closedir(d);
+}
+
+// Maps every file and splits it into records (files may be concatenated archives).
+// Returns the total mapped size; the maps stay valid until unmapped by the caller.
+inline size_t mapRecords(const std::vector<std::string>& files, std::vector<MappedFile>& maps, std::vector<ReplayView>& records) {
+    size_t bytes = 0;
+    for (const auto& path : files) {
+        MappedFile mf;
+        if (!mapFile(path, mf)) { std::cerr << "cannot map " << path << "\n"; continue; }
+        maps.push_back(mf);
+        bytes += mf.size;
+        size_t off = 0;
+        ReplayView r;
+        while (off < mf.size && parseReplay(mf.data + off, mf.size - off, r)) { records.push_back(r); off += r.size(); }
+        if (off != mf.size) std::cerr << path << ": stopped at byte " << off << " (bad or truncated record)\n";
+    }
+    return bytes;
+}
@@ -0,0 +1,79 @@
+// replay_stats.cpp
+// Map-reduce over replay archives: memory-maps every input, re-simulates each
+// record with the headless rules on all cores (jobs.h) and merges per-thread metrics.
+// Results go to stdout; metrics with a compact file form (heatmap.thmp) are
+// written to --out and can be shown in the game with --heatmap <file>.
+//
+// --job-stats prints how busy each thread was.
+//
+//   replay_stats [--threads N] [--metrics heatmap,clears,topout] [--out dir] [--job-stats] <file|dir>...
+
+#include "analytics.h"
+#include "jobs.h"
+#include "replay_files.h"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+int main(int argc, char** argv) {
+    int threads = (int)std::thread::hardware_concurrency();
+    std::string metricList = "heatmap,clears,topout", outDir = ".";
+    std::vector<std::string> files;
+    bool jobStats = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (a == "--job-stats") jobStats = true;
+        else if (a == "--metrics" && i + 1 < argc) metricList = argv[++i];
+        else if (a == "--out" && i + 1 < argc) outDir = argv[++i];
+        else collectInputs(a, files);
+    }
+    if (files.empty()) { std::cerr << "usage: replay_stats [--threads N] [--metrics a,b] [--out dir] [--job-stats] <file|dir>...\n"; return 1; }
+    jobThreads = std::max(1, threads);   // the main thread works too
+    JobSystem& js = jobSystem();
+    threads = js.threadCount();
+
+    initPieces();
+    registerBuiltinMetrics();
+    std::vector<const ReplayMetric*> selected;
+    std::stringstream ss(metricList);
+    for (std::string name; std::getline(ss, name, ',');) {
+        const ReplayMetric* m = findMetric(name);
+        if (!m) { std::cerr << "unknown metric " << name << "\n"; return 1; }
+        selected.push_back(m);
+    }
+
+    // map + index: only record headers are touched here
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<MappedFile> maps;
+    std::vector<ReplayView> records;
+    size_t bytes = mapRecords(files, maps, records);
+
+    // map: chunks of records go to whichever thread is free, each re-simulating into its
+    // own GameState and metrics
+    const int CHUNK = 64;
+    std::vector<MetricSet> sets(threads);
+    for (auto& s : sets) for (auto* m : selected) s.metrics.push_back(m->clone());
+    std::vector<GameState> states(threads);
+    js.parallelFor(0, (int)records.size(), CHUNK, [&](int i) {
+        int t = js.currentSlot();
+        simulateReplay(records[i], states[t], &sets[t]);
+    });
+
+    // reduce
+    for (int t = 1; t < threads; ++t)
+        for (size_t m = 0; m < selected.size(); ++m) sets[0].metrics[m]->merge(*sets[t].metrics[m]);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::cout << records.size() << " replays, " << bytes / (1024.0 * 1024.0) << " MB in " << secs << " s ("
+              << (secs > 0 ? records.size() / secs : 0) << " replays/s, " << (secs > 0 ? bytes / (1024.0 * 1024.0) / secs : 0)
+              << " MB/s, " << threads << " threads)\n";
+    for (auto& m : sets[0].metrics) {
+        m->report(std::cout);
+        if (!m->save(outDir)) std::cerr << "cannot write " << m->name() << " results to " << outDir << "\n";
+    }
+    for (auto& mf : maps) munmap((void*)mf.data, mf.size);
+    if (jobStats) js.report(std::cout);
+    return 0;
+}
@@ -0,0 +1,355 @@
+// replay_verifier.cpp
+// Headless leaderboard verifier (verify.h). Takes submissions (.tsub: claim + replay)
+// from a spool directory or a Unix socket, re-simulates them on the job system and
+// writes one signed verdict line per submission.
+//
+//   --spool DIR     picks up DIR/*.tsub, appends verdicts to --out, then deletes the
+//                   files; keeps watching unless --once
+//   --socket PATH   clients write submissions back to back and read one verdict line
+//                   per submission on the same connection (also logged to --out)
+//   --send PATH     client: sends .tsub files to a verifier socket, prints the verdicts
+//   --samples DIR   writes --count bot games as .tsub files, some with false claims
+//   --bench         verifies --count generated submissions in memory and reports the rate
+//   --check         reads verdict lines on stdin and checks their signatures
+//
+//   replay_verifier --key FILE (--spool DIR [--once] | --socket PATH | --bench | --check)
+//                   [--threads N] [--queue N] [--max-bytes N] [--out FILE]
+//   replay_verifier --send PATH FILE...
+//   replay_verifier --samples DIR [--count N] [--seed S]
+
+#include "bot_eval.h"
+#include "verify.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+// --------------------------- SAMPLE SUBMISSIONS ----------------------------
+// A greedy bot game typed one input every 4 ticks under default gravity, recorded
+// the way the game records it. Every fourth claim is off by a line, every seventh
+// replay has a byte flipped; the rest are honest.
+std::vector<uint8_t> sampleSubmission(int n, unsigned seed) {
+    GameState g;
+    resetGame(g, seed);
+    ReplayWriter w;
+    w.start("", seed, gravityTicksFor(g));
+    uint32_t tick = 0;
+    ReplayClaim claim;
+    int pieces = 50 + (int)(seed * 2654435761u % 400);
+    GameAction keys[PLACEMENT_MAX_INPUTS];
+    for (int p = 0; p < pieces && !g.gameOver; ++p) {
+        BitBoard bb;
+        toBitBoard(g.board, bb);
+        Placement best{0, g.currentPos.x};
+        int bestScore = INT_MIN;
+        forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& pl, const BitBoard& after, int lines) {
+            int s = evaluateBoard(after, lines);
+            if (s > bestScore) { bestScore = s; best = pl; }
+        });
+        int k = placementInputs(g, best.rotation, best.x, keys);
+        for (int i = 0; i < k && !g.gameOver; ++i) {
+            for (int t = 0; t < 4; ++t) if (++tick % g.gravityTicks == 0) {
+                unsigned serial = g.pieceSerial;
+                int lines = applyAction(g, ACT_GRAVITY);
+                if (g.pieceSerial != serial) { claim.lines += (uint32_t)lines; claim.score += clearScore(lines); }
+            }
+            if (g.gameOver) break;
+            w.add(tick, keys[i]);
+            unsigned serial = g.pieceSerial;
+            int lines = applyAction(g, keys[i]);
+            if (g.pieceSerial != serial) { claim.lines += (uint32_t)lines; claim.score += clearScore(lines); }
+        }
+    }
+    w.finish(tick);
+    std::vector<uint8_t> replay = w.bytes();
+    if (n % 4 == 3) ++claim.lines;
+    if (n % 7 == 6) replay[REPLAY_HEADER_SIZE + replay.size() / 2 % (replay.size() - REPLAY_HEADER_SIZE)] ^= 0x5a;
+    std::vector<uint8_t> out;
+    putSubmission(out, "sample-" + std::to_string(n), claim, replay.data(), replay.size());
+    return out;
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& out, size_t limit) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    out.clear();
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0 && out.size() <= limit) out.insert(out.end(), buf, buf + n);
+    std::fclose(f);
+    return out.size() <= limit;
+}
+
+bool writeAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        p += k; n -= (size_t)k;
+    }
+    return true;
+}
+
+// --------------------------- SPOOL ----------------------------
+// One pass over the spool: every submission is queued (blocking while the queue is
+// full), the verdicts are flushed, and only then are the files removed.
+size_t spoolPass(const std::string& dir, VerifyService& service, size_t maxFile, std::ostream& log) {
+    std::vector<std::string> names;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            std::string n = e->d_name;
+            if (n.size() > 5 && n.compare(n.size() - 5, 5, ".tsub") == 0) names.push_back(n);
+        }
+        closedir(d);
+    }
+    std::vector<uint8_t> file;
+    size_t jobs = 0;
+    for (const std::string& n : names) {
+        std::string path = dir + "/" + n;
+        if (!readFile(path, file, maxFile)) { log << n << " unreadable or over " << maxFile << " bytes, skipped\n"; continue; }
+        size_t off = 0;
+        SubmissionView s;
+        while (off < file.size() && parseSubmission(file.data() + off, file.size() - off, maxFile, s) == 1) {
+            service.submit(VerifyJob{s.id, s.claim, std::vector<uint8_t>(s.replay, s.replay + s.replayBytes), 0});
+            off += s.bytes;
+            ++jobs;
+        }
+        if (off != file.size()) log << n << ": stopped at byte " << off << " (bad or truncated submission)\n";
+    }
+    service.drain();
+    log.flush();
+    for (const std::string& n : names) unlink((dir + "/" + n).c_str());
+    return jobs;
+}
+
+// --------------------------- SOCKET ----------------------------
+// One thread polls every connection. A connection buffers at most one submission; when
+// the queue is full submit() blocks this thread, nothing more is read, and the clients
+// stall on full socket buffers.
+struct SocketServer {
+    std::mutex mtx;
+    std::map<uint64_t, int> fds;   // connection id -> fd, for the workers' replies
+
+    void reply(uint64_t conn, const std::string& line) {
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = fds.find(conn);
+        if (it != fds.end()) writeAll(it->second, (line + "\n").data(), line.size() + 1);
+    }
+
+    int run(const std::string& path, VerifyService& service, size_t maxReplay) {
+        int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (ls < 0 || path.size() >= sizeof(addr.sun_path)) { std::cerr << "cannot open socket " << path << "\n"; return 1; }
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        unlink(path.c_str());
+        if (bind(ls, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(ls, 64) != 0) { std::cerr << "cannot listen on " << path << "\n"; return 1; }
+        struct Conn { int fd; uint64_t id; std::vector<uint8_t> buf; };
+        std::vector<Conn> conns;
+        uint64_t nextId = 1;
+        std::vector<pollfd> pfds;
+        std::vector<uint8_t> chunk(65536);
+        for (;;) {
+            pfds.assign(1, pollfd{ls, POLLIN, 0});
+            for (const Conn& c : conns) pfds.push_back(pollfd{c.fd, POLLIN, 0});
+            if (poll(pfds.data(), pfds.size(), -1) < 0) continue;
+            if (pfds[0].revents & POLLIN) {
+                int fd = accept(ls, nullptr, nullptr);
+                if (fd >= 0) {
+                    conns.push_back(Conn{fd, nextId++, {}});
+                    std::lock_guard<std::mutex> lk(mtx);
+                    fds[conns.back().id] = fd;
+                }
+            }
+            for (size_t i = 1; i < pfds.size(); ++i) {
+                if (!pfds[i].revents) continue;
+                Conn& c = conns[i - 1];
+                ssize_t n = read(c.fd, chunk.data(), chunk.size());
+                bool bad = n <= 0;
+                if (n > 0) c.buf.insert(c.buf.end(), chunk.begin(), chunk.begin() + n);
+                size_t off = 0;
+                SubmissionView s;
+                int got;
+                while (!bad && (got = parseSubmission(c.buf.data() + off, c.buf.size() - off, maxReplay, s)) != 0) {
+                    if (got < 0) { reply(c.id, "- BAD_SUBMISSION"); bad = true; break; }
+                    service.submit(VerifyJob{s.id, s.claim, std::vector<uint8_t>(s.replay, s.replay + s.replayBytes), c.id});
+                    off += s.bytes;
+                }
+                c.buf.erase(c.buf.begin(), c.buf.begin() + (ptrdiff_t)off);
+                if (bad) {
+                    // verdicts still in flight for this connection are dropped
+                    { std::lock_guard<std::mutex> lk(mtx); fds.erase(c.id); }
+                    close(c.fd);
+                    c.fd = -1;
+                }
+            }
+            conns.erase(std::remove_if(conns.begin(), conns.end(), [](const Conn& c) { return c.fd < 0; }), conns.end());
+        }
+    }
+};
+
+int sendFiles(const std::string& path, const std::vector<std::string>& files) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (fd < 0 || path.size() >= sizeof(addr.sun_path)) { std::cerr << "cannot open socket\n"; return 1; }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) { std::cerr << "cannot connect to " << path << "\n"; return 1; }
+    // count the submissions first, so we know how many lines to wait for
+    std::vector<std::vector<uint8_t>> data(files.size());
+    size_t expected = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!readFile(files[i], data[i], 1u << 30)) { std::cerr << "cannot read " << files[i] << "\n"; return 1; }
+        SubmissionView s;
+        for (size_t off = 0; off < data[i].size() && parseSubmission(data[i].data() + off, data[i].size() - off, 1u << 30, s) == 1; off += s.bytes) ++expected;
+    }
+    std::thread writer([&] {
+        for (const auto& d : data) if (!writeAll(fd, (const char*)d.data(), d.size())) break;
+    });
+    std::string pending;
+    char buf[4096];
+    size_t lines = 0;
+    while (lines < expected) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] != '\n') { pending += buf[i]; continue; }
+            std::cout << pending << "\n";
+            pending.clear();
+            ++lines;
+        }
+    }
+    shutdown(fd, SHUT_RDWR);
+    writer.join();
+    close(fd);
+    return lines == expected ? 0 : 1;
+}
+
+// --------------------------- MAIN ----------------------------
+int main(int argc, char** argv) {
+    std::string keyPath, spool, socketPath, sendPath, samplesDir, outPath;
+    bool once = false, bench = false, check = false;
+    int threads = 0, count = 10000;
+    size_t queueJobs = 4096;
+    unsigned seed = 1;
+    VerifyLimits limits;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--key" && i + 1 < argc) keyPath = argv[++i];
+        else if (a == "--spool" && i + 1 < argc) spool = argv[++i];
+        else if (a == "--once") once = true;
+        else if (a == "--socket" && i + 1 < argc) socketPath = argv[++i];
+        else if (a == "--send" && i + 1 < argc) sendPath = argv[++i];
+        else if (a == "--samples" && i + 1 < argc) samplesDir = argv[++i];
+        else if (a == "--bench") bench = true;
+        else if (a == "--check") check = true;
+        else if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (a == "--queue" && i + 1 < argc) queueJobs = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (a == "--max-bytes" && i + 1 < argc) limits.maxBytes = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (a == "--count" && i + 1 < argc) count = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seed" && i + 1 < argc) seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--out" && i + 1 < argc) outPath = argv[++i];
+        else if (!sendPath.empty() && a[0] != '-') files.push_back(a);
+        else {
+            std::cerr << "usage: replay_verifier --key FILE (--spool DIR [--once] | --socket PATH | --bench | --check)\n"
+                         "                       [--threads N] [--queue N] [--max-bytes N] [--out FILE]\n"
+                         "       replay_verifier --send PATH FILE...\n"
+                         "       replay_verifier --samples DIR [--count N] [--seed S]\n";
+            return 1;
+        }
+    }
+    initPieces();
+
+    if (!sendPath.empty()) return sendFiles(sendPath, files);
+    if (!samplesDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(samplesDir, ec);
+        for (int n = 0; n < count; ++n) {
+            std::vector<uint8_t> s = sampleSubmission(n, seed + (unsigned)n);
+            std::ofstream f(samplesDir + "/sample-" + std::to_string(n) + ".tsub", std::ios::binary);
+            if (!f.write((const char*)s.data(), (std::streamsize)s.size())) { std::cerr << "cannot write to " << samplesDir << "\n"; return 1; }
+        }
+        std::cout << count << " submissions in " << samplesDir << "\n";
+        return 0;
+    }
+
+    std::vector<uint8_t> keyBytes;
+    if (keyPath.empty() || !readFile(keyPath, keyBytes, 4096) || keyBytes.empty()) { std::cerr << "need a signing key (--key FILE)\n"; return 1; }
+    std::string key(keyBytes.begin(), keyBytes.end());
+
+    if (check) {
+        int good = 0, bad = 0;
+        for (std::string line; std::getline(std::cin, line);) {
+            bool ok = checkVerdictLine(key, line);
+            (ok ? good : bad)++;
+            if (!ok) std::cout << "BAD SIGNATURE: " << line << "\n";
+        }
+        std::cout << good << " verdicts signed, " << bad << " not\n";
+        return bad ? 1 : 0;
+    }
+
+    // verification runs on the job workers; this thread reads the spool or the socket
+    jobThreads = threads;
+    jobMainParticipates = false;
+    std::ofstream outFile;
+    if (!outPath.empty()) {
+        outFile.open(outPath, std::ios::app);
+        if (!outFile) { std::cerr << "cannot write " << outPath << "\n"; return 1; }
+    }
+    std::ostream& log = outPath.empty() ? std::cout : outFile;
+    std::mutex logMtx;
+    SocketServer server;
+    long long counts[5] = {}, misjudged = 0;
+    VerifyService service(key, limits, threads, queueJobs, [&](const VerifyJob& job, const VerifyResult& r, const std::string& line) {
+        if (job.tag) server.reply(job.tag, line);
+        std::lock_guard<std::mutex> lk(logMtx);
+        ++counts[(int)r.verdict];
+        if (!bench) log << line << "\n";
+        if (job.tag) log.flush();   // socket verdicts are answered one by one; spool passes flush at the end
+        // samples: a quarter of the claims are false and a seventh of the replays damaged
+        int n = std::atoi(job.id.c_str() + 7);
+        if (bench && (r.verdict == Verdict::Ok) != (n % 4 != 3 && n % 7 != 6)) ++misjudged;
+    });
+    const size_t maxSubmission = SUBMISSION_HEADER_SIZE + SUBMISSION_MAX_ID + limits.maxBytes;
+
+    if (bench) {
+        std::vector<VerifyJob> jobs;
+        size_t bytes = 0;
+        for (int n = 0; n < count; ++n) {
+            std::vector<uint8_t> s = sampleSubmission(n, seed + (unsigned)n);
+            SubmissionView v;
+            parseSubmission(s.data(), s.size(), maxSubmission, v);
+            jobs.push_back(VerifyJob{v.id, v.claim, std::vector<uint8_t>(v.replay, v.replay + v.replayBytes), 0});
+            bytes += v.replayBytes;
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for (VerifyJob& j : jobs) service.submit(std::move(j));
+        service.drain();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << count << " submissions (" << bytes / std::max(1, count) << " bytes avg) on " << service.threadCount() << " threads in "
+                  << secs << " s: " << (long long)(count / secs) << " replays/s\n";
+        for (int v = 0; v < 5; ++v) std::cout << "  " << verdictName((Verdict)v) << " " << counts[v] << "\n";
+        if (misjudged) std::cout << "  " << misjudged << " MISJUDGED\n";
+        return misjudged ? 1 : 0;
+    }
+    if (!spool.empty()) {
+        for (;;) {
+            size_t n = spoolPass(spool, service, maxSubmission, log);
+            if (once) { std::cerr << n << " submissions verified\n"; return 0; }
+            if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!socketPath.empty()) return server.run(socketPath, service, limits.maxBytes);
+    std::cerr << "nothing to do: give --spool, --socket, --bench or --check\n";
+    return 1;
+}
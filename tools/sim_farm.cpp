@@ -0,0 +1,304 @@
+// sim_farm.cpp
+// Multi-process simulation farm (farm.h). The coordinator starts --workers copies of
+// this program, each pinned to a core or a NUMA node, and splits the job into tasks:
+//
+//   games    greedy bot games over a seed range, summed
+//   tune     cross-entropy tuning of the four heuristic weights: every generation
+//            samples --population weight vectors, plays each on the same --games
+//            seeds and moves the distribution toward the best quarter
+//   verify   the submissions of a .tsub archive (verify.h), counted per verdict
+//
+// A worker that dies mid-task, or is still on one after --task-timeout seconds, is
+// (killed and) restarted and the task runs again, so totals do not depend on crashes;
+// --chaos P makes workers kill themselves on a task with probability P to show it. A
+// task that cannot run, such as an archive the worker cannot open, fails the batch.
+//
+//   sim_farm games  [--seeds N] [--pieces N] [--chunk N] [common]
+//   sim_farm tune   [--generations N] [--population N] [--games N] [--pieces N] [common]
+//   sim_farm verify --archive FILE [--chunk N] [common]
+//   common: [--workers N] [--pin core|node|none] [--chaos P] [--task-timeout S] [--socket PATH]
+
+#include "bot_eval.h"
+#include "farm.h"
+#include "replay_files.h"
+#include "verify.h"
+
+#include <sched.h>
+#include <signal.h>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+// --------------------------- PINNING ----------------------------
+// "0-3,8-11" -> {0,1,2,3,8,9,10,11}
+std::vector<int> parseCpuList(const std::string& s) {
+    std::vector<int> cpus;
+    std::stringstream ss(s);
+    for (std::string part; std::getline(ss, part, ',');) {
+        int a = 0, b = -1;
+        if (std::sscanf(part.c_str(), "%d-%d", &a, &b) < 2) b = a;
+        for (int c = a; c <= b; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// Worker index -> the CPUs it may run on: one core each, or every core of one NUMA
+// node, round robin. Empty means no pinning.
+std::vector<int> workerCpus(const std::string& mode, int index) {
+#if defined(__linux__)
+    cpu_set_t set;
+    std::vector<int> online;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) online.push_back(c);
+    if (mode == "core" && !online.empty()) return {online[(size_t)index % online.size()]};
+    if (mode == "node") {
+        std::vector<std::vector<int>> nodes;
+        for (int n = 0;; ++n) {
+            std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+            std::string line;
+            if (!f || !std::getline(f, line)) break;
+            nodes.push_back(parseCpuList(line));
+        }
+        if (!nodes.empty()) return nodes[(size_t)index % nodes.size()];
+    }
+#else
+    (void)mode; (void)index;
+#endif
+    return {};
+}
+
+void pinTo(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpus;
+#endif
+}
+
+// --------------------------- TASKS ----------------------------
+// games, pieces, lines, topouts
+FarmResult playGames(const FarmTask& t) {
+    uint64_t v[4] = {};
+    for (uint64_t seed = t.begin; seed < t.end; ++seed) {
+        GameState g;
+        resetGame(g, (unsigned)seed);
+        uint32_t n = 0;
+        for (; n < t.maxPieces && !g.gameOver; ++n) {
+            BitBoard bb;
+            toBitBoard(g.board, bb);
+            Placement best{0, g.currentPos.x};
+            int bestScore = INT_MIN;
+            forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& after, int lines) {
+                BoardFeatures f;
+                extractFeatures(after, f);
+                int s = scoreFeatures(f, lines, t.weights);
+                if (s > bestScore) { bestScore = s; best = p; }
+            });
+            v[2] += (uint64_t)applyPlacement(g, best);
+        }
+        ++v[0];
+        v[1] += n;
+        v[3] += g.gameOver;
+    }
+    return FarmResult{t.id, {v, v + 4}, ""};
+}
+
+// one count per Verdict; starts at t.offset, where the coordinator found submission t.begin
+FarmResult verifyRange(const FarmTask& t) {
+    FarmResult r{t.id, std::vector<uint64_t>(5, 0), ""};
+    MappedFile mf;
+    if (!mapFile(t.path, mf)) { r.values.clear(); r.error = "cannot map " + t.path; return r; }
+    GameState g;
+    VerifyLimits limits;
+    SubmissionView s;
+    size_t off = t.offset;
+    for (uint64_t index = t.begin; index < t.end; ++index) {
+        if (off >= mf.size || parseSubmission(mf.data + off, mf.size - off, limits.maxBytes, s) != 1) {
+            r.values.clear();
+            r.error = t.path + ": no submission " + std::to_string(index) + " at offset " + std::to_string(off);
+            break;
+        }
+        ++r.values[(size_t)verifyReplay(s.replay, s.replayBytes, s.claim, limits, g).verdict];
+        off += s.bytes;
+    }
+    munmap((void*)mf.data, mf.size);
+    return r;
+}
+
+int runWorker(const std::string& socketPath, int index, const std::string& pin, double chaos) {
+    pinTo(workerCpus(pin, index));
+    std::mt19937 rng((unsigned)getpid());
+    return farmWorker(socketPath, (uint32_t)index, [&](const FarmTask& t) {
+        if (chaos > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < chaos) kill(getpid(), SIGKILL);
+        return t.kind == FARM_VERIFY ? verifyRange(t) : playGames(t);
+    });
+}
+
+// --------------------------- MAIN ----------------------------
+int main(int argc, char** argv) {
+    std::string mode = argc > 1 ? argv[1] : "", pin = "core", socketPath, archive;
+    int workers = 0, generations = 10, population = 24, games = 8, chunk = 0, workerIndex = -1;
+    uint64_t seeds = 2000;
+    uint32_t pieces = 500;
+    double chaos = 0.0, taskTimeout = 300.0;
+    for (int i = mode == "--worker" ? 1 : 2; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--worker" && i + 1 < argc) socketPath = argv[++i];
+        else if (a == "--id" && i + 1 < argc) workerIndex = std::atoi(argv[++i]);
+        else if (a == "--workers" && i + 1 < argc) workers = std::atoi(argv[++i]);
+        else if (a == "--pin" && i + 1 < argc) pin = argv[++i];
+        else if (a == "--chaos" && i + 1 < argc) chaos = std::atof(argv[++i]);
+        else if (a == "--task-timeout" && i + 1 < argc) taskTimeout = std::max(0.001, std::atof(argv[++i]));
+        else if (a == "--socket" && i + 1 < argc) socketPath = argv[++i];
+        else if (a == "--seeds" && i + 1 < argc) seeds = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--pieces" && i + 1 < argc) pieces = (uint32_t)std::max(1, std::atoi(argv[++i]));
+        else if (a == "--chunk" && i + 1 < argc) chunk = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--generations" && i + 1 < argc) generations = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--population" && i + 1 < argc) population = std::max(4, std::atoi(argv[++i]));
+        else if (a == "--games" && i + 1 < argc) games = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--archive" && i + 1 < argc) archive = argv[++i];
+        else { mode.clear(); break; }
+    }
+    initPieces();
+    if (mode == "--worker") return runWorker(socketPath, workerIndex, pin, chaos);
+    if (mode != "games" && mode != "tune" && mode != "verify") {
+        std::cerr << "usage: sim_farm games  [--seeds N] [--pieces N] [--chunk N] [common]\n"
+                     "       sim_farm tune   [--generations N] [--population N] [--games N] [--pieces N] [common]\n"
+                     "       sim_farm verify --archive FILE [--chunk N] [common]\n"
+                     "       common: [--workers N] [--pin core|node|none] [--chaos P] [--task-timeout S] [--socket PATH]\n";
+        return 1;
+    }
+    if (workers <= 0) workers = std::max(1, (int)std::thread::hardware_concurrency());
+    if (socketPath.empty()) socketPath = "/tmp/sim_farm." + std::to_string(getpid()) + ".sock";
+
+    FarmCoordinator farm;
+    farm.taskSeconds = taskTimeout;
+    if (!farm.listen(socketPath)) { std::cerr << "cannot listen on " << socketPath << "\n"; return 1; }
+    std::string self = argv[0];
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len > 0) self.assign(exe, (size_t)len);
+    farm.start(workers, [&](int index) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::string id = std::to_string(index), c = std::to_string(chaos);
+            const char* args[] = {self.c_str(), "--worker", socketPath.c_str(), "--id", id.c_str(), "--pin", pin.c_str(), "--chaos", c.c_str(), nullptr};
+            execv(self.c_str(), (char* const*)args);
+            _exit(127);
+        }
+        return pid;
+    });
+    auto t0 = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); };
+    std::vector<FarmTask> tasks;
+    uint32_t nextId = 1;
+
+    if (mode == "games") {
+        uint64_t step = chunk > 0 ? (uint64_t)chunk : std::max<uint64_t>(1, seeds / ((uint64_t)workers * 8));
+        for (uint64_t s = 0; s < seeds; s += step) {
+            FarmTask t;
+            t.id = nextId++;
+            t.kind = FARM_GAMES;
+            t.begin = 1 + s;
+            t.end = 1 + std::min(seeds, s + step);
+            t.maxPieces = pieces;
+            std::copy(HEURISTIC_WEIGHTS, HEURISTIC_WEIGHTS + 4, t.weights);
+            tasks.push_back(t);
+        }
+        uint64_t sum[4] = {};
+        bool ok = farm.run(tasks, [&](const FarmTask&, const FarmResult& r) {
+            for (size_t i = 0; i < 4 && i < r.values.size(); ++i) sum[i] += r.values[i];
+        });
+        double secs = elapsed();
+        std::cout << sum[0] << " games on " << workers << " workers (" << tasks.size() << " tasks) in " << secs << " s: "
+                  << (double)sum[1] / std::max<uint64_t>(1, sum[0]) << " pieces/game, " << (double)sum[2] / std::max<uint64_t>(1, sum[0])
+                  << " lines/game, " << sum[3] << " topouts, " << (long long)(sum[1] / secs) << " pieces/s, "
+                  << farm.crashes << " worker restarts, " << farm.timeouts << " timeouts\n";
+        if (!ok) std::cerr << "gave up: the workers kept dying\n";
+        return ok ? 0 : 1;
+    }
+
+    if (mode == "verify") {
+        // one pass over the archive here; each task starts at its first submission
+        MappedFile mf;
+        if (!mapFile(archive, mf)) { std::cerr << "cannot map " << archive << "\n"; return 1; }
+        uint64_t total = 0, step = chunk > 0 ? (uint64_t)chunk : 256;
+        SubmissionView s;
+        for (size_t off = 0; off < mf.size && parseSubmission(mf.data + off, mf.size - off, VerifyLimits().maxBytes, s) == 1; off += s.bytes) {
+            if (total % step == 0) {
+                FarmTask t;
+                t.id = nextId++;
+                t.kind = FARM_VERIFY;
+                t.begin = total;
+                t.offset = off;
+                t.path = archive;
+                tasks.push_back(t);
+            }
+            tasks.back().end = ++total;
+        }
+        munmap((void*)mf.data, mf.size);
+        uint64_t counts[5] = {};
+        std::string firstError;
+        bool ok = farm.run(tasks, [&](const FarmTask&, const FarmResult& r) {
+            if (!r.error.empty() && firstError.empty()) firstError = r.error;
+            for (size_t i = 0; i < 5 && i < r.values.size(); ++i) counts[i] += r.values[i];
+        });
+        double secs = elapsed();
+        std::cout << total << " submissions on " << workers << " workers in " << secs << " s: " << (long long)(total / secs)
+                  << " replays/s, " << farm.crashes << " worker restarts, " << farm.timeouts << " timeouts\n";
+        for (int v = 0; v < 5; ++v) std::cout << "  " << verdictName((Verdict)v) << " " << counts[v] << "\n";
+        if (!ok) std::cerr << "gave up: the workers kept dying\n";
+        if (farm.failed) std::cerr << farm.failed << " of " << tasks.size() << " tasks failed, first: " << firstError << "\n";
+        return ok && !farm.failed ? 0 : 1;
+    }
+
+    // tune: cross-entropy method over the four weights
+    double mean[4], sigma[4] = {30, 30, 30, 30};
+    for (int i = 0; i < 4; ++i) mean[i] = HEURISTIC_WEIGHTS[i] * 0.5;
+    std::mt19937 rng(1);
+    for (int gen = 0; gen < generations; ++gen) {
+        tasks.clear();
+        for (int k = 0; k < population; ++k) {
+            FarmTask t;
+            t.id = nextId++;
+            t.kind = FARM_GAMES;
+            t.begin = 1 + (uint64_t)gen * (uint64_t)games;
+            t.end = t.begin + (uint64_t)games;
+            t.maxPieces = pieces;
+            for (int i = 0; i < 4; ++i) t.weights[i] = (int32_t)std::lround(std::normal_distribution<double>(mean[i], sigma[i])(rng));
+            tasks.push_back(t);
+        }
+        std::vector<std::pair<uint64_t, const FarmTask*>> scored;
+        std::vector<uint64_t> lines(nextId, 0);
+        if (!farm.run(tasks, [&](const FarmTask& t, const FarmResult& r) { if (r.values.size() > 2) lines[t.id] = r.values[2]; })) {
+            std::cerr << "gave up: the workers kept dying\n";
+            return 1;
+        }
+        for (const FarmTask& t : tasks) scored.push_back({lines[t.id], &t});
+        std::sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        int elite = std::max(2, population / 4);
+        for (int i = 0; i < 4; ++i) {
+            double m = 0, var = 0;
+            for (int e = 0; e < elite; ++e) m += scored[(size_t)e].second->weights[i];
+            m /= elite;
+            for (int e = 0; e < elite; ++e) var += (scored[(size_t)e].second->weights[i] - m) * (scored[(size_t)e].second->weights[i] - m);
+            mean[i] = m;
+            sigma[i] = std::sqrt(var / elite) + 2.0;   // a floor keeps the search from collapsing early
+        }
+        const FarmTask& best = *scored[0].second;
+        std::cout << "generation " << gen << ": best " << (double)scored[0].first / games << " lines/game with {" << best.weights[0] << ", "
+                  << best.weights[1] << ", " << best.weights[2] << ", " << best.weights[3] << "}, mean {" << std::lround(mean[0]) << ", "
+                  << std::lround(mean[1]) << ", " << std::lround(mean[2]) << ", " << std::lround(mean[3]) << "} ("
+                  << elapsed() << " s, " << farm.crashes << " restarts)" << std::endl;
+    }
+    return 0;
+}
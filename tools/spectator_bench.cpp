@@ -0,0 +1,100 @@
+// spectator_bench.cpp
+// Runs a SpectatorServer (spectator.h) on loopback with thousands of watching clients
+// in the same process. The server publishes a two-player game of random inputs at the
+// given rate; client threads poll their sockets. Afterwards every client must hold the
+// server's final state. Reports bandwidth per client and the server's send cost.
+//
+//   spectator_bench [--clients N] [--seconds S] [--hz HZ] [--loss PERCENT] [--threads N]
+
+#include "spectator.h"
+#include "rollback.h"
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+int main(int argc, char** argv) {
+    int clientCount = 2000, hz = 60, threads = 4;
+    double seconds = 5.0, lossPercent = 5.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--clients" && i + 1 < argc) clientCount = std::atoi(argv[++i]);
+        else if (a == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (a == "--hz" && i + 1 < argc) hz = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--loss" && i + 1 < argc) lossPercent = std::atof(argv[++i]);
+        else if (a == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else { std::cerr << "usage: spectator_bench [--clients N] [--seconds S] [--hz HZ] [--loss PERCENT] [--threads N]\n"; return 1; }
+    }
+    initPieces();
+
+    // one socket per client
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < (rlim_t)clientCount + 64) {
+        lim.rlim_cur = std::min<rlim_t>(lim.rlim_max, (rlim_t)clientCount + 64);
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    SpectatorServer server;
+    if (!server.start(0)) { std::cerr << "cannot open the server socket\n"; return 1; }
+    std::vector<std::unique_ptr<SpectatorClient>> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        clients.emplace_back(new SpectatorClient());
+        if (!clients.back()->connect("127.0.0.1", server.port())) { std::cerr << "cannot open client socket " << i << "\n"; return 1; }
+        clients.back()->simulatedLoss = lossPercent / 100.0;
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> pollers;
+    for (int t = 0; t < threads; ++t)
+        pollers.emplace_back([&, t]{
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (size_t i = (size_t)t; i < clients.size(); i += (size_t)threads) clients[i]->poll();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+    // random two-player game; both players mash keys
+    VersusSim sim;
+    sim.reset(77);
+    std::mt19937 rng(77);
+    const GameState* games[2] = {&sim.players[0], &sim.players[1]};
+    int frames = (int)(seconds * hz);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) {
+        uint8_t in[2];
+        for (auto& b : in) b = rng() % 5 ? 0 : netInputBit((GameAction)(rng() % (ACT_HARD_DROP + 1)));
+        sim.step(in);
+        if (sim.over) sim.reset(rng());
+        server.submit(games, 2);
+        std::this_thread::sleep_until(t0 + std::chrono::microseconds((long long)(f + 1) * 1000000 / hz));
+    }
+    // let everyone catch up, then stop
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    stop = true;
+    for (auto& th : pollers) th.join();
+    server.stop();
+
+    int synced = 0;
+    uint64_t received = 0;
+    for (const auto& c : clients) {
+        received += c->bytesReceived();
+        if (!c->hasState() || c->frame() + 1 != server.frameCount()) continue;
+        const SpectatorFrame& a = c->state();
+        const SpectatorFrame& b = server.latest();
+        bool same = a.count == b.count;
+        for (int g = 0; g < a.count && same; ++g) same = a.games[g] == b.games[g];
+        synced += same;
+    }
+
+    const SpectatorServerStats& st = server.stats();
+    std::cout << clientCount << " clients, " << st.frames << " frames: " << synced << " in sync at the end\n"
+              << "encoded " << (double)st.encodedBytes / std::max<uint64_t>(1, st.frames) << " B/frame (full state "
+              << (double)st.keyframeBytes / std::max<uint64_t>(1, (st.frames + SPECTATE_KEYFRAME_INTERVAL - 1) / SPECTATE_KEYFRAME_INTERVAL) << " B)\n"
+              << "sent " << st.datagrams << " datagrams, " << st.bytesSent / 1024.0 << " KB ("
+              << (double)st.bytesSent / clientCount / seconds << " B/s per client), " << st.fullStatesSent << " full states; received "
+              << received / 1024.0 << " KB\n"
+              << "server pump avg " << st.pumpSeconds / std::max<uint64_t>(1, st.pumps) * 1000.0 << " ms, max " << st.maxPumpSeconds * 1000.0 << " ms\n";
+    return synced == clientCount ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+// td_train.cpp
+// Self-play TD trainer (td_learn.h): every thread plays games and updates one shared
+// weight vector. At every checkpoint the weights are written as a network file (to a
+// temporary name, then renamed, so a reader never sees half a file) and the network
+// plays a few seeded games to show how far it has come.
+//
+//   td_train [--out file] [--threads N] [--seconds S] [--checkpoint S] [--alpha A]
+//            [--gamma G] [--survival R] [--epsilon E] [--eval-games N] [--eval-pieces N] [--seed S]
+
+#include "td_learn.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// Lines per game of the network playing greedily on fixed seeds.
+double evalNetwork(const NnEval& net, int games, int maxPieces) {
+    long long lines = 0;
+    BitBoard after[MAX_PLACEMENTS];
+    Placement placements[MAX_PLACEMENTS];
+    int cleared[MAX_PLACEMENTS], scores[MAX_PLACEMENTS];
+    for (int game = 0; game < games; ++game) {
+        GameState g;
+        resetGame(g, 1000u + (unsigned)game);
+        for (int n = 0; n < maxPieces && !g.gameOver; ++n) {
+            BitBoard bb;
+            toBitBoard(g.board, bb);
+            int count = 0;
+            forEachPlacement(bb, g.currentPieceIndex, [&](const Placement& p, const BitBoard& b, int l) {
+                placements[count] = p; after[count] = b; cleared[count] = l; ++count;
+            });
+            if (count == 0) break;
+            nnEvaluateBoards(net, after, cleared, count, scores);
+            int best = 0;
+            for (int i = 1; i < count; ++i) if (scores[i] > scores[best]) best = i;
+            lines += applyPlacement(g, placements[best]);
+        }
+    }
+    return (double)lines / games;
+}
+
+int main(int argc, char** argv) {
+    TdConfig cfg;
+    std::string out = "td.tnne";
+    int threads = 0, evalGames = 5, evalPieces = 2000;
+    double seconds = 300.0, every = 30.0;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--out" && i + 1 < argc) out = argv[++i];
+        else if (a == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (a == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (a == "--checkpoint" && i + 1 < argc) every = std::max(0.1, std::atof(argv[++i]));
+        else if (a == "--alpha" && i + 1 < argc) cfg.alpha = (float)std::atof(argv[++i]);
+        else if (a == "--gamma" && i + 1 < argc) cfg.gamma = (float)std::atof(argv[++i]);
+        else if (a == "--survival" && i + 1 < argc) cfg.survival = (float)std::atof(argv[++i]);
+        else if (a == "--epsilon" && i + 1 < argc) cfg.epsilon = (float)std::atof(argv[++i]);
+        else if (a == "--eval-games" && i + 1 < argc) evalGames = std::max(0, std::atoi(argv[++i]));
+        else if (a == "--eval-pieces" && i + 1 < argc) evalPieces = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "usage: td_train [--out file] [--threads N] [--seconds S] [--checkpoint S] [--alpha A]\n"
+                         "                [--gamma G] [--survival R] [--epsilon E] [--eval-games N] [--eval-pieces N] [--seed S]\n";
+            return 1;
+        }
+    }
+    // the learners are background jobs; this thread just sleeps between checkpoints
+    jobThreads = threads;
+    jobMainParticipates = false;
+    initPieces();
+
+    bool written = true;
+    std::vector<float> weights;
+    auto checkpoint = [&](const std::vector<float>& w, const TdStats& st) {
+        NnEval net = tdNetwork(w.data());
+        std::string tmp = out + ".tmp";
+        written = saveNnEval(tmp, net) && std::rename(tmp.c_str(), out.c_str()) == 0;
+        std::cout << (int)st.seconds << " s: " << st.games << " games, " << (long long)(st.pieces / std::max(st.seconds, 1e-9))
+                  << " pieces/s, " << (double)st.lines / std::max(1LL, st.games) << " lines/game in training";
+        if (evalGames) std::cout << ", eval " << evalNetwork(net, evalGames, evalPieces) << " lines/game";
+        std::cout << (written ? "" : ", CANNOT WRITE " + out) << std::endl;
+    };
+    TdStats st = trainTd(cfg, weights, threads, seconds, every, seed, checkpoint);
+
+    std::cout << "weights:";
+    for (float v : weights) std::cout << " " << v;
+    std::cout << "\n" << st.pieces << " pieces in " << st.seconds << " s -> " << out << "\n";
+    return written ? 0 : 1;
+}